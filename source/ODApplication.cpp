@@ -22,28 +22,31 @@
 #include "ODApplication.h"
 
 #include "network/ODServer.h"
-#include "network/ODClient.h"
 #include "network/ServerMode.h"
-#include "sound/MusicPlayer.h"
-#include "sound/SoundEffectsManager.h"
-#include "render/Gui.h"
-#include "render/ODFrameListener.h"
-#include "render/TextRenderer.h"
 #include "utils/ConfigManager.h"
 #include "utils/LogManager.h"
 #include "utils/LogSinkConsole.h"
 #include "utils/LogSinkFile.h"
-#include "utils/LogSinkOgre.h"
 #include "utils/Random.h"
 #include "utils/ResourceManager.h"
 
+#ifndef OD_HEADLESS_SERVER
+#include "network/ODClient.h"
+#include "sound/MusicPlayer.h"
+#include "sound/SoundEffectsManager.h"
+#include "render/Gui.h"
+#include "render/ODFrameListener.h"
+#include "render/TextRenderer.h"
+#include "utils/LogSinkOgre.h"
+
 #include <OgreErrorDialog.h>
 #include <OgreRenderWindow.h>
 #include <OgreRoot.h>
 #include <Overlay/OgreOverlaySystem.h>
 #include <RTShaderSystem/OgreShaderGenerator.h>
+#endif
 
-#ifdef OD_USE_SFML_WINDOW
+#if defined(OD_USE_SFML_WINDOW) && !defined(OD_HEADLESS_SERVER)
 #include "modes/ModeManager.h"
 
 #include <SFML/Window.hpp>
@@ -71,10 +74,21 @@ void ODApplication::startGame(boost::program_options::variables_map& options)
     logMgr.addSink(std::unique_ptr<LogSink>(new LogSinkConsole()));
     logMgr.addSink(std::unique_ptr<LogSink>(new LogSinkFile(resMgr.getLogFile())));
 
+#ifdef OD_HEADLESS_SERVER
+    // The dedicated server has no window. It can only host the level given on the command line
+    if(!resMgr.isServerMode())
+    {
+        OD_LOG_ERR("No level given. The dedicated server should be launched with --server, --servercustom or --serversave");
+        return;
+    }
+
+    startServer();
+#else
     if(resMgr.isServerMode())
         startServer();
     else
         startClient();
+#endif
 }
 
 void ODApplication::startServer()
@@ -106,6 +120,7 @@ void ODApplication::startServer()
     server.stopServer();
 }
 
+#ifndef OD_HEADLESS_SERVER
 void ODApplication::startClient()
 {
     ResourceManager& resMgr = ResourceManager::getSingleton();
@@ -271,6 +286,7 @@ void ODApplication::startClient()
     Ogre::RTShader::ShaderGenerator::destroy();
     ogreRoot.destroyRenderTarget(renderWindow);
 }
+#endif
 
 //TODO: find some better places for some of these
 double ODApplication::turnsPerSecond = 1.4;
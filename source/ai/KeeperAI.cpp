@@ -31,6 +31,7 @@
 #include "spells/SpellSummonWorker.h"
 #include "utils/Helper.h"
 #include "utils/LogManager.h"
+#include "utils/Profiler.h"
 #include "utils/Random.h"
 
 #include <vector>
@@ -75,6 +76,7 @@ KeeperAI::KeeperAI(GameMap& gameMap, Player& player, int cooldownDefenseMin, int
 
 bool KeeperAI::doTurn(double timeSinceLastTurn)
 {
+    OD_PROFILE_ZONE("KeeperAI::doTurn");
     // If we have no dungeon temple, we are dead
     if(getDungeonTemple() == nullptr)
         return false;
@@ -0,0 +1,86 @@
+/*
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "benchmark/AllocationCounter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<uint64_t> gNbAllocations(0);
+static std::atomic<uint64_t> gNbBytes(0);
+
+static void* countedAlloc(std::size_t size)
+{
+    gNbAllocations.fetch_add(1, std::memory_order_relaxed);
+    gNbBytes.fetch_add(size, std::memory_order_relaxed);
+
+    // malloc(0) may return nullptr while new should return a valid pointer
+    if(size == 0)
+        size = 1;
+
+    void* ptr = std::malloc(size);
+    if(ptr == nullptr)
+        throw std::bad_alloc();
+
+    return ptr;
+}
+
+void* operator new(std::size_t size)
+{
+    return countedAlloc(size);
+}
+
+void* operator new[](std::size_t size)
+{
+    return countedAlloc(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+namespace AllocationCounter
+{
+
+uint64_t getNbAllocations()
+{
+    return gNbAllocations.load(std::memory_order_relaxed);
+}
+
+uint64_t getNbBytes()
+{
+    return gNbBytes.load(std::memory_order_relaxed);
+}
+
+} // namespace AllocationCounter
@@ -0,0 +1,35 @@
+/*
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ALLOCATIONCOUNTER_H
+#define ALLOCATIONCOUNTER_H
+
+#include <cstdint>
+
+//! \brief Counts the memory allocations done by the whole process (every thread) through the
+//! global operator new. The counting operators are replaced in AllocationCounter.cpp so they are
+//! only active in the executables linking it (the benchmark)
+namespace AllocationCounter
+{
+    //! \brief Number of allocations since the process started
+    uint64_t getNbAllocations();
+
+    //! \brief Number of bytes allocated since the process started (freed memory is not subtracted)
+    uint64_t getNbBytes();
+}
+
+#endif // ALLOCATIONCOUNTER_H
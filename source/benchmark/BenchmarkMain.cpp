@@ -0,0 +1,177 @@
+/*
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "benchmark/MicroBenchmarks.h"
+#include "benchmark/SimulationBenchmark.h"
+#include "network/ODServer.h"
+#include "utils/ConfigManager.h"
+#include "utils/LogManager.h"
+#include "utils/LogSinkConsole.h"
+#include "utils/Profiler.h"
+#include "utils/Random.h"
+#include "utils/ResourceManager.h"
+#include "utils/StackTracePrint.h"
+
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+
+#include <fstream>
+#include <iostream>
+
+//! \brief Seed used when none is given on the command line so that two runs simulate the same game
+static const uint64_t DEFAULT_BENCHMARK_SEED = 1;
+
+static const uint32_t DEFAULT_BENCHMARK_TURNS = 500;
+static const uint32_t DEFAULT_BENCHMARK_ITERATIONS = 1000;
+
+//! \brief Returns the path of the given level. It can be a path or the name of an official
+//! level (with or without extension). Returns an empty string if not found
+static std::string findLevel(const ResourceManager& resMgr, const std::string& level)
+{
+    std::vector<std::string> candidates = {
+        level,
+        resMgr.getGameLevelPathMultiplayer() + level,
+        resMgr.getGameLevelPathSkirmish() + level
+    };
+    for(const std::string& candidate : candidates)
+    {
+        if(boost::filesystem::is_regular_file(candidate))
+            return candidate;
+
+        if(boost::filesystem::is_regular_file(candidate + ".level"))
+            return candidate + ".level";
+    }
+
+    return std::string();
+}
+
+int main(int argc, char** argv)
+{
+    // To log segfaults
+    StackTracePrint trace("crash.log");
+
+    boost::program_options::options_description desc("Allowed options");
+    desc.add_options()
+        ("help", "produce help message")
+        ("level", boost::program_options::value<std::vector<std::string>>()->composing(),
+            "Level to simulate (path or official level name). Can be given several times. Defaults to TestBigMap and RuinsOfTheConfluent")
+        ("turns", boost::program_options::value<uint32_t>()->default_value(DEFAULT_BENCHMARK_TURNS), "Number of turns simulated per level")
+        ("iterations", boost::program_options::value<uint32_t>()->default_value(DEFAULT_BENCHMARK_ITERATIONS), "Number of iterations of the micro benchmarks")
+        ("nomicro", "Do not run the micro benchmarks")
+        ("output", boost::program_options::value<std::string>(), "Writes the results as JSON to the given file")
+        ("trace", boost::program_options::value<std::string>(), "Writes the profiler zones of the simulated turns to the given Chrome trace file")
+    ;
+    ResourceManager::buildCommandOptions(desc);
+
+    boost::program_options::variables_map options;
+    try
+    {
+        boost::program_options::store(boost::program_options::command_line_parser(argc, argv).options(desc).run(), options);
+        boost::program_options::notify(options);
+    }
+    catch(const boost::program_options::error& e)
+    {
+        std::cerr << e.what() << "\n" << desc << "\n";
+        return 1;
+    }
+
+    if (options.count("help"))
+    {
+        std::cout << desc << "\n";
+        return 0;
+    }
+
+    ResourceManager resMgr(options);
+
+    // By default, only warnings are logged so that the logs do not weigh on the measures
+    LogManager logMgr;
+    logMgr.setLevel(options.count("loglevel") ? resMgr.getLogLevel() : LogMessageLevel::WARNING);
+    logMgr.addSink(std::unique_ptr<LogSink>(new LogSinkConsole()));
+
+    uint64_t seed = resMgr.getForcedRandomSeed();
+    if(seed == 0)
+        seed = DEFAULT_BENCHMARK_SEED;
+
+    Random::initialize(seed);
+    ConfigManager configManager(resMgr.getConfigPath(), "", resMgr.getSoundPath());
+
+    std::vector<std::string> levels;
+    if(options.count("level"))
+        levels = options["level"].as<std::vector<std::string>>();
+    else
+        levels = { "TestBigMap.level", "RuinsOfTheConfluent.level" };
+
+    uint32_t nbTurns = options["turns"].as<uint32_t>();
+    uint32_t nbIterations = options["iterations"].as<uint32_t>();
+    bool runMicro = (options.count("nomicro") == 0);
+
+    if(options.count("trace"))
+    {
+        Profiler::setEnabled(true);
+        if(!Profiler::startTrace(options["trace"].as<std::string>()))
+            return 1;
+    }
+
+    bool isOk = true;
+    std::vector<LevelBenchmarkResult> levelResults;
+    std::vector<MicroBenchmarkResult> microResults;
+    ODServer server;
+    for(const std::string& level : levels)
+    {
+        std::string levelPath = findLevel(resMgr, level);
+        if(levelPath.empty())
+        {
+            OD_LOG_ERR("Level not found: " + level);
+            isOk = false;
+            continue;
+        }
+
+        LevelBenchmarkResult result;
+        if(!SimulationBenchmark::runLevel(server, levelPath, seed, nbTurns, result))
+        {
+            OD_LOG_ERR("Could not simulate level: " + levelPath);
+            isOk = false;
+            continue;
+        }
+
+        result.mLevel = level;
+        levelResults.push_back(result);
+
+        if(runMicro)
+            MicroBenchmarks::run(*server.getGameMap(), level, nbIterations, seed, microResults);
+
+        server.stopServer();
+    }
+
+    Profiler::stopTrace();
+
+    SimulationBenchmark::writeSummary(std::cout, levelResults, microResults);
+    if(options.count("output"))
+    {
+        const std::string& outputFile = options["output"].as<std::string>();
+        std::ofstream output(outputFile.c_str());
+        if(!output.is_open())
+        {
+            OD_LOG_ERR("Cannot open output file " + outputFile);
+            return 1;
+        }
+
+        SimulationBenchmark::writeJson(output, levelResults, microResults);
+    }
+
+    return isOk ? 0 : 1;
+}
@@ -0,0 +1,171 @@
+/*
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "benchmark/MicroBenchmarks.h"
+
+#include "benchmark/AllocationCounter.h"
+#include "benchmark/SimulationBenchmark.h"
+#include "entities/Creature.h"
+#include "entities/CreatureDefinition.h"
+#include "entities/Tile.h"
+#include "gamemap/GameMap.h"
+#include "network/ODPacket.h"
+#include "utils/LogManager.h"
+#include "utils/Random.h"
+
+#include <algorithm>
+#include <chrono>
+
+//! \brief Radius used by the visibleTiles benchmark when the gamemap has no creature
+static const int DEFAULT_VISIBLE_TILES_RADIUS = 10;
+
+//! \brief enableFloodFill processes the whole map. It is run less often than the other benchmarks
+static const uint32_t FLOODFILL_ITERATIONS_DIVIDER = 100;
+
+//! \brief Calls func(iteration) nbIterations times and stores the mean time and allocations per call
+template<typename Func>
+static void measure(const std::string& name, const std::string& level, uint32_t nbIterations, Func func,
+    std::vector<MicroBenchmarkResult>& results)
+{
+    if(nbIterations == 0)
+        return;
+
+    uint64_t nbAllocationsStart = AllocationCounter::getNbAllocations();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for(uint32_t iteration = 0; iteration < nbIterations; ++iteration)
+        func(iteration);
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    uint64_t nbAllocations = AllocationCounter::getNbAllocations() - nbAllocationsStart;
+
+    MicroBenchmarkResult result;
+    result.mName = name;
+    result.mLevel = level;
+    result.mNbIterations = nbIterations;
+    result.mNsPerIteration = std::chrono::duration<double, std::nano>(end - start).count() / nbIterations;
+    result.mAllocationsPerIteration = static_cast<double>(nbAllocations) / nbIterations;
+    results.push_back(result);
+}
+
+//! \brief Returns nbTiles tiles drawn from the gamemap. If onlyNotFull is true, full tiles are skipped
+static std::vector<Tile*> drawTiles(GameMap& gameMap, RandomStream& random, uint32_t nbTiles, bool onlyNotFull)
+{
+    std::vector<Tile*> candidates;
+    for(int jj = 0; jj < gameMap.getMapSizeY(); ++jj)
+    {
+        for(int ii = 0; ii < gameMap.getMapSizeX(); ++ii)
+        {
+            Tile* tile = gameMap.getTile(ii, jj);
+            if(onlyNotFull && tile->isFullTile())
+                continue;
+
+            candidates.push_back(tile);
+        }
+    }
+
+    std::vector<Tile*> tiles;
+    if(candidates.empty())
+        return tiles;
+
+    tiles.reserve(nbTiles);
+    for(uint32_t i = 0; i < nbTiles; ++i)
+        tiles.push_back(candidates[random.Uint(0, static_cast<unsigned int>(candidates.size() - 1))]);
+
+    return tiles;
+}
+
+namespace MicroBenchmarks
+{
+
+void run(GameMap& gameMap, const std::string& level, uint32_t nbIterations, uint64_t randomSeed,
+    std::vector<MicroBenchmarkResult>& results)
+{
+    RandomStream random(randomSeed);
+
+    std::vector<Creature*> creatures;
+    int maxSightRadius = 0;
+    for(Creature* creature : gameMap.getCreatures())
+    {
+        if(creature->getPositionTile() == nullptr)
+            continue;
+
+        creatures.push_back(creature);
+        maxSightRadius = std::max(maxSightRadius, creature->getDefinition()->getSightRadius());
+    }
+
+    // Paths from the creatures to random walkable tiles. As there are as many destinations as
+    // iterations, most searches are not answered by the paths cache
+    if(creatures.empty())
+    {
+        OD_LOG_WRN("No creature on " + level + ", GameMap::path is not measured");
+    }
+    else
+    {
+        std::vector<Tile*> destinations = drawTiles(gameMap, random, nbIterations, true);
+        if(!destinations.empty())
+        {
+            measure("GameMap::path", level, nbIterations, [&](uint32_t iteration)
+            {
+                Creature* creature = creatures[iteration % creatures.size()];
+                gameMap.path(creature, destinations[iteration]);
+            }, results);
+        }
+    }
+
+    uint32_t nbFloodFillIterations = std::max(1u, nbIterations / FLOODFILL_ITERATIONS_DIVIDER);
+    measure("GameMap::enableFloodFill", level, nbFloodFillIterations, [&](uint32_t)
+    {
+        gameMap.enableFloodFill();
+    }, results);
+
+    int radius = (maxSightRadius > 0) ? maxSightRadius : DEFAULT_VISIBLE_TILES_RADIUS;
+    gameMap.prepareRegionRadius(radius);
+    std::vector<Tile*> centers = drawTiles(gameMap, random, nbIterations, false);
+    std::vector<Tile*> visibleTiles;
+    if(!centers.empty())
+    {
+        measure("TileContainer::visibleTiles", level, nbIterations, [&](uint32_t iteration)
+        {
+            Tile* center = centers[iteration];
+            gameMap.visibleTiles(center->getX(), center->getY(), radius, visibleTiles);
+        }, results);
+    }
+
+    // Creatures are the entities the most often sent to the clients
+    if(!creatures.empty())
+    {
+        measure("ODPacket/creatureUpdate", level, nbIterations, [&](uint32_t iteration)
+        {
+            Creature* creature = creatures[iteration % creatures.size()];
+            ODPacket packet;
+            creature->exportToPacketForUpdate(packet, creature->getSeat());
+        }, results);
+    }
+
+    measure("ODPacket/roundTrip", level, nbIterations, [&](uint32_t iteration)
+    {
+        ODPacket packet;
+        int32_t valueInt = static_cast<int32_t>(iteration);
+        uint64_t valueUint = random.next();
+        double valueDouble = static_cast<double>(iteration) * 0.5;
+        std::string valueString = "Creature_Name";
+        Ogre::Vector3 valueVector(1.0f, 2.0f, 3.0f);
+        packet << valueInt << valueUint << valueDouble << valueString << valueVector;
+        packet >> valueInt >> valueUint >> valueDouble >> valueString >> valueVector;
+    }, results);
+}
+
+} // namespace MicroBenchmarks
@@ -0,0 +1,38 @@
+/*
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MICROBENCHMARKS_H
+#define MICROBENCHMARKS_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class GameMap;
+struct MicroBenchmarkResult;
+
+//! \brief Measures separately the functions taking most of the turns time
+namespace MicroBenchmarks
+{
+    //! \brief Runs the micro benchmarks on the given gamemap. It should be a running game (with creatures)
+    //! because paths are computed for its creatures. Some benchmarks recompute data of the gamemap (like the
+    //! floodfill) so it should not be used to run turns afterwards. Inputs are drawn from randomSeed
+    void run(GameMap& gameMap, const std::string& level, uint32_t nbIterations, uint64_t randomSeed,
+        std::vector<MicroBenchmarkResult>& results);
+}
+
+#endif // MICROBENCHMARKS_H
@@ -0,0 +1,225 @@
+/*
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "benchmark/SimulationBenchmark.h"
+
+#include "benchmark/AllocationCounter.h"
+#include "gamemap/GameMap.h"
+#include "network/ODServer.h"
+#include "utils/Random.h"
+#include "ODApplication.h"
+
+#include <OgrePlatform.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+//! \brief Escapes the characters that cannot be written as they are in a JSON string
+static std::string jsonEscape(const std::string& str)
+{
+    std::string escaped;
+    escaped.reserve(str.size());
+    for(char c : str)
+    {
+        if((c == '"') || (c == '\\'))
+            escaped += '\\';
+
+        escaped += c;
+    }
+    return escaped;
+}
+
+//! \brief Sample at the given percentile (nearest rank) of the sorted samples
+static double getPercentile(const std::vector<double>& sortedSamples, double percentile)
+{
+    if(sortedSamples.empty())
+        return 0.0;
+
+    size_t rank = static_cast<size_t>(std::ceil(percentile / 100.0 * static_cast<double>(sortedSamples.size())));
+    if(rank > 0)
+        --rank;
+
+    return sortedSamples[std::min(rank, sortedSamples.size() - 1)];
+}
+
+static void writeTimesJson(std::ostream& os, const BenchmarkTimes& times)
+{
+    os << "{\"mean\":" << times.mMean
+       << ",\"p50\":" << times.mP50
+       << ",\"p90\":" << times.mP90
+       << ",\"p99\":" << times.mP99
+       << ",\"max\":" << times.mMax << "}";
+}
+
+namespace SimulationBenchmark
+{
+
+bool runLevel(ODServer& server, const std::string& levelPath, uint64_t randomSeed, uint32_t nbTurns,
+    LevelBenchmarkResult& result)
+{
+    if(!server.startOfflineGame(levelPath, randomSeed))
+        return false;
+
+    GameMap* gameMap = server.getGameMap();
+    Random::ScopedStream randomStream(gameMap->getRandom());
+
+    // Turns are simulated as if they lasted their normal length
+    double timeSinceLastTurn = 1.0 / ODApplication::turnsPerSecond;
+
+    std::vector<double> turnTimes;
+    turnTimes.reserve(nbTurns);
+    unsigned int nbPathCallsStart = gameMap->getNumCallsToPath();
+    uint64_t nbAllocationsStart = AllocationCounter::getNbAllocations();
+    uint64_t nbBytesStart = AllocationCounter::getNbBytes();
+    for(uint32_t turn = 0; turn < nbTurns; ++turn)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        server.doOfflineTurn(timeSinceLastTurn);
+        std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+        turnTimes.push_back(std::chrono::duration<double, std::micro>(end - start).count());
+    }
+
+    result.mLevel = levelPath;
+    result.mRandomSeed = randomSeed;
+    result.mNbTurns = nbTurns;
+    result.mTurnTimes = computeTimes(turnTimes);
+    result.mNbPathCalls = gameMap->getNumCallsToPath() - nbPathCallsStart;
+    result.mNbAllocations = AllocationCounter::getNbAllocations() - nbAllocationsStart;
+    result.mNbAllocatedBytes = AllocationCounter::getNbBytes() - nbBytesStart;
+    result.mNbCreatures = gameMap->getCreatures().size();
+    result.mPeakRssKb = getPeakRssKb();
+    return true;
+}
+
+BenchmarkTimes computeTimes(std::vector<double> samples)
+{
+    BenchmarkTimes times;
+    if(samples.empty())
+        return times;
+
+    std::sort(samples.begin(), samples.end());
+    double total = 0.0;
+    for(double sample : samples)
+        total += sample;
+
+    times.mMean = total / static_cast<double>(samples.size());
+    times.mP50 = getPercentile(samples, 50.0);
+    times.mP90 = getPercentile(samples, 90.0);
+    times.mP99 = getPercentile(samples, 99.0);
+    times.mMax = samples.back();
+    return times;
+}
+
+uint64_t getPeakRssKb()
+{
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if(!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return 0;
+
+    return static_cast<uint64_t>(counters.PeakWorkingSetSize) / 1024;
+#else
+    struct rusage usage;
+    if(getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+
+#if OGRE_PLATFORM == OGRE_PLATFORM_APPLE
+    // On OSX, ru_maxrss is in bytes
+    return static_cast<uint64_t>(usage.ru_maxrss) / 1024;
+#else
+    return static_cast<uint64_t>(usage.ru_maxrss);
+#endif
+#endif
+}
+
+void writeJson(std::ostream& os, const std::vector<LevelBenchmarkResult>& levelResults,
+    const std::vector<MicroBenchmarkResult>& microResults)
+{
+    os << std::fixed << std::setprecision(3);
+    os << "{\n";
+    os << "\"version\":\"" << jsonEscape(ODApplication::VERSION) << "\",\n";
+    os << "\"levels\":[";
+    for(size_t i = 0; i < levelResults.size(); ++i)
+    {
+        const LevelBenchmarkResult& result = levelResults[i];
+        os << (i == 0 ? "\n" : ",\n");
+        os << "{\"level\":\"" << jsonEscape(result.mLevel) << "\""
+           << ",\"seed\":" << result.mRandomSeed
+           << ",\"turns\":" << result.mNbTurns
+           << ",\"turnTimeUs\":";
+        writeTimesJson(os, result.mTurnTimes);
+        os << ",\"pathCalls\":" << result.mNbPathCalls
+           << ",\"allocations\":" << result.mNbAllocations
+           << ",\"allocatedBytes\":" << result.mNbAllocatedBytes
+           << ",\"creatures\":" << result.mNbCreatures
+           << ",\"peakRssKb\":" << result.mPeakRssKb << "}";
+    }
+    os << "\n],\n";
+    os << "\"micro\":[";
+    for(size_t i = 0; i < microResults.size(); ++i)
+    {
+        const MicroBenchmarkResult& result = microResults[i];
+        os << (i == 0 ? "\n" : ",\n");
+        os << "{\"name\":\"" << jsonEscape(result.mName) << "\""
+           << ",\"level\":\"" << jsonEscape(result.mLevel) << "\""
+           << ",\"iterations\":" << result.mNbIterations
+           << ",\"nsPerIteration\":" << result.mNsPerIteration
+           << ",\"allocationsPerIteration\":" << result.mAllocationsPerIteration << "}";
+    }
+    os << "\n]\n";
+    os << "}\n";
+}
+
+void writeSummary(std::ostream& os, const std::vector<LevelBenchmarkResult>& levelResults,
+    const std::vector<MicroBenchmarkResult>& microResults)
+{
+    os << std::fixed << std::setprecision(1);
+    for(const LevelBenchmarkResult& result : levelResults)
+    {
+        os << result.mLevel << " (seed=" << result.mRandomSeed << ", turns=" << result.mNbTurns << ")\n"
+           << "    turn time us: mean=" << result.mTurnTimes.mMean
+           << " p50=" << result.mTurnTimes.mP50
+           << " p90=" << result.mTurnTimes.mP90
+           << " p99=" << result.mTurnTimes.mP99
+           << " max=" << result.mTurnTimes.mMax << "\n"
+           << "    path calls=" << result.mNbPathCalls
+           << " allocations=" << result.mNbAllocations
+           << " (" << result.mNbAllocatedBytes / 1024 << " KB)"
+           << " creatures=" << result.mNbCreatures
+           << " peak rss=" << result.mPeakRssKb << " KB\n";
+    }
+
+    for(const MicroBenchmarkResult& result : microResults)
+    {
+        os << result.mName << " on " << result.mLevel << ": "
+           << result.mNsPerIteration << " ns/iteration, "
+           << result.mAllocationsPerIteration << " allocations/iteration ("
+           << result.mNbIterations << " iterations)\n";
+    }
+}
+
+} // namespace SimulationBenchmark
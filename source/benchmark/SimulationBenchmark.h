@@ -0,0 +1,113 @@
+/*
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SIMULATIONBENCHMARK_H
+#define SIMULATIONBENCHMARK_H
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+class ODServer;
+
+//! \brief Statistics over time samples, in microseconds
+struct BenchmarkTimes
+{
+    BenchmarkTimes() :
+        mMean(0.0),
+        mP50(0.0),
+        mP90(0.0),
+        mP99(0.0),
+        mMax(0.0)
+    {}
+
+    double mMean;
+    double mP50;
+    double mP90;
+    double mP99;
+    double mMax;
+};
+
+//! \brief Measures of the turns simulated on one level
+struct LevelBenchmarkResult
+{
+    LevelBenchmarkResult() :
+        mRandomSeed(0),
+        mNbTurns(0),
+        mNbPathCalls(0),
+        mNbAllocations(0),
+        mNbAllocatedBytes(0),
+        mNbCreatures(0),
+        mPeakRssKb(0)
+    {}
+
+    std::string mLevel;
+    uint64_t mRandomSeed;
+    uint32_t mNbTurns;
+    BenchmarkTimes mTurnTimes;
+    uint64_t mNbPathCalls;
+    uint64_t mNbAllocations;
+    uint64_t mNbAllocatedBytes;
+    //! \brief Number of creatures alive after the last turn
+    uint64_t mNbCreatures;
+    //! \brief Peak resident memory of the process once the level was simulated. As it is a peak, it
+    //! can only grow from one level to the next
+    uint64_t mPeakRssKb;
+};
+
+//! \brief Measures of one micro benchmark
+struct MicroBenchmarkResult
+{
+    MicroBenchmarkResult() :
+        mNbIterations(0),
+        mNsPerIteration(0.0),
+        mAllocationsPerIteration(0.0)
+    {}
+
+    std::string mName;
+    std::string mLevel;
+    uint32_t mNbIterations;
+    double mNsPerIteration;
+    double mAllocationsPerIteration;
+};
+
+//! \brief Runs server turns without network nor rendering to measure the game simulation
+namespace SimulationBenchmark
+{
+    //! \brief Starts an offline game on the given level (see ODServer::startOfflineGame) and runs
+    //! nbTurns turns. The game is left running so that the micro benchmarks can use its gamemap. It
+    //! should be stopped with ODServer::stopServer. Returns false if the level cannot be loaded
+    bool runLevel(ODServer& server, const std::string& levelPath, uint64_t randomSeed, uint32_t nbTurns,
+        LevelBenchmarkResult& result);
+
+    //! \brief Computes the mean and the percentiles of the given samples
+    BenchmarkTimes computeTimes(std::vector<double> samples);
+
+    //! \brief Peak resident memory of the process in KB (0 if unknown)
+    uint64_t getPeakRssKb();
+
+    //! \brief Writes the results as JSON so that they can be compared between runs
+    void writeJson(std::ostream& os, const std::vector<LevelBenchmarkResult>& levelResults,
+        const std::vector<MicroBenchmarkResult>& microResults);
+
+    //! \brief Writes the results in a human readable way
+    void writeSummary(std::ostream& os, const std::vector<LevelBenchmarkResult>& levelResults,
+        const std::vector<MicroBenchmarkResult>& microResults);
+}
+
+#endif // SIMULATIONBENCHMARK_H
@@ -136,7 +136,7 @@ bool CreatureActionFindHome::handleFindHome(Creature& creature, bool forced)
     }
 
     Tile* choosenTile = nullptr;
-    std::list<Tile*> tempPath = creature.getGameMap()->findBestPath(&creature, myTile, availableDormitories, choosenTile);
+    std::list<Tile*> tempPath = creature.getGameMap()->findClosestPath(&creature, myTile, availableDormitories, choosenTile);
     std::vector<Ogre::Vector3> path;
     creature.tileToVector3(tempPath, path, true, 0.0);
     creature.setWalkPath(EntityAnimation::walk_anim, EntityAnimation::idle_anim, true, true, path);
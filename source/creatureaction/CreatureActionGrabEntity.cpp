@@ -103,7 +103,7 @@ bool CreatureActionGrabEntity::handleGrabEntity(Creature& creature, GameEntity*
     }
 
     Tile* tileBuilding = nullptr;
-    creature.getGameMap()->findBestPath(&creature, myTile, tilesDest, tileBuilding);
+    creature.getGameMap()->findClosestPath(&creature, myTile, tilesDest, tileBuilding);
     if(tileBuilding == nullptr)
     {
         // We couldn't find a way to the building
@@ -144,7 +144,7 @@ bool CreatureActionSearchFood::handleSearchFood(Creature& creature, bool forced)
     }
 
     Tile* chosenTile = nullptr;
-    std::list<Tile*> pathToHatchery = creature.getGameMap()->findBestPath(&creature, myTile, hatcheriesTiles, chosenTile);
+    std::list<Tile*> pathToHatchery = creature.getGameMap()->findClosestPath(&creature, myTile, hatcheriesTiles, chosenTile);
     if(chosenTile == nullptr)
     {
         // We couldn't find a path !
@@ -20,10 +20,12 @@
 #include "creatureaction/CreatureActionGetFee.h"
 #include "creatureaction/CreatureActionSearchFood.h"
 #include "creatureaction/CreatureActionSleep.h"
+#include "creatureaction/CreatureActionWalkToTile.h"
 #include "creaturemood/CreatureMood.h"
 #include "entities/Creature.h"
 #include "entities/Tile.h"
 #include "game/Seat.h"
+#include "gamemap/GameMap.h"
 #include "rooms/Room.h"
 #include "utils/Helper.h"
 #include "utils/LogManager.h"
@@ -115,8 +117,8 @@ bool CreatureActionUseRoom::handleJob(Creature& creature, Room* room, bool force
     // We check if we are on a room tile. If not, we will go to one
     if(myTile->getCoveringRoom() != room)
     {
-        Tile* dest = room->getCoveredTile(0);
-        if(dest == nullptr)
+        std::vector<Tile*> roomTiles = room->getCoveredTiles();
+        if(roomTiles.empty())
         {
             // No tile to go to !
             OD_LOG_ERR("creature=" + creature.getName() + ", room=" + room->getName());
@@ -124,9 +126,19 @@ bool CreatureActionUseRoom::handleJob(Creature& creature, Room* room, bool force
             return true;
         }
 
-        if(!creature.setDestination(dest))
+        // We go to the closest room tile
+        Tile* dest = nullptr;
+        std::list<Tile*> tilePath = creature.getGameMap()->findClosestPath(&creature, myTile, roomTiles, dest);
+        if(dest == nullptr)
+        {
             creature.popAction();
+            return true;
+        }
 
+        std::vector<Ogre::Vector3> vectorPath;
+        creature.tileToVector3(tilePath, vectorPath, true, 0.0);
+        creature.setWalkPath(EntityAnimation::walk_anim, EntityAnimation::idle_anim, true, true, vectorPath);
+        creature.pushAction(Utils::make_unique<CreatureActionWalkToTile>(creature));
         return true;
     }
 
@@ -75,6 +75,7 @@
 #include "utils/MakeUnique.h"
 #include "utils/Random.h"
 
+#ifndef OD_HEADLESS_SERVER
 #include <CEGUI/Event.h>
 #include <CEGUI/System.h>
 #include <CEGUI/UDim.h>
@@ -83,6 +84,7 @@
 #include <CEGUI/Window.h>
 #include <CEGUI/widgets/FrameWindow.h>
 #include <CEGUI/widgets/PushButton.h>
+#endif
 
 #include <OgreQuaternion.h>
 #include <OgreVector3.h>
@@ -171,7 +173,14 @@ Creature::Creature(GameMap* gameMap, const CreatureDefinition* definition, Seat*
     mSeatPrison              (nullptr),
     mNbTurnsTorture          (0),
     mNbTurnsPrison           (0),
-    mActiveSlapsCount        (0)
+    mActiveSlapsCount        (0),
+    mVisionTile              (nullptr),
+    mIsVisionPrepared        (false),
+    mIsMoodPrepared          (false),
+    mMoodPointsPrepared      (0),
+    mIsCountedInSeat         (false),
+    mSeatCounted             (nullptr),
+    mIsCountedAsWorker       (false)
 
 {
     //TODO: This should be set in initialiser list in parent classes
@@ -249,7 +258,14 @@ Creature::Creature(GameMap* gameMap) :
     mSeatPrison              (nullptr),
     mNbTurnsTorture          (0),
     mNbTurnsPrison           (0),
-    mActiveSlapsCount        (0)
+    mActiveSlapsCount        (0),
+    mVisionTile              (nullptr),
+    mIsVisionPrepared        (false),
+    mIsMoodPrepared          (false),
+    mMoodPointsPrepared      (0),
+    mIsCountedInSeat         (false),
+    mSeatCounted             (nullptr),
+    mIsCountedAsWorker       (false)
 {
 }
 
@@ -341,6 +357,9 @@ void Creature::removeFromGameMap()
         home->releaseTileForSleeping(getHomeTile(), this);
     }
 
+    mVisionSource.clear();
+    mVisionTile = nullptr;
+
     fireRemoveEntityToSeatsWithVision();
     getGameMap()->removeActiveObject(this);
 }
@@ -669,33 +688,76 @@ void Creature::update(Ogre::Real timeSinceLastFrame)
         computeVisualDebugEntities();
     }
 
+#ifndef OD_HEADLESS_SERVER
     if(getOverlayStatus() != nullptr)
     {
         getOverlayStatus()->update(timeSinceLastFrame);
     }
+#endif
 }
 
 void Creature::computeVisibleTiles()
 {
-    // dead Creatures do not give vision
-    if (getHP() <= 0.0)
+    // dead Creatures, KO Creatures and creatures in jail do not give vision
+    Tile* posTile = getPositionTile();
+    if ((getHP() <= 0.0) ||
+        isKo() ||
+        (mSeatPrison != nullptr) ||
+        !getIsOnMap() ||
+        (posTile == nullptr))
+    {
+        mVisionSource.clear();
+        mVisionTile = nullptr;
         return;
+    }
 
-    // KO Creatures do not give vision
-    if (isKo())
+    // The tiles in sight may already have been updated by prepareUpkeep
+    if(mIsVisionPrepared)
+        mIsVisionPrepared = false;
+    else if(isVisionOutdated())
+        updateTilesInSight();
+    else
         return;
 
-    // creatures in jail do not give vision
-    if (mSeatPrison != nullptr)
-        return;
+    mVisionTile = posTile;
+    mVisionSource.setTiles(std::vector<Seat*>(1, getSeat()), mVisibleTiles);
+}
+
+bool Creature::isVisionOutdated() const
+{
+    // The surrounding area only needs to be checked again if the creature moved, changed seat
+    // or if a tile around blocks vision differently
+    Tile* posTile = getPositionTile();
+    return (posTile != mVisionTile) ||
+        mVisionSource.getSeats().empty() ||
+        (mVisionSource.getSeats().front() != getSeat()) ||
+        getGameMap()->isOcclusionChanged(posTile, mDefinition->getSightRadius());
+}
+
+void Creature::prepareUpkeep()
+{
+    mIsVisionPrepared = false;
+    mIsMoodPrepared = false;
 
-    if (!getIsOnMap())
+    // Same checks as computeVisibleTiles and doUpkeep. Creatures that do not pass them
+    // will be handled there
+    if(!isAlive() || isKo() || (mSeatPrison != nullptr) || !getIsOnMap() ||
+       (getPositionTile() == nullptr))
+    {
         return;
+    }
 
-    // Look at the surrounding area
-    updateTilesInSight();
-    for(Tile* tile : mVisibleTiles)
-        tile->notifyVision(getSeat());
+    if(isVisionOutdated())
+    {
+        updateTilesInSight();
+        mIsVisionPrepared = true;
+    }
+
+    if((mMoodCooldownTurns == 0) && !getSeat()->isRogueSeat())
+    {
+        mMoodPointsPrepared = CreatureMoodManager::computeCreatureMoodModifiers(*this);
+        mIsMoodPrepared = true;
+    }
 }
 
 void Creature::setLevel(unsigned int level)
@@ -751,6 +813,10 @@ void Creature::dropCarriedEquipment()
 
 void Creature::doUpkeep()
 {
+    // The mood prepared by prepareUpkeep is only valid for this upkeep
+    bool isMoodPrepared = mIsMoodPrepared;
+    mIsMoodPrepared = false;
+
     // If the creature is in jail, we check if it is still standing on it (if not picked up). If
     // not, it is free
     if((mSeatPrison != nullptr) &&
@@ -908,7 +974,11 @@ void Creature::doUpkeep()
     // Rogue creatures do not have mood
     else if(!getSeat()->isRogueSeat())
     {
-        computeMood();
+        if(isMoodPrepared)
+            computeMood(mMoodPointsPrepared);
+        else
+            computeMood(CreatureMoodManager::computeCreatureMoodModifiers(*this));
+
         computeCreatureOverlayMoodValue();
         mMoodCooldownTurns = Random::Int(0, 5);
     }
@@ -1092,7 +1162,8 @@ bool Creature::handleIdleAction()
             uint32_t index = Random::Uint(0,reachableCallToWars.size()-1);
             Spell* callToWar = reachableCallToWars[index];
             Tile* callToWarTile = callToWar->getPositionTile();
-            std::list<Tile*> tempPath = getGameMap()->path(this, callToWarTile);
+            // Many creatures may go to the same call to war. They share the same flow field
+            std::list<Tile*> tempPath = getGameMap()->flowFieldPath(this, callToWarTile);
             // If we are 5 tiles from the call to war, we don't go there
             if(tempPath.size() >= 5)
             {
@@ -1341,7 +1412,7 @@ bool Creature::searchBestTargetInList(const std::vector<GameEntity*>& listObject
         int bestScoreAttack = -1;
         std::vector<Tile*> tiles;
         if(tilesFilter.empty())
-            tiles = getGameMap()->visibleTiles(tileAttackCheck->getX(), tileAttackCheck->getY(), skillRangeMaxInt);
+            getGameMap()->visibleTiles(tileAttackCheck->getX(), tileAttackCheck->getY(), skillRangeMaxInt, tiles);
         else
         {
             float radiusSquared = skillRangeMaxInt * skillRangeMaxInt;
@@ -1397,7 +1468,7 @@ bool Creature::searchBestTargetInList(const std::vector<GameEntity*>& listObject
         Tile* fleeTile = nullptr;
         std::vector<Tile*> tiles;
         if(tilesFilter.empty())
-            tiles = getGameMap()->visibleTiles(tileEntityFlee->getX(), tileEntityFlee->getY(), fightIdleDist);
+            getGameMap()->visibleTiles(tileEntityFlee->getX(), tileEntityFlee->getY(), fightIdleDist, tiles);
         else
         {
             float radiusSquared = fightIdleDist * fightIdleDist;
@@ -1558,65 +1629,103 @@ void Creature::checkLevelUp()
     setLevel(mLevel + 1);
 }
 
-void Creature::exportToPacketForUpdate(ODPacket& os, const Seat* seat) const
+CreatureUpdateValues Creature::getUpdateValues(const Seat* seat) const
 {
-    MovableGameEntity::exportToPacketForUpdate(os, seat);
-
-    int seatId = getSeat()->getId();
-    os << mLevel;
-    os << seatId;
-    os << mOverlayHealthValue;
+    CreatureUpdateValues values;
+    values.mLevel = mLevel;
+    values.mSeatId = getSeat()->getId();
+    values.mOverlayHealthValue = mOverlayHealthValue;
 
     // Only allied players should see creature mood (except some states)
-    uint32_t moodValue = 0;
     if(seat->isAlliedSeat(getSeat()))
-        moodValue = mOverlayMoodValue;
+        values.mMoodValue = mOverlayMoodValue;
     else if(mSeatPrison != nullptr)
     {
         if(mSeatPrison->isAlliedSeat(seat))
-            moodValue = mOverlayMoodValue & CreatureMoodValues::MoodPrisonFiltersPrisonAllies;
+            values.mMoodValue = mOverlayMoodValue & CreatureMoodValues::MoodPrisonFiltersPrisonAllies;
         else
-            moodValue = mOverlayMoodValue & CreatureMoodValues::MoodPrisonFiltersAllPlayers;
+            values.mMoodValue = mOverlayMoodValue & CreatureMoodValues::MoodPrisonFiltersAllPlayers;
     }
 
-    os << moodValue;
-    os << mGroundSpeed;
-    os << mWaterSpeed;
-    os << mLavaSpeed;
-    os << mSpeedModifier;
+    values.mGroundSpeed = mGroundSpeed;
+    values.mWaterSpeed = mWaterSpeed;
+    values.mLavaSpeed = mLavaSpeed;
+    values.mSpeedModifier = mSpeedModifier;
 
-    int seatPrisonId = -1;
     if(mSeatPrison != nullptr)
-        seatPrisonId = mSeatPrison->getId();
+        values.mSeatPrisonId = mSeatPrison->getId();
+
+    return values;
+}
+
+void Creature::exportToPacketForUpdate(ODPacket& os, Seat* seat) const
+{
+    MovableGameEntity::exportToPacketForUpdate(os, seat);
 
-    os << seatPrisonId;
+    getUpdateValues(seat).exportToPacket(os, CreatureUpdateFields::All);
 }
 
 void Creature::updateFromPacket(ODPacket& is)
 {
     MovableGameEntity::updateFromPacket(is);
 
-    int seatId;
-    OD_ASSERT_TRUE(is >> mLevel);
-    OD_ASSERT_TRUE(is >> seatId);
-    OD_ASSERT_TRUE(is >> mOverlayHealthValue);
-    OD_ASSERT_TRUE(is >> mOverlayMoodValue);
-    OD_ASSERT_TRUE(is >> mGroundSpeed);
-    OD_ASSERT_TRUE(is >> mWaterSpeed);
-    OD_ASSERT_TRUE(is >> mLavaSpeed);
-    OD_ASSERT_TRUE(is >> mSpeedModifier);
+    // Only the fields that changed since the last update are sent. The others keep their current values
+    CreatureUpdateValues values = getClientUpdateValues();
+    uint16_t fields;
+    OD_ASSERT_TRUE(values.importFromPacket(is, fields));
+    applyUpdateValues(values, fields);
+}
 
-    // We do not scale the creature if it is picked up (because it is already not at its normal size). It will be
-    // resized anyway when dropped
-    if(getIsOnMap())
-        RenderManager::getSingleton().rrScaleCreature(*this);
+void Creature::exportToPacketForReplay(ODPacket& os) const
+{
+    getClientUpdateValues().exportToPacket(os, CreatureUpdateFields::All);
+}
+
+bool Creature::importFromPacketForReplay(ODPacket& is)
+{
+    CreatureUpdateValues values = getClientUpdateValues();
+    uint16_t fields;
+    if(!values.importFromPacket(is, fields))
+        return false;
 
-    if(getSeat()->getId() != seatId)
+    applyUpdateValues(values, fields);
+    return true;
+}
+
+CreatureUpdateValues Creature::getClientUpdateValues() const
+{
+    CreatureUpdateValues values;
+    values.mLevel = mLevel;
+    values.mSeatId = getSeat()->getId();
+    values.mOverlayHealthValue = mOverlayHealthValue;
+    values.mMoodValue = mOverlayMoodValue;
+    values.mGroundSpeed = mGroundSpeed;
+    values.mWaterSpeed = mWaterSpeed;
+    values.mLavaSpeed = mLavaSpeed;
+    values.mSpeedModifier = mSpeedModifier;
+    if(mSeatPrison != nullptr)
+        values.mSeatPrisonId = mSeatPrison->getId();
+
+    return values;
+}
+
+void Creature::applyUpdateValues(const CreatureUpdateValues& values, uint16_t fields)
+{
+    if((fields & CreatureUpdateFields::Level) != 0)
+    {
+        mLevel = values.mLevel;
+        // We do not scale the creature if it is picked up (because it is already not at its normal size). It will be
+        // resized anyway when dropped
+        if(getIsOnMap())
+            RenderManager::getSingleton().rrScaleCreature(*this);
+    }
+
+    if(((fields & CreatureUpdateFields::SeatId) != 0) && (getSeat()->getId() != values.mSeatId))
     {
-        Seat* seat = getGameMap()->getSeatById(seatId);
+        Seat* seat = getGameMap()->getSeatById(values.mSeatId);
         if(seat == nullptr)
         {
-            OD_LOG_ERR("Creature " + getName() + ", wrong seatId=" + Helper::toString(seatId));
+            OD_LOG_ERR("Creature " + getName() + ", wrong seatId=" + Helper::toString(values.mSeatId));
         }
         else
         {
@@ -1624,15 +1733,24 @@ void Creature::updateFromPacket(ODPacket& is)
         }
     }
 
-    OD_ASSERT_TRUE(is >> seatId);
-    if(seatId == -1)
-        mSeatPrison = nullptr;
-    else
+    mOverlayHealthValue = values.mOverlayHealthValue;
+    mOverlayMoodValue = values.mMoodValue;
+    mGroundSpeed = values.mGroundSpeed;
+    mWaterSpeed = values.mWaterSpeed;
+    mLavaSpeed = values.mLavaSpeed;
+    mSpeedModifier = values.mSpeedModifier;
+
+    if((fields & CreatureUpdateFields::SeatPrisonId) != 0)
     {
-        mSeatPrison = getGameMap()->getSeatById(seatId);
-        if(mSeatPrison == nullptr)
+        if(values.mSeatPrisonId == -1)
+            mSeatPrison = nullptr;
+        else
         {
-            OD_LOG_ERR("Creature " + getName() + ", wrong seatId=" + Helper::toString(seatId));
+            mSeatPrison = getGameMap()->getSeatById(values.mSeatPrisonId);
+            if(mSeatPrison == nullptr)
+            {
+                OD_LOG_ERR("Creature " + getName() + ", wrong seatId=" + Helper::toString(values.mSeatPrisonId));
+            }
         }
     }
 }
@@ -1647,7 +1765,7 @@ void Creature::updateTilesInSight()
     mTilesWithinSightRadius = getGameMap()->circularRegion(posTile->getX(), posTile->getY(), mDefinition->getSightRadius());
 
     // Only the tiles the creature can "see".
-    mVisibleTiles = getGameMap()->visibleTiles(posTile->getX(), posTile->getY(), mDefinition->getSightRadius());
+    getGameMap()->visibleTiles(posTile->getX(), posTile->getY(), mDefinition->getSightRadius(), mVisibleTiles);
 }
 
 std::vector<GameEntity*> Creature::getVisibleEnemyObjects()
@@ -1833,6 +1951,7 @@ uint32_t Creature::numCoveredTiles() const
     return 1;
 }
 
+#ifndef OD_HEADLESS_SERVER
 bool Creature::CloseStatsWindow(const CEGUI::EventArgs& /*e*/)
 {
     destroyStatsWindow();
@@ -1900,6 +2019,25 @@ void Creature::updateStatsWindow(const std::string& txt)
     CEGUI::Window* textWindow = mStatsWindow->getChild("TextDisplay");
     textWindow->setText(txt);
 }
+#else
+// The dedicated server has no gui. Stats windows are never opened
+bool Creature::CloseStatsWindow(const CEGUI::EventArgs& /*e*/)
+{
+    return true;
+}
+
+void Creature::createStatsWindow()
+{
+}
+
+void Creature::destroyStatsWindow()
+{
+}
+
+void Creature::updateStatsWindow(const std::string& /*txt*/)
+{
+}
+#endif
 
 std::string Creature::getStatsText()
 {
@@ -2461,8 +2599,7 @@ void Creature::releaseCarriedEntity()
 
         ServerNotification* serverNotification = new ServerNotification(
             ServerNotificationType::releaseCarriedEntity, seat->getPlayer());
-        serverNotification->mPacket << getName() << carriedEntity->getObjectType();
-        serverNotification->mPacket << carriedEntity->getName();
+        serverNotification->mPacket << getNetworkId() << carriedEntity->getNetworkId();
         serverNotification->mPacket << mPosition;
         ODServer::getSingleton().queueServerNotification(serverNotification);
     }
@@ -2548,33 +2685,31 @@ void Creature::fireAddEntity(Seat* seat, bool async)
 
         serverNotification = new ServerNotification(
             ServerNotificationType::carryEntity, seat->getPlayer());
-        serverNotification->mPacket << getName() << mCarriedEntity->getObjectType();
-        serverNotification->mPacket << mCarriedEntity->getName();
+        serverNotification->mPacket << getNetworkId() << mCarriedEntity->getNetworkId();
         ODServer::getSingleton().queueServerNotification(serverNotification);
     }
 }
 
 void Creature::fireRemoveEntity(Seat* seat)
 {
+    // The client will create the creature again if it gets vision back. The next update will contain every field
+    mUpdatesSent.seatRemoved(seat);
+
     // If we are carrying an entity, we release it first, then we can remove it and us
     if(mCarriedEntity != nullptr)
     {
         ServerNotification* serverNotification = new ServerNotification(
             ServerNotificationType::releaseCarriedEntity, seat->getPlayer());
-        serverNotification->mPacket << getName() << mCarriedEntity->getObjectType();
-        serverNotification->mPacket << mCarriedEntity->getName();
+        serverNotification->mPacket << getNetworkId() << mCarriedEntity->getNetworkId();
         serverNotification->mPacket << mPosition;
         ODServer::getSingleton().queueServerNotification(serverNotification);
 
         mCarriedEntity->removeSeatWithVision(seat);
     }
 
-    const std::string& name = getName();
     ServerNotification *serverNotification = new ServerNotification(
         ServerNotificationType::removeEntity, seat->getPlayer());
-    GameEntityType type = getObjectType();
-    serverNotification->mPacket << type;
-    serverNotification->mPacket << name;
+    serverNotification->mPacket << getNetworkId();
     ODServer::getSingleton().queueServerNotification(serverNotification);
 }
 
@@ -2591,14 +2726,21 @@ void Creature::fireCreatureRefreshIfNeeded()
         if(!seat->getPlayer()->getIsHuman())
             continue;
 
-        const std::string& name = getName();
+        // We only send the fields that changed since the last update sent to this seat. Note that
+        // some changes are not visible to every seat (like the mood)
+        CreatureUpdateValues values = getUpdateValues(seat);
+        uint16_t fields = mUpdatesSent.getFieldsToSend(seat, values);
+
+        if((fields == CreatureUpdateFields::Nothing) && mEntityParticleEffects.empty())
+            continue;
+
         ServerNotification *serverNotification = new ServerNotification(
             ServerNotificationType::entitiesRefresh, seat->getPlayer());
         uint32_t nbCreature = 1;
         serverNotification->mPacket << nbCreature;
-        serverNotification->mPacket << GameEntityType::creature;
-        serverNotification->mPacket << name;
-        exportToPacketForUpdate(serverNotification->mPacket, seat);
+        serverNotification->mPacket << getNetworkId();
+        MovableGameEntity::exportToPacketForUpdate(serverNotification->mPacket, seat);
+        values.exportToPacket(serverNotification->mPacket, fields);
         ODServer::getSingleton().queueServerNotification(serverNotification);
     }
 }
@@ -2739,8 +2881,10 @@ void Creature::setupDefinition(GameMap& gameMap, const CreatureDefinition& defau
             // name
             if (getName().compare("autoname") == 0)
             {
+                std::string oldName = getName();
                 std::string name = getGameMap()->nextUniqueNameCreature(mDefinition->getClassName());
                 setName(name);
+                getGameMap()->creatureRenamed(this, oldName);
             }
         }
     }
@@ -2766,6 +2910,9 @@ void Creature::setupDefinition(GameMap& gameMap, const CreatureDefinition& defau
 
         computeCreatureOverlayHealthValue();
     }
+
+    // Creatures loaded from the level file are added to the GameMap before their definition is known
+    refreshSeatCount();
 }
 
 void Creature::fireCreatureSound(CreatureSound sound)
@@ -2840,9 +2987,9 @@ void Creature::decreaseWakefulness(double value)
     mWakefulness = std::max(0.0, mWakefulness - value);
 }
 
-void Creature::computeMood()
+void Creature::computeMood(int32_t moodPoints)
 {
-    mMoodPoints = CreatureMoodManager::computeCreatureMoodModifiers(*this);
+    mMoodPoints = moodPoints;
 
     CreatureMoodLevel oldMoodValue = mMoodValue;
     mMoodValue = CreatureMoodManager::getCreatureMoodLevel(mMoodPoints);
@@ -2894,6 +3041,37 @@ void Creature::computeCreatureOverlayHealthValue()
         mOverlayHealthValue = value;
         mNeedFireRefresh = true;
     }
+
+    // Dead creatures are not counted in their seat
+    refreshSeatCount();
+}
+
+void Creature::refreshSeatCount()
+{
+    if(!getIsOnServerMap())
+        return;
+
+    Seat* seat = nullptr;
+    if(mIsCountedInSeat && (mDefinition != nullptr) && isAlive())
+        seat = getSeat();
+
+    bool isWorker = (seat != nullptr) && mDefinition->isWorker();
+    if((seat == mSeatCounted) && (isWorker == mIsCountedAsWorker))
+        return;
+
+    if(mSeatCounted != nullptr)
+        mSeatCounted->addNumCreatures(mIsCountedAsWorker, -1);
+
+    mSeatCounted = seat;
+    mIsCountedAsWorker = isWorker;
+    if(mSeatCounted != nullptr)
+        mSeatCounted->addNumCreatures(mIsCountedAsWorker, 1);
+}
+
+void Creature::setIsCountedInSeat(bool isCounted)
+{
+    mIsCountedInSeat = isCounted;
+    refreshSeatCount();
 }
 
 void Creature::computeCreatureOverlayMoodValue()
@@ -3220,6 +3398,7 @@ void Creature::changeSeat(Seat* newSeat)
     OD_LOG_INF("creature=" + getName() + " changes side from seatId=" + Helper::toString(getSeat()->getId()) + " to seatId=" + Helper::toString(newSeat->getId()));
     OD_ASSERT_TRUE_MSG(getSeat() != newSeat, "creature=" + getName() + ", seatId=" + Helper::toString(newSeat->getId()));
     setSeat(newSeat);
+    refreshSeatCount();
     mMoodValue = CreatureMoodLevel::Neutral;
     mMoodPoints = 0;
     mWakefulness = 100;
@@ -21,12 +21,14 @@
 #ifndef CREATURE_H
 #define CREATURE_H
 
+#include "entities/CreatureUpdateValues.h"
 #include "entities/MovableGameEntity.h"
+#include "gamemap/VisionSource.h"
 
 #include <OgreVector2.h>
 #include <OgreVector3.h>
-#include <CEGUI/EventArgs.h>
 
+#include <map>
 #include <memory>
 #include <string>
 
@@ -48,6 +50,7 @@ enum class SkillType;
 
 namespace CEGUI
 {
+class EventArgs;
 class Window;
 }
 
@@ -252,6 +255,17 @@ public:
     //! \brief Computes the visible tiles and tags them to know which are visible
     void computeVisibleTiles();
 
+    //! \brief Computes from the current state of the gamemap what computeVisibleTiles and doUpkeep
+    //! will need this turn (the tiles in sight if the creature moved and its mood if it has to be
+    //! refreshed). It only reads the gamemap and writes data owned by this creature so that it can be
+    //! called for several creatures at the same time (see GameMap::doMiscUpkeep). The result is
+    //! applied by computeVisibleTiles and doUpkeep that should be called right after, one creature
+    //! at a time
+    void prepareUpkeep();
+
+    //! \brief Returns true if the tiles seen by the creature may have changed since they were last computed
+    bool isVisionOutdated() const;
+
     virtual bool isAttackable(Tile* tile, Seat* seat) const;
 
     double getPhysicalDefense() const;
@@ -550,9 +564,15 @@ public:
 
     virtual void clientUpkeep() override;
 
-    virtual void exportToPacketForUpdate(ODPacket& os, const Seat* seat) const override;
+    //! \brief Exports every update field. fireCreatureRefreshIfNeeded only sends the ones that changed
+    virtual void exportToPacketForUpdate(ODPacket& os, Seat* seat) const override;
     virtual void updateFromPacket(ODPacket& is) override;
 
+    //! \brief Exports every update field as known by the client. The creature updates only send the fields that
+    //! changed so the replay keyframes need them all (see ODClient::exportReplayKeyframe)
+    void exportToPacketForReplay(ODPacket& os) const;
+    bool importFromPacketForReplay(ODPacket& is);
+
     //! \brief Called when an angry creature wants to attack a natural enemy
     void engageAlliedNaturalEnemy(Creature& attacker);
 
@@ -573,6 +593,10 @@ public:
 
     void computeCreatureOverlayHealthValue();
 
+    //! \brief Updates the creatures count of the seats after the creature died, changed seat, got its
+    //! definition or was added to/removed from the GameMap
+    void refreshSeatCount();
+
     //! \brief Search within listObjects the closest attackable one.
     //! If a target is found and can be attacked, returns true and
     //! attackedEntity, attackedTile will be set to the target closest tile and positionTile will
@@ -588,6 +612,10 @@ public:
     //! \brief Called when the creature changes seat (for example when it becomes rogue or after torture)
     void changeSeat(Seat* newSeat);
 
+    //! \brief Called on server side by the GameMap when the creature is added to (or removed from) its creatures.
+    //! Living creatures added to the GameMap are counted in the workers or fighters of their seat
+    void setIsCountedInSeat(bool isCounted);
+
 protected:
     virtual void exportToPacket(ODPacket& os, const Seat* seat) const override;
     virtual void importFromPacket(ODPacket& is) override;
@@ -614,6 +642,14 @@ private:
     //! \brief Constructor for sending creatures through network. It should not be used in game.
     Creature(GameMap* gameMap);
 
+    CreatureUpdateValues getUpdateValues(const Seat* seat) const;
+
+    //! \brief Returns the update values the client currently has
+    CreatureUpdateValues getClientUpdateValues() const;
+
+    //! \brief Applies the given fields of the given update values on the client
+    void applyUpdateValues(const CreatureUpdateValues& values, uint16_t fields);
+
     //! \brief Natural physical and magical attack and defense (without equipment)
     double mPhysicalDefense;
     double mMagicalDefense;
@@ -758,9 +794,31 @@ private:
     //! \brief Counts the number of active slaps affecting the creature
     uint32_t                        mActiveSlapsCount;
 
+    //! \brief Tiles this creature gives vision on and the tile it was on when they were computed
+    VisionSource                    mVisionSource;
+    Tile*                           mVisionTile;
+
+    //! \brief True if prepareUpkeep already updated the tiles in sight for the next call to computeVisibleTiles
+    bool                            mIsVisionPrepared;
+
+    //! \brief True if prepareUpkeep computed mMoodPointsPrepared for the next call to doUpkeep
+    bool                            mIsMoodPrepared;
+    int32_t                         mMoodPointsPrepared;
+
+    //! \brief True if the creature should be counted in its seat (see setIsCountedInSeat)
+    bool                            mIsCountedInSeat;
+    //! \brief Seat whose workers or fighters count includes this creature (nullptr if none) and the
+    //! count it is in. It allows to remove the creature from the right count when something changes
+    Seat*                           mSeatCounted;
+    bool                            mIsCountedAsWorker;
+
     //! \brief Skills the creature can use
     std::vector<CreatureSkillData> mSkillData;
 
+    //! \brief Last update sent to each seat client by fireCreatureRefreshIfNeeded. Cleared for a seat when its client
+    //! removes the creature (see fireRemoveEntity)
+    CreatureUpdatesSent mUpdatesSent;
+
     //! \brief A sub-function called by doTurn()
     //! This one checks if there is something prioritary to do (like fighting). If it is the case,
     //! it should empty the action list before adding what to do.
@@ -776,7 +834,8 @@ private:
 
     void increaseHunger(double value);
 
-    void computeMood();
+    //! \brief Sets the mood points of the creature (computed by CreatureMoodManager) and refreshes its mood value
+    void computeMood(int32_t moodPoints);
 
     void computeCreatureOverlayMoodValue();
 };
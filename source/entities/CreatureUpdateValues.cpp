@@ -0,0 +1,126 @@
+/*
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "entities/CreatureUpdateValues.h"
+
+#include "network/ODPacket.h"
+
+CreatureUpdateValues::CreatureUpdateValues() :
+    mLevel(0),
+    mSeatId(-1),
+    mOverlayHealthValue(0),
+    mMoodValue(0),
+    mGroundSpeed(0.0),
+    mWaterSpeed(0.0),
+    mLavaSpeed(0.0),
+    mSpeedModifier(1.0),
+    mSeatPrisonId(-1)
+{
+}
+
+uint16_t CreatureUpdateValues::getChangedFields(const CreatureUpdateValues& other) const
+{
+    uint16_t fields = CreatureUpdateFields::Nothing;
+    if(mLevel != other.mLevel)
+        fields |= CreatureUpdateFields::Level;
+    if(mSeatId != other.mSeatId)
+        fields |= CreatureUpdateFields::SeatId;
+    if(mOverlayHealthValue != other.mOverlayHealthValue)
+        fields |= CreatureUpdateFields::OverlayHealth;
+    if(mMoodValue != other.mMoodValue)
+        fields |= CreatureUpdateFields::Mood;
+    if(mGroundSpeed != other.mGroundSpeed)
+        fields |= CreatureUpdateFields::GroundSpeed;
+    if(mWaterSpeed != other.mWaterSpeed)
+        fields |= CreatureUpdateFields::WaterSpeed;
+    if(mLavaSpeed != other.mLavaSpeed)
+        fields |= CreatureUpdateFields::LavaSpeed;
+    if(mSpeedModifier != other.mSpeedModifier)
+        fields |= CreatureUpdateFields::SpeedModifier;
+    if(mSeatPrisonId != other.mSeatPrisonId)
+        fields |= CreatureUpdateFields::SeatPrisonId;
+
+    return fields;
+}
+
+void CreatureUpdateValues::exportToPacket(ODPacket& os, uint16_t fields) const
+{
+    os << fields;
+    if((fields & CreatureUpdateFields::Level) != 0)
+        os << mLevel;
+    if((fields & CreatureUpdateFields::SeatId) != 0)
+        os << mSeatId;
+    if((fields & CreatureUpdateFields::OverlayHealth) != 0)
+        os << mOverlayHealthValue;
+    if((fields & CreatureUpdateFields::Mood) != 0)
+        os << mMoodValue;
+    if((fields & CreatureUpdateFields::GroundSpeed) != 0)
+        os << mGroundSpeed;
+    if((fields & CreatureUpdateFields::WaterSpeed) != 0)
+        os << mWaterSpeed;
+    if((fields & CreatureUpdateFields::LavaSpeed) != 0)
+        os << mLavaSpeed;
+    if((fields & CreatureUpdateFields::SpeedModifier) != 0)
+        os << mSpeedModifier;
+    if((fields & CreatureUpdateFields::SeatPrisonId) != 0)
+        os << mSeatPrisonId;
+}
+
+bool CreatureUpdateValues::importFromPacket(ODPacket& is, uint16_t& fields)
+{
+    if(!(is >> fields))
+        return false;
+    if(((fields & CreatureUpdateFields::Level) != 0) && !(is >> mLevel))
+        return false;
+    if(((fields & CreatureUpdateFields::SeatId) != 0) && !(is >> mSeatId))
+        return false;
+    if(((fields & CreatureUpdateFields::OverlayHealth) != 0) && !(is >> mOverlayHealthValue))
+        return false;
+    if(((fields & CreatureUpdateFields::Mood) != 0) && !(is >> mMoodValue))
+        return false;
+    if(((fields & CreatureUpdateFields::GroundSpeed) != 0) && !(is >> mGroundSpeed))
+        return false;
+    if(((fields & CreatureUpdateFields::WaterSpeed) != 0) && !(is >> mWaterSpeed))
+        return false;
+    if(((fields & CreatureUpdateFields::LavaSpeed) != 0) && !(is >> mLavaSpeed))
+        return false;
+    if(((fields & CreatureUpdateFields::SpeedModifier) != 0) && !(is >> mSpeedModifier))
+        return false;
+    if(((fields & CreatureUpdateFields::SeatPrisonId) != 0) && !(is >> mSeatPrisonId))
+        return false;
+
+    return true;
+}
+
+uint16_t CreatureUpdatesSent::getFieldsToSend(const Seat* seat, const CreatureUpdateValues& values)
+{
+    std::map<const Seat*, CreatureUpdateValues>::iterator itSent = mUpdatesSent.find(seat);
+    if(itSent == mUpdatesSent.end())
+    {
+        mUpdatesSent.emplace(seat, values);
+        return CreatureUpdateFields::All;
+    }
+
+    uint16_t fields = values.getChangedFields(itSent->second);
+    itSent->second = values;
+    return fields;
+}
+
+void CreatureUpdatesSent::seatRemoved(const Seat* seat)
+{
+    mUpdatesSent.erase(seat);
+}
@@ -0,0 +1,89 @@
+/*
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CREATUREUPDATEVALUES_H
+#define CREATUREUPDATEVALUES_H
+
+#include <cstdint>
+#include <map>
+
+class ODPacket;
+class Seat;
+
+//! Fields of the creature updates. An update starts with the mask of the fields it contains
+namespace CreatureUpdateFields
+{
+    const uint16_t Nothing = 0x0000;
+    const uint16_t Level = 0x0001;
+    const uint16_t SeatId = 0x0002;
+    const uint16_t OverlayHealth = 0x0004;
+    const uint16_t Mood = 0x0008;
+    const uint16_t GroundSpeed = 0x0010;
+    const uint16_t WaterSpeed = 0x0020;
+    const uint16_t LavaSpeed = 0x0040;
+    const uint16_t SpeedModifier = 0x0080;
+    const uint16_t SeatPrisonId = 0x0100;
+    const uint16_t All = 0x01FF;
+}
+
+//! \brief Values sent in the creature updates (see Creature::exportToPacketForUpdate). Some of them depend on the
+//! seat they are sent to (the mood is only visible to allies)
+class CreatureUpdateValues
+{
+public:
+    CreatureUpdateValues();
+
+    //! \brief Returns the mask of the fields that differ from the given values
+    uint16_t getChangedFields(const CreatureUpdateValues& other) const;
+
+    //! \brief Exports the mask of the given fields followed by their values
+    void exportToPacket(ODPacket& os, uint16_t fields) const;
+
+    //! \brief Reads an update exported by exportToPacket. Only the fields in the mask are changed. The mask
+    //! is returned in fields. Returns false if the packet could not be read
+    bool importFromPacket(ODPacket& is, uint16_t& fields);
+
+    unsigned int mLevel;
+    int mSeatId;
+    uint32_t mOverlayHealthValue;
+    uint32_t mMoodValue;
+    double mGroundSpeed;
+    double mWaterSpeed;
+    double mLavaSpeed;
+    double mSpeedModifier;
+    int mSeatPrisonId;
+};
+
+//! \brief Keeps the last creature update sent to each seat client. The next updates only contain the fields that
+//! changed since. The messages to a client are received in the order they are sent so the client always applies the
+//! updates on the values they were computed from
+class CreatureUpdatesSent
+{
+public:
+    //! \brief Returns the fields to send to the given seat so that its client gets the given values and saves them
+    //! as the last ones sent. Every field is sent if nothing was sent to this seat yet
+    uint16_t getFieldsToSend(const Seat* seat, const CreatureUpdateValues& values);
+
+    //! \brief Called when the client of the given seat removes the creature. The next update sent to this seat
+    //! will contain every field
+    void seatRemoved(const Seat* seat);
+
+private:
+    std::map<const Seat*, CreatureUpdateValues> mUpdatesSent;
+};
+
+#endif // CREATUREUPDATEVALUES_H
@@ -88,6 +88,7 @@ GameEntity::GameEntity(
           ) :
     mPosition          (Ogre::Vector3::ZERO),
     mName              (name),
+    mNetworkId         (0),
     mMeshName          (meshName),
     mMeshExists        (false),
     mSeat              (seat),
@@ -101,6 +102,8 @@ GameEntity::GameEntity(
     mEntityParentNodeAttach     (EntityParentNodeAttach::ATTACHED)
 {
     assert(mGameMap != nullptr);
+    if(mGameMap->isServerGameMap())
+        mNetworkId = mGameMap->nextUniqueNetworkId();
 }
 
 GameEntity::~GameEntity()
@@ -164,8 +167,7 @@ void GameEntity::removeEntityFromPositionTile()
 void GameEntity::firePickupEntity(Player* playerPicking)
 {
     int seatId = playerPicking->getSeat()->getId();
-    GameEntityType entityType = getObjectType();
-    const std::string& entityName = getName();
+    uint32_t networkId = getNetworkId();
     for(std::vector<Seat*>::iterator it = mSeatsWithVisionNotified.begin(); it != mSeatsWithVisionNotified.end();)
     {
         Seat* seat = *it;
@@ -195,14 +197,14 @@ void GameEntity::firePickupEntity(Player* playerPicking)
         {
             ServerNotification serverNotification(
                 ServerNotificationType::entityPickedUp, seat->getPlayer());
-            serverNotification.mPacket << seatId << entityType << entityName;
+            serverNotification.mPacket << seatId << networkId;
             ODServer::getSingleton().sendAsyncMsg(serverNotification);
         }
         else
         {
             ServerNotification* serverNotification = new ServerNotification(
                 ServerNotificationType::entityPickedUp, seat->getPlayer());
-            serverNotification->mPacket << seatId << entityType << entityName;
+            serverNotification->mPacket << seatId << networkId;
             ODServer::getSingleton().queueServerNotification(serverNotification);
         }
     }
@@ -279,12 +281,18 @@ void GameEntity::fireDropEntity(Player* playerPicking, Tile* tile)
 
 void GameEntity::notifySeatsWithVision(const std::vector<Seat*>& seats)
 {
+    // Most of the time, the seats with vision did not change since last time
+    SeatMask seatsMask = Seat::buildSeatMask(seats);
+    SeatMask notifiedMask = Seat::buildSeatMask(mSeatsWithVisionNotified);
+    if(seatsMask == notifiedMask)
+        return;
+
     // We notify seats that lost vision
-    for(std::vector<Seat*>::iterator it = mSeatsWithVisionNotified.begin(); it != mSeatsWithVisionNotified.end();)
+    SeatMask lostMask = notifiedMask & ~seatsMask;
+    for(std::vector<Seat*>::iterator it = mSeatsWithVisionNotified.begin(); (lostMask != 0) && (it != mSeatsWithVisionNotified.end());)
     {
         Seat* seat = *it;
-        // If the seat is still in the list, nothing to do
-        if(std::find(seats.begin(), seats.end(), seat) != seats.end())
+        if((lostMask & seat->getSeatMask()) == 0)
         {
             ++it;
             continue;
@@ -301,12 +309,14 @@ void GameEntity::notifySeatsWithVision(const std::vector<Seat*>& seats)
     }
 
     // We notify seats that gain vision
+    SeatMask gainedMask = seatsMask & ~notifiedMask;
     for(Seat* seat : seats)
     {
-        // If the seat was already in the list, nothing to do
-        if(std::find(mSeatsWithVisionNotified.begin(), mSeatsWithVisionNotified.end(), seat) != mSeatsWithVisionNotified.end())
+        if((gainedMask & seat->getSeatMask()) == 0)
             continue;
 
+        // A seat can be in the given list several times
+        gainedMask &= ~seat->getSeatMask();
         mSeatsWithVisionNotified.push_back(seat);
 
         if(seat->getPlayer() == nullptr)
@@ -375,6 +385,7 @@ void GameEntity::exportToPacket(ODPacket& os, const Seat* seat) const
     if(mSeat != nullptr)
         seatId = mSeat->getId();
 
+    os << mNetworkId;
     os << seatId;
     os << mName;
     os << mMeshName;
@@ -389,6 +400,7 @@ void GameEntity::exportToPacket(ODPacket& os, const Seat* seat) const
 void GameEntity::importFromPacket(ODPacket& is)
 {
     int seatId;
+    OD_ASSERT_TRUE(is >> mNetworkId);
     OD_ASSERT_TRUE(is >> seatId);
     if(seatId != -1)
         mSeat = mGameMap->getSeatById(seatId);
@@ -591,7 +603,7 @@ void GameEntity::destroyMesh()
     destroyMeshLocal();
 }
 
-void GameEntity::exportToPacketForUpdate(ODPacket& os, const Seat* seat) const
+void GameEntity::exportToPacketForUpdate(ODPacket& os, Seat* seat) const
 {
     uint32_t nbCreatureEffect = mEntityParticleEffects.size();
     os << nbCreatureEffect;
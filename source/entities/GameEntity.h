@@ -168,6 +168,12 @@ class GameEntity
     inline const std::string& getName() const
     { return mName; }
 
+    //! \brief Get the id used to identify the object in the messages between the server and the clients.
+    //! It is given by the server when the object is created and sent to the clients with the object.
+    //! 0 if the object has no id
+    inline uint32_t getNetworkId() const
+    { return mNetworkId; }
+
     //! \brief Get the mesh name of the object
     inline const std::string& getMeshName() const
     { return mMeshName; }
@@ -256,8 +262,10 @@ class GameEntity
     //! \brief Exports the entity so that it can be updated on server side. exportToPacketForUpdate should be
     //! called on server side and the packet should be given to the corresponding entity in updateFromPacket
     //! exportToPacketForUpdate and updateFromPacket works like exportToPacket and importFromPacket but for entities
-    //! that already exist on client side and that we only want to update (for example a creature that levels up)
-    virtual void exportToPacketForUpdate(ODPacket& os, const Seat* seat) const;
+    //! that already exist on client side and that we only want to update (for example a creature that levels up).
+    //! Some entities only send the fields that changed since the last update sent to the seat. That is why
+    //! the seat is not const
+    virtual void exportToPacketForUpdate(ODPacket& os, Seat* seat) const;
     virtual void updateFromPacket(ODPacket& is);
 
     //! \brief Get if the object can be attacked or not
@@ -426,6 +434,9 @@ class GameEntity
     //! brief The name of the entity
     std::string mName;
 
+    //! \brief The id of the entity in the network messages (see getNetworkId)
+    uint32_t mNetworkId;
+
     //! \brief The name of the mesh
     std::string mMeshName;
 
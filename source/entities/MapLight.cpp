@@ -174,12 +174,9 @@ void MapLight::fireAddEntity(Seat* seat, bool async)
 
 void MapLight::fireRemoveEntity(Seat* seat)
 {
-    const std::string& name = getName();
     ServerNotification *serverNotification = new ServerNotification(
         ServerNotificationType::removeEntity, seat->getPlayer());
-    GameEntityType type = getObjectType();
-    serverNotification->mPacket << type;
-    serverNotification->mPacket << name;
+    serverNotification->mPacket << getNetworkId();
     ODServer::getSingleton().queueServerNotification(serverNotification);
 }
 
@@ -311,6 +308,7 @@ bool MapLight::importFromStream(std::istream& is)
 void MapLight::exportToPacket(ODPacket& os, const Seat* seat) const
 {
     const std::string& name = getName();
+    os << mNetworkId;
     os << name;
     os << mPosition.x << mPosition.y << mPosition.z;
     os << mDiffuseColor.r << mDiffuseColor.g << mDiffuseColor.b;
@@ -322,6 +320,7 @@ void MapLight::exportToPacket(ODPacket& os, const Seat* seat) const
 void MapLight::importFromPacket(ODPacket& is)
 {
     std::string name;
+    OD_ASSERT_TRUE(is >> mNetworkId);
     OD_ASSERT_TRUE(is >> name);
     setName(name);
     OD_ASSERT_TRUE(is >> mPosition.x >> mPosition.y >> mPosition.z);
@@ -105,6 +105,11 @@ public:
 
     virtual void restoreEntityState() override;
 
+    //! \brief Exports the client side state of the walk in progress that exportToPacket does not contain (the
+    //! animation to play when the walk queue is done). Used by the replay keyframes
+    void exportWalkStateToPacket(ODPacket& os) const;
+    void importWalkStateFromPacket(ODPacket& is);
+
     static std::string getMovableGameEntityStreamFormat();
 
 protected:
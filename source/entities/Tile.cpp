@@ -34,6 +34,7 @@
 #include "utils/Helper.h"
 #include "utils/LogManager.h"
 
+#include <algorithm>
 #include <cstddef>
 #include <bitset>
 #include <istream>
@@ -58,8 +59,15 @@ Tile::Tile(GameMap* gameMap, int x, int y, TileType type, double fullness) :
     mFullness           (fullness),
     mRefundPriceRoom    (0),
     mRefundPriceTrap    (0),
+    mSeatsWithVisionMask(0),
+    mIsVisionChanged    (false),
+    mIsOcclusionChanged (false),
+    mIsEntitiesChanged  (false),
+    mIsRefreshNeeded    (false),
     mCoveringBuilding   (nullptr),
+    mFloodFillColor     (static_cast<uint32_t>(FloodFillType::nbValues), NO_FLOODFILL),
     mClaimedPercentage  (0.0),
+    mClaimedTilesSeat   (nullptr),
     mIsRoom             (false),
     mIsTrap             (false),
     mDisplayTileMesh    (true),
@@ -553,115 +561,115 @@ bool Tile::isSameFloodFill(Seat* seat, FloodFillType type, Tile* tile) const
 
 void Tile::resetFloodFill()
 {
-    for(std::vector<uint32_t>& values : mFloodFillColor)
-    {
-        for(uint32_t& floodFillValue : values)
-        {
-            floodFillValue = NO_FLOODFILL;
-        }
-    }
+    for(uint32_t& floodFillValue : mFloodFillColor)
+        floodFillValue = NO_FLOODFILL;
+
+    mFloodFillOverlays.clear();
 }
 
 bool Tile::updateFloodFillFromTile(Seat* seat, FloodFillType type, Tile* tile)
 {
-    if(seat->getTeamIndex() >= mFloodFillColor.size())
-    {
-        static bool logMsg = false;
-        if(!logMsg)
-        {
-            logMsg = true;
-            OD_LOG_ERR("Wrong floodfill seat index seatId=" + Helper::toString(seat->getId())
-                + ", tile=" + Tile::displayAsString(this)
-                + ", seatIndex=" + Helper::toString(seat->getTeamIndex()) + ", floodfillsize=" + Helper::toString(static_cast<uint32_t>(mFloodFillColor.size()))
-                + ", fullness=" + Helper::toString(getFullness()));
-        }
-        return false;
-    }
-
-    std::vector<uint32_t>& values = mFloodFillColor[seat->getTeamIndex()];
-    uint32_t intType = static_cast<uint32_t>(type);
-    if(intType >= values.size())
-    {
-        static bool logMsg = false;
-        if(!logMsg)
-        {
-            logMsg = true;
-            OD_LOG_ERR("Wrong floodfill seat index seatId=" + Helper::toString(seat->getId())
-                + ", tile=" + Tile::displayAsString(this)
-                + ", intType=" + Helper::toString(intType) + ", floodfillsize=" + Helper::toString(static_cast<uint32_t>(values.size())));
-        }
-        return false;
-    }
-
-    if((values[intType] != NO_FLOODFILL) ||
+    if((getFloodFillValue(seat, type) != NO_FLOODFILL) ||
        (tile->getFloodFillValue(seat, type) == NO_FLOODFILL))
     {
         return false;
     }
 
-    values[intType] = tile->getFloodFillValue(seat, type);
+    replaceFloodFill(seat, type, tile->getFloodFillValue(seat, type));
     return true;
 }
 
 void Tile::replaceFloodFill(Seat* seat, FloodFillType type, uint32_t newValue)
 {
-    if(seat->getTeamIndex() >= mFloodFillColor.size())
+    uint32_t intType = static_cast<uint32_t>(type);
+    if(intType >= mFloodFillColor.size())
     {
         static bool logMsg = false;
         if(!logMsg)
         {
             logMsg = true;
-            OD_LOG_ERR("Wrong floodfill seat index seatId=" + Helper::toString(seat->getId())
-                + ", tile=" + Tile::displayAsString(this)
-                + ", seatIndex=" + Helper::toString(seat->getTeamIndex()) + ", floodfillsize=" + Helper::toString(static_cast<uint32_t>(mFloodFillColor.size())));
+            OD_LOG_ERR("Wrong floodfill type tile=" + Tile::displayAsString(this)
+                + ", intType=" + Helper::toString(intType) + ", floodfillsize=" + Helper::toString(static_cast<uint32_t>(mFloodFillColor.size())));
         }
         return;
     }
 
-    std::vector<uint32_t>& values = mFloodFillColor[seat->getTeamIndex()];
-    uint32_t intType = static_cast<uint32_t>(type);
-    if(intType >= values.size())
+    if(seat == nullptr)
     {
-        static bool logMsg = false;
-        if(!logMsg)
+        // The base layer is changed. Teams with an overlay are updated on their own (see GameMap::getFloodFillLayerSeats)
+        // so they should keep seeing the color they had before
+        uint32_t oldValue = mFloodFillColor[intType];
+        if((oldValue != NO_FLOODFILL) && (oldValue != newValue))
         {
-            logMsg = true;
-            OD_LOG_ERR("Wrong floodfill seat index seatId=" + Helper::toString(seat->getId())
-                + ", tile=" + Tile::displayAsString(this)
-                + ", intType=" + Helper::toString(intType) + ", floodfillsize=" + Helper::toString(static_cast<uint32_t>(values.size())));
+            uint32_t nbTeams = static_cast<uint32_t>(getGameMap()->getTeamIds().size());
+            for(uint32_t teamIndex = 0; teamIndex < nbTeams; ++teamIndex)
+            {
+                if(!getGameMap()->hasFloodFillOverlay(teamIndex))
+                    continue;
+
+                if(getFloodFillOverlay(teamIndex) != nullptr)
+                    continue;
+
+                FloodFillOverlay overlay;
+                overlay.mTeamIndex = teamIndex;
+                overlay.mColors = mFloodFillColor;
+                mFloodFillOverlays.push_back(overlay);
+            }
         }
+
+        mFloodFillColor[intType] = newValue;
         return;
     }
 
-    values[intType] = newValue;
+    std::vector<uint32_t>* colors = getFloodFillOverlay(seat->getTeamIndex());
+    if(colors == nullptr)
+    {
+        // The tile only needs an overlay if the team does not see it like the base layer
+        if(getGameMap()->getFloodFillRepresentative(seat, mFloodFillColor[intType]) == getGameMap()->getFloodFillRepresentative(seat, newValue))
+            return;
+
+        FloodFillOverlay overlay;
+        overlay.mTeamIndex = seat->getTeamIndex();
+        overlay.mColors = mFloodFillColor;
+        mFloodFillOverlays.push_back(overlay);
+        colors = &mFloodFillOverlays.back().mColors;
+    }
+
+    (*colors)[intType] = newValue;
 }
 
-void Tile::copyFloodFillToOtherSeats(Seat* seatToCopy)
+void Tile::removeFloodFillOverlay(uint32_t teamIndex)
 {
-    if(seatToCopy->getTeamIndex() >= mFloodFillColor.size())
+    for(auto it = mFloodFillOverlays.begin(); it != mFloodFillOverlays.end(); ++it)
     {
-        static bool logMsg = false;
-        if(!logMsg)
-        {
-            logMsg = true;
-            OD_LOG_ERR("Wrong floodfill seat index seatId=" + Helper::toString(seatToCopy->getId())
-                + ", tile=" + Tile::displayAsString(this)
-                + ", seatIndex=" + Helper::toString(seatToCopy->getTeamIndex()) + ", floodfillsize=" + Helper::toString(static_cast<uint32_t>(mFloodFillColor.size())));
-        }
+        if(it->mTeamIndex != teamIndex)
+            continue;
+
+        mFloodFillOverlays.erase(it);
         return;
     }
+}
 
-    std::vector<uint32_t>& valuesToCopy = mFloodFillColor[seatToCopy->getTeamIndex()];
-    for(uint32_t indexFloodFill = 0; indexFloodFill < mFloodFillColor.size(); ++indexFloodFill)
+std::vector<uint32_t>* Tile::getFloodFillOverlay(uint32_t teamIndex)
+{
+    for(FloodFillOverlay& overlay : mFloodFillOverlays)
     {
-        if(seatToCopy->getTeamIndex() == indexFloodFill)
-            continue;
+        if(overlay.mTeamIndex == teamIndex)
+            return &overlay.mColors;
+    }
 
-        std::vector<uint32_t>& values = mFloodFillColor[indexFloodFill];
-        for(uint32_t intType = 0; intType < static_cast<uint32_t>(FloodFillType::nbValues); ++intType)
-            values[intType] = valuesToCopy[intType];
+    return nullptr;
+}
 
+const std::vector<uint32_t>* Tile::getFloodFillOverlay(uint32_t teamIndex) const
+{
+    for(const FloodFillOverlay& overlay : mFloodFillOverlays)
+    {
+        if(overlay.mTeamIndex == teamIndex)
+            return &overlay.mColors;
     }
+
+    return nullptr;
 }
 
 void Tile::logFloodFill() const
@@ -670,10 +678,17 @@ void Tile::logFloodFill() const
         + " - type=" + Tile::tileVisualToString(getTileVisual())
         + " - fullness=" + Helper::toString(getFullness())
         + " - seatId=" + std::string(getSeat() == nullptr ? "-1" : Helper::toString(getSeat()->getId()));
-    for(const std::vector<uint32_t>& values : mFloodFillColor)
+    int cpt = 0;
+    for(const uint32_t& floodFill : mFloodFillColor)
+    {
+        str += ", [" + Helper::toString(cpt) + "]=" + Helper::toString(floodFill);
+        ++cpt;
+    }
+    for(const FloodFillOverlay& overlay : mFloodFillOverlays)
     {
-        int cpt = 0;
-        for(const uint32_t& floodFill : values)
+        str += " - team=" + Helper::toString(overlay.mTeamIndex);
+        cpt = 0;
+        for(const uint32_t& floodFill : overlay.mColors)
         {
             str += ", [" + Helper::toString(cpt) + "]=" + Helper::toString(floodFill);
             ++cpt;
@@ -719,58 +734,82 @@ bool Tile::isClaimed() const
     return true;
 }
 
-void Tile::clearVision()
+void Tile::addVisionRef(Seat* seat)
 {
-    mSeatsWithVision.clear();
+    // Allied seats share vision
+    SeatMask visionMask = seat->getVisionMask();
+    for(uint32_t seatIndex = 0; visionMask != 0; ++seatIndex, visionMask >>= 1)
+    {
+        if((visionMask & 1) != 0)
+            incrementVisionCount(seatIndex);
+    }
 }
 
-void Tile::notifyVision(Seat* seat)
+void Tile::removeVisionRef(Seat* seat)
 {
-    if(std::find(mSeatsWithVision.begin(), mSeatsWithVision.end(), seat) != mSeatsWithVision.end())
+    SeatMask visionMask = seat->getVisionMask();
+    for(uint32_t seatIndex = 0; visionMask != 0; ++seatIndex, visionMask >>= 1)
+    {
+        if((visionMask & 1) != 0)
+            decrementVisionCount(seatIndex);
+    }
+}
+
+bool Tile::hasVision(const Seat* seat) const
+{
+    return (mSeatsWithVisionMask & seat->getSeatMask()) != 0;
+}
+
+void Tile::incrementVisionCount(uint32_t seatIndex)
+{
+    if(seatIndex >= mVisionCounts.size())
+        mVisionCounts.resize(seatIndex + 1, 0);
+
+    ++mVisionCounts[seatIndex];
+    if(mVisionCounts[seatIndex] > 1)
         return;
 
-    seat->notifyVisionOnTile(this);
+    Seat* seat = getGameMap()->getSeatByIndex(seatIndex);
+    mSeatsWithVisionMask |= seatMaskFromIndex(seatIndex);
     mSeatsWithVision.push_back(seat);
-
-    // We also notify vision for allied seats
-    for(Seat* alliedSeat : seat->getAlliedSeats())
-        notifyVision(alliedSeat);
+    seat->notifyVisionOnTile(this);
+    getGameMap()->tileEntitiesChanged(this);
 }
 
-void Tile::setSeats(const std::vector<Seat*>& seats)
+void Tile::decrementVisionCount(uint32_t seatIndex)
 {
-    mTileChangedForSeats.clear();
-    for(Seat* seat : seats)
+    if((seatIndex >= mVisionCounts.size()) || (mVisionCounts[seatIndex] == 0))
     {
-        // Every tile should be notified by default
-        std::pair<Seat*, bool> p(seat, true);
-        mTileChangedForSeats.push_back(p);
+        OD_LOG_ERR("Vision released without reference tile=" + Tile::displayAsString(this) + ", seatIndex=" + Helper::toString(seatIndex));
+        return;
     }
+
+    --mVisionCounts[seatIndex];
+    if(mVisionCounts[seatIndex] > 0)
+        return;
+
+    Seat* seat = getGameMap()->getSeatByIndex(seatIndex);
+    mSeatsWithVisionMask &= ~seatMaskFromIndex(seatIndex);
+    mSeatsWithVision.erase(std::find(mSeatsWithVision.begin(), mSeatsWithVision.end(), seat));
+    seat->notifyVisionLostOnTile(this);
+    getGameMap()->tileEntitiesChanged(this);
 }
 
-bool Tile::hasChangedForSeat(Seat* seat) const
+void Tile::setSeats(const std::vector<Seat*>& seats)
 {
-    for(const std::pair<Seat*, bool>& seatChanged : mTileChangedForSeats)
-    {
-        if(seatChanged.first != seat)
-            continue;
+    // Every tile should be notified by default
+    getGameMap()->getTileSeatsChangedMask(mX, mY) = Seat::buildSeatMask(seats);
+    getGameMap()->tileRefreshNeeded(this);
+}
 
-        return seatChanged.second;
-    }
-    OD_LOG_ERR("tile=" + Tile::displayAsString(this) + ", unknown seat id=" + Helper::toString(seat->getId()));
-    return false;
+bool Tile::hasChangedForSeat(Seat* seat) const
+{
+    return (getGameMap()->getTileSeatsChangedMask(mX, mY) & seat->getSeatMask()) != 0;
 }
 
 void Tile::changeNotifiedForSeat(Seat* seat)
 {
-    for(std::pair<Seat*, bool>& seatChanged : mTileChangedForSeats)
-    {
-        if(seatChanged.first != seat)
-            continue;
-
-        seatChanged.second = false;
-        break;
-    }
+    getGameMap()->getTileSeatsChangedMask(mX, mY) &= ~seat->getSeatMask();
 }
 
 void Tile::computeTileVisual()
@@ -842,41 +881,28 @@ void Tile::computeTileVisual()
 
 uint32_t Tile::getFloodFillValue(Seat* seat, FloodFillType type) const
 {
-    if(seat->getTeamIndex() >= mFloodFillColor.size())
-    {
-        static bool logMsg = false;
-        if(!logMsg)
-        {
-            logMsg = true;
-            OD_LOG_ERR("Wrong floodfill seat index seatId=" + Helper::toString(seat->getId())
-                + ", tile=" + Tile::displayAsString(this)
-                + ", seatIndex=" + Helper::toString(seat->getTeamIndex()) + ", floodfillsize=" + Helper::toString(static_cast<uint32_t>(mFloodFillColor.size()))
-                + ", fullness=" + Helper::toString(getFullness()));
-        }
-        return NO_FLOODFILL;
-    }
-
-    const std::vector<uint32_t>& values = mFloodFillColor[seat->getTeamIndex()];
     uint32_t intType = static_cast<uint32_t>(type);
-    if(intType >= values.size())
+    if(intType >= mFloodFillColor.size())
     {
         static bool logMsg = false;
         if(!logMsg)
         {
             logMsg = true;
-            OD_LOG_ERR("Wrong floodfill seat index seatId=" + Helper::toString(seat->getId())
-                + ", tile=" + Tile::displayAsString(this)
-                + ", intType=" + Helper::toString(intType) + ", floodfillsize=" + Helper::toString(static_cast<uint32_t>(values.size())));
+            OD_LOG_ERR("Wrong floodfill type tile=" + Tile::displayAsString(this)
+                + ", intType=" + Helper::toString(intType) + ", floodfillsize=" + Helper::toString(static_cast<uint32_t>(mFloodFillColor.size())));
         }
         return NO_FLOODFILL;
     }
 
-    return values.at(intType);
-}
+    // If the team has an overlay on this tile, it is used. Otherwise, the team sees the tile like the base layer
+    const std::vector<uint32_t>* colors = nullptr;
+    if(seat != nullptr)
+        colors = getFloodFillOverlay(seat->getTeamIndex());
+    if(colors == nullptr)
+        colors = &mFloodFillColor;
 
-void Tile::setTeamsNumber(uint32_t nbTeams)
-{
-    mFloodFillColor = std::vector<std::vector<uint32_t>>(nbTeams, std::vector<uint32_t>(static_cast<uint32_t>(FloodFillType::nbValues), NO_FLOODFILL));
+    // Areas are merged without changing the tiles colors. We return the color the tile color has been merged into
+    return getGameMap()->getFloodFillRepresentative(seat, colors->at(intType));
 }
 
 bool Tile::shouldColorTileMesh() const
@@ -916,10 +942,20 @@ void Tile::setFullness(double f)
         if(!getGameMap()->isInEditorMode())
         {
             // Do a flood fill to update the contiguous region touching the tile.
-            for(Seat* seat : getGameMap()->getSeats())
+            for(Seat* seat : getGameMap()->getFloodFillLayerSeats())
                 getGameMap()->refreshFloodFill(seat, this);
+
+            getGameMap()->tilePassabilityChanged(this);
         }
     }
+
+    // Walls block vision
+    if((oldFullness > 0.0) != (mFullness > 0.0))
+    {
+        getGameMap()->refreshTileOpacity(this);
+        if(getIsOnServerMap() && !getGameMap()->isInEditorMode())
+            getGameMap()->tileVisionChanged(this, true);
+    }
 }
 
 void Tile::createMeshLocal()
@@ -961,14 +997,15 @@ void Tile::setCoveringBuilding(Building *building)
 
     // We set the tile as dirty for all seats if needed (we have to check because we
     // don't want to refresh tiles for traps for enemy players)
-    if(mCoveringBuilding != nullptr)
+    if(getIsOnServerMap() && (mCoveringBuilding != nullptr))
     {
-        for(std::pair<Seat*, bool>& seatChanged : mTileChangedForSeats)
+        for(Seat* seat : getGameMap()->getSeats())
         {
-            if(!mCoveringBuilding->shouldSetCoveringTileDirty(seatChanged.first, this))
+            if(!mCoveringBuilding->shouldSetCoveringTileDirty(seat, this))
                 continue;
 
-            seatChanged.second = true;
+            getGameMap()->getTileSeatsChangedMask(mX, mY) |= seat->getSeatMask();
+            getGameMap()->tileRefreshNeeded(this);
         }
     }
     mCoveringBuilding = building;
@@ -988,17 +1025,31 @@ void Tile::setCoveringBuilding(Building *building)
 
     if(mCoveringBuilding != nullptr)
     {
-        for(std::pair<Seat*, bool>& seatChanged : mTileChangedForSeats)
+        if(getIsOnServerMap())
         {
-            if(!mCoveringBuilding->shouldSetCoveringTileDirty(seatChanged.first, this))
-                continue;
+            for(Seat* seat : getGameMap()->getSeats())
+            {
+                if(!mCoveringBuilding->shouldSetCoveringTileDirty(seat, this))
+                    continue;
 
-            seatChanged.second = true;
+                getGameMap()->getTileSeatsChangedMask(mX, mY) |= seat->getSeatMask();
+                getGameMap()->tileRefreshNeeded(this);
+            }
         }
 
         // Set the tile as claimed and of the team color of the building
         setSeat(mCoveringBuilding->getSeat());
         mClaimedPercentage = 1.0;
+        refreshClaimedTilesCount();
+    }
+
+    // Buildings like bridges or doors change the way creatures go through the tile. They can also block vision
+    getGameMap()->refreshTileOpacity(this);
+    if(getIsOnServerMap())
+    {
+        // Removing a building (like a door) may open paths without changing the tile passability mask
+        getGameMap()->tilePassabilityChanged(this, true);
+        getGameMap()->tileVisionChanged(this, true);
     }
 }
 
@@ -1019,41 +1070,73 @@ bool Tile::isGroundClaimable(Seat* seat) const
     return true;
 }
 
-void Tile::exportToPacketForUpdate(ODPacket& os, const Seat* seat) const
+void Tile::exportToPacketForUpdate(ODPacket& os, Seat* seat) const
 {
     exportToPacketForUpdate(os, seat, false);
 }
 
-void Tile::exportToPacketForUpdate(ODPacket& os, const Seat* seat, bool hideSeatId) const
+void Tile::exportToPacketForUpdate(ODPacket& os, Seat* seat, bool hideSeatId) const
 {
     GameEntity::exportToPacketForUpdate(os, seat);
 
     seat->exportTileToPacket(os, this, hideSeatId);
 }
 
+void Tile::exportToPacketForReplay(ODPacket& os) const
+{
+    GameEntity::exportToPacketForUpdate(os, nullptr);
+
+    TileUpdateValues values;
+    values.mIsRoom = mIsRoom;
+    values.mIsTrap = mIsTrap;
+    values.mRefundPriceRoom = mRefundPriceRoom;
+    values.mRefundPriceTrap = mRefundPriceTrap;
+    values.mDisplayTileMesh = mDisplayTileMesh;
+    values.mColorCustomMesh = mColorCustomMesh;
+    values.mHasBridge = mHasBridge;
+    if(getSeat() != nullptr)
+        values.mSeatId = getSeat()->getId();
+    values.mMeshName = getMeshName();
+    values.mTileVisual = mTileVisual;
+    values.exportToPacket(os, TileUpdateFields::All);
+}
+
 void Tile::updateFromPacket(ODPacket& is)
 {
     GameEntity::updateFromPacket(is);
 
-    // This function should read parameters as sent by Tile::exportToPacketForUpdate
-    int seatId;
-    std::string meshName;
+    // This function should read parameters as sent by Tile::exportToPacketForUpdate. Only the fields
+    // that changed since the last update are sent
+    uint16_t fields;
     std::stringstream ss;
 
-    // We set the seat if there is one
-    OD_ASSERT_TRUE(is >> mIsRoom);
-    OD_ASSERT_TRUE(is >> mIsTrap);
-    OD_ASSERT_TRUE(is >> mRefundPriceRoom);
-    OD_ASSERT_TRUE(is >> mRefundPriceTrap);
+    OD_ASSERT_TRUE(is >> fields);
+    if((fields & TileUpdateFields::IsRoom) != 0)
+        OD_ASSERT_TRUE(is >> mIsRoom);
+    if((fields & TileUpdateFields::IsTrap) != 0)
+        OD_ASSERT_TRUE(is >> mIsTrap);
+    if((fields & TileUpdateFields::RefundPriceRoom) != 0)
+        OD_ASSERT_TRUE(is >> mRefundPriceRoom);
+    if((fields & TileUpdateFields::RefundPriceTrap) != 0)
+        OD_ASSERT_TRUE(is >> mRefundPriceTrap);
 
-    OD_ASSERT_TRUE(is >> mDisplayTileMesh);
-    OD_ASSERT_TRUE(is >> mColorCustomMesh);
-    OD_ASSERT_TRUE(is >> mHasBridge);
+    if((fields & TileUpdateFields::DisplayTileMesh) != 0)
+        OD_ASSERT_TRUE(is >> mDisplayTileMesh);
+    if((fields & TileUpdateFields::ColorCustomMesh) != 0)
+        OD_ASSERT_TRUE(is >> mColorCustomMesh);
+    if((fields & TileUpdateFields::HasBridge) != 0)
+        OD_ASSERT_TRUE(is >> mHasBridge);
 
-    OD_ASSERT_TRUE(is >> seatId);
+    int seatId = -1;
+    if((fields & TileUpdateFields::SeatId) != 0)
+        OD_ASSERT_TRUE(is >> seatId);
 
-    OD_ASSERT_TRUE(is >> meshName);
-    setMeshName(meshName);
+    if((fields & TileUpdateFields::MeshName) != 0)
+    {
+        std::string meshName;
+        OD_ASSERT_TRUE(is >> meshName);
+        setMeshName(meshName);
+    }
 
     ss.str(std::string());
     ss << TILE_PREFIX;
@@ -1063,18 +1146,21 @@ void Tile::updateFromPacket(ODPacket& is)
 
     setName(ss.str());
 
-    OD_ASSERT_TRUE(is >> mTileVisual);
+    if((fields & TileUpdateFields::Visual) != 0)
+        OD_ASSERT_TRUE(is >> mTileVisual);
 
-    if(seatId == -1)
-    {
-        setSeat(nullptr);
-    }
-    else
+    if((fields & TileUpdateFields::SeatId) != 0)
     {
-        Seat* seat = getGameMap()->getSeatById(seatId);
-        if(seat != nullptr)
-            setSeat(seat);
-
+        if(seatId == -1)
+        {
+            setSeat(nullptr);
+        }
+        else
+        {
+            Seat* seat = getGameMap()->getSeatById(seatId);
+            if(seat != nullptr)
+                setSeat(seat);
+        }
     }
 
     // We need to check if the tile is unmarked after reading the needed information.
@@ -1153,6 +1239,7 @@ void Tile::loadFromLine(const std::string& line, Tile *t)
         return;
     t->setSeat(seat);
     t->mClaimedPercentage = 1.0;
+    t->refreshClaimedTilesCount();
 }
 
 void Tile::refreshMesh()
@@ -1203,6 +1290,11 @@ bool Tile::addEntity(GameEntity *entity)
         entity->setParentNodeDetachFlags(
             EntityParentNodeAttach::DETACH_CULLING, mTileCulling == CullingType::HIDE);
     }
+    else
+    {
+        // Seats with vision on this tile should be notified of the new entity
+        getGameMap()->tileEntitiesChanged(this);
+    }
     fireTileStateChanged();
     return true;
 }
@@ -1217,6 +1309,9 @@ void Tile::removeEntity(GameEntity *entity)
     }
 
     mEntitiesInTile.erase(it);
+    if(getIsOnServerMap())
+        getGameMap()->tileEntitiesChanged(this);
+
     fireTileStateChanged();
 }
 
@@ -1242,6 +1337,7 @@ void Tile::claimForSeat(Seat* seat, double nDanceRate)
     }
     else
     {
+        bool wasClaimed = isClaimed();
         mClaimedPercentage -= nDanceRate;
         if (mClaimedPercentage <= 0.0)
         {
@@ -1255,13 +1351,20 @@ void Tile::claimForSeat(Seat* seat, double nDanceRate)
             computeTileVisual();
             setDirtyForAllSeats();
         }
+
+        // A tile that is not fully claimed anymore does not give vision
+        if(wasClaimed && !isClaimed() && getIsOnServerMap())
+            getGameMap()->tileVisionChanged(this, false);
     }
 
     if ((getSeat() != nullptr) && (mClaimedPercentage >= 1.0) &&
         (getSeat()->isAlliedSeat(seat)))
     {
         claimTile(seat);
+        return;
     }
+
+    refreshClaimedTilesCount();
 }
 
 void Tile::claimTile(Seat* seat)
@@ -1273,6 +1376,7 @@ void Tile::claimTile(Seat* seat)
     // We need this because if we are a client, the tile may be from a non allied seat
     setSeat(seat);
     mClaimedPercentage = 1.0;
+    refreshClaimedTilesCount();
 
     if(isFullTile())
         fireTileSound(TileSound::ClaimWall);
@@ -1297,9 +1401,32 @@ void Tile::claimTile(Seat* seat)
         }
     }
 
+    if(getIsOnServerMap())
+    {
+        getGameMap()->tilePassabilityChanged(this);
+        getGameMap()->tileVisionChanged(this, false);
+    }
+
     fireTileStateChanged();
 }
 
+void Tile::refreshClaimedTilesCount()
+{
+    if(!getIsOnServerMap())
+        return;
+
+    Seat* seat = isClaimed() ? getSeat() : nullptr;
+    if(seat == mClaimedTilesSeat)
+        return;
+
+    if(mClaimedTilesSeat != nullptr)
+        mClaimedTilesSeat->decrementNumClaimedTiles();
+
+    mClaimedTilesSeat = seat;
+    if(mClaimedTilesSeat != nullptr)
+        mClaimedTilesSeat->incrementNumClaimedTiles();
+}
+
 void Tile::unclaimTile()
 {
     // Unclaim the tile.
@@ -1308,6 +1435,7 @@ void Tile::unclaimTile()
 
     setSeat(nullptr);
     mClaimedPercentage = 0.0;
+    refreshClaimedTilesCount();
 
     computeTileVisual();
     setDirtyForAllSeats();
@@ -1324,6 +1452,12 @@ void Tile::unclaimTile()
         }
     }
 
+    if(getIsOnServerMap())
+    {
+        getGameMap()->tilePassabilityChanged(this);
+        getGameMap()->tileVisionChanged(this, false);
+    }
+
     fireTileStateChanged();
 }
 
@@ -1711,21 +1845,20 @@ void Tile::computeVisibleTiles()
     if(!getGameMap()->getIsFOWActivated())
     {
         // If the FOW is deactivated, we allow vision for every seat
-        for(Seat* seat : getGameMap()->getSeats())
-            notifyVision(seat);
-
+        mVisionSource.setTiles(getGameMap()->getSeats(), std::vector<Tile*>(1, this));
         return;
     }
 
     if(!isClaimed())
+    {
+        mVisionSource.clear();
         return;
+    }
 
     // A claimed tile can see it self and its neighboors
-    notifyVision(getSeat());
-    for(Tile* tile : mNeighbors)
-    {
-        tile->notifyVision(getSeat());
-    }
+    std::vector<Tile*> tiles = mNeighbors;
+    tiles.push_back(this);
+    mVisionSource.setTiles(std::vector<Seat*>(1, getSeat()), tiles);
 }
 
 void Tile::setDirtyForAllSeats()
@@ -1733,8 +1866,8 @@ void Tile::setDirtyForAllSeats()
     if(!getIsOnServerMap())
         return;
 
-    for(std::pair<Seat*, bool>& seatChanged : mTileChangedForSeats)
-        seatChanged.second = true;
+    getGameMap()->getTileSeatsChangedMask(mX, mY) = Seat::buildSeatMask(getGameMap()->getSeats());
+    getGameMap()->tileRefreshNeeded(this);
 }
 
 void Tile::notifyEntitiesSeatsWithVision()
@@ -19,6 +19,8 @@
 #define TILE_H
 
 #include "entities/GameEntity.h"
+#include "game/SeatMask.h"
+#include "gamemap/VisionSource.h"
 
 #include <OgreVector3.h>
 
@@ -99,6 +101,24 @@ ODPacket& operator>>(ODPacket& is, TileVisual& type);
 std::ostream& operator<<(std::ostream& os, const TileVisual& type);
 std::istream& operator>>(std::istream& is, TileVisual& type);
 
+//! Fields of the tile updates sent to the clients (see Seat::exportTileToPacket). An update starts with the
+//! mask of the fields it contains. Only the fields that changed since the last update sent to the seat are sent
+namespace TileUpdateFields
+{
+    const uint16_t Nothing = 0x0000;
+    const uint16_t IsRoom = 0x0001;
+    const uint16_t IsTrap = 0x0002;
+    const uint16_t RefundPriceRoom = 0x0004;
+    const uint16_t RefundPriceTrap = 0x0008;
+    const uint16_t DisplayTileMesh = 0x0010;
+    const uint16_t ColorCustomMesh = 0x0020;
+    const uint16_t HasBridge = 0x0040;
+    const uint16_t SeatId = 0x0080;
+    const uint16_t MeshName = 0x0100;
+    const uint16_t Visual = 0x0200;
+    const uint16_t All = 0x03FF;
+}
+
 enum class FloodFillType
 {
     ground = 0,
@@ -272,6 +292,10 @@ public:
     void claimForSeat(Seat* seat, double nDanceRate);
     void claimTile(Seat* seat);
     void unclaimTile();
+
+    //! \brief Updates the claimed tiles count of the seats if the tile got claimed, unclaimed or changed
+    //! owner. Should be called on server side each time the seat or the claiming of the tile may have changed
+    void refreshClaimedTilesCount();
     double digOut(double digRate);
 
     inline Building* getCoveringBuilding() const
@@ -366,10 +390,42 @@ public:
     //! Fills the given vector with corresponding entities on this tile.
     void fillWithEntities(std::vector<GameEntity*>& entities, SelectionEntityWanted entityWanted, Player* player);
 
-    //! \brief Computes the visible tiles and tags them to know which are visible
+    //! \brief Updates the tiles this tile gives vision on (itself and its neighbors if claimed). It is
+    //! only called when the tile has changed (see GameMap::tileVisionChanged)
     void computeVisibleTiles();
-    void clearVision();
-    void notifyVision(Seat* seat);
+
+    //! \brief Adds/removes a vision reference on this tile for the given seat and its allies. The seats are
+    //! notified when they gain or lose vision (see VisionSource)
+    void addVisionRef(Seat* seat);
+    void removeVisionRef(Seat* seat);
+
+    //! \brief Releases the tiles this tile gives vision on
+    void clearVisionSource()
+    { mVisionSource.clear(); }
+
+    inline bool getIsVisionChanged() const
+    { return mIsVisionChanged; }
+
+    inline void setIsVisionChanged(bool isVisionChanged)
+    { mIsVisionChanged = isVisionChanged; }
+
+    inline bool getIsOcclusionChanged() const
+    { return mIsOcclusionChanged; }
+
+    inline void setIsOcclusionChanged(bool isOcclusionChanged)
+    { mIsOcclusionChanged = isOcclusionChanged; }
+
+    inline bool getIsEntitiesChanged() const
+    { return mIsEntitiesChanged; }
+
+    inline void setIsEntitiesChanged(bool isEntitiesChanged)
+    { mIsEntitiesChanged = isEntitiesChanged; }
+
+    inline bool getIsRefreshNeeded() const
+    { return mIsRefreshNeeded; }
+
+    inline void setIsRefreshNeeded(bool isRefreshNeeded)
+    { mIsRefreshNeeded = isRefreshNeeded; }
 
     void setSeats(const std::vector<Seat*>& seats);
     bool hasChangedForSeat(Seat* seat) const;
@@ -380,6 +436,11 @@ public:
     const std::vector<Seat*>& getSeatsWithVision()
     { return mSeatsWithVision; }
 
+    inline SeatMask getSeatsWithVisionMask() const
+    { return mSeatsWithVisionMask; }
+
+    bool hasVision(const Seat* seat) const;
+
     void resetFloodFill();
 
     static std::string toString(FloodFillType type);
@@ -390,11 +451,14 @@ public:
     //! returns true if the floodfill has been updated and false otherwise
     bool updateFloodFillFromTile(Seat* seat, FloodFillType type, Tile* tile);
 
-    //! Sets the floodfill value corresponding at type to newValue
+    //! Sets the floodfill value corresponding at type to newValue. If seat is nullptr, the base layer
+    //! shared by all the teams is changed. Otherwise, only the team of the given seat is changed
     void replaceFloodFill(Seat* seat, FloodFillType type, uint32_t newValue);
 
-    void copyFloodFillToOtherSeats(Seat* seatToCopy);
+    //! Removes the floodfill values specific to the given team. It will use the base layer again
+    void removeFloodFillOverlay(uint32_t teamIndex);
 
+    //! Returns the floodfill value for the team of the given seat (or the base layer if seat is nullptr)
     uint32_t getFloodFillValue(Seat* seat, FloodFillType type) const;
 
     void logFloodFill() const;
@@ -413,9 +477,6 @@ public:
     //! server and client
     bool isFullTile() const;
 
-    //! Sets the number of teams in this gamemap (after seat configuration). This number includes the rogue team.
-    void setTeamsNumber(uint32_t nbTeams);
-
     //! \brief returns true if the mesh from the tileset should be displayed and false otherwise
     inline bool shouldDisplayTileMesh() const
     { return mDisplayTileMesh; }
@@ -458,9 +519,13 @@ public:
 
     static void exportToStream(Tile* tile, std::ostream& os);
 
-    virtual void exportToPacketForUpdate(ODPacket& os, const Seat* seat) const override;
+    virtual void exportToPacketForUpdate(ODPacket& os, Seat* seat) const override;
     virtual void updateFromPacket(ODPacket& is) override;
-    void exportToPacketForUpdate(ODPacket& os, const Seat* seat, bool hideSeatId) const;
+    void exportToPacketForUpdate(ODPacket& os, Seat* seat, bool hideSeatId) const;
+
+    //! \brief Exports the tile as known by the local player in the format read by updateFromPacket. Used
+    //! on client side to save the map state in the replays
+    void exportToPacketForReplay(ODPacket& os) const;
 
     bool addTileStateListener(TileStateListener& listener);
     bool removeTileStateListener(TileStateListener& listener);
@@ -507,19 +572,45 @@ private:
 
     std::vector<Tile*> mNeighbors;
     std::vector<const Player*> mPlayersMarkingTile;
-    std::vector<std::pair<Seat*, bool>> mTileChangedForSeats;
     std::vector<Seat*> mSeatsWithVision;
+    SeatMask mSeatsWithVisionMask;
+    //! \brief Number of vision sources for each seat. Indexed by seat index
+    std::vector<uint32_t> mVisionCounts;
+
+    //! \brief Tiles this tile gives vision on
+    VisionSource mVisionSource;
+
+    //! \brief True if the tile is waiting in the GameMap to recompute its vision source
+    bool mIsVisionChanged;
+    //! \brief True if the tile is waiting in the GameMap to notify the vision sources that it blocks vision differently
+    bool mIsOcclusionChanged;
+    //! \brief True if the tile is waiting in the GameMap to notify its entities of the seats with vision
+    bool mIsEntitiesChanged;
+    //! \brief True if the tile is waiting in the GameMap to be sent to the seats it changed for
+    bool mIsRefreshNeeded;
 
     //! \brief List of the entities actually on this tile. Most of the creatures actions will rely on this list
     std::vector<GameEntity*> mEntitiesInTile;
 
     Building* mCoveringBuilding;
-    //! Floodfill values per seat and per floodfill type
-    std::vector<std::vector<uint32_t>> mFloodFillColor;
+    //! \brief Floodfill values specific to a team
+    struct FloodFillOverlay
+    {
+        uint32_t mTeamIndex;
+        std::vector<uint32_t> mColors;
+    };
+
+    //! Floodfill values per floodfill type shared by all the teams (base layer)
+    std::vector<uint32_t> mFloodFillColor;
+    //! Teams only differ from the base layer near their locked doors. Most tiles have no overlay
+    std::vector<FloodFillOverlay> mFloodFillOverlays;
 
     //! \brief The tile claiming. Used on server side only
     double mClaimedPercentage;
 
+    //! \brief Seat whose claimed tiles count includes this tile (nullptr if none). Used on server side only
+    Seat* mClaimedTilesSeat;
+
     //! \brief True if a building is on this tile. False otherwise. It is used on client side because the clients do not know about
     //! buildings. However, it needs to know the tiles where a building is to display the room/trap costs.
     bool mIsRoom;
@@ -545,6 +636,9 @@ private:
 
     void setDirtyForAllSeats();
 
+    void incrementVisionCount(uint32_t seatIndex);
+    void decrementVisionCount(uint32_t seatIndex);
+
     //! \brief Vector with the number of workers digging the tile. The index corresponds
     //! to the index in mNeighbors
     std::vector<uint32_t> mNbWorkersDigging;
@@ -552,6 +646,10 @@ private:
     std::vector<TileStateListener*> mStateListeners;
 
     void fireTileStateChanged();
+
+    //! \brief Returns the floodfill values of the given team on this tile or nullptr if it uses the base layer
+    std::vector<uint32_t>* getFloodFillOverlay(uint32_t teamIndex);
+    const std::vector<uint32_t>* getFloodFillOverlay(uint32_t teamIndex) const;
 };
 
 #endif // TILE_H
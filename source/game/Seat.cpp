@@ -56,13 +56,79 @@ const int32_t Seat::PLAYER_TYPE_INACTIVE_ID = 0;
 const int32_t Seat::PLAYER_ID_HUMAN_MIN = static_cast<int32_t>(KeeperAIType::nbAI) + Seat::PLAYER_TYPE_INACTIVE_ID + 1;
 
 
+TileUpdateValues::TileUpdateValues():
+    mIsRoom(false),
+    mIsTrap(false),
+    mRefundPriceRoom(0),
+    mRefundPriceTrap(0),
+    mDisplayTileMesh(true),
+    mColorCustomMesh(false),
+    mHasBridge(false),
+    mSeatId(-1),
+    mTileVisual(TileVisual::nullTileVisual)
+{
+}
+
+uint16_t TileUpdateValues::getChangedFields(const TileUpdateValues& other) const
+{
+    uint16_t fields = TileUpdateFields::Nothing;
+    if(mIsRoom != other.mIsRoom)
+        fields |= TileUpdateFields::IsRoom;
+    if(mIsTrap != other.mIsTrap)
+        fields |= TileUpdateFields::IsTrap;
+    if(mRefundPriceRoom != other.mRefundPriceRoom)
+        fields |= TileUpdateFields::RefundPriceRoom;
+    if(mRefundPriceTrap != other.mRefundPriceTrap)
+        fields |= TileUpdateFields::RefundPriceTrap;
+    if(mDisplayTileMesh != other.mDisplayTileMesh)
+        fields |= TileUpdateFields::DisplayTileMesh;
+    if(mColorCustomMesh != other.mColorCustomMesh)
+        fields |= TileUpdateFields::ColorCustomMesh;
+    if(mHasBridge != other.mHasBridge)
+        fields |= TileUpdateFields::HasBridge;
+    if(mSeatId != other.mSeatId)
+        fields |= TileUpdateFields::SeatId;
+    if(mMeshName != other.mMeshName)
+        fields |= TileUpdateFields::MeshName;
+    if(mTileVisual != other.mTileVisual)
+        fields |= TileUpdateFields::Visual;
+
+    return fields;
+}
+
+void TileUpdateValues::exportToPacket(ODPacket& os, uint16_t fields) const
+{
+    os << fields;
+    if((fields & TileUpdateFields::IsRoom) != 0)
+        os << mIsRoom;
+    if((fields & TileUpdateFields::IsTrap) != 0)
+        os << mIsTrap;
+    if((fields & TileUpdateFields::RefundPriceRoom) != 0)
+        os << mRefundPriceRoom;
+    if((fields & TileUpdateFields::RefundPriceTrap) != 0)
+        os << mRefundPriceTrap;
+    if((fields & TileUpdateFields::DisplayTileMesh) != 0)
+        os << mDisplayTileMesh;
+    if((fields & TileUpdateFields::ColorCustomMesh) != 0)
+        os << mColorCustomMesh;
+    if((fields & TileUpdateFields::HasBridge) != 0)
+        os << mHasBridge;
+    if((fields & TileUpdateFields::SeatId) != 0)
+        os << mSeatId;
+    if((fields & TileUpdateFields::MeshName) != 0)
+        os << mMeshName;
+    if((fields & TileUpdateFields::Visual) != 0)
+        os << mTileVisual;
+}
+
 TileStateNotified::TileStateNotified():
     mTileVisual(TileVisual::nullTileVisual),
     mSeatIdOwner(-1),
     mMarkedForDigging(false),
     mVisionTurnLast(false),
     mVisionTurnCurrent(false),
-    mBuilding(nullptr)
+    mBuilding(nullptr),
+    mIsUpdateSent(false)
 {
 }
 
@@ -71,8 +137,11 @@ Seat::Seat(GameMap* gameMap) :
     mGameMap(gameMap),
     mPlayer(nullptr),
     mGoldMined(0),
+    mStartingGold(0),
     mDefaultWorkerClass(nullptr),
     mTeamIndex(0),
+    mSeatIndex(0),
+    mVisionMask(seatMaskFromIndex(0)),
     mIsDebuggingVision(false),
     mSkillPoints(0),
     mCurrentSkill(nullptr),
@@ -225,24 +294,64 @@ void Seat::addAlliedSeat(Seat* seat)
     mAlliedSeats.push_back(seat);
 }
 
-void Seat::clearTilesWithVision()
+void Seat::setSeatIndex(uint32_t index)
+{
+    mSeatIndex = index;
+    mVisionMask = getSeatMask();
+}
+
+SeatMask Seat::buildSeatMask(const std::vector<Seat*>& seats)
+{
+    SeatMask seatMask = 0;
+    for(Seat* seat : seats)
+        seatMask |= seat->getSeatMask();
+
+    return seatMask;
+}
+
+void Seat::clearForcedVisionTiles()
+{
+    // Tiles claimed by an enemy are seen until the next vision computation. Then, they are
+    // only seen if a vision source gives vision on them
+    for(Tile* tile : mTilesVisionForced)
+    {
+        TileStateNotified& tileState = mTilesStates[tile->getX()][tile->getY()];
+        tileState.mVisionTurnLast = true;
+        tileState.mVisionTurnCurrent = tile->hasVision(this);
+        mTilesVisionChanged.push_back(tile);
+        if(tileState.mVisionTurnCurrent && tile->hasChangedForSeat(this))
+            mGameMap->tileRefreshNeeded(tile);
+    }
+    mTilesVisionForced.clear();
+}
+
+void Seat::notifyVisionOnTile(Tile* tile)
 {
     if(mPlayer == nullptr)
         return;
     if(!mPlayer->getIsHuman())
         return;
 
-    for(std::vector<TileStateNotified>& vec : mTilesStates)
+    if(tile->getX() >= static_cast<int>(mTilesStates.size()))
     {
-        for(TileStateNotified& p : vec)
-        {
-            p.mVisionTurnLast = p.mVisionTurnCurrent;
-            p.mVisionTurnCurrent = false;
-        }
+        OD_LOG_ERR("Tile=" + Tile::displayAsString(tile));
+        return;
     }
+    if(tile->getY() >= static_cast<int>(mTilesStates[tile->getX()].size()))
+    {
+        OD_LOG_ERR("Tile=" + Tile::displayAsString(tile));
+        return;
+    }
+
+    TileStateNotified& tileState = mTilesStates[tile->getX()][tile->getY()];
+    tileState.mVisionTurnCurrent = true;
+    mTilesVisionChanged.push_back(tile);
+    // Changes that happened while we could not see the tile are sent now
+    if(tile->hasChangedForSeat(this))
+        mGameMap->tileRefreshNeeded(tile);
 }
 
-void Seat::notifyVisionOnTile(Tile* tile)
+void Seat::notifyVisionLostOnTile(Tile* tile)
 {
     if(mPlayer == nullptr)
         return;
@@ -261,7 +370,8 @@ void Seat::notifyVisionOnTile(Tile* tile)
     }
 
     TileStateNotified& tileState = mTilesStates[tile->getX()][tile->getY()];
-    tileState.mVisionTurnCurrent = true;
+    tileState.mVisionTurnCurrent = false;
+    mTilesVisionChanged.push_back(tile);
 }
 
 void Seat::notifyTileClaimedByEnemy(Tile* tile)
@@ -288,6 +398,10 @@ void Seat::notifyTileClaimedByEnemy(Tile* tile)
     tileState.mSeatIdOwner = -1;
     tileState.mTileVisual = TileVisual::dirtGround;
     tileState.mVisionTurnCurrent = true;
+    mTilesVisionForced.push_back(tile);
+    mTilesVisionChanged.push_back(tile);
+    if(tile->hasChangedForSeat(this))
+        mGameMap->tileRefreshNeeded(tile);
 }
 
 const std::string Seat::getFactionFromLine(const std::string& line)
@@ -595,7 +709,7 @@ unsigned int Seat::checkAllGoals()
     return numUncompleteGoals();
 }
 
-void Seat::notifyChangedVisibleTiles()
+void Seat::notifyChangedVisibleTiles(const std::vector<Tile*>& tiles)
 {
     if(mPlayer == nullptr)
         return;
@@ -603,22 +717,24 @@ void Seat::notifyChangedVisibleTiles()
         return;
 
     std::vector<Tile*> tilesToNotify;
-    int xMax = static_cast<int>(mTilesStates.size());
-    for(int xxx = 0; xxx < xMax; ++xxx)
+    for(Tile* tile : tiles)
     {
-        int yMax = static_cast<int>(mTilesStates[xxx].size());
-        for(int yyy = 0; yyy < yMax; ++yyy)
+        if(!tile->hasChangedForSeat(this))
+            continue;
+
+        int xxx = tile->getX();
+        int yyy = tile->getY();
+        if((xxx >= static_cast<int>(mTilesStates.size())) ||
+           (yyy >= static_cast<int>(mTilesStates[xxx].size())))
         {
-            if(!mTilesStates[xxx][yyy].mVisionTurnCurrent)
-                continue;
+            continue;
+        }
 
-            Tile* tile = mGameMap->getTile(xxx, yyy);
-            if(!tile->hasChangedForSeat(this))
-                continue;
+        if(!mTilesStates[xxx][yyy].mVisionTurnCurrent)
+            continue;
 
-            tilesToNotify.push_back(tile);
-            tile->changeNotifiedForSeat(this);
-        }
+        tilesToNotify.push_back(tile);
+        tile->changeNotifiedForSeat(this);
     }
 
     if(tilesToNotify.empty())
@@ -760,29 +876,27 @@ void Seat::sendVisibleTiles()
         ServerNotificationType::refreshVisibleTiles, getPlayer());
     std::vector<Tile*> tilesVisionGained;
     std::vector<Tile*> tilesVisionLost;
-    // Tiles we gained vision
-    int xMax = static_cast<int>(mTilesStates.size());
-    for(int xxx = 0; xxx < xMax; ++xxx)
+    // We only check the tiles where vision was gained or lost since the last call. A tile can be there
+    // more than once or have gained and lost vision. Once processed, its state is the last state notified
+    for(Tile* tile : mTilesVisionChanged)
     {
-        int yMax = static_cast<int>(mTilesStates[xxx].size());
-        for(int yyy = 0; yyy < yMax; ++yyy)
-        {
-            if(mTilesStates[xxx][yyy].mVisionTurnCurrent == mTilesStates[xxx][yyy].mVisionTurnLast)
-                continue;
+        TileStateNotified& tileState = mTilesStates[tile->getX()][tile->getY()];
+        if(tileState.mVisionTurnCurrent == tileState.mVisionTurnLast)
+            continue;
 
-            Tile* tile = mGameMap->getTile(xxx, yyy);
-            if(mTilesStates[xxx][yyy].mVisionTurnCurrent)
-            {
-                // Vision gained
-                tilesVisionGained.push_back(tile);
-            }
-            else
-            {
-                // Vision lost
-                tilesVisionLost.push_back(tile);
-            }
+        tileState.mVisionTurnLast = tileState.mVisionTurnCurrent;
+        if(tileState.mVisionTurnCurrent)
+        {
+            // Vision gained
+            tilesVisionGained.push_back(tile);
+        }
+        else
+        {
+            // Vision lost
+            tilesVisionLost.push_back(tile);
         }
     }
+    mTilesVisionChanged.clear();
 
     // Notify tiles we gained vision
     nbTiles = tilesVisionGained.size();
@@ -839,6 +953,7 @@ Seat* Seat::createRogueSeat(GameMap* gameMap)
     seat->mGold = 0;
     seat->mGoldMax = 0;
     seat->mGoldMined = 0;
+    seat->mStartingGold = 0;
     seat->mColorId = "0";
     seat->mMana = 0;
 
@@ -939,7 +1054,7 @@ bool Seat::importSeatFromStream(std::istream& is)
         OD_LOG_INF("WARNING: expected gold and read " + str);
         return false;
     }
-    OD_ASSERT_TRUE(is >> mGold);
+    OD_ASSERT_TRUE(is >> mStartingGold);
 
     OD_ASSERT_TRUE(is >> str);
     if(str != "goldMined")
@@ -1181,7 +1296,7 @@ bool Seat::exportSeatToStream(std::ostream& os) const
     os << std::endl;
 
     os << "gold\t";
-    os << mGold;
+    os << mStartingGold;
     os << std::endl;
 
     os << "goldMined\t";
@@ -1631,7 +1746,7 @@ void Seat::setVisibleBuildingOnTile(Building* building, Tile* tile)
 }
 
 void Seat::exportTileToPacket(ODPacket& os, const Tile* tile,
-        bool hideSeatId) const
+        bool hideSeatId)
 {
     if(getPlayer() == nullptr)
     {
@@ -1655,9 +1770,9 @@ void Seat::exportTileToPacket(ODPacket& os, const Tile* tile,
         return;
     }
 
-    const TileStateNotified& tileState = mTilesStates[tile->getX()][tile->getY()];
+    TileStateNotified& tileState = mTilesStates[tile->getX()][tile->getY()];
+    TileUpdateValues values;
 
-    int tileSeatId = -1;
     // We only pass the tile seat to the client if the tile is fully claimed
     if(!hideSeatId)
     {
@@ -1665,70 +1780,56 @@ void Seat::exportTileToPacket(ODPacket& os, const Tile* tile,
         {
             case TileVisual::claimedGround:
             case TileVisual::claimedFull:
-                tileSeatId = tileState.mSeatIdOwner;
+                values.mSeatId = tileState.mSeatIdOwner;
                 break;
             case TileVisual::waterGround:
             case TileVisual::lavaGround:
                 if(tileState.mBuilding != nullptr)
-                    tileSeatId = tileState.mSeatIdOwner;
+                    values.mSeatId = tileState.mSeatIdOwner;
                 break;
             default:
                 break;
         }
     }
 
-    std::string meshName;
-
+    // If there is no building, we set an empty mesh so that the client can compute the tile itself
     if((tileState.mBuilding != nullptr) &&
        !tileState.mBuilding->getMeshName().empty())
     {
-        meshName = tileState.mBuilding->getMeshName() + ".mesh";
-    }
-    else
-    {
-        // We set an empty mesh so that the client can compute the tile itself
-        meshName.clear();
+        values.mMeshName = tileState.mBuilding->getMeshName() + ".mesh";
     }
-    bool isRoom = false;
-    bool isTrap = false;
-    bool displayTileMesh = true;
-    bool colorCustomMesh = false;
-    bool hasBridge = false;
 
-    uint32_t refundPriceRoom = 0;
-    uint32_t refundPriceTrap = 0;
     if(tileState.mBuilding != nullptr)
     {
-        displayTileMesh = tileState.mBuilding->displayTileMesh();
-        colorCustomMesh = tileState.mBuilding->colorCustomMesh();
+        values.mDisplayTileMesh = tileState.mBuilding->displayTileMesh();
+        values.mColorCustomMesh = tileState.mBuilding->colorCustomMesh();
 
         if(tileState.mBuilding->getObjectType() == GameEntityType::room)
         {
-            isRoom = true;
+            values.mIsRoom = true;
             Room* room = static_cast<Room*>(tileState.mBuilding);
             if(room->getSeat() == this)
-                refundPriceRoom = (RoomManager::costPerTile(room->getType()) / 2);
+                values.mRefundPriceRoom = (RoomManager::costPerTile(room->getType()) / 2);
 
-            hasBridge = room->isBridge();
+            values.mHasBridge = room->isBridge();
         }
         else if(tileState.mBuilding->getObjectType() == GameEntityType::trap)
         {
-            isTrap = true;
+            values.mIsTrap = true;
             Trap* trap = static_cast<Trap*>(tileState.mBuilding);
             if(trap->getSeat() == this)
-                refundPriceTrap = (TrapManager::costPerTile(trap->getType()) / 2);
+                values.mRefundPriceTrap = (TrapManager::costPerTile(trap->getType()) / 2);
         }
     }
-    os << isRoom;
-    os << isTrap;
-    os << refundPriceRoom;
-    os << refundPriceTrap;
-    os << displayTileMesh;
-    os << colorCustomMesh;
-    os << hasBridge;
-    os << tileSeatId;
-    os << meshName;
-    os << tileState.mTileVisual;
+    values.mTileVisual = tileState.mTileVisual;
+
+    uint16_t fields = TileUpdateFields::All;
+    if(tileState.mIsUpdateSent)
+        fields = values.getChangedFields(tileState.mUpdateSent);
+
+    values.exportToPacket(os, fields);
+    tileState.mIsUpdateSent = true;
+    tileState.mUpdateSent = values;
 }
 
 void Seat::notifyBuildingRemovedFromGameMap(Building* building, Tile* tile)
@@ -19,6 +19,7 @@
 #define SEAT_H
 
 #include "game/SeatData.h"
+#include "game/SeatMask.h"
 
 #include <OgreVector3.h>
 #include <OgreColourValue.h>
@@ -45,6 +46,30 @@ enum class SpellType;
 enum class TileVisual;
 enum class TrapType;
 
+//! Values sent to the client of a seat to update a tile (see Seat::exportTileToPacket)
+class TileUpdateValues
+{
+public:
+    TileUpdateValues();
+
+    //! \brief Returns the mask of the fields (see TileUpdateFields) that differ from the given values
+    uint16_t getChangedFields(const TileUpdateValues& other) const;
+
+    //! \brief Exports the mask of the given fields followed by their values. The packet is read by Tile::updateFromPacket
+    void exportToPacket(ODPacket& os, uint16_t fields) const;
+
+    bool mIsRoom;
+    bool mIsTrap;
+    uint32_t mRefundPriceRoom;
+    uint32_t mRefundPriceTrap;
+    bool mDisplayTileMesh;
+    bool mColorCustomMesh;
+    bool mHasBridge;
+    int mSeatId;
+    std::string mMeshName;
+    TileVisual mTileVisual;
+};
+
 //! Class used to save the last tile state notified to each seat
 class TileStateNotified
 {
@@ -57,6 +82,12 @@ public:
     bool mVisionTurnLast;
     bool mVisionTurnCurrent;
     Building* mBuilding;
+
+    //! \brief Last update sent to the seat client (if mIsUpdateSent is true). The next update only contains the
+    //! fields that changed since. The messages to a client are received in the order they are sent so the client
+    //! always applies the updates on the values they were computed from
+    bool mIsUpdateSent;
+    TileUpdateValues mUpdateSent;
 };
 
 class Seat : public SeatData
@@ -129,6 +160,25 @@ public:
     inline void setTeamIndex(uint32_t index)
     { mTeamIndex = index; }
 
+    inline uint32_t getSeatIndex() const
+    { return mSeatIndex; }
+
+    //! \brief Sets the index of the seat in the gamemap. Its vision mask is reset to the seat alone
+    void setSeatIndex(uint32_t index);
+
+    inline SeatMask getSeatMask() const
+    { return seatMaskFromIndex(mSeatIndex); }
+
+    //! \brief Mask of the seats getting vision when this seat gets vision: the seat itself and its allies
+    inline SeatMask getVisionMask() const
+    { return mVisionMask; }
+
+    inline void setVisionMask(SeatMask visionMask)
+    { mVisionMask = visionMask; }
+
+    //! \brief Returns the mask of the given seats
+    static SeatMask buildSeatMask(const std::vector<Seat*>& seats);
+
     inline int32_t getConfigPlayerId() const
     { return mConfigPlayerId; }
 
@@ -156,6 +206,9 @@ public:
     inline int getGoldMined() const
     { return mGoldMined; }
 
+    inline int getStartingGold() const
+    { return mStartingGold; }
+
     inline bool getKoCreatures() const
     { return mKoCreatures; }
 
@@ -200,16 +253,20 @@ public:
     bool canOwnedCreatureUseRoomFrom(const Seat* seat) const;
     bool canBuildingBeDestroyedBy(const Seat* seat) const;
 
-    void clearTilesWithVision();
+    //! \brief Called before the vision is computed. Tiles only seen because they were claimed
+    //! by an enemy are not seen anymore if no vision source gives vision on them
+    void clearForcedVisionTiles();
+    //! \brief Called by the tiles when this seat gains or loses vision on them
     void notifyVisionOnTile(Tile* tile);
+    void notifyVisionLostOnTile(Tile* tile);
     void notifyTileClaimedByEnemy(Tile* tile);
 
     //! \brief Returns true if this seat can see the given tile and false otherwise
     bool hasVisionOnTile(Tile* tile);
 
-    //! \brief Checks if the visible tiles seen by this seat have changed and notify
-    //! the players if yes
-    void notifyChangedVisibleTiles();
+    //! \brief Checks if the given tiles have changed and are seen by this seat and notify
+    //! the players if yes. Tiles changed while not seen are kept dirty until vision is regained
+    void notifyChangedVisibleTiles(const std::vector<Tile*>& tiles);
 
     //! \brief Server side to toggle the tiles this seat has vision on
     void toggleSeatVisualDebug();
@@ -295,10 +352,11 @@ public:
 
     /*! \brief Exports the tile data to the packet so that the client
      * associated to the seat have the needed information to display the
-     * tile correctly
+     * tile correctly. Only the fields that changed since the last export
+     * for this tile are exported. The packet should be sent to the client
      */
     void exportTileToPacket(ODPacket& os, const Tile* tile,
-        bool hideSeatId) const;
+        bool hideSeatId);
 
     static bool sortForMapSave(Seat* s1, Seat* s2);
 
@@ -333,6 +391,10 @@ private:
     //! \brief The total amount of gold coins mined by workers under this seat's control.
     int mGoldMined;
 
+    //! \brief Gold the seat starts with (the level gold field). It is deposited in the treasuries when the game
+    //! is launched. The seat gold (mGold) only counts what the treasuries contain
+    int mStartingGold;
+
     //! \brief The actual color that this color index translates into.
     Ogre::ColourValue mColorValue;
 
@@ -363,12 +425,24 @@ private:
 
     std::map<std::pair<int, int>, TileStateNotified> mTilesStateLoaded;
 
+    //! \brief Tiles where vision was gained or lost since the last sendVisibleTiles
+    std::vector<Tile*> mTilesVisionChanged;
+
+    //! \brief Tiles seen this turn because they were claimed by an enemy (see notifyTileClaimedByEnemy)
+    std::vector<Tile*> mTilesVisionForced;
+
     std::vector<Tile*> mVisualDebugEntityTiles;
 
     //! \brief Index of the team in the gamemap (from 0 to N). Must be set when the seat is added to the gamemap
     //! and never changed after
     uint32_t mTeamIndex;
 
+    //! \brief Index of the seat in the gamemap. Set when the seat is added to the gamemap (see SeatMask)
+    uint32_t mSeatIndex;
+
+    //! \brief See getVisionMask. Computed when seats are configured
+    SeatMask mVisionMask;
+
     bool mIsDebuggingVision;
 
     //! \brief Counter for skill points
@@ -56,6 +56,26 @@ public:
     inline void incrementNumClaimedTiles()
     { ++mNumClaimedTiles; }
 
+    inline void decrementNumClaimedTiles()
+    { --mNumClaimedTiles; }
+
+    //! \brief Adds nb (that can be negative) to the number of workers or fighters of this seat
+    inline void addNumCreatures(bool isWorker, int nb)
+    {
+        if(isWorker)
+            mNumCreaturesWorkers += nb;
+        else
+            mNumCreaturesFighters += nb;
+    }
+
+    //! \brief Adds the given amounts (that can be negative) to the gold stored in the treasuries
+    //! of this seat and to their capacity
+    inline void addGoldStored(int gold, int goldMax)
+    {
+        mGold += gold;
+        mGoldMax += goldMax;
+    }
+
     void setTeamId(int teamId);
 
     inline const std::vector<int>& getAvailableTeamIds() const
@@ -137,7 +157,8 @@ protected:
     int mStartingX;
     int mStartingY;
 
-    //! \brief The number of living creatures fighters under this seat's control
+    //! \brief The number of living creatures fighters under this seat's control. On server side, it is
+    //! updated when creatures are added, removed, die or change seat (see Creature::refreshSeatCount)
     int mNumCreaturesFighters;
     int mNumCreaturesFightersMax;
     int mNumCreaturesWorkers;
@@ -148,12 +169,14 @@ protected:
     //! \brief Team ids this seat can use defined in the level file.
     std::vector<int> mAvailableTeamIds;
 
-    //! \brief How many tiles have been claimed by this seat, updated in GameMap::doTurn().
+    //! \brief How many tiles have been claimed by this seat. On server side, it is updated when a tile
+    //! gets claimed or unclaimed (see Tile::refreshClaimedTilesCount)
     unsigned int mNumClaimedTiles;
 
     bool mHasGoalsChanged;
 
-    //! \brief The total amount of gold coins in the keeper's treasury and in the dungeon heart.
+    //! \brief The total amount of gold coins in the keeper's treasury and in the dungeon heart. On server
+    //! side, it is updated by the treasuries when gold is deposited or withdrawn (see RoomTreasury::refreshSeatGold)
     int mGold;
 
     //! \brief The total amount of gold coins that the keeper treasuries can have.
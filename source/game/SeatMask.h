@@ -0,0 +1,34 @@
+/*
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SEATMASK_H
+#define SEATMASK_H
+
+#include <cstdint>
+
+//! \brief Set of seats. The bit i is set if the seat with index i (see Seat::getSeatIndex) is in the set
+typedef uint64_t SeatMask;
+
+//! \brief Maximum number of seats a GameMap can have so that they fit in a SeatMask
+const uint32_t MAX_NB_SEATS = 64;
+
+inline SeatMask seatMaskFromIndex(uint32_t seatIndex)
+{
+    return static_cast<SeatMask>(1) << seatIndex;
+}
+
+#endif // SEATMASK_H
@@ -20,9 +20,6 @@
 #include "game/Skill.h"
 #include "game/Seat.h"
 #include "game/SkillType.h"
-#include "modes/GameEditorModeBase.h"
-#include "modes/GameMode.h"
-#include "render/Gui.h"
 #include "rooms/RoomType.h"
 #include "spells/SpellType.h"
 #include "traps/TrapType.h"
@@ -30,11 +27,18 @@
 #include "utils/Helper.h"
 #include "utils/LogManager.h"
 
+#ifndef OD_HEADLESS_SERVER
+#include "modes/GameEditorModeBase.h"
+#include "modes/GameMode.h"
+#include "render/Gui.h"
+
 #include <CEGUI/Window.h>
 #include <CEGUI/widgets/PushButton.h>
+#endif
 
 namespace
 {
+#ifndef OD_HEADLESS_SERVER
 //! \brief Functor to select skills from gui
 class SkillSelector
 {
@@ -56,6 +60,7 @@ public:
     SkillType mType;
     GameMode& mGameMode;
 };
+#endif
 
 SkillManager& getSkillManager()
 {
@@ -85,7 +90,9 @@ public:
 
     virtual SkillFamily getSkillFamily() const = 0;
 
+#ifndef OD_HEADLESS_SERVER
     virtual void connectGuiButtons(GameEditorModeBase* mode, CEGUI::Window* rootWindow, PlayerSelection& playerSelection) const = 0;
+#endif
 
     virtual const std::string& getGuiPath() const = 0;
 
@@ -105,6 +112,7 @@ public:
     SkillFamily getSkillFamily() const
     { return SkillFamily::rooms; }
 
+#ifndef OD_HEADLESS_SERVER
     void connectGuiButtons(GameEditorModeBase* mode, CEGUI::Window* rootWindow, PlayerSelection& playerSelection) const override
     {
         mode->addEventConnection(
@@ -114,6 +122,7 @@ public:
             )
         );
     }
+#endif
 
     const std::string& getGuiPath() const
     {
@@ -150,6 +159,7 @@ public:
     SkillFamily getSkillFamily() const
     { return SkillFamily::traps; }
 
+#ifndef OD_HEADLESS_SERVER
     void connectGuiButtons(GameEditorModeBase* mode, CEGUI::Window* rootWindow, PlayerSelection& playerSelection) const override
     {
         mode->addEventConnection(
@@ -159,6 +169,7 @@ public:
             )
         );
     }
+#endif
 
     const std::string& getGuiPath() const
     {
@@ -195,6 +206,7 @@ public:
     SkillFamily getSkillFamily() const
     { return SkillFamily::spells; }
 
+#ifndef OD_HEADLESS_SERVER
     void connectGuiButtons(GameEditorModeBase* mode, CEGUI::Window* rootWindow, PlayerSelection& playerSelection) const override
     {
         mode->addEventConnection(
@@ -204,6 +216,7 @@ public:
             )
         );
     }
+#endif
 
     const std::string& getGuiPath() const
     {
@@ -709,6 +722,7 @@ void SkillManager::listAllSpellsProgressBars(const std::function<void(SpellType
     }
 }
 
+#ifndef OD_HEADLESS_SERVER
 void SkillManager::connectSkills(GameMode* mode, CEGUI::Window* rootWindow)
 {
     for(const SkillDef* skill : getSkillManager().mSkills)
@@ -735,3 +749,4 @@ void SkillManager::connectGuiButtons(GameEditorModeBase* mode, CEGUI::Window* ro
         skill->connectGuiButtons(mode, rootWindow, playerSelection);
     }
 }
+#endif
@@ -0,0 +1,155 @@
+/*!
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ENTITYREGISTRY_H
+#define ENTITYREGISTRY_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*! \brief List of the entities of a given category in the GameMap indexed by name.
+ *
+ * Entities are stored in a vector so that they can be iterated quickly. The index of each entity in
+ * the vector is kept in mIndexes so that it can be removed by moving the last entity at its place instead of
+ * shifting the others. Note that the order of the entities is not kept when one is removed.
+ * Entities are also indexed by name so that entities sent through the network can be found without
+ * going through the whole list. If an entity is renamed while registered, rename should be called.
+ * Entities with a network id (see GameEntity::getNetworkId) are indexed by this id too.
+ * T should have getName() and getNetworkId() functions.
+ */
+template <typename T>
+class EntityRegistry
+{
+public:
+    typedef typename std::vector<T*>::const_iterator const_iterator;
+
+    //! \brief Adds the given entity. Returns false if it was already registered
+    bool add(T* entity)
+    {
+        if(mIndexes.count(entity) > 0)
+            return false;
+
+        mIndexes[entity] = static_cast<uint32_t>(mEntities.size());
+        mEntities.push_back(entity);
+        // If there are several entities with the same name, we index the last one
+        mNames[entity->getName()] = entity;
+        if(entity->getNetworkId() != 0)
+            mNetworkIds[entity->getNetworkId()] = entity;
+        return true;
+    }
+
+    //! \brief Removes the given entity. The last entity takes its place. Returns false if it was not registered
+    bool remove(T* entity)
+    {
+        typename std::unordered_map<const T*, uint32_t>::iterator it = mIndexes.find(entity);
+        if(it == mIndexes.end())
+            return false;
+
+        uint32_t index = it->second;
+        mIndexes.erase(it);
+        T* last = mEntities.back();
+        mEntities.pop_back();
+        if(last != entity)
+        {
+            mEntities[index] = last;
+            mIndexes[last] = index;
+        }
+
+        removeName(entity, entity->getName());
+        typename std::unordered_map<uint32_t, T*>::iterator itId = mNetworkIds.find(entity->getNetworkId());
+        if((itId != mNetworkIds.end()) && (itId->second == entity))
+            mNetworkIds.erase(itId);
+        return true;
+    }
+
+    //! \brief Should be called when a registered entity has been renamed
+    void rename(T* entity, const std::string& oldName)
+    {
+        if(mIndexes.count(entity) == 0)
+            return;
+
+        removeName(entity, oldName);
+        mNames[entity->getName()] = entity;
+    }
+
+    //! \brief Returns the entity with the given name or nullptr if there is none
+    T* get(const std::string& name) const
+    {
+        typename std::unordered_map<std::string, T*>::const_iterator it = mNames.find(name);
+        if(it == mNames.end())
+            return nullptr;
+
+        return it->second;
+    }
+
+    //! \brief Returns the entity with the given network id or nullptr if there is none
+    T* getByNetworkId(uint32_t networkId) const
+    {
+        typename std::unordered_map<uint32_t, T*>::const_iterator it = mNetworkIds.find(networkId);
+        if(it == mNetworkIds.end())
+            return nullptr;
+
+        return it->second;
+    }
+
+    inline bool contains(const T* entity) const
+    { return mIndexes.count(entity) > 0; }
+
+    void clear()
+    {
+        mEntities.clear();
+        mIndexes.clear();
+        mNames.clear();
+        mNetworkIds.clear();
+    }
+
+    inline const std::vector<T*>& getEntities() const
+    { return mEntities; }
+
+    inline const_iterator begin() const
+    { return mEntities.begin(); }
+
+    inline const_iterator end() const
+    { return mEntities.end(); }
+
+    inline bool empty() const
+    { return mEntities.empty(); }
+
+    inline uint32_t size() const
+    { return static_cast<uint32_t>(mEntities.size()); }
+
+    inline T* operator[](uint32_t index) const
+    { return mEntities[index]; }
+
+private:
+    std::vector<T*> mEntities;
+    std::unordered_map<const T*, uint32_t> mIndexes;
+    std::unordered_map<std::string, T*> mNames;
+    std::unordered_map<uint32_t, T*> mNetworkIds;
+
+    void removeName(const T* entity, const std::string& name)
+    {
+        // The name may index another entity if several have the same one
+        typename std::unordered_map<std::string, T*>::iterator it = mNames.find(name);
+        if((it != mNames.end()) && (it->second == entity))
+            mNames.erase(it);
+    }
+};
+
+#endif // ENTITYREGISTRY_H
@@ -0,0 +1,126 @@
+/*!
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gamemap/FloodFillForest.h"
+
+#include <algorithm>
+
+void FloodFillForest::clear()
+{
+    mBase = Forest();
+    mOverlays.clear();
+}
+
+uint32_t FloodFillForest::find(uint32_t color)
+{
+    return find(mBase, color);
+}
+
+void FloodFillForest::merge(uint32_t color1, uint32_t color2)
+{
+    merge(mBase, color1, color2);
+}
+
+uint32_t FloodFillForest::find(uint32_t teamIndex, uint32_t color)
+{
+    if(!hasOverlay(teamIndex))
+        return find(mBase, color);
+
+    return find(mOverlays[teamIndex], color);
+}
+
+void FloodFillForest::merge(uint32_t teamIndex, uint32_t color1, uint32_t color2)
+{
+    createOverlay(teamIndex);
+    merge(mOverlays[teamIndex], color1, color2);
+}
+
+bool FloodFillForest::hasOverlay(uint32_t teamIndex) const
+{
+    if(teamIndex >= mOverlays.size())
+        return false;
+
+    return mOverlays[teamIndex].mIsUsed;
+}
+
+void FloodFillForest::createOverlay(uint32_t teamIndex)
+{
+    if(hasOverlay(teamIndex))
+        return;
+
+    if(teamIndex >= mOverlays.size())
+        mOverlays.resize(teamIndex + 1);
+
+    mOverlays[teamIndex] = mBase;
+    mOverlays[teamIndex].mIsUsed = true;
+}
+
+void FloodFillForest::removeOverlay(uint32_t teamIndex)
+{
+    if(teamIndex >= mOverlays.size())
+        return;
+
+    mOverlays[teamIndex] = Forest();
+}
+
+uint32_t FloodFillForest::find(Forest& forest, uint32_t color)
+{
+    std::vector<uint32_t>& parents = forest.mParents;
+    if(color >= parents.size())
+        return color;
+
+    // Path halving: each visited color is linked to its grand parent
+    while(parents[color] != color)
+    {
+        parents[color] = parents[parents[color]];
+        color = parents[color];
+    }
+
+    return color;
+}
+
+void FloodFillForest::merge(Forest& forest, uint32_t color1, uint32_t color2)
+{
+    uint32_t maxColor = std::max(color1, color2);
+    if(maxColor >= forest.mParents.size())
+    {
+        uint32_t oldSize = static_cast<uint32_t>(forest.mParents.size());
+        forest.mParents.resize(maxColor + 1);
+        forest.mRanks.resize(maxColor + 1, 0);
+        for(uint32_t color = oldSize; color <= maxColor; ++color)
+            forest.mParents[color] = color;
+    }
+
+    uint32_t root1 = find(forest, color1);
+    uint32_t root2 = find(forest, color2);
+    if(root1 == root2)
+        return;
+
+    if(forest.mRanks[root1] < forest.mRanks[root2])
+    {
+        forest.mParents[root1] = root2;
+    }
+    else if(forest.mRanks[root1] > forest.mRanks[root2])
+    {
+        forest.mParents[root2] = root1;
+    }
+    else
+    {
+        forest.mParents[root2] = root1;
+        ++forest.mRanks[root1];
+    }
+}
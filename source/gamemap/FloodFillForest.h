@@ -0,0 +1,81 @@
+/*!
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FLOODFILLFOREST_H
+#define FLOODFILLFOREST_H
+
+#include <cstdint>
+#include <vector>
+
+/*! \brief Disjoint sets of floodfill colors.
+ *
+ * Tiles store a raw floodfill color. When 2 areas get connected (a tile is dug, a door is unlocked, ...),
+ * instead of replacing the color of every tile of one area, the 2 colors are merged here. The floodfill
+ * value of a tile is then the representative of its raw color. Merges are done by rank and lookups
+ * compress the paths so that both are almost O(1).
+ * There is a base forest shared by every team. Teams only differ because of their locked doors. The first
+ * time a team needs its own merges (see merge(teamIndex, ...)), it gets an overlay forest initialized
+ * from the base one. Teams without overlay use the base forest. Colors that have never been merged are
+ * their own representative and take no memory.
+ */
+class FloodFillForest
+{
+public:
+    //! \brief Removes every merge and every team overlay
+    void clear();
+
+    //! \brief Returns the representative of the given color in the base forest
+    uint32_t find(uint32_t color);
+
+    //! \brief Merges the sets containing the 2 given colors in the base forest. Team overlays are not changed
+    void merge(uint32_t color1, uint32_t color2);
+
+    //! \brief Returns the representative of the given color for the given team
+    uint32_t find(uint32_t teamIndex, uint32_t color);
+
+    //! \brief Merges the sets containing the 2 given colors for the given team. If the team has no
+    //! overlay yet, it is created
+    void merge(uint32_t teamIndex, uint32_t color1, uint32_t color2);
+
+    bool hasOverlay(uint32_t teamIndex) const;
+
+    //! \brief Creates the overlay of the given team from the base forest if it does not exist yet
+    void createOverlay(uint32_t teamIndex);
+
+    //! \brief Drops the overlay of the given team. It will use the base forest again
+    void removeOverlay(uint32_t teamIndex);
+
+private:
+    struct Forest
+    {
+        Forest() :
+            mIsUsed(false)
+        {}
+
+        std::vector<uint32_t> mParents;
+        std::vector<uint8_t> mRanks;
+        bool mIsUsed;
+    };
+
+    static uint32_t find(Forest& forest, uint32_t color);
+    static void merge(Forest& forest, uint32_t color1, uint32_t color2);
+
+    Forest mBase;
+    std::vector<Forest> mOverlays;
+};
+
+#endif // FLOODFILLFOREST_H
@@ -0,0 +1,78 @@
+/*!
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gamemap/FlowField.h"
+
+#include <algorithm>
+
+const int32_t FlowField::NOT_REACHED;
+
+FlowField::FlowField() :
+    mMapSizeX(0),
+    mMapSizeY(0),
+    mTarget(PathfindingArena::NO_INDEX)
+{
+}
+
+void FlowField::setFromArena(const PathfindingArena& arena, int mapSizeX, int mapSizeY, int32_t target)
+{
+    mMapSizeX = mapSizeX;
+    mMapSizeY = mapSizeY;
+    mTarget = target;
+    int32_t nbTiles = mapSizeX * mapSizeY;
+    mNext.assign(static_cast<uint32_t>(nbTiles), NOT_REACHED);
+    mCosts.assign(static_cast<uint32_t>(nbTiles), 0.0);
+    for(int32_t index = 0; index < nbTiles; ++index)
+    {
+        if(!arena.isReached(index))
+            continue;
+
+        const PathfindingArena::Node& node = arena.getNode(index);
+        // The search was done from the target so the parent is the next tile towards it
+        mNext[index] = node.mParent;
+        mCosts[index] = node.mG;
+    }
+}
+
+bool FlowField::isTileUsed(int x, int y) const
+{
+    for(int yy = std::max(0, y - 1); yy <= std::min(mMapSizeY - 1, y + 1); ++yy)
+    {
+        for(int xx = std::max(0, x - 1); xx <= std::min(mMapSizeX - 1, x + 1); ++xx)
+        {
+            if(isReached(yy * mMapSizeX + xx))
+                return true;
+        }
+    }
+
+    return false;
+}
+
+bool FlowField::buildPath(int32_t index, std::vector<int32_t>& indexes) const
+{
+    indexes.clear();
+    if(!isReached(index))
+        return false;
+
+    while(index != PathfindingArena::NO_INDEX)
+    {
+        indexes.push_back(index);
+        index = mNext[index];
+    }
+
+    return true;
+}
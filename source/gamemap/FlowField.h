@@ -0,0 +1,73 @@
+/*!
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FLOWFIELD_H
+#define FLOWFIELD_H
+
+#include "gamemap/PathfindingArena.h"
+
+#include <cstdint>
+#include <vector>
+
+/*! \brief Walking cost from every tile to a given target with the next tile to go to.
+ *
+ * It is computed once with a reverse search from the target (see GameMap::computeFlowField) and can then
+ * be used by any number of creatures moving the same way to get their path. That is useful when many
+ * creatures head to the same place (call to war for example). Tile indexes are (y * mapSizeX + x).
+ */
+class FlowField
+{
+public:
+    FlowField();
+
+    //! \brief Copies the result of the reverse search stored in the given arena. Nodes not reached
+    //! by the search cannot reach the target
+    void setFromArena(const PathfindingArena& arena, int mapSizeX, int mapSizeY, int32_t target);
+
+    inline int32_t getTarget() const
+    { return mTarget; }
+
+    inline bool isReached(int32_t index) const
+    { return mNext[index] != NOT_REACHED; }
+
+    //! \brief Returns the tile to go to from the given one. PathfindingArena::NO_INDEX for the target
+    //! and NOT_REACHED if the target cannot be reached from the given tile
+    inline int32_t getNext(int32_t index) const
+    { return mNext[index]; }
+
+    inline double getCost(int32_t index) const
+    { return mCosts[index]; }
+
+    //! \brief Returns true if the given tile or one of its neighbours was reached. If so, a change
+    //! on this tile may change the field
+    bool isTileUsed(int x, int y) const;
+
+    //! \brief Fills indexes with the tiles from the given one to the target (both included).
+    //! Returns false if the target cannot be reached
+    bool buildPath(int32_t index, std::vector<int32_t>& indexes) const;
+
+    static const int32_t NOT_REACHED = -2;
+
+private:
+    int mMapSizeX;
+    int mMapSizeY;
+    int32_t mTarget;
+    std::vector<int32_t> mNext;
+    std::vector<double> mCosts;
+};
+
+#endif // FLOWFIELD_H
@@ -40,6 +40,7 @@
 #include "game/Seat.h"
 #include "gamemap/MapHandler.h"
 #include "gamemap/Pathfinding.h"
+#include "gamemap/PathfindingArena.h"
 #include "gamemap/TileSet.h"
 #include "goals/Goal.h"
 #include "modes/ModeManager.h"
@@ -58,97 +59,85 @@
 #include "traps/TrapManager.h"
 #include "utils/ConfigManager.h"
 #include "utils/Helper.h"
+#include "utils/JobSystem.h"
 #include "utils/LogManager.h"
+#include "utils/Profiler.h"
 #include "utils/ResourceManager.h"
 
 #include <OgreTimer.h>
 
+#include <boost/thread/tss.hpp>
+
 #include <algorithm>
 #include <cassert>
 #include <cmath>
 #include <cstdlib>
+#include <ctime>
 #include <iostream>
+#include <new>
+#include <set>
 #include <sstream>
 #include <string>
 
 const std::string DEFAULT_NICK = "You";
 
-using namespace std;
-
-/*! \brief A helper class for the A* search in the GameMap::path function.
-*
-* This class stores the requisite information about a tile which is placed in
-* the search queue for the A-star, or A*, algorithm which is used to
-* calculate paths in the path function.
-*
-* The A* description can be found here:
-* http://en.wikipedia.org/wiki/A*_search_algorithm
-*/
-class AstarEntry
-{
-public:
-    AstarEntry() :
-        tile    (nullptr),
-        parent  (nullptr),
-        g       (0.0),
-        h       (0.0)
-    {}
+//! \brief Size of the clusters used by the hierarchical pathfinding
+const int HIERARCHICAL_PATHFINDING_CLUSTER_SIZE = 16;
 
-    AstarEntry(Tile* tile, int x1, int y1, int x2, int y2) :
-        mHasBeenProcessed (false),
-        tile    (tile),
-        parent  (nullptr),
-        g       (0.0),
-        h       (0.0)
-    {
-        h = computeHeuristic(x1, y1, x2, y2);
-    }
+//! \brief Maximum number of tiles checked around a door being locked before considering it splits its area
+const uint32_t DOOR_LOCK_MAX_TILES_CHECKED = 512;
 
-    static double computeHeuristic(const int& x1, const int& y1, const int& x2, const int& y2)
-    {
-        return fabs(static_cast<double>(x2 - x1)) + fabs(static_cast<double>(y2 - y1));
-    }
-
-    void setHeuristic(const int& x1, const int& y1, const int& x2, const int& y2)
-    {
-        h = fabs(static_cast<double>(x2 - x1)) + fabs(static_cast<double>(y2 - y1));
-    }
+//! \brief Maximum number of paths kept in the path cache
+const uint32_t PATH_CACHE_CAPACITY = 1024;
+//! \brief Size of the regions used to invalidate the cached paths
+const int PATH_CACHE_REGION_SIZE = 8;
 
-    inline double fCost() const
-    { return g + h; }
+//! \brief Number of turns between 2 checks of the seats counts (debug only)
+const int64_t SEAT_COUNTS_CHECK_PERIOD = 50;
 
-    inline Tile* getTile() const
-    { return tile; }
+//! \brief Number of creatures prepared by each job during the upkeep
+const uint32_t CREATURES_UPKEEP_BATCH_SIZE = 8;
 
-    inline bool getHasBeenProcessed() const
-    { return mHasBeenProcessed; }
-
-    inline void setHasBeenProcessed()
-    { mHasBeenProcessed = true; }
-
-    inline void setTile(Tile* newTile)
-    { tile = newTile; }
-
-    inline AstarEntry* getParent() const
-    { return parent; }
+using namespace std;
 
-    inline void setParent(AstarEntry* newParent)
-    { parent = newParent; }
+//! \brief Search nodes reused by every path computation done on the calling thread. Both the server
+//! and the client game maps may compute paths so we cannot share a single arena.
+static boost::thread_specific_ptr<PathfindingArena> gPathfindingArena;
 
-    inline const double& getG() const
-    { return g; }
+static PathfindingArena& getPathfindingArena()
+{
+    if(gPathfindingArena.get() == nullptr)
+        gPathfindingArena.reset(new PathfindingArena);
 
-    inline void setG(const double& newG)
-    { g = newG; }
+    return *gPathfindingArena;
+}
 
-private:
-    bool        mHasBeenProcessed;
-    Tile*       tile;
-    AstarEntry* parent;
-    double      g;
-    double      h;
-};
+//! \brief Manhattan distance used both as the A* heuristic and as the base cost to move between 2 tiles
+static inline double manhattanDistance(int x1, int y1, int x2, int y2)
+{
+    return fabs(static_cast<double>(x2 - x1)) + fabs(static_cast<double>(y2 - y1));
+}
 
+//! \brief Name of the profiler zone measuring the upkeep of the given entity type. Profiler zones
+//! keep a pointer to their name so it must be a literal
+static const char* getUpkeepZoneName(GameEntityType type)
+{
+    switch(type)
+    {
+        case GameEntityType::creature:
+            return "GameEntity::doUpkeep/creature";
+        case GameEntityType::room:
+            return "GameEntity::doUpkeep/room";
+        case GameEntityType::trap:
+            return "GameEntity::doUpkeep/trap";
+        case GameEntityType::spell:
+            return "GameEntity::doUpkeep/spell";
+        case GameEntityType::missileObject:
+            return "GameEntity::doUpkeep/missile";
+        default:
+            return "GameEntity::doUpkeep/other";
+    }
+}
 
 GameMap::GameMap(bool isServerGameMap) :
         TileContainer(isServerGameMap ? 15 : 0),
@@ -157,10 +146,22 @@ GameMap::GameMap(bool isServerGameMap) :
         mLocalPlayerNick(DEFAULT_NICK),
         mTurnNumber(-1),
         mIsPaused(false),
+        mMapInfoRandomSeed(0),
+        mRandomSeed(0),
         mTimePayDay(0),
         mFloodFillEnabled(false),
         mIsFOWActivated(true),
+        mIsVisionInitialized(false),
         mNumCallsTo_path(0),
+        mHierarchicalPathfinding(static_cast<uint32_t>(FloodFillType::nbValues), HIERARCHICAL_PATHFINDING_CLUSTER_SIZE),
+        mPathfindingMode(PathfindingMode::flat),
+        mNbHierarchicalPathsCompared(0),
+        mNbHierarchicalPathsMissed(0),
+        mHierarchicalPathsLength(0),
+        mFlatPathsLength(0),
+        mPathCache(PATH_CACHE_CAPACITY, PATH_CACHE_REGION_SIZE),
+        mNbFlowFieldsComputed(0),
+        mJobSystem(new JobSystem(isServerGameMap ? 0 : 1)),
         mAiManager(*this),
         mTileSet(nullptr)
 {
@@ -185,7 +186,12 @@ bool GameMap::isInEditorMode() const
     if (isServerGameMap())
         return (ODServer::getSingleton().getServerMode() == ServerMode::ModeEditor);
 
+#ifdef OD_HEADLESS_SERVER
+    // The dedicated server has no client gamemap
+    return false;
+#else
     return (ODFrameListener::getSingleton().getModeManager()->getCurrentModeType() == ModeManager::EDITOR);
+#endif
 }
 
 bool GameMap::loadLevel(const std::string& levelFilepath)
@@ -213,14 +219,32 @@ bool GameMap::loadLevel(const std::string& levelFilepath)
         delete rogueSeat;
     }
 
+    mMapInfoRandomSeed = 0;
     if (MapHandler::readGameMapFromFile(levelFilepath, *this))
         setLevelFileName(levelFilepath);
     else
         return false;
 
+    // The game is seeded from the command line if forced, from the level if it has a seed and
+    // from the time otherwise
+    uint64_t seed = ResourceManager::getSingleton().getForcedRandomSeed();
+    if(seed == 0)
+        seed = mMapInfoRandomSeed;
+    if(seed == 0)
+        seed = static_cast<uint64_t>(std::time(nullptr));
+
+    seedRandom(seed);
+
     return true;
 }
 
+void GameMap::seedRandom(uint64_t seed)
+{
+    OD_LOG_INF("Random seed=" + std::to_string(seed));
+    mRandomSeed = seed;
+    mRandom.seed(seed);
+}
+
 bool GameMap::createNewMap(int sizeX, int sizeY)
 {
     if (!allocateMapMemory(sizeX, sizeY))
@@ -230,7 +254,7 @@ bool GameMap::createNewMap(int sizeX, int sizeY)
     {
         for (int ii = 0; ii < mMapSizeX; ++ii)
         {
-            Tile* tile = new Tile(this, ii, jj);
+            Tile* tile = new (getTileStorage(ii, jj)) Tile(this, ii, jj);
             tile->setName(Tile::buildName(ii, jj));
             tile->setType(TileType::dirt);
             addTile(tile);
@@ -251,6 +275,7 @@ void GameMap::setAllFullnessAndNeighbors()
             Tile* tile = getTile(ii, jj);
             tile->setFullness(tile->getFullness());
             setTileNeighbors(tile);
+            refreshTileOpacity(tile);
         }
     }
 }
@@ -284,6 +309,11 @@ void GameMap::clearAll()
     mTurnNumber = -1;
     resetUniqueNumbers();
     mIsFOWActivated = true;
+    mIsVisionInitialized = false;
+    mTilesVisionChanged.clear();
+    mTilesOcclusionChanged.clear();
+    mTilesEntitiesChanged.clear();
+    mTilesRefreshNeeded.clear();
     mTimePayDay = 0;
 
     // We check if the different vectors are empty
@@ -328,7 +358,7 @@ void GameMap::clearAll()
 void GameMap::clearCreatures()
 {
     // We need to work on a copy of mCreatures because removeFromGameMap will remove them from this vector
-    std::vector<Creature*> creatures = mCreatures;
+    std::vector<Creature*> creatures = mCreatures.getEntities();
     for (Creature* creature : creatures)
     {
         creature->removeFromGameMap();
@@ -374,7 +404,7 @@ void GameMap::clearWeapons()
 void GameMap::clearRenderedMovableEntities()
 {
     // We need to work on a copy of mRenderedMovableEntities because removeFromGameMap will remove them from this vector
-    std::vector<RenderedMovableEntity*> renderedMovableEntities = mRenderedMovableEntities;
+    std::vector<RenderedMovableEntity*> renderedMovableEntities = mRenderedMovableEntities.getEntities();
     for (RenderedMovableEntity* obj : renderedMovableEntities)
     {
         obj->removeFromGameMap();
@@ -401,6 +431,8 @@ void GameMap::resetUniqueNumbers()
     mUniqueNumberTrap = 0;
     mUniqueNumberMapLight = 0;
     mUniqueFloodFillValue = 0;
+    mUniqueNetworkId = 0;
+    mFloodFillForest.clear();
 }
 
 void GameMap::addClassDescription(const CreatureDefinition *c)
@@ -489,21 +521,23 @@ void GameMap::addCreature(Creature *cc)
     OD_LOG_INF(serverStr() + "Adding Creature " + cc->getName()
         + ", seatId=" + (cc->getSeat() != nullptr ? Helper::toString(cc->getSeat()->getId()) : std::string("null")));
 
-    mCreatures.push_back(cc);
+    mCreatures.add(cc);
+    if(isServerGameMap())
+        cc->setIsCountedInSeat(true);
 }
 
 void GameMap::removeCreature(Creature *c)
 {
     OD_LOG_INF(serverStr() + "Removing Creature " + c->getName());
 
-    std::vector<Creature*>::iterator it = std::find(mCreatures.begin(), mCreatures.end(), c);
-    if(it == mCreatures.end())
+    if(!mCreatures.remove(c))
     {
         OD_LOG_ERR("creature name=" + c->getName());
         return;
     }
 
-    mCreatures.erase(it);
+    if(isServerGameMap())
+        c->setIsCountedInSeat(false);
 }
 
 void GameMap::queueEntityForDeletion(GameEntity *ge)
@@ -805,58 +839,50 @@ Creature* GameMap::getFighterToPickupBySeat(Seat* seat)
 
 void GameMap::addAnimatedObject(MovableGameEntity *a)
 {
-    mAnimatedObjects.push_back(a);
+    mAnimatedObjects.add(a);
 }
 
 void GameMap::removeAnimatedObject(MovableGameEntity *a)
 {
-    std::vector<MovableGameEntity*>::iterator it = std::find(mAnimatedObjects.begin(), mAnimatedObjects.end(), a);
-    if(it == mAnimatedObjects.end())
-        return;
-
-    mAnimatedObjects.erase(it);
+    mAnimatedObjects.remove(a);
 }
 
 MovableGameEntity* GameMap::getAnimatedObject(const std::string& name) const
 {
-    for (MovableGameEntity* mge : mAnimatedObjects)
-    {
-        if (mge->getName().compare(name) == 0)
-            return mge;
-    }
+    return mAnimatedObjects.get(name);
+}
 
-    return nullptr;
+MovableGameEntity* GameMap::getAnimatedObjectFromNetworkId(uint32_t networkId) const
+{
+    return mAnimatedObjects.getByNetworkId(networkId);
 }
 
 void GameMap::addRenderedMovableEntity(RenderedMovableEntity *obj)
 {
     OD_LOG_INF(serverStr() + "Adding rendered object " + obj->getName()
         + ",MeshName=" + obj->getMeshName());
-    mRenderedMovableEntities.push_back(obj);
+    mRenderedMovableEntities.add(obj);
 }
 
 void GameMap::removeRenderedMovableEntity(RenderedMovableEntity *obj)
 {
     OD_LOG_INF(serverStr() + "Removing rendered object " + obj->getName()
         + ",MeshName=" + obj->getMeshName());
-    std::vector<RenderedMovableEntity*>::iterator it = std::find(mRenderedMovableEntities.begin(), mRenderedMovableEntities.end(), obj);
-    if(it == mRenderedMovableEntities.end())
+    if(!mRenderedMovableEntities.remove(obj))
     {
         OD_LOG_ERR("obj name=" + obj->getName());
         return;
     }
-
-    mRenderedMovableEntities.erase(it);
 }
 
 RenderedMovableEntity* GameMap::getRenderedMovableEntity(const std::string& name)
 {
-    for(RenderedMovableEntity* renderedMovableEntity : mRenderedMovableEntities)
-    {
-        if(name.compare(renderedMovableEntity->getName()) == 0)
-            return renderedMovableEntity;
-    }
-    return nullptr;
+    return mRenderedMovableEntities.get(name);
+}
+
+RenderedMovableEntity* GameMap::getRenderedMovableEntityFromNetworkId(uint32_t networkId) const
+{
+    return mRenderedMovableEntities.getByNetworkId(networkId);
 }
 
 void GameMap::addActiveObject(GameEntity *a)
@@ -865,7 +891,7 @@ void GameMap::addActiveObject(GameEntity *a)
     if(!isServerGameMap())
         return;
 
-    mActiveObjects.push_back(a);
+    mActiveObjects.add(a);
 }
 
 void GameMap::removeActiveObject(GameEntity *a)
@@ -874,14 +900,11 @@ void GameMap::removeActiveObject(GameEntity *a)
     if(!isServerGameMap())
         return;
 
-    auto it = std::find(mActiveObjects.begin(), mActiveObjects.end(), a);
-    if(it == mActiveObjects.end())
+    if(!mActiveObjects.remove(a))
     {
         OD_LOG_ERR("ActiveObject name=" + a->getName());
         return;
     }
-
-    mActiveObjects.erase(it);
 }
 
 unsigned int GameMap::numClassDescriptions()
@@ -1064,19 +1087,31 @@ void GameMap::destroyAllEntities()
 
 Creature* GameMap::getCreature(const std::string& cName) const
 {
-    for (Creature* creature : mCreatures)
-    {
-        if (creature->getName().compare(cName) == 0)
-            return creature;
-    }
-    return nullptr;
+    return mCreatures.get(cName);
+}
+
+Creature* GameMap::getCreatureFromNetworkId(uint32_t networkId) const
+{
+    return mCreatures.getByNetworkId(networkId);
+}
+
+void GameMap::creatureRenamed(Creature* creature, const std::string& oldName)
+{
+    mCreatures.rename(creature, oldName);
+    mAnimatedObjects.rename(creature, oldName);
+    mActiveObjects.rename(creature, oldName);
 }
 
 void GameMap::doTurn(double timeSinceLastTurn)
 {
+    OD_PROFILE_ZONE("GameMap::doTurn");
     OD_LOG_INF("Computing turn " + Helper::toString(mTurnNumber) + ", timeSinceLastTurn=" + Helper::toString(timeSinceLastTurn));
     unsigned int numCallsTo_path_atStart = mNumCallsTo_path;
 
+    // Flow fields are only kept for the turn
+    mFlowFields.clear();
+    mNbFlowFieldsComputed = 0;
+
     uint32_t miscUpkeepTime = doMiscUpkeep(timeSinceLastTurn);
 
     for (Seat* seat : mSeats)
@@ -1088,17 +1123,34 @@ void GameMap::doTurn(double timeSinceLastTurn)
     }
 
     OD_LOG_INF("During this turn there were " + Helper::toString(mNumCallsTo_path - numCallsTo_path_atStart)
-        + " calls to GameMap::path(), miscUpkeepTime=" + Helper::toString(miscUpkeepTime));
+        + " calls to GameMap::path() (path cache hits=" + Helper::toString(mPathCache.getNbHits())
+        + ", misses=" + Helper::toString(mPathCache.getNbMisses())
+        + ", flow fields computed=" + Helper::toString(mNbFlowFieldsComputed)
+        + "), miscUpkeepTime=" + Helper::toString(miscUpkeepTime));
+    mPathCache.resetStats();
+
+    if(mPathfindingMode == PathfindingMode::compare)
+    {
+        OD_LOG_INF("Hierarchical pathfinding compared=" + Helper::toString(mNbHierarchicalPathsCompared)
+            + ", missed=" + Helper::toString(mNbHierarchicalPathsMissed)
+            + ", hierarchicalLength=" + Helper::toString(mHierarchicalPathsLength)
+            + ", flatLength=" + Helper::toString(mFlatPathsLength));
+        mNbHierarchicalPathsCompared = 0;
+        mNbHierarchicalPathsMissed = 0;
+        mHierarchicalPathsLength = 0;
+        mFlatPathsLength = 0;
+    }
 }
 
 void GameMap::doPlayerAITurn(double timeSinceLastTurn)
 {
+    OD_PROFILE_ZONE("GameMap::doPlayerAITurn");
     mAiManager.doTurn(timeSinceLastTurn);
 }
 
 unsigned long int GameMap::doMiscUpkeep(double timeSinceLastTurn)
 {
-    Tile *tempTile;
+    OD_PROFILE_ZONE("GameMap::doMiscUpkeep");
     Ogre::Timer stopwatch;
     unsigned long int timeTaken;
 
@@ -1116,20 +1168,7 @@ unsigned long int GameMap::doMiscUpkeep(double timeSinceLastTurn)
                 continue;
 
             // We notify the player if he owns a fighter only
-            bool isCreatureSeat = false;
-            for(Creature* creature : mCreatures)
-            {
-                if(creature->getSeat() != player->getSeat())
-                    continue;
-
-                if(creature->getDefinition()->isWorker())
-                    continue;
-
-                isCreatureSeat = true;
-                break;
-            }
-
-            if(!isCreatureSeat)
+            if(player->getSeat()->getNumCreaturesFighters() <= 0)
                 continue;
 
             ServerNotification *serverNotification = new ServerNotification(
@@ -1148,6 +1187,7 @@ unsigned long int GameMap::doMiscUpkeep(double timeSinceLastTurn)
     // Add any seats with no remaining goals to the winningSeats vector.
     for (Seat* seat : mSeats)
     {
+        OD_PROFILE_ZONE("GameMap::doMiscUpkeep/goals");
         if(seat->getPlayer() == nullptr)
             continue;
 
@@ -1160,85 +1200,106 @@ unsigned long int GameMap::doMiscUpkeep(double timeSinceLastTurn)
             addWinningSeat(seat);
 
         seat->mNumCreaturesFightersMax = getMaxNumberCreatures(seat);
-
-        // Set the creatures count to 0. It will be reset by the next count in doTurn()
-        seat->mNumCreaturesFighters = 0;
-        seat->mNumCreaturesWorkers = 0;
     }
 
-    // Count how many creatures the player controls
-    for(Creature* creature : mCreatures)
-    {
-        // Check to see if the creature has died.
-        if (!creature->isAlive())
-            continue;
+    // Claimed tiles, creatures and gold are counted when they change (see Tile::refreshClaimedTilesCount,
+    // Creature::refreshSeatCount and RoomTreasury::refreshSeatGold). In debug, we check from time to
+    // time that the counts are right
+#ifdef OD_DEBUG
+    if((mTurnNumber % SEAT_COUNTS_CHECK_PERIOD) == 0)
+        checkSeatCounts();
+#endif // OD_DEBUG
 
-        Seat *tempSeat = creature->getSeat();
-        if(tempSeat == nullptr)
-            continue;
+    {
+        OD_PROFILE_ZONE("GameMap::doMiscUpkeep/vision");
+        // Vision is counted per tile and per seat (see VisionSource). We only recompute what
+        // may have changed since last upkeep. We need to compute every seats including AI because
+        // a human can be allied with an AI and they would share vision
+        for (Seat* seat : mSeats)
+            seat->clearForcedVisionTiles();
 
-        // We only count fighters
-        if (creature->getDefinition()->isWorker())
-            ++(tempSeat->mNumCreaturesWorkers);
+        if(!mIsVisionInitialized)
+        {
+            for (int jj = 0; jj < getMapSizeY(); ++jj)
+            {
+                for (int ii = 0; ii < getMapSizeX(); ++ii)
+                {
+                    getTile(ii,jj)->computeVisibleTiles();
+                }
+            }
+            mIsVisionInitialized = true;
+        }
         else
-            ++(tempSeat->mNumCreaturesFighters);
-    }
+        {
+            for (Tile* tile : mTilesVisionChanged)
+                tile->computeVisibleTiles();
+        }
 
-    // At each upkeep, we re-compute tiles with vision
-    for (Seat* seat : mSeats)
-        seat->clearTilesWithVision();
+        for (Tile* tile : mTilesVisionChanged)
+            tile->setIsVisionChanged(false);
 
-    for (int jj = 0; jj < getMapSizeY(); ++jj)
-    {
-        for (int ii = 0; ii < getMapSizeX(); ++ii)
+        mTilesVisionChanged.clear();
+
+        // The creatures upkeep is done in 2 phases. First, each creature computes what it sees and its
+        // mood. That only reads the gamemap so it is done in parallel. Then, the results are applied one
+        // creature at a time, always in the same order, so that the game does not depend on the threads.
+        // Creatures check mTilesOcclusionChanged to know if they have to recompute their vision
+        int maxSightRadius = 0;
+        for (Creature* creature : mCreatures)
+            maxSightRadius = std::max(maxSightRadius, creature->getDefinition()->getSightRadius());
+
+        prepareRegionRadius(maxSightRadius);
+        const std::vector<Creature*>& creatures = mCreatures.getEntities();
+        mJobSystem->parallelFor(static_cast<uint32_t>(creatures.size()), CREATURES_UPKEEP_BATCH_SIZE,
+            [&creatures](uint32_t index)
+            {
+                OD_PROFILE_ZONE("Creature::prepareUpkeep");
+                creatures[index]->prepareUpkeep();
+            });
+
+        for (Creature* creature : mCreatures)
         {
-            getTile(ii,jj)->clearVision();
+            creature->computeVisibleTiles();
         }
-    }
 
-    // Compute vision. We need to compute every seats including AI because
-    // a human can be allied with an AI and they would share vision
-    for (int jj = 0; jj < getMapSizeY(); ++jj)
-    {
-        for (int ii = 0; ii < getMapSizeX(); ++ii)
+        for (Spell* spell : mSpells)
         {
-            getTile(ii,jj)->computeVisibleTiles();
+            spell->computeVisibleTiles();
         }
-    }
 
-    for (Creature* creature : mCreatures)
-    {
-        creature->computeVisibleTiles();
-    }
+        for (Tile* tile : mTilesOcclusionChanged)
+            tile->setIsOcclusionChanged(false);
 
-    for (Spell* spell : mSpells)
-    {
-        spell->computeVisibleTiles();
-    }
+        mTilesOcclusionChanged.clear();
 
-    for (Seat* seat : mSeats)
-    {
-        if(!seat->getIsDebuggingVision())
-            continue;
+        for (Seat* seat : mSeats)
+        {
+            if(!seat->getIsDebuggingVision())
+                continue;
 
-        seat->refreshSeatVisualDebug();
-    }
+            seat->refreshSeatVisualDebug();
+        }
 
-    // We send to each seat the list of tiles he has vision on
-    for (Seat* seat : mSeats)
-        seat->sendVisibleTiles();
+        // We send to each seat the list of tiles he has vision on
+        for (Seat* seat : mSeats)
+            seat->sendVisibleTiles();
+    }
 
     // Carry out the upkeep round of all the active objects in the game.
     // Here, we work on a copy of the active objects list because they might
     // try to remove themselves which would break the iterator
-    std::vector<GameEntity*> activeObjects = mActiveObjects;
+    std::vector<GameEntity*> activeObjects = mActiveObjects.getEntities();
     for(GameEntity* ge : activeObjects)
+    {
+        Profiler::ScopedZone zone(getUpkeepZoneName(ge->getObjectType()));
         ge->doUpkeep();
+    }
 
     // Carry out the upkeep round for each seat. This means recomputing how much gold is
     // available in their treasuries, how much mana they gain/lose during this turn, etc.
     for (Seat* seat : mSeats)
     {
+        OD_PROFILE_ZONE("GameMap::doMiscUpkeep/seats");
         if(seat->getPlayer() == nullptr)
             continue;
 
@@ -1258,47 +1319,76 @@ unsigned long int GameMap::doMiscUpkeep(double timeSinceLastTurn)
             if (seat->mMana > maxMana)
                 seat->mMana = maxMana;
         }
-
-        // Update the count on how much gold is available in all of the treasuries claimed by the given seat.
-        seat->mGold = 0;
-        seat->mGoldMax = 0;
-        for (Room* room : getRooms())
-        {
-            if(room->getSeat() != seat)
-                continue;
-
-            seat->mGold += room->getTotalGoldStored();
-            seat->mGoldMax += room->getTotalGoldStorage();
-        }
     }
 
-    // Determine the number of tiles claimed by each seat.
-    // Begin by setting the number of claimed tiles for each seat to 0.
-    for (Seat* seat : mSeats)
-        seat->setNumClaimedTiles(0);
+    timeTaken = stopwatch.getMicroseconds();
+    return timeTaken;
+}
 
-    // Now loop over all of the tiles, if the tile is claimed increment the given seats count.
+void GameMap::checkSeatCounts()
+{
+    std::map<Seat*, unsigned int> nbClaimedTiles;
     for (int jj = 0; jj < getMapSizeY(); ++jj)
     {
         for (int ii = 0; ii < getMapSizeX(); ++ii)
         {
-            tempTile = getTile(ii,jj);
-
-            // Check to see if the current tile is claimed by anyone.
-            if (tempTile->isClaimed())
-            {
-                // Increment the count of the seat who owns the tile.
-                tempTile->getSeat()->incrementNumClaimedTiles();
-            }
+            Tile* tile = getTile(ii,jj);
+            if (tile->isClaimed())
+                ++nbClaimedTiles[tile->getSeat()];
         }
     }
 
-    timeTaken = stopwatch.getMicroseconds();
-    return timeTaken;
+    std::map<Seat*, int> nbWorkers;
+    std::map<Seat*, int> nbFighters;
+    for(Creature* creature : mCreatures)
+    {
+        if (!creature->isAlive())
+            continue;
+        if (creature->getSeat() == nullptr)
+            continue;
+        if (creature->getDefinition() == nullptr)
+            continue;
+
+        if (creature->getDefinition()->isWorker())
+            ++nbWorkers[creature->getSeat()];
+        else
+            ++nbFighters[creature->getSeat()];
+    }
+
+    std::map<Seat*, int> gold;
+    std::map<Seat*, int> goldMax;
+    for (Room* room : mRooms)
+    {
+        if(room->getSeat() == nullptr)
+            continue;
+
+        gold[room->getSeat()] += room->getTotalGoldStored();
+        goldMax[room->getSeat()] += room->getTotalGoldStorage();
+    }
+
+    for (Seat* seat : mSeats)
+    {
+        if((seat->mNumClaimedTiles == nbClaimedTiles[seat]) &&
+           (seat->mNumCreaturesWorkers == nbWorkers[seat]) &&
+           (seat->mNumCreaturesFighters == nbFighters[seat]) &&
+           (seat->mGold == gold[seat]) &&
+           (seat->mGoldMax == goldMax[seat]))
+        {
+            continue;
+        }
+
+        OD_LOG_ERR("Wrong counts for seatId=" + Helper::toString(seat->getId())
+            + ", claimedTiles=" + Helper::toString(seat->mNumClaimedTiles) + "/" + Helper::toString(nbClaimedTiles[seat])
+            + ", workers=" + Helper::toString(seat->mNumCreaturesWorkers) + "/" + Helper::toString(nbWorkers[seat])
+            + ", fighters=" + Helper::toString(seat->mNumCreaturesFighters) + "/" + Helper::toString(nbFighters[seat])
+            + ", gold=" + Helper::toString(seat->mGold) + "/" + Helper::toString(gold[seat])
+            + ", goldMax=" + Helper::toString(seat->mGoldMax) + "/" + Helper::toString(goldMax[seat]));
+    }
 }
 
 void GameMap::updateAnimations(Ogre::Real timeSinceLastFrame)
 {
+    OD_PROFILE_ZONE("GameMap::updateAnimations");
     if(mIsPaused)
         return;
 
@@ -1334,64 +1424,55 @@ void GameMap::playerIsFighting(Player* player, Tile* tile)
     }
 }
 
-std::list<Tile*> GameMap::findBestPath(const Creature* creature, Tile* tileStart, const std::vector<Tile*> possibleDests,
+std::list<Tile*> GameMap::findClosestPath(const Creature* creature, Tile* tileStart, const std::vector<Tile*>& possibleDests,
     Tile*& chosenTile)
 {
-    chosenTile = nullptr;
-    std::list<Tile*> returnList;
-    if(possibleDests.empty())
-        return returnList;
+    std::vector<Tile*> pathTiles;
+    computeClosestPath(creature, tileStart, possibleDests, chosenTile, pathTiles);
+    return std::list<Tile*>(pathTiles.begin(), pathTiles.end());
+}
 
-    // We start by sorting the vector
-    std::vector<Tile*> possibleDestsTmp = possibleDests;
-    std::sort(possibleDestsTmp.begin(), possibleDestsTmp.end(), [this, &tileStart](Tile* tile1, Tile* tile2){
-              int d1 = Pathfinding::squaredDistanceTile(*tile1, *tileStart);
-              int d2 = Pathfinding::squaredDistanceTile(*tile2, *tileStart);
-              return d1 < d2;
-        });
+bool GameMap::computeClosestPath(const Creature* creature, Tile* tileStart, const std::vector<Tile*>& possibleDests,
+    Tile*& chosenTile, std::vector<Tile*>& pathTiles)
+{
+    OD_PROFILE_ZONE("GameMap::computeClosestPath");
+    ++mNumCallsTo_path;
+    chosenTile = nullptr;
+    pathTiles.clear();
+    if((creature == nullptr) || (tileStart == nullptr))
+        return false;
 
-    double magic = 2.0;
-    for(Tile* tile : possibleDestsTmp)
+    // We only search for the tiles that can be reached. If none, there is no need to search
+    std::vector<int32_t> targets;
+    targets.reserve(possibleDests.size());
+    for(Tile* tile : possibleDests)
     {
         if(!pathExists(creature, tileStart, tile))
             continue;
 
-        // The first reachable tile is the best by default
-        Ogre::Real dist = std::hypotf(tile->getX() - tileStart->getX(), tile->getY() - tileStart->getY());
-        if(chosenTile == nullptr)
-        {
-            chosenTile = tile;
-            returnList = path(tileStart, tile, creature, creature->getSeat(), false);
-            continue;
-        }
-
-        // We compute the path only if walkableDist < (dist * magic).
-        double walkableDist = static_cast<double>(returnList.size());
-        if(walkableDist < (dist * magic))
-            continue;
-
-        std::list<Tile*> pathTmp = path(tileStart, tile, creature, creature->getSeat(), false);
-        if(pathTmp.size() < returnList.size())
-        {
-            // The path is shorter
-            chosenTile = tile;
-            returnList = pathTmp;
-        }
+        targets.push_back(tile->getY() * getMapSizeX() + tile->getX());
     }
-    return returnList;
-}
 
-bool GameMap::pathExists(const Creature* creature, Tile* tileStart, Tile* tileEnd)
-{
-    // If floodfill is not enabled, we cannot check if the path exists so we return true
-    if(!mFloodFillEnabled)
-        return true;
+    if(targets.empty())
+        return false;
 
-    // We check if the tile we are heading to is walkable. We don't do the same for the start tile because it might
-    //not be the case if a creature is on a door tile while it is closed
-    if(creature == nullptr)
+    std::sort(targets.begin(), targets.end());
+    targets.erase(std::unique(targets.begin(), targets.end()), targets.end());
+
+    // We expand from the start tile until we reach one of the targets. It will be the closest by walking cost
+    PathfindingArena& arena = getPathfindingArena();
+    int32_t reachedIndex = searchTiles(arena, tileStart, targets.data(), static_cast<uint32_t>(targets.size()),
+        nullptr, creature, creature->getSeat(), false);
+    if(reachedIndex == PathfindingArena::NO_INDEX)
         return false;
 
+    buildPathTiles(arena, reachedIndex, pathTiles);
+    chosenTile = pathTiles.back();
+    return true;
+}
+
+FloodFillType GameMap::getFloodFillType(const Creature* creature) const
+{
     FloodFillType floodFill = FloodFillType::ground;
     if((creature->getMoveSpeedGround() > 0.0) &&
         (creature->getMoveSpeedWater() > 0.0) &&
@@ -1410,11 +1491,26 @@ bool GameMap::pathExists(const Creature* creature, Tile* tileStart, Tile* tileEn
         floodFill = FloodFillType::groundLava;
     }
 
+    return floodFill;
+}
+
+bool GameMap::pathExists(const Creature* creature, Tile* tileStart, Tile* tileEnd)
+{
+    // If floodfill is not enabled, we cannot check if the path exists so we return true
+    if(!mFloodFillEnabled)
+        return true;
+
+    // We check if the tile we are heading to is walkable. We don't do the same for the start tile because it might
+    //not be the case if a creature is on a door tile while it is closed
+    if(creature == nullptr)
+        return false;
+
+    FloodFillType floodFill = getFloodFillType(creature);
     if(creature->getDefinition()->isWorker())
     {
         // Workers can go on a tile if and only if the path is open for any creature. If it is closed, that
         // means that a door is closed
-        for(Seat* seat : mSeats)
+        for(Seat* seat : getFloodFillLayerSeats())
         {
             if(tileStart->isSameFloodFill(seat, floodFill, tileEnd))
                 continue;
@@ -1434,219 +1530,498 @@ bool GameMap::pathExists(const Creature* creature, Tile* tileStart, Tile* tileEn
 
 std::list<Tile*> GameMap::path(int x1, int y1, int x2, int y2, const Creature* creature, Seat* seat, bool throughDiggableTiles)
 {
+    std::vector<Tile*> pathTiles;
+    computePath(x1, y1, x2, y2, creature, seat, throughDiggableTiles, pathTiles);
+    return std::list<Tile*>(pathTiles.begin(), pathTiles.end());
+}
+
+bool GameMap::computePath(int x1, int y1, int x2, int y2, const Creature* creature, Seat* seat, bool throughDiggableTiles,
+    std::vector<Tile*>& pathTiles)
+{
+    OD_PROFILE_ZONE("GameMap::computePath");
     ++mNumCallsTo_path;
-    std::list<Tile*> returnList;
+    pathTiles.clear();
 
     // If the start tile was not found return an empty path
     Tile* start = getTile(x1, y1);
     if (start == nullptr)
-        return returnList;
+        return false;
 
     // If the end tile was not found return an empty path
     Tile* destination = getTile(x2, y2);
     if (destination == nullptr)
-        return returnList;
+        return false;
 
     if (creature == nullptr)
-        return returnList;
+        return false;
 
     // If flood filling is enabled, we can possibly eliminate this path by checking to see if they two tiles are floodfilled differently.
     if (!throughDiggableTiles && !pathExists(creature, start, destination))
-        return returnList;
+        return false;
 
-    AstarEntry *currentEntry = new AstarEntry(start, x1, y1, x2, y2);
-    AstarEntry neighbor;
+    // Paths through diggable tiles depend on the tiles marked by the seat. We do not cache them
+    if (throughDiggableTiles || !mFloodFillEnabled)
+        return searchPath(start, destination, creature, seat, throughDiggableTiles, pathTiles);
 
-    std::vector<AstarEntry*> openList;
-    openList.push_back(currentEntry);
+    PathCache::Key cacheKey = getPathKey(creature, y1 * getMapSizeX() + x1, y2 * getMapSizeX() + x2);
 
-    // This list will contain the processed and the to process entries
-    // allowing to quickly know if a tile has been processed or not
-    std::vector<std::vector<AstarEntry*>> processList(getMapSizeX(), std::vector<AstarEntry*>(getMapSizeY(), nullptr));
-    processList[currentEntry->getTile()->getX()][currentEntry->getTile()->getY()] = currentEntry;
-    AstarEntry* destinationEntry = nullptr;
-    while (true)
+    std::vector<int32_t>& indexes = mPathCacheIndexes;
+    if (mPathCache.get(cacheKey, indexes))
     {
-        // if the openList is empty we failed to find a path
-        if (openList.empty())
-            break;
+        pathTiles.reserve(indexes.size());
+        for(int32_t index : indexes)
+            pathTiles.push_back(getTile(index % getMapSizeX(), index / getMapSizeX()));
+
+        return true;
+    }
 
-        // openList being sorted, the last element is the smallest
-        auto smallestAstar = openList.rbegin();
-        openList.pop_back();
+    if (!searchPath(start, destination, creature, seat, throughDiggableTiles, pathTiles))
+        return false;
 
-        currentEntry = *smallestAstar;
-        currentEntry->setHasBeenProcessed();
+    indexes.clear();
+    for(Tile* tile : pathTiles)
+        indexes.push_back(tile->getY() * getMapSizeX() + tile->getX());
 
-        // We found the path, break out of the search loop
-        if (currentEntry->getTile() == destination)
+    mPathCache.put(cacheKey, indexes);
+    return true;
+}
+
+PathCache::Key GameMap::getPathKey(const Creature* creature, int32_t start, int32_t destination) const
+{
+    PathCache::Key key;
+    key.mStart = start;
+    key.mDestination = destination;
+    key.mSpeedGround = creature->getMoveSpeedGround();
+    key.mSpeedWater = creature->getMoveSpeedWater();
+    key.mSpeedLava = creature->getMoveSpeedLava();
+    key.mSeatId = (creature->getSeat() != nullptr) ? creature->getSeat()->getId() : -1;
+    key.mIsFighting = creature->isActionInList(CreatureActionType::fight) ||
+        creature->isActionInList(CreatureActionType::flee);
+    return key;
+}
+
+std::list<Tile*> GameMap::flowFieldPath(const Creature* creature, Tile* destination)
+{
+    std::vector<Tile*> pathTiles;
+    computeFlowFieldPath(creature, destination, pathTiles);
+    return std::list<Tile*>(pathTiles.begin(), pathTiles.end());
+}
+
+bool GameMap::computeFlowFieldPath(const Creature* creature, Tile* destination, std::vector<Tile*>& pathTiles)
+{
+    OD_PROFILE_ZONE("GameMap::computeFlowFieldPath");
+    pathTiles.clear();
+    if((creature == nullptr) || (destination == nullptr))
+        return false;
+
+    Tile* start = creature->getPositionTile();
+    if(start == nullptr)
+        return false;
+
+    // Without floodfill, tile changes are not tracked so we cannot keep the flow fields
+    if(!mFloodFillEnabled)
+        return computePath(start->getX(), start->getY(), destination->getX(), destination->getY(), creature,
+            creature->getSeat(), false, pathTiles);
+
+    ++mNumCallsTo_path;
+    if(!pathExists(creature, start, destination))
+        return false;
+
+    int32_t destinationIndex = destination->getY() * getMapSizeX() + destination->getX();
+    PathCache::Key key = getPathKey(creature, PathfindingArena::NO_INDEX, destinationIndex);
+    std::unique_ptr<FlowField>& flowField = mFlowFields[key];
+    if(flowField == nullptr)
+    {
+        flowField.reset(new FlowField);
+        computeFlowField(destination, creature, *flowField);
+        ++mNbFlowFieldsComputed;
+    }
+
+    std::vector<int32_t>& indexes = mPathCacheIndexes;
+    if(!flowField->buildPath(start->getY() * getMapSizeX() + start->getX(), indexes))
+        return false;
+
+    pathTiles.reserve(indexes.size());
+    for(int32_t index : indexes)
+        pathTiles.push_back(getTile(index % getMapSizeX(), index / getMapSizeX()));
+
+    return true;
+}
+
+void GameMap::computeFlowField(Tile* target, const Creature* creature, FlowField& flowField)
+{
+    // We search from the target. Moving from a tile to its neighbour costs the same as in searchTiles
+    // (it depends on the tile we leave) but since we go backward, the cost depends on the neighbour
+    PathfindingArena& arena = getPathfindingArena();
+    arena.startSearch(getMapSizeX(), getMapSizeY());
+    int32_t targetIndex = arena.toIndex(target->getX(), target->getY());
+    arena.open(targetIndex, 0.0, 0.0, PathfindingArena::NO_INDEX);
+    while (!arena.isOpenListEmpty())
+    {
+        int32_t currentIndex = arena.popBest();
+        int currentX = arena.indexToX(currentIndex);
+        int currentY = arena.indexToY(currentIndex);
+        Tile* currentTile = getTile(currentX, currentY);
+
+        // Tiles the creature cannot go through are kept because a creature can start from there (if
+        // on a closed door for example) but we do not go further
+        if(!creature->canGoThroughTile(currentTile))
+            continue;
+
+        double currentG = arena.getNode(currentIndex).mG;
+        bool areTilesPassable[4] = {false, false, false, false};
+        // Note : to disable diagonals, process tiles from 0 to 3. To allow them, process tiles from 0 to 7
+        for (unsigned int i = 0; i < 8; ++i)
         {
-            destinationEntry = currentEntry;
-            break;
+            int neighborX = currentX;
+            int neighborY = currentY;
+            switch(i)
+            {
+                case 0:
+                    neighborX -= 1;
+                    break;
+                case 1:
+                    neighborX += 1;
+                    break;
+                case 2:
+                    neighborY -= 1;
+                    break;
+                case 3:
+                    neighborY += 1;
+                    break;
+                // Diagonals are allowed if the 2 tiles between are passable (like in searchTiles)
+                case 4:
+                    if(!areTilesPassable[0] || !areTilesPassable[2])
+                        continue;
+                    neighborX -= 1;
+                    neighborY -= 1;
+                    break;
+                case 5:
+                    if(!areTilesPassable[0] || !areTilesPassable[3])
+                        continue;
+                    neighborX -= 1;
+                    neighborY += 1;
+                    break;
+                case 6:
+                    if(!areTilesPassable[1] || !areTilesPassable[2])
+                        continue;
+                    neighborX += 1;
+                    neighborY -= 1;
+                    break;
+                case 7:
+                    if(!areTilesPassable[1] || !areTilesPassable[3])
+                        continue;
+                    neighborX += 1;
+                    neighborY += 1;
+                    break;
+                default:
+                    break;
+            }
+            Tile* neighborTile = getTile(neighborX, neighborY);
+            if(neighborTile == nullptr)
+                continue;
+
+            double moveSpeed = creature->getMoveSpeedGround();
+            if(creature->canGoThroughTile(neighborTile))
+            {
+                if(i < 4)
+                    areTilesPassable[i] = true;
+
+                if(neighborTile->getFullness() == 0)
+                    moveSpeed = creature->getMoveSpeed(neighborTile);
+            }
+
+            int32_t neighborIndex = arena.toIndex(neighborX, neighborY);
+            if (arena.isClosed(neighborIndex))
+                continue;
+
+            double g = currentG + (manhattanDistance(neighborX, neighborY, currentX, currentY) / moveSpeed);
+            if (!arena.isReached(neighborIndex))
+                arena.open(neighborIndex, g, 0.0, currentIndex);
+            else if (g < arena.getNode(neighborIndex).mG)
+                arena.decreaseCost(neighborIndex, g, 0.0, currentIndex);
+        }
+    }
+
+    flowField.setFromArena(arena, getMapSizeX(), getMapSizeY(), targetIndex);
+}
+
+void GameMap::invalidateFlowFields(Tile* tile)
+{
+    auto it = mFlowFields.begin();
+    while(it != mFlowFields.end())
+    {
+        if(it->second->isTileUsed(tile->getX(), tile->getY()))
+            it = mFlowFields.erase(it);
+        else
+            ++it;
+    }
+}
+
+bool GameMap::searchPath(Tile* start, Tile* destination, const Creature* creature, Seat* seat, bool throughDiggableTiles,
+    std::vector<Tile*>& pathTiles)
+{
+    // Long paths can be computed on the clusters layer. If it fails, we fallback on the full search
+    if (!throughDiggableTiles &&
+        (mPathfindingMode == PathfindingMode::hierarchical) &&
+        computeHierarchicalPath(start, destination, creature, pathTiles))
+    {
+        return true;
+    }
+
+    bool found = computeFlatPath(start, destination, creature, seat, throughDiggableTiles, pathTiles);
+
+    if (!throughDiggableTiles && (mPathfindingMode == PathfindingMode::compare))
+    {
+        std::vector<Tile*> hierarchicalPath;
+        if(computeHierarchicalPath(start, destination, creature, hierarchicalPath))
+        {
+            ++mNbHierarchicalPathsCompared;
+            mHierarchicalPathsLength += hierarchicalPath.size();
+            mFlatPathsLength += pathTiles.size();
+            if(!found)
+            {
+                OD_LOG_ERR("Hierarchical path found while flat one was not tileStart=" + Tile::displayAsString(start)
+                    + ", tileDest=" + Tile::displayAsString(destination));
+            }
         }
+        else if(found)
+            ++mNbHierarchicalPathsMissed;
+    }
+
+    return found;
+}
+
+bool GameMap::computeFlatPath(Tile* start, Tile* destination, const Creature* creature, Seat* seat, bool throughDiggableTiles,
+    std::vector<Tile*>& pathTiles)
+{
+    PathfindingArena& arena = getPathfindingArena();
+    int32_t destinationIndex = destination->getY() * getMapSizeX() + destination->getX();
+    int32_t reachedIndex = searchTiles(arena, start, &destinationIndex, 1, destination, creature, seat, throughDiggableTiles);
+    if (reachedIndex == PathfindingArena::NO_INDEX)
+        return false;
+
+    buildPathTiles(arena, reachedIndex, pathTiles);
+    return true;
+}
+
+int32_t GameMap::searchTiles(PathfindingArena& arena, Tile* start, const int32_t* sortedTargets, uint32_t nbTargets,
+    Tile* heuristicTile, const Creature* creature, Seat* seat, bool throughDiggableTiles)
+{
+    // The arena holds one node per tile. The nodes from the previous searches are invalidated by startSearch
+    // so that we do not have to allocate or clear anything here
+    arena.startSearch(getMapSizeX(), getMapSizeY());
+    double startH = 0.0;
+    if (heuristicTile != nullptr)
+        startH = manhattanDistance(start->getX(), start->getY(), heuristicTile->getX(), heuristicTile->getY());
+    arena.open(arena.toIndex(start->getX(), start->getY()), 0.0, startH, PathfindingArena::NO_INDEX);
+
+    while (!arena.isOpenListEmpty())
+    {
+        int32_t currentIndex = arena.popBest();
+
+        // We found the path, break out of the search loop
+        if (std::binary_search(sortedTargets, sortedTargets + nbTargets, currentIndex))
+            return currentIndex;
+
+        int currentX = arena.indexToX(currentIndex);
+        int currentY = arena.indexToY(currentIndex);
+        Tile* currentTile = getTile(currentX, currentY);
+        double currentG = arena.getNode(currentIndex).mG;
+
+        // The cost to leave the current tile only depends on the current tile
+        double moveSpeed;
+        if(currentTile->getFullness() == 0)
+            moveSpeed = creature->getMoveSpeed(currentTile);
+        else
+            moveSpeed = creature->getMoveSpeedGround();
 
         // Check the tiles surrounding the current square
         bool areTilesPassable[4] = {false, false, false, false};
         // Note : to disable diagonals, process tiles from 0 to 3. To allow them, process tiles from 0 to 7
         for (unsigned int i = 0; i < 8; ++i)
         {
-            Tile* neighborTile = nullptr;
+            int neighborX = currentX;
+            int neighborY = currentY;
             switch(i)
             {
                 // We process the 4 adjacent tiles
                 case 0:
-                    neighborTile = getTile(currentEntry->getTile()->getX() - 1, currentEntry->getTile()->getY());
+                    neighborX -= 1;
                     break;
                 case 1:
-                    neighborTile = getTile(currentEntry->getTile()->getX() + 1, currentEntry->getTile()->getY());
+                    neighborX += 1;
                     break;
                 case 2:
-                    neighborTile = getTile(currentEntry->getTile()->getX(), currentEntry->getTile()->getY() - 1);
+                    neighborY -= 1;
                     break;
                 case 3:
-                    neighborTile = getTile(currentEntry->getTile()->getX(), currentEntry->getTile()->getY() + 1);
+                    neighborY += 1;
                     break;
                 // We process the 4 diagonal tiles. We only process a diagonal tile if the 2 tiles adjacent to the original one are
                 // passable.
                 case 4:
-                    if(areTilesPassable[0] && areTilesPassable[2])
-                        neighborTile = getTile(currentEntry->getTile()->getX() - 1, currentEntry->getTile()->getY() - 1);
+                    if(!areTilesPassable[0] || !areTilesPassable[2])
+                        continue;
+                    neighborX -= 1;
+                    neighborY -= 1;
                     break;
                 case 5:
-                    if(areTilesPassable[0] && areTilesPassable[3])
-                        neighborTile = getTile(currentEntry->getTile()->getX() - 1, currentEntry->getTile()->getY() + 1);
+                    if(!areTilesPassable[0] || !areTilesPassable[3])
+                        continue;
+                    neighborX -= 1;
+                    neighborY += 1;
                     break;
                 case 6:
-                    if(areTilesPassable[1] && areTilesPassable[2])
-                        neighborTile = getTile(currentEntry->getTile()->getX() + 1, currentEntry->getTile()->getY() - 1);
+                    if(!areTilesPassable[1] || !areTilesPassable[2])
+                        continue;
+                    neighborX += 1;
+                    neighborY -= 1;
                     break;
                 case 7:
-                    if(areTilesPassable[1] && areTilesPassable[3])
-                        neighborTile = getTile(currentEntry->getTile()->getX() + 1, currentEntry->getTile()->getY() + 1);
+                    if(!areTilesPassable[1] || !areTilesPassable[3])
+                        continue;
+                    neighborX += 1;
+                    neighborY += 1;
                     break;
                 default:
                     break;
             }
+            Tile* neighborTile = getTile(neighborX, neighborY);
             if(neighborTile == nullptr)
                 continue;
 
-            neighbor.setTile(neighborTile);
-
             bool processNeighbor = false;
             // We process the tile if the creature can go through. But if it is the first tile that is
             // not passable, we also process it. That happens if a door is closed
-            if((creature->canGoThroughTile(neighbor.getTile())) ||
-               (neighbor.getTile() == start))
+            if((creature->canGoThroughTile(neighborTile)) ||
+               (neighborTile == start))
             {
                 processNeighbor = true;
                 // We set passability for the 4 adjacent tiles only
                 if(i < 4)
                     areTilesPassable[i] = true;
              }
-            else if(throughDiggableTiles && neighbor.getTile()->isDiggable(seat))
+            else if(throughDiggableTiles && neighborTile->isDiggable(seat))
                 processNeighbor = true;
 
             if (!processNeighbor)
                 continue;
 
             // See if the neighbor has already been processed
-            AstarEntry* neighborEntry = processList[neighbor.getTile()->getX()][neighbor.getTile()->getY()];
-            if ((neighborEntry != nullptr) && (neighborEntry->getHasBeenProcessed()))
+            int32_t neighborIndex = arena.toIndex(neighborX, neighborY);
+            if (arena.isClosed(neighborIndex))
                 continue;
 
-            // If the neighbor is not in the open list
-            if (neighborEntry == nullptr)
-            {
-                double weightToParent = AstarEntry::computeHeuristic(neighbor.getTile()->getX(), neighbor.getTile()->getY(),
-                    currentEntry->getTile()->getX(), currentEntry->getTile()->getY());
-
-                if(currentEntry->getTile()->getFullness() == 0)
-                    weightToParent /= creature->getMoveSpeed(currentEntry->getTile());
-                else
-                    weightToParent /= creature->getMoveSpeedGround();
-                neighbor.setG(currentEntry->getG() + weightToParent);
-
-                // Use the manhattan distance for the heuristic
-                neighbor.setHeuristic(neighbor.getTile()->getX(), neighbor.getTile()->getY(), x2, y2);
-                neighbor.setParent(currentEntry);
-
-                AstarEntry* entry = new AstarEntry(neighbor);
-                auto itr = openList.begin();
-                while((itr != openList.end()) &&
-                      ((*itr)->fCost() > entry->fCost()))
-                {
-                    ++itr;
-                }
+            double g = currentG + (manhattanDistance(neighborX, neighborY, currentX, currentY) / moveSpeed);
+            // Use the manhattan distance for the heuristic. Without heuristic tile, we have a Dijkstra
+            double h = 0.0;
+            if (heuristicTile != nullptr)
+                h = manhattanDistance(neighborX, neighborY, heuristicTile->getX(), heuristicTile->getY());
 
-                openList.insert(itr, entry);
-                processList[neighbor.getTile()->getX()][neighbor.getTile()->getY()] = entry;
+            if (!arena.isReached(neighborIndex))
+            {
+                arena.open(neighborIndex, g, h, currentIndex);
             }
-            else
+            else if (g < arena.getNode(neighborIndex).mG)
             {
                 // If this path to the given neighbor tile is a shorter path than the
                 // one already given, make this the new parent.
-                double weightToParent = AstarEntry::computeHeuristic(neighbor.getTile()->getX(), neighbor.getTile()->getY(),
-                    currentEntry->getTile()->getX(), currentEntry->getTile()->getY());
-
-                if(currentEntry->getTile()->getFullness() == 0)
-                    weightToParent /= creature->getMoveSpeed(currentEntry->getTile());
-                else
-                    weightToParent /= creature->getMoveSpeedGround();
-
-                if (currentEntry->getG() + weightToParent < neighborEntry->getG())
-                {
-                    neighborEntry->setG(currentEntry->getG() + weightToParent);
-                    neighborEntry->setParent(currentEntry);
-
-                    // The cost changed. We need to re-order openList
-                    auto itr = std::find(openList.begin(), openList.end(), neighborEntry);
-                    if(itr == openList.end())
-                    {
-                        OD_LOG_ERR("Unexpected entry not found tileStart=" + Tile::displayAsString(start)
-                            + ", tileDest=" + Tile::displayAsString(destination)
-                            + ", tile=" + Tile::displayAsString(neighborEntry->getTile()));
-                    }
-                    else
-                    {
-                        itr = openList.erase(itr);
-                        // We look for the new location
-                        while((itr != openList.end()) &&
-                              ((*itr)->fCost() > neighborEntry->fCost()))
-                        {
-                            ++itr;
-                        }
-
-                        openList.insert(itr, neighborEntry);
-                    }
-                }
+                arena.decreaseCost(neighborIndex, g, h, currentIndex);
             }
         }
     }
 
-    if (destinationEntry != nullptr)
+    return PathfindingArena::NO_INDEX;
+}
+
+void GameMap::buildPathTiles(const PathfindingArena& arena, int32_t index, std::vector<Tile*>& pathTiles)
+{
+    // Follow the parent chain back the the starting tile
+    std::vector<int32_t> indexes;
+    arena.buildPath(index, indexes);
+    pathTiles.reserve(indexes.size());
+    for(int32_t i : indexes)
+        pathTiles.push_back(getTile(arena.indexToX(i), arena.indexToY(i)));
+}
+
+bool GameMap::computeHierarchicalPath(Tile* start, Tile* destination, const Creature* creature, std::vector<Tile*>& pathTiles)
+{
+    pathTiles.clear();
+    if(!mFloodFillEnabled)
+        return false;
+
+    // Close tiles are faster to compute with the full search
+    int distance = std::abs(destination->getX() - start->getX()) + std::abs(destination->getY() - start->getY());
+    if(distance < mHierarchicalPathfinding.getClusterSize())
+        return false;
+
+    uint32_t layer = static_cast<uint32_t>(getFloodFillType(creature));
+    std::vector<int32_t> indexes;
+    if(!mHierarchicalPathfinding.findPath(start->getX(), start->getY(), destination->getX(), destination->getY(), layer, indexes))
+        return false;
+
+    // The clusters layer does not know about the creature. We check that it can go through every
+    // tile (it may not be the case because of a bridge or a door)
+    pathTiles.reserve(indexes.size());
+    for(int32_t index : indexes)
     {
-        // Follow the parent chain back the the starting tile
-        AstarEntry* curEntry = destinationEntry;
-        do
+        Tile* tile = getTile(mHierarchicalPathfinding.indexToX(index), mHierarchicalPathfinding.indexToY(index));
+        if((tile != start) && !creature->canGoThroughTile(tile))
         {
-            if (curEntry->getTile() != nullptr)
-            {
-                returnList.push_front(curEntry->getTile());
-                curEntry = curEntry->getParent();
-            }
+            pathTiles.clear();
+            return false;
+        }
+        pathTiles.push_back(tile);
+    }
+
+    return true;
+}
 
-        } while (curEntry != nullptr);
+void GameMap::resetHierarchicalPathfinding()
+{
+    mFlowFields.clear();
+    mPathCache.init(getMapSizeX(), getMapSizeY());
+    mHierarchicalPathfinding.init(getMapSizeX(), getMapSizeY());
+    for (int jj = 0; jj < getMapSizeY(); ++jj)
+    {
+        for (int ii = 0; ii < getMapSizeX(); ++ii)
+            tilePassabilityChanged(getTile(ii, jj));
     }
+}
 
-    // Clean up the memory we allocated by deleting the astarEntries.  Note that
-    // processList contains all the created entries so it is enough to clean it.
-    for (std::vector<AstarEntry*>& column : processList)
+void GameMap::tilePassabilityChanged(Tile* tile, bool mayOpen)
+{
+    bool isOpened = mayOpen;
+    uint32_t mask = 0;
+    for(uint32_t i = 0; i < static_cast<uint32_t>(FloodFillType::nbValues); ++i)
     {
-        for (AstarEntry* entry : column)
-            delete entry;
+        if(!tile->isFloodFillPossible(nullptr, static_cast<FloodFillType>(i)))
+            continue;
+
+        mask |= (1u << i);
+        if(!mHierarchicalPathfinding.isTilePassable(tile->getX(), tile->getY(), i))
+            isOpened = true;
     }
 
-    return returnList;
+    mPathCache.tileChanged(tile->getX(), tile->getY(), isOpened);
+    invalidateFlowFields(tile);
+    mHierarchicalPathfinding.setTilePassability(tile->getX(), tile->getY(), mask);
+}
+
+bool GameMap::consoleSetPathfindingMode(const std::string& mode)
+{
+    if(mode == "flat")
+        mPathfindingMode = PathfindingMode::flat;
+    else if(mode == "hierarchical")
+        mPathfindingMode = PathfindingMode::hierarchical;
+    else if(mode == "compare")
+        mPathfindingMode = PathfindingMode::compare;
+    else
+        return false;
+
+    OD_LOG_INF("Pathfinding mode set to " + mode);
+    return true;
 }
 
 bool GameMap::addPlayer(Player* player)
@@ -1791,7 +2166,7 @@ std::vector<GameEntity*> GameMap::getCarryableEntities(Creature* carrier, const
 void GameMap::clearRooms()
 {
     // We need to work on a copy of mRooms because removeFromGameMap will remove them from this vector
-    std::vector<Room*> rooms = mRooms;
+    std::vector<Room*> rooms = mRooms.getEntities();
     for (Room *tempRoom : rooms)
     {
         tempRoom->removeFromGameMap();
@@ -1811,7 +2186,7 @@ void GameMap::addRoom(Room *r)
         OD_LOG_INF(serverStr() + "Adding room " + r->getName() + ", tile=" + Tile::displayAsString(tile));
     }
 
-    mRooms.push_back(r);
+    mRooms.add(r);
 }
 
 void GameMap::removeRoom(Room *r)
@@ -1819,14 +2194,11 @@ void GameMap::removeRoom(Room *r)
     OD_LOG_INF(serverStr() + "Removing room " + r->getName());
     // Rooms are removed when absorbed by another room or when they have no more tile
     // In both cases, the client have enough information to do that alone so no need to notify him
-    std::vector<Room*>::iterator it = std::find(mRooms.begin(), mRooms.end(), r);
-    if(it == mRooms.end())
+    if(!mRooms.remove(r))
     {
         OD_LOG_ERR("Room name=" + r->getName());
         return;
     }
-
-    mRooms.erase(it);
 }
 
 std::vector<Room*> GameMap::getRoomsByType(RoomType type) const
@@ -1932,30 +2304,18 @@ std::vector<Building*> GameMap::getReachableBuildingsPerSeat(Seat* seat,
 
 Room* GameMap::getRoomByName(const std::string& name)
 {
-    for (Room* room : mRooms)
-    {
-        if(room->getName().compare(name) == 0)
-            return room;
-    }
-
-    return nullptr;
+    return mRooms.get(name);
 }
 
 Trap* GameMap::getTrapByName(const std::string& name)
 {
-    for (Trap* trap : mTraps)
-    {
-        if(trap->getName().compare(name) == 0)
-            return trap;
-    }
-
-    return nullptr;
+    return mTraps.get(name);
 }
 
 void GameMap::clearTraps()
 {
     // We need to work on a copy of mTraps because removeFromGameMap will remove them from this vector
-    std::vector<Trap*> traps = mTraps;
+    std::vector<Trap*> traps = mTraps.getEntities();
     for (Trap* trap : traps)
     {
         trap->removeFromGameMap();
@@ -1971,20 +2331,17 @@ void GameMap::addTrap(Trap *trap)
     OD_LOG_INF(serverStr() + "Adding trap " + trap->getName() + ", nbTiles="
         + Helper::toString(nbTiles) + ", seatId=" + Helper::toString(trap->getSeat()->getId()));
 
-    mTraps.push_back(trap);
+    mTraps.add(trap);
 }
 
 void GameMap::removeTrap(Trap *t)
 {
     OD_LOG_INF(serverStr() + "Removing trap " + t->getName());
-    std::vector<Trap*>::iterator it = std::find(mTraps.begin(), mTraps.end(), t);
-    if(it == mTraps.end())
+    if(!mTraps.remove(t))
     {
         OD_LOG_ERR("Trap name=" + t->getName());
         return;
     }
-
-    mTraps.erase(it);
 }
 
 bool GameMap::withdrawFromTreasuries(int gold, Seat* seat)
@@ -2006,13 +2363,17 @@ bool GameMap::withdrawFromTreasuries(int gold, Seat* seat)
             break;
     }
 
+    // The seat gold should be what the treasuries contain
+    if(goldStillNeeded > 0)
+        OD_LOG_ERR("seatId=" + Helper::toString(seat->getId()) + ", gold=" + Helper::toString(seat->getGold()) + ", missing=" + Helper::toString(goldStillNeeded));
+
     return true;
 }
 
 void GameMap::clearMapLights()
 {
     // We need to work on a copy of mMapLights because removeFromGameMap will remove them from this vector
-    std::vector<MapLight*> mapLights = mMapLights;
+    std::vector<MapLight*> mapLights = mMapLights.getEntities();
     for (MapLight* mapLight : mapLights)
     {
         mapLight->removeFromGameMap();
@@ -2025,32 +2386,23 @@ void GameMap::clearMapLights()
 void GameMap::addMapLight(MapLight *m)
 {
     OD_LOG_INF(serverStr() + "Adding MapLight " + m->getName());
-    mMapLights.push_back(m);
+    mMapLights.add(m);
 }
 
 void GameMap::removeMapLight(MapLight *m)
 {
     OD_LOG_INF(serverStr() + "Removing MapLight " + m->getName());
 
-    std::vector<MapLight*>::iterator it = std::find(mMapLights.begin(), mMapLights.end(), m);
-    if(it == mMapLights.end())
+    if(!mMapLights.remove(m))
     {
         OD_LOG_ERR("MapLight name=" + m->getName());
         return;
     }
-
-    mMapLights.erase(it);
 }
 
 MapLight* GameMap::getMapLight(const std::string& name) const
 {
-    for (MapLight* mapLight : mMapLights)
-    {
-        if (mapLight->getName() == name)
-            return mapLight;
-    }
-
-    return nullptr;
+    return mMapLights.get(name);
 }
 
 void GameMap::clearSeats()
@@ -2078,6 +2430,13 @@ bool GameMap::addSeat(Seat *s)
             return false;
         }
     }
+    if(mSeats.size() >= MAX_NB_SEATS)
+    {
+        OD_LOG_ERR("Too many seats, cannot add seat id=" + Helper::toString(s->getId()));
+        return false;
+    }
+
+    s->setSeatIndex(static_cast<uint32_t>(mSeats.size()));
     mSeats.push_back(s);
     // We set the Seat color value
     const Ogre::ColourValue& colorValue = ConfigManager::getSingleton().getColorFromId(s->getColorId());
@@ -2152,68 +2511,81 @@ void GameMap::clearGoalsForAllSeats()
     mGoalsForAllSeats.clear();
 }
 
-bool GameMap::doFloodFill(Seat* seat, Tile* tile)
+void GameMap::replaceFloodFill(Seat* seat, FloodFillType floodFillType, uint32_t colorOld, uint32_t colorNew)
 {
-    if (!mFloodFillEnabled)
-        return false;
+    // Colors are unique for every floodfill type so we do not need it. Since the tiles colored with colorOld
+    // and colorNew are now connected, we merge the 2 colors instead of changing every tile
+    if(seat == nullptr)
+        mFloodFillForest.merge(colorOld, colorNew);
+    else
+        mFloodFillForest.merge(seat->getTeamIndex(), colorOld, colorNew);
+}
 
-    if(tile->isFloodFillFilled(seat))
-        return false;
+uint32_t GameMap::getFloodFillRepresentative(Seat* seat, uint32_t color)
+{
+    if(seat == nullptr)
+        return mFloodFillForest.find(color);
 
-    bool hasChanged = false;
-    // If a neigboor is colored with the same colors, we color the tile
-    for(Tile* neigh : tile->getAllNeighbors())
+    return mFloodFillForest.find(seat->getTeamIndex(), color);
+}
+
+void GameMap::updateFloodFillLayerSeats()
+{
+    std::vector<Seat*>& seats = mFloodFillLayerSeats;
+    seats.clear();
+    seats.push_back(nullptr);
+    for(uint32_t teamIndex = 0; teamIndex < mTeamIds.size(); ++teamIndex)
     {
-        // TODO: check if this can be optimized with Tile::isFloodFillPossible
-        switch(tile->getType())
+        if(!mFloodFillForest.hasOverlay(teamIndex))
+            continue;
+
+        for(Seat* seat : mSeats)
         {
-            case TileType::dirt:
-            case TileType::gold:
-            case TileType::rock:
-            {
-                hasChanged |= tile->updateFloodFillFromTile(seat, FloodFillType::ground, neigh);
-                hasChanged |= tile->updateFloodFillFromTile(seat, FloodFillType::groundWater, neigh);
-                hasChanged |= tile->updateFloodFillFromTile(seat, FloodFillType::groundLava, neigh);
-                hasChanged |= tile->updateFloodFillFromTile(seat, FloodFillType::groundWaterLava, neigh);
-                break;
-            }
-            case TileType::water:
-            {
-                hasChanged |= tile->updateFloodFillFromTile(seat, FloodFillType::groundWater, neigh);
-                hasChanged |= tile->updateFloodFillFromTile(seat, FloodFillType::groundWaterLava, neigh);
-                break;
-            }
-            case TileType::lava:
-            {
-                hasChanged |= tile->updateFloodFillFromTile(seat, FloodFillType::groundLava, neigh);
-                hasChanged |= tile->updateFloodFillFromTile(seat, FloodFillType::groundWaterLava, neigh);
-                break;
-            }
-            default:
+            if(seat->getTeamIndex() != teamIndex)
                 continue;
-        }
 
-        // If the tile is fully filled, no need to continue
-        if(tile->isFloodFillFilled(seat))
-            return true;
+            seats.push_back(seat);
+            break;
+        }
     }
-
-    return hasChanged;
 }
 
-void GameMap::replaceFloodFill(Seat* seat, FloodFillType floodFillType, uint32_t colorOld, uint32_t colorNew)
+bool GameMap::isFloodFillConnected(Seat* seat, FloodFillType type, Tile* startTile, const std::vector<Tile*>& tilesToReach,
+    Tile* tileIgnored, uint32_t maxTiles)
 {
-    for (int jj = 0; jj < getMapSizeY(); ++jj)
+    uint32_t color = startTile->getFloodFillValue(seat, type);
+    std::vector<Tile*> tilesNotReached = tilesToReach;
+    std::set<Tile*> tilesVisited;
+    std::vector<Tile*> tilesToProcess;
+    tilesToProcess.push_back(startTile);
+    tilesVisited.insert(startTile);
+    while(!tilesToProcess.empty())
     {
-        for (int ii = 0; ii < getMapSizeX(); ++ii)
+        Tile* tile = tilesToProcess.back();
+        tilesToProcess.pop_back();
+        tilesNotReached.erase(std::remove(tilesNotReached.begin(), tilesNotReached.end(), tile), tilesNotReached.end());
+        if(tilesNotReached.empty())
+            return true;
+
+        if(tilesVisited.size() >= maxTiles)
+            return false;
+
+        for(Tile* neigh : tile->getAllNeighbors())
         {
-            Tile* tile = getTile(ii,jj);
-            if(tile->getFloodFillValue(seat, floodFillType) != colorOld)
+            if(neigh == tileIgnored)
+                continue;
+
+            if(neigh->getFloodFillValue(seat, type) != color)
+                continue;
+
+            if(!tilesVisited.insert(neigh).second)
                 continue;
 
-            tile->replaceFloodFill(seat, floodFillType, colorNew);
+            tilesToProcess.push_back(neigh);
         }
     }
+
+    return tilesNotReached.empty();
 }
 
 void GameMap::refreshFloodFill(Seat* seat, Tile* tile)
@@ -2285,6 +2657,8 @@ void GameMap::enableFloodFill()
             getTile(ii,jj)->resetFloodFill();
         }
     }
+    mFloodFillForest.clear();
+    mFloodFillLockedDoors.clear();
 
     // The algorithm used to find a path is efficient when the path exists but not if it doesn't.
     // To improve path finding, we tag the contiguous tiles to know if a path exists between 2 tiles or not.
@@ -2292,153 +2666,50 @@ void GameMap::enableFloodFill()
     // Note : when a tile is digged, floodfill will have to be refreshed.
     mFloodFillEnabled = true;
 
-    // To optimize floodfilling, we start by tagging the dirt tiles with fullness = 0
-    // because they are walkable for most creatures. When we will have tagged all
-    // thoses, we will deal with water/lava remaining (there can be some left if
-    // surrounded by not passable tiles).
-    FloodFillType currentType = FloodFillType::ground;
-    // We do the floodfill for the rogue seat. Then, once it is done, we copy for the other seats.
-    // If there are locked doors, floodfill will be refreshed when they are added
-    Seat* rogueSeat = getSeatRogue();
-    while(true)
+    // For each floodfill type, when we find a tile not tagged yet, we use a new color and tag all
+    // the tiles connected to it. That way, each tile is processed once per floodfill type.
+    // We only compute the base layer shared by all the teams. If there are locked doors, the
+    // overlay of their team will be created when they are added
+    std::vector<Tile*> tilesToProcess;
+    for(uint32_t i = 0; i < static_cast<uint32_t>(FloodFillType::nbValues); ++i)
     {
-        int yy = 0;
-
-        bool isTileFound;
-        isTileFound = false;
-        while(!isTileFound && (yy < getMapSizeY()))
+        FloodFillType type = static_cast<FloodFillType>(i);
+        for (int jj = 0; jj < getMapSizeY(); ++jj)
         {
-            for(int xx = 0; xx < getMapSizeX(); ++xx)
+            for (int ii = 0; ii < getMapSizeX(); ++ii)
             {
-                Tile* tile = getTile(xx, yy);
-                if(tile->getFullness() > 0.0)
+                Tile* tile = getTile(ii, jj);
+                if(!tile->isFloodFillPossible(nullptr, type))
                     continue;
 
-                if(currentType == FloodFillType::ground)
-                {
-                    if(((tile->getType() == TileType::dirt) ||
-                        (tile->getType() == TileType::gold) ||
-                        (tile->getType() == TileType::rock)) &&
-                       (tile->getFloodFillValue(rogueSeat, FloodFillType::ground) == Tile::NO_FLOODFILL))
-                    {
-                        isTileFound = true;
-                        if(tile->getFloodFillValue(rogueSeat, FloodFillType::ground) == Tile::NO_FLOODFILL)
-                            tile->replaceFloodFill(rogueSeat, FloodFillType::ground, nextUniqueFloodFillValue());
-                        if(tile->getFloodFillValue(rogueSeat, FloodFillType::groundWater) == Tile::NO_FLOODFILL)
-                            tile->replaceFloodFill(rogueSeat, FloodFillType::groundWater, nextUniqueFloodFillValue());
-                        if(tile->getFloodFillValue(rogueSeat, FloodFillType::groundLava) == Tile::NO_FLOODFILL)
-                            tile->replaceFloodFill(rogueSeat, FloodFillType::groundLava, nextUniqueFloodFillValue());
-                        if(tile->getFloodFillValue(rogueSeat, FloodFillType::groundWaterLava) == Tile::NO_FLOODFILL)
-                            tile->replaceFloodFill(rogueSeat, FloodFillType::groundWaterLava, nextUniqueFloodFillValue());
-                        break;
-                    }
-                }
-                else if(currentType == FloodFillType::groundWater)
-                {
-                    if((tile->getType() == TileType::water) &&
-                       (tile->getFloodFillValue(rogueSeat, FloodFillType::groundWater) == Tile::NO_FLOODFILL))
-                    {
-                        isTileFound = true;
-                        if(tile->getFloodFillValue(rogueSeat, FloodFillType::groundWater) == Tile::NO_FLOODFILL)
-                            tile->replaceFloodFill(rogueSeat, FloodFillType::groundWater, nextUniqueFloodFillValue());
-                        if(tile->getFloodFillValue(rogueSeat, FloodFillType::groundWaterLava) == Tile::NO_FLOODFILL)
-                            tile->replaceFloodFill(rogueSeat, FloodFillType::groundWaterLava, nextUniqueFloodFillValue());
-                        break;
-                    }
-                }
-                else if(currentType == FloodFillType::groundLava)
-                {
-                    if((tile->getType() == TileType::lava) &&
-                       (tile->getFloodFillValue(rogueSeat, FloodFillType::groundLava) == Tile::NO_FLOODFILL))
-                    {
-                        isTileFound = true;
-                        if(tile->getFloodFillValue(rogueSeat, FloodFillType::groundLava) == Tile::NO_FLOODFILL)
-                            tile->replaceFloodFill(rogueSeat, FloodFillType::groundLava, nextUniqueFloodFillValue());
-                        if(tile->getFloodFillValue(rogueSeat, FloodFillType::groundWaterLava) == Tile::NO_FLOODFILL)
-                            tile->replaceFloodFill(rogueSeat, FloodFillType::groundWaterLava, nextUniqueFloodFillValue());
-                        break;
-                    }
-                }
-            }
-
-            if(!isTileFound)
-                ++yy;
-        }
+                if(tile->getFloodFillValue(nullptr, type) != Tile::NO_FLOODFILL)
+                    continue;
 
-        // If there are no more walkable tiles, we go for water. Then, for lava. After that, floodfill should be complete
-        if(!isTileFound)
-        {
-            switch(currentType)
-            {
-                case FloodFillType::ground:
-                {
-                    // There are no more ground tiles. We go for water tiles
-                    currentType = FloodFillType::groundWater;
-                    isTileFound = true;
-                    break;
-                }
-                case FloodFillType::groundWater:
-                {
-                    // There are no more ground tiles. We go for water tiles
-                    currentType = FloodFillType::groundLava;
-                    isTileFound = true;
-                    break;
-                }
-                case FloodFillType::groundLava:
+                uint32_t color = nextUniqueFloodFillValue();
+                tile->replaceFloodFill(nullptr, type, color);
+                tilesToProcess.push_back(tile);
+                while(!tilesToProcess.empty())
                 {
-                    // There are no more tiles. We can stop
-                    break;
-                }
-                default:
-                    OD_LOG_ERR("Unexpected enum value=" + Tile::toString(currentType));
-                    break;
-            }
-        }
-
-        if(!isTileFound)
-            break;
+                    Tile* tileArea = tilesToProcess.back();
+                    tilesToProcess.pop_back();
+                    for(Tile* neigh : tileArea->getAllNeighbors())
+                    {
+                        if(!neigh->isFloodFillPossible(nullptr, type))
+                            continue;
 
-        while(yy < getMapSizeY())
-        {
-            int nbTiles = 0;
-            for(int xx = 0; xx < getMapSizeX(); ++xx)
-            {
-                Tile* tile = getTile(xx, yy);
-                if(doFloodFill(rogueSeat, tile))
-                    ++nbTiles;
-            }
+                        if(neigh->getFloodFillValue(nullptr, type) != Tile::NO_FLOODFILL)
+                            continue;
 
-            // For optimization purposes, if a tile has changed, we go on the other side
-            if(nbTiles > 0)
-            {
-                for(int xx = getMapSizeX() - 1; xx >= 0; --xx)
-                {
-                    Tile* tile = getTile(xx, yy);
-                    if(doFloodFill(rogueSeat, tile))
-                        ++nbTiles;
+                        neigh->replaceFloodFill(nullptr, type, color);
+                        tilesToProcess.push_back(neigh);
+                    }
                 }
             }
-
-            // If at least one tile as been changed, we go back to the previous line
-            if((nbTiles > 0) && (yy > 0))
-                --yy;
-            else
-                ++yy;
         }
     }
 
-    // We copy floodfill for all seats
-    for(int xx = 0; xx < getMapSizeX(); ++xx)
-    {
-        for(int yy = 0; yy < getMapSizeY(); ++yy)
-        {
-            Tile* tile = getTile(xx, yy);
-            if(tile == nullptr)
-                continue;
-
-            tile->copyFloodFillToOtherSeats(rogueSeat);
-        }
-    }
+    updateFloodFillLayerSeats();
+    resetHierarchicalPathfinding();
 }
 
 std::list<Tile*> GameMap::path(Creature *c1, Creature *c2, const Creature* creature, Seat* seat, bool throughDiggableTiles)
@@ -2668,45 +2939,6 @@ std::string GameMap::nextUniqueNameMapLight()
     return ret;
 }
 
-GameEntity* GameMap::getEntityFromTypeAndName(GameEntityType entityType,
-    const std::string& entityName)
-{
-    switch(entityType)
-    {
-        case GameEntityType::creature:
-            return getCreature(entityName);
-
-        case GameEntityType::buildingObject:
-        case GameEntityType::chickenEntity:
-        case GameEntityType::craftedTrap:
-        case GameEntityType::missileObject:
-        case GameEntityType::persistentObject:
-        case GameEntityType::smallSpiderEntity:
-        case GameEntityType::trapEntity:
-        case GameEntityType::treasuryObject:
-        case GameEntityType::skillEntity:
-        case GameEntityType::giftBoxEntity:
-            return getRenderedMovableEntity(entityName);
-
-        case GameEntityType::spell:
-            return getSpell(entityName);
-
-        case GameEntityType::mapLight:
-            return getMapLight(entityName);
-
-        case GameEntityType::room:
-            return getRoomByName(entityName);
-
-        case GameEntityType::trap:
-            return getTrapByName(entityName);
-
-        default:
-            break;
-    }
-
-    return nullptr;
-}
-
 void GameMap::logFloodFileTiles()
 {
     for(int yy = 0; yy < getMapSizeY(); ++yy)
@@ -2768,6 +3000,8 @@ void GameMap::consoleSetLevelCreature(const std::string& creatureName, uint32_t
 void GameMap::consoleAskToggleFOW()
 {
     mIsFOWActivated = !mIsFOWActivated;
+    // Every tile gives vision to everybody or only to its owner. We recompute all of them
+    mIsVisionInitialized = false;
 }
 
 void GameMap::consoleAskUnlockSkills()
@@ -2803,22 +3037,30 @@ Creature* GameMap::getWorkerForPathFinding(Seat* seat)
 
 void GameMap::updateVisibleEntities()
 {
-    // Notify what happened to entities on visible tiles
-    for (int jj = 0; jj < getMapSizeY(); ++jj)
+    OD_PROFILE_ZONE("GameMap::updateVisibleEntities");
+    // Notify what happened to entities on the tiles that changed. Notifying may
+    // change other tiles so we work on a copy of the list
+    std::vector<Tile*> tiles;
+    tiles.swap(mTilesEntitiesChanged);
+    for (Tile* tile : tiles)
     {
-        for (int ii = 0; ii < getMapSizeX(); ++ii)
-        {
-            Tile* tile = getTile(ii,jj);
-            tile->notifyEntitiesSeatsWithVision();
-        }
+        tile->setIsEntitiesChanged(false);
+        tile->notifyEntitiesSeatsWithVision();
     }
 }
 
 void GameMap::fireRefreshEntities()
 {
-    // Notify changes on visible tiles
+    OD_PROFILE_ZONE("GameMap::fireRefreshEntities");
+    // Notify changes on visible tiles. Tiles changed for seats that do not see them are
+    // added again when vision is regained (see Seat::notifyVisionOnTile)
     for(Seat* seat : mSeats)
-        seat->notifyChangedVisibleTiles();
+        seat->notifyChangedVisibleTiles(mTilesRefreshNeeded);
+
+    for(Tile* tile : mTilesRefreshNeeded)
+        tile->setIsRefreshNeeded(false);
+
+    mTilesRefreshNeeded.clear();
 
     for(Creature* creature : mCreatures)
     {
@@ -2830,37 +3072,29 @@ void GameMap::addSpell(Spell *spell)
 {
     OD_LOG_INF(serverStr() + "Adding spell " + spell->getName()
         + ",MeshName=" + spell->getMeshName());
-    mSpells.push_back(spell);
+    mSpells.add(spell);
 }
 
 void GameMap::removeSpell(Spell *spell)
 {
     OD_LOG_INF(serverStr() + "Removing spell " + spell->getName()
         + ",MeshName=" + spell->getMeshName());
-    std::vector<Spell*>::iterator it = std::find(mSpells.begin(), mSpells.end(), spell);
-    if(it == mSpells.end())
+    if(!mSpells.remove(spell))
     {
         OD_LOG_ERR("spell name=" + spell->getName());
         return;
     }
-
-    mSpells.erase(it);
 }
 
 Spell* GameMap::getSpell(const std::string& name) const
 {
-    for(Spell* spell : mSpells)
-    {
-        if(name.compare(spell->getName()) == 0)
-            return spell;
-    }
-    return nullptr;
+    return mSpells.get(name);
 }
 
 void GameMap::clearSpells()
 {
     // We need to work on a copy of mSpells because removeFromGameMap will remove them from this vector
-    std::vector<Spell*> spells = mSpells;
+    std::vector<Spell*> spells = mSpells.getEntities();
     for (Spell* spell : spells)
     {
         spell->removeFromGameMap();
@@ -3058,6 +3292,14 @@ void GameMap::clientUpKeep(int64_t turnNumber)
 
 void GameMap::doorLock(Tile* tileDoor, Seat* seat, bool locked)
 {
+    // The clusters layer does not depend on the seat. A locked door is avoided by everybody. If a creature
+    // is allowed to go through, the full search will be used
+    mHierarchicalPathfinding.setTileBlocked(tileDoor->getX(), tileDoor->getY(), locked);
+    mPathCache.tileChanged(tileDoor->getX(), tileDoor->getY(), !locked);
+    invalidateFlowFields(tileDoor);
+    // Locked doors block vision
+    tileVisionChanged(tileDoor, true);
+
     if(!locked)
     {
         // When a door is unlocked, we check all its neighboors to find a floodfill value for each possible
@@ -3090,9 +3332,33 @@ void GameMap::doorLock(Tile* tileDoor, Seat* seat, bool locked)
             }
         }
 
+        // If the team has no locked door left, it sees the map like the base layer again
+        std::vector<Tile*>& lockedDoors = mFloodFillLockedDoors[seat->getTeamIndex()];
+        lockedDoors.erase(std::remove(lockedDoors.begin(), lockedDoors.end(), tileDoor), lockedDoors.end());
+        if(lockedDoors.empty() && mFloodFillForest.hasOverlay(seat->getTeamIndex()))
+        {
+            mFloodFillForest.removeOverlay(seat->getTeamIndex());
+            for(int xx = 0; xx < getMapSizeX(); ++xx)
+            {
+                for(int yy = 0; yy < getMapSizeY(); ++yy)
+                    getTile(xx, yy)->removeFloodFillOverlay(seat->getTeamIndex());
+            }
+            updateFloodFillLayerSeats();
+        }
+
         return;
     }
 
+    // The team of the locked door now differs from the base layer
+    std::vector<Tile*>& lockedDoors = mFloodFillLockedDoors[seat->getTeamIndex()];
+    if(std::find(lockedDoors.begin(), lockedDoors.end(), tileDoor) == lockedDoors.end())
+        lockedDoors.push_back(tileDoor);
+    if(!mFloodFillForest.hasOverlay(seat->getTeamIndex()))
+    {
+        mFloodFillForest.createOverlay(seat->getTeamIndex());
+        updateFloodFillLayerSeats();
+    }
+
     // We save the list of the creatures that are on the same floodfill as the door tile. Then, we will check if the path
     // is still valid
     std::vector<Creature*> creatures;
@@ -3139,6 +3405,7 @@ void GameMap::doorLock(Tile* tileDoor, Seat* seat, bool locked)
     // We only change tiles floodfilled like tileChange. That will avoid changing floodfill on tiles closed by
     // another closed door or something
     std::vector<uint32_t> colorsToChange(static_cast<uint32_t>(FloodFillType::nbValues), Tile::NO_FLOODFILL);
+    bool isSplit = false;
     for(uint32_t i = 0; i < colors.size(); ++i)
     {
         FloodFillType type = static_cast<FloodFillType>(i);
@@ -3146,11 +3413,24 @@ void GameMap::doorLock(Tile* tileDoor, Seat* seat, bool locked)
         if(tileChangeColor == Tile::NO_FLOODFILL)
             continue;
 
+        // If tileChange can still reach the other tiles around the door without going through it, the
+        // area is not split. We only look at the tiles close to the door. If we cannot tell, we split
+        std::vector<Tile*> tilesToReach;
+        for(Tile* neigh : tileDoor->getAllNeighbors())
+        {
+            if((neigh != tileChange) && (neigh->getFloodFillValue(seat, type) == tileChangeColor))
+                tilesToReach.push_back(neigh);
+        }
+        if(isFloodFillConnected(seat, type, tileChange, tilesToReach, tileDoor, DOOR_LOCK_MAX_TILES_CHECKED))
+            continue;
+
         colorsToChange[i] = tileChangeColor;
         colors[i] = nextUniqueFloodFillValue();
+        isSplit = true;
     }
 
-    changeFloodFillConnectedTiles(tileChange, seat, colorsToChange, colors, tileDoor);
+    if(isSplit)
+        changeFloodFillConnectedTiles(tileChange, seat, colorsToChange, colors, tileDoor);
 
     // We check if a creature from the given seat has a path through the door and stop it if there is
     for(Creature* creature : creatures)
@@ -3185,7 +3465,7 @@ void GameMap::changeFloodFillConnectedTiles(Tile* startTile, Seat* seat, const s
                     continue;
 
                 if((neighColor == oldColors[i]) &&
-                   (std::find(tiles.begin(), tiles.end(), tile) == tiles.end()))
+                   (std::find(tiles.begin(), tiles.end(), neigh) == tiles.end()))
                 {
                     tiles.push_back(neigh);
                     break;
@@ -3233,18 +3513,18 @@ void GameMap::notifySeatsConfigured()
         seat->setTeamIndex(teamIndex);
     }
 
-    uint32_t nbTeams = mTeamIds.size();
-    for(int xxx = 0; xxx < getMapSizeX(); ++xxx)
+    // Allied seats share vision. We compute once the seats each seat gives vision to
+    for(Seat* seat : mSeats)
     {
-        for(int yyy = 0; yyy < getMapSizeY(); ++yyy)
+        SeatMask visionMask = seat->getSeatMask();
+        for(Seat* alliedSeat : mSeats)
         {
-            Tile* tile = getTile(xxx, yyy);
-            if(tile == nullptr)
-                continue;
-
-            tile->setTeamsNumber(nbTeams);
+            if(seat->isAlliedSeat(alliedSeat))
+                visionMask |= alliedSeat->getSeatMask();
         }
+        seat->setVisionMask(visionMask);
     }
+
     // Now that team ids are set and tiles are configured, we can compute floodfill
     enableFloodFill();
 }
@@ -3281,3 +3561,57 @@ void GameMap::fireRelativeSound(const std::vector<Seat*>& seats, const std::stri
         ODServer::getSingleton().queueServerNotification(serverNotification);
     }
 }
+
+void GameMap::tileVisionChanged(Tile* tile, bool occlusionChanged)
+{
+    if(occlusionChanged)
+        refreshTileOpacity(tile);
+
+    if(!tile->getIsVisionChanged())
+    {
+        tile->setIsVisionChanged(true);
+        mTilesVisionChanged.push_back(tile);
+    }
+
+    if(!occlusionChanged)
+        return;
+
+    if(tile->getIsOcclusionChanged())
+        return;
+
+    tile->setIsOcclusionChanged(true);
+    mTilesOcclusionChanged.push_back(tile);
+}
+
+void GameMap::tileEntitiesChanged(Tile* tile)
+{
+    if(tile->getIsEntitiesChanged())
+        return;
+
+    tile->setIsEntitiesChanged(true);
+    mTilesEntitiesChanged.push_back(tile);
+}
+
+void GameMap::tileRefreshNeeded(Tile* tile)
+{
+    if(tile->getIsRefreshNeeded())
+        return;
+
+    tile->setIsRefreshNeeded(true);
+    mTilesRefreshNeeded.push_back(tile);
+}
+
+bool GameMap::isOcclusionChanged(const Tile* tile, int radius) const
+{
+    for(Tile* tileChanged : mTilesOcclusionChanged)
+    {
+        if(std::abs(tileChanged->getX() - tile->getX()) > radius)
+            continue;
+        if(std::abs(tileChanged->getY() - tile->getY()) > radius)
+            continue;
+
+        return true;
+    }
+
+    return false;
+}
@@ -21,6 +21,12 @@
 #include "gamemap/TileContainer.h"
 
 #include "ai/AIManager.h"
+#include "gamemap/EntityRegistry.h"
+#include "gamemap/FloodFillForest.h"
+#include "gamemap/FlowField.h"
+#include "gamemap/HierarchicalPathfinding.h"
+#include "gamemap/PathCache.h"
+#include "utils/Random.h"
 
 #ifdef __MINGW32__
 #ifndef mode_t
@@ -39,6 +45,7 @@ class Building;
 class Tile;
 class Creature;
 class GameEntity;
+class JobSystem;
 class Player;
 class Trap;
 class Seat;
@@ -54,7 +61,6 @@ class Spell;
 class TileSet;
 class TileSetValue;
 
-enum class GameEntityType;
 enum class FloodFillType;
 enum class KeeperAIType;
 enum class RoomType;
@@ -85,6 +91,17 @@ enum class SelectionEntityWanted
     creatureAliveEnemyAttackable
 };
 
+//! \brief Algorithm used by GameMap::path
+enum class PathfindingMode
+{
+    //! \brief Full A* on the tiles
+    flat,
+    //! \brief Long paths are computed on the clusters layer (see HierarchicalPathfinding)
+    hierarchical,
+    //! \brief Full A* is used but paths are also computed on the clusters layer to log the differences
+    compare
+};
+
 /*! \brief The class which stores the entire game state on the server and a subset of this on each client.
  *
  * This class is one of the key classes in the OpenDungeons game.  The map
@@ -153,6 +170,10 @@ public:
     //! \brief Returns a pointer to the creature whose name matches name or
     //! nullptr if it is not found
     Creature* getCreature(const std::string& cName) const;
+    Creature* getCreatureFromNetworkId(uint32_t networkId) const;
+
+    //! \brief Should be called when a creature already added to the GameMap is renamed
+    void creatureRenamed(Creature* creature, const std::string& oldName);
 
     inline bool getIsFOWActivated() const
     { return mIsFOWActivated; }
@@ -162,7 +183,7 @@ public:
     std::vector<Creature*> getCreaturesBySeat(const Seat* seat) const;
 
     inline const std::vector<Creature*>& getCreatures() const
-    { return mCreatures; }
+    { return mCreatures.getEntities(); }
 
     Creature* getWorkerToPickupBySeat(Seat* seat);
     Creature* getFighterToPickupBySeat(Seat* seat);
@@ -171,6 +192,10 @@ public:
     void addAnimatedObject(MovableGameEntity *a);
     void removeAnimatedObject(MovableGameEntity *a);
     MovableGameEntity* getAnimatedObject(const std::string& name) const;
+    MovableGameEntity* getAnimatedObjectFromNetworkId(uint32_t networkId) const;
+
+    inline const std::vector<MovableGameEntity*>& getAnimatedObjects() const
+    { return mAnimatedObjects.getEntities(); }
 
     void addClientUpkeepEntity(GameEntity* entity);
     void removeClientUpkeepEntity(GameEntity* entity);
@@ -224,7 +249,7 @@ public:
 
     //! \brief A simple accessor method to return the number of Rooms stored in the GameMap.
     inline const std::vector<Room*>& getRooms() const
-    { return mRooms; }
+    { return mRooms.getEntities(); }
 
     std::vector<Room*> getRoomsByType(RoomType type) const;
     std::vector<Room*> getRoomsByTypeAndSeat(RoomType type,
@@ -245,7 +270,7 @@ public:
     void addTrap(Trap *t);
     void removeTrap(Trap *t);
     inline const std::vector<Trap*>& getTraps() const
-    { return mTraps; }
+    { return mTraps.getEntities(); }
 
     //! \brief Map Lights related functions.
     void clearMapLights();
@@ -253,7 +278,7 @@ public:
     void removeMapLight(MapLight *m);
     MapLight* getMapLight(const std::string& name) const;
     inline const std::vector<MapLight*>& getMapLights() const
-    { return mMapLights; }
+    { return mMapLights.getEntities(); }
 
     //! \brief Deletes the data structure for all the players in the GameMap.
     void clearPlayers();
@@ -273,6 +298,10 @@ public:
     inline const std::vector<Seat*>& getSeats() const
     { return mSeats; }
 
+    //! \brief Returns the seat with the given index (see Seat::getSeatIndex)
+    inline Seat* getSeatByIndex(uint32_t seatIndex) const
+    { return mSeats[seatIndex]; }
+
     //! \brief Returns a pointer to the player structure stored by this GameMap whose seat id matches seatId.
     Player* getPlayerBySeatId(int seatId) const;
     Player* getPlayerBySeat(Seat* seat) const;
@@ -281,8 +310,8 @@ public:
     void clearSeats();
 
     //! \brief A simple mutator method to add another Seat to the GameMap. Checks if a seat with the same
-    //! id is already in the list before inserting. Returns true if the seat was inserted and false
-    //! otherwise
+    //! id is already in the list and if there is room for it in a SeatMask before inserting. Returns true
+    //! if the seat was inserted and false otherwise
     bool addSeat(Seat* s);
 
     int nextSeatId(int SeatId);
@@ -335,6 +364,24 @@ public:
     inline void setLevelFightMusicFile(const std::string& levelFightMusicFile)
     { mMapInfoFightMusicFile = levelFightMusicFile; }
 
+    //! \brief Random seed given in the level file (0 if none)
+    inline uint64_t getLevelRandomSeed() const
+    { return mMapInfoRandomSeed; }
+
+    inline void setLevelRandomSeed(uint64_t levelRandomSeed)
+    { mMapInfoRandomSeed = levelRandomSeed; }
+
+    //! \brief Random numbers used by the game logic. The server thread draws from it (see
+    //! Random::ScopedStream) so that a game started with the same seed gives the same results
+    inline RandomStream& getRandom()
+    { return mRandom; }
+
+    //! \brief Seed the random stream was last started from
+    inline uint64_t getRandomSeed() const
+    { return mRandomSeed; }
+
+    void seedRandom(uint64_t seed);
+
     std::string getGoalsStringForPlayer(Player* player);
 
     //! \brief Loops over all the creatures and calls their individual doTurn methods,
@@ -343,22 +390,29 @@ public:
 
     void doPlayerAITurn(double timeSinceLastTurn);
 
+    //! \brief Returns the floodfill type matching the tiles the given creature can walk on
+    FloodFillType getFloodFillType(const Creature* creature) const;
+
     //! \brief Tells whether a path exists between two tiles for the given creature.
     bool pathExists(const Creature* creature, Tile* tileStart, Tile* tileEnd);
 
     /*! \brief Calculates the walkable path between tileStart and one of the possibleDests. This function
-     * will choose the closest tile in possibleDests and return the path between tileStart and it.
+     * will choose the closest tile in possibleDests (by walking cost) and return the path between tileStart and it.
      * If a path is found, it is returned and chosenTile is set to the chosen tile. If no path is found,
      * an empty list will be returned and chosenTile will be set to nullptr
-     * Note that this function will use some magic numbers to avoid computing paths that are likely to be
-     * further
+     * Only one search is done: it expands from tileStart until one of possibleDests is reached.
      */
-    std::list<Tile*> findBestPath(const Creature* creature, Tile* tileStart, const std::vector<Tile*> possibleDests,
+    std::list<Tile*> findClosestPath(const Creature* creature, Tile* tileStart, const std::vector<Tile*>& possibleDests,
         Tile*& chosenTile);
 
+    //! \brief Same as findClosestPath but fills the given vector instead of building a list.
+    //! \returns true if a path was found.
+    bool computeClosestPath(const Creature* creature, Tile* tileStart, const std::vector<Tile*>& possibleDests,
+        Tile*& chosenTile, std::vector<Tile*>& pathTiles);
+
     /*! \brief Calculates the walkable path between tiles (x1, y1) and (x2, y2).
      *
-     * The search is carried out using the A-star search algorithm.
+     * The search is carried out using the A-star search algorithm with a binary heap as open list.
      * The path returned contains both the starting and ending tiles, and consists
      * entirely of tiles which satify the passability criterion specified by the creature
      * definition.  A "manhattan path" is used what means that successive tile is one of
@@ -374,6 +428,33 @@ public:
     //! \note Returns a path for the given creature to the given destination.
     std::list<Tile*> path(const Creature* creature, Tile* destination, bool throughDiggableTiles = false);
 
+    //! \brief Same as path but fills the given vector instead of building a list. pathTiles is cleared before
+    //! the search so that the same vector can be reused between calls.
+    //! \returns true if a path was found.
+    bool computePath(int x1, int y1, int x2, int y2, const Creature* creature, Seat* seat, bool throughDiggableTiles,
+        std::vector<Tile*>& pathTiles);
+
+    //! \brief Number of path searches asked since the gamemap was created (path, computePath, findClosestPath, ...)
+    inline unsigned int getNumCallsToPath() const
+    { return mNumCallsTo_path; }
+
+    /*! \brief Computes the path for the given creature to destination from a flow field. The flow field is computed
+     * once for all the creatures moving the same way to the same destination and kept during the turn. It should
+     * be used when many creatures go to the same place (call to war for example).
+     */
+    std::list<Tile*> flowFieldPath(const Creature* creature, Tile* destination);
+    bool computeFlowFieldPath(const Creature* creature, Tile* destination, std::vector<Tile*>& pathTiles);
+
+    //! \brief Called when the given tile passability may have changed (dug, claimed, covered by a building, ...)
+    //! to update the hierarchical pathfinding layer and invalidate the cached paths going through it.
+    //! If the tile became passable, or if mayOpen is true (the change cannot be seen in the passability mask, like
+    //! a door removed or unlocked), every cached path is invalidated as a shorter one may exist
+    void tilePassabilityChanged(Tile* tile, bool mayOpen = false);
+
+    //! \brief Sets the algorithm used by path. mode can be "flat", "hierarchical" or "compare".
+    //! Returns false if the mode is unknown
+    bool consoleSetPathfindingMode(const std::string& mode);
+
     //! \brief Loops over the visibleTiles and returns any creature/room/trap in those tiles allied with the given seat
     //! (or if enemyForce is true, is not allied)
     std::vector<GameEntity*> getVisibleForce(const std::vector<Tile*>& visibleTiles, Seat* seat, bool enemyForce);
@@ -385,13 +466,26 @@ public:
     //! \brief Loops over the given tiles and returns any carryable entity in those tiles
     std::vector<GameEntity*> getCarryableEntities(Creature* carrier, const std::vector<Tile*>& tiles);
 
-    //! \brief Checks the neighboor tiles to see if the floodfill can be used. Floodfill consists on tagging all contiguous tiles
-    //! to be able to know before computing it if a path exists between 2 tiles. We do that to avoid computing paths when we
-    //! already know that no path exists.
-    bool doFloodFill(Seat* seat, Tile* tile);
+    //! \brief Floodfill consists on tagging all contiguous tiles to be able to know before computing it if a path exists
+    //! between 2 tiles. We do that to avoid computing paths when we already know that no path exists.
+    //! There is a base layer shared by all the teams. Teams with locked doors also have an overlay where they differ
+    //! from the base layer. When seat is nullptr, the base layer is used. Otherwise, the team of the given seat is used.
+    //! refreshFloodFill updates the floodfill around the given tile when it becomes walkable.
     void refreshFloodFill(Seat* seat, Tile* tile);
+    //! \brief Tiles colored with colorOld are now colored with colorNew (the 2 colors are merged, see FloodFillForest)
     void replaceFloodFill(Seat* seat, FloodFillType floodFillType, uint32_t colorOld, uint32_t colorNew);
 
+    //! \brief Returns the floodfill color the given raw tile color has been merged into
+    uint32_t getFloodFillRepresentative(Seat* seat, uint32_t color);
+
+    bool hasFloodFillOverlay(uint32_t teamIndex) const
+    { return mFloodFillForest.hasOverlay(teamIndex); }
+
+    //! \brief Returns the seats to use to update every floodfill layer after a change that is the same for
+    //! all the teams (tile dug, bridge built, ...): nullptr for the base layer and one seat per team with an overlay
+    const std::vector<Seat*>& getFloodFillLayerSeats() const
+    { return mFloodFillLayerSeats; }
+
     //! \brief Temporarily disables the flood fill computations on this game map.
     void disableFloodFill()
     { mFloodFillEnabled = false; }
@@ -466,17 +560,18 @@ public:
     std::string nextUniqueNameMapLight();
     inline uint32_t nextUniqueFloodFillValue()
     { return ++mUniqueFloodFillValue; }
+    inline uint32_t nextUniqueNetworkId()
+    { return ++mUniqueNetworkId; }
 
     void addRenderedMovableEntity(RenderedMovableEntity *obj);
     void removeRenderedMovableEntity(RenderedMovableEntity *obj);
     RenderedMovableEntity* getRenderedMovableEntity(const std::string& name);
+    RenderedMovableEntity* getRenderedMovableEntityFromNetworkId(uint32_t networkId) const;
     void clearRenderedMovableEntities();
-    GameEntity* getEntityFromTypeAndName(GameEntityType entityType,
-        const std::string& entityName);
 
     //! brief Functions to add/remove/get Spells
     inline const std::vector<Spell*>& getSpells() const
-    { return mSpells; }
+    { return mSpells.getEntities(); }
     void addSpell(Spell *spell);
     void removeSpell(Spell *spell);
     Spell* getSpell(const std::string& name) const;
@@ -497,7 +592,7 @@ public:
     void fireRefreshEntities();
 
     inline const std::vector<RenderedMovableEntity*>& getRenderedMovableEntities() const
-    { return mRenderedMovableEntities; }
+    { return mRenderedMovableEntities.getEntities(); }
 
     inline void setTileSetName(const std::string& tileSetName)
     { mTileSetName = tileSetName; }
@@ -522,6 +617,28 @@ public:
     //! allowed to go through tile
     void doorLock(Tile* tileDoor, Seat* seat, bool locked);
 
+    //! \brief Called on server side when something changed on the given tile that may change vision. If
+    //! occlusionChanged is true, the tile started or stopped blocking vision and the vision of the creatures
+    //! close to it will be recomputed at next upkeep. Otherwise, only the vision given by the tile itself is
+    void tileVisionChanged(Tile* tile, bool occlusionChanged);
+
+    //! \brief Called on server side when the entities on the given tile changed (added, removed, vision
+    //! changed, ...). Only the tiles notified here are checked in updateVisibleEntities
+    void tileEntitiesChanged(Tile* tile);
+
+    //! \brief Called on server side when the given tile has to be sent again to at least one seat. Only the
+    //! tiles notified here are checked in fireRefreshEntities
+    void tileRefreshNeeded(Tile* tile);
+
+    //! \brief Returns true if a tile within the given radius of the given tile started or stopped blocking
+    //! vision since the last upkeep
+    bool isOcclusionChanged(const Tile* tile, int radius) const;
+
+    //! \brief Returns true if all the tilesToReach can be reached from startTile through tiles with the same
+    //! floodfill color without going through tileIgnored. If more than maxTiles tiles are processed, returns false
+    bool isFloodFillConnected(Seat* seat, FloodFillType type, Tile* startTile, const std::vector<Tile*>& tilesToReach,
+        Tile* tileIgnored, uint32_t maxTiles);
+
     //! \brief Goes through all tile neighbors from startTile and replaces floodfill for all values in oldColors
     //! by newColors for each value in oldColors != Tile::NO_FLOODFILL
     //! If tileIgnored is not null, this tile won't be processed if found
@@ -561,6 +678,16 @@ private:
     int mUniqueNumberTrap;
     int mUniqueNumberMapLight;
     uint32_t mUniqueFloodFillValue;
+    uint32_t mUniqueNetworkId;
+
+    //! \brief Floodfill colors merged when areas get connected
+    FloodFillForest mFloodFillForest;
+
+    //! \brief Locked door tiles per team index. When a team has no locked door left, its floodfill overlay is removed
+    std::map<uint32_t, std::vector<Tile*>> mFloodFillLockedDoors;
+
+    //! \brief See getFloodFillLayerSeats. Updated when a team overlay is created or removed
+    std::vector<Seat*> mFloodFillLayerSeats;
 
     //! \brief When paused, the GameMap is not updated.
     bool mIsPaused;
@@ -575,8 +702,12 @@ private:
     std::string mMapInfoDescription;
     std::string mMapInfoMusicFile;
     std::string mMapInfoFightMusicFile;
+    uint64_t mMapInfoRandomSeed;
 
-    std::vector<Creature*> mCreatures;
+    RandomStream mRandom;
+    uint64_t mRandomSeed;
+
+    EntityRegistry<Creature> mCreatures;
 
     //! \brief The creature definition data. We use a pair to be able to make the difference between the original
     //! data from the global creature definition file and the specific data from the level file. With this trick,
@@ -586,12 +717,12 @@ private:
     std::vector<std::pair<const Weapon*,Weapon*> > mWeapons;
 
     //Mutable to allow locking in const functions.
-    std::vector<MovableGameEntity*> mAnimatedObjects;
+    EntityRegistry<MovableGameEntity> mAnimatedObjects;
 
     //! \brief Map Entities
-    std::vector<Room*> mRooms;
-    std::vector<Trap*> mTraps;
-    std::vector<MapLight*> mMapLights;
+    EntityRegistry<Room> mRooms;
+    EntityRegistry<Trap> mTraps;
+    EntityRegistry<MapLight> mMapLights;
 
     //! \brief Players and available game player slots (Seats)
     std::vector<Player*> mPlayers;
@@ -610,7 +741,23 @@ private:
     //! When true, fog of war will work normally. When false, every connected client will see the whole map
     bool mIsFOWActivated;
 
-    std::vector<GameEntity*> mActiveObjects;
+    //! \brief False until the vision of every tile has been computed. Set back to false when
+    //! fog of war is toggled
+    bool mIsVisionInitialized;
+
+    //! \brief Tiles that need their vision to be recomputed at next upkeep (see tileVisionChanged)
+    std::vector<Tile*> mTilesVisionChanged;
+
+    //! \brief Tiles that started or stopped blocking vision since last upkeep
+    std::vector<Tile*> mTilesOcclusionChanged;
+
+    //! \brief Tiles with entities to notify to seats at next updateVisibleEntities (see tileEntitiesChanged)
+    std::vector<Tile*> mTilesEntitiesChanged;
+
+    //! \brief Tiles to send to the seats at next fireRefreshEntities (see tileRefreshNeeded)
+    std::vector<Tile*> mTilesRefreshNeeded;
+
+    EntityRegistry<GameEntity> mActiveObjects;
 
     //! \brief Useless entities that need to be deleted. They will be deleted when processDeletionQueues is called
     std::vector<GameEntity*> mEntitiesToDelete;
@@ -618,9 +765,33 @@ private:
     //! \brief Debug member used to know how many call to pathfinding has been made within the same turn.
     unsigned int mNumCallsTo_path;
 
-    std::vector<RenderedMovableEntity*> mRenderedMovableEntities;
+    //! \brief Clusters layer used to compute long paths. There is one layer per FloodFillType
+    HierarchicalPathfinding mHierarchicalPathfinding;
+    PathfindingMode mPathfindingMode;
+
+    //! \brief Debug members used in PathfindingMode::compare to know how the hierarchical paths
+    //! compare to the full A* ones within the same turn
+    uint32_t mNbHierarchicalPathsCompared;
+    uint32_t mNbHierarchicalPathsMissed;
+    uint64_t mHierarchicalPathsLength;
+    uint64_t mFlatPathsLength;
+
+    //! \brief Paths recently computed. Many creatures ask for the same paths (to the treasury, the
+    //! dormitory, ...)
+    PathCache mPathCache;
+    //! \brief Tile indexes exchanged with mPathCache. Kept to avoid allocations
+    std::vector<int32_t> mPathCacheIndexes;
+
+    //! \brief Flow fields computed during this turn. The key start tile is not used
+    std::map<PathCache::Key, std::unique_ptr<FlowField>> mFlowFields;
+    uint32_t mNbFlowFieldsComputed;
 
-    std::vector<Spell*> mSpells;
+    //! \brief Threads used to prepare the creatures upkeep in parallel
+    std::unique_ptr<JobSystem> mJobSystem;
+
+    EntityRegistry<RenderedMovableEntity> mRenderedMovableEntities;
+
+    EntityRegistry<Spell> mSpells;
 
     std::vector<int> mTeamIds;
 
@@ -632,11 +803,53 @@ private:
     std::string mTileSetName;
 
     //! \brief Updates different entities states.
-    //! Updates active objects (creatures, rooms, ...), goals, count each team Workers, gold, mana and claimed tiles.
+    //! Updates active objects (creatures, rooms, ...), goals and mana.
     unsigned long int doMiscUpkeep(double timeSinceLastTurn);
 
+    //! \brief Recounts the claimed tiles, creatures and gold of every seat and logs an error if the
+    //! counts maintained incrementally differ. Used in debug only
+    void checkSeatCounts();
+
     //! \brief Resets the unique numbers
     void resetUniqueNumbers();
+
+    //! \brief Returns the key used to cache paths for the given creature
+    PathCache::Key getPathKey(const Creature* creature, int32_t start, int32_t destination) const;
+
+    //! \brief Computes the walking cost from every tile to target for the given creature
+    void computeFlowField(Tile* target, const Creature* creature, FlowField& flowField);
+
+    //! \brief Drops the flow fields that may change because of the given tile
+    void invalidateFlowFields(Tile* tile);
+
+    //! \brief Computes the path between start and destination without the path cache
+    bool searchPath(Tile* start, Tile* destination, const Creature* creature, Seat* seat, bool throughDiggableTiles,
+        std::vector<Tile*>& pathTiles);
+
+    //! \brief Computes the path between start and destination with a full A* on the tiles
+    bool computeFlatPath(Tile* start, Tile* destination, const Creature* creature, Seat* seat, bool throughDiggableTiles,
+        std::vector<Tile*>& pathTiles);
+
+    /*! \brief Searches the tiles from start until one of the targets (sorted tile indexes) is reached. If heuristicTile
+     * is not null, the manhattan distance to it is used as heuristic (A*). Otherwise, the closest target by walking
+     * cost is reached (Dijkstra).
+     * \returns the index of the reached target or PathfindingArena::NO_INDEX if none can be reached. The path
+     * can be retrieved from the arena.
+     */
+    int32_t searchTiles(PathfindingArena& arena, Tile* start, const int32_t* sortedTargets, uint32_t nbTargets,
+        Tile* heuristicTile, const Creature* creature, Seat* seat, bool throughDiggableTiles);
+
+    //! \brief Fills pathTiles with the tiles from the search start to the given tile index
+    void buildPathTiles(const PathfindingArena& arena, int32_t index, std::vector<Tile*>& pathTiles);
+
+    //! \brief Computes the path between start and destination on the clusters layer. Returns false if the
+    //! tiles are too close or if the path cannot be used by the given creature. In this case, the full
+    //! search should be used
+    bool computeHierarchicalPath(Tile* start, Tile* destination, const Creature* creature, std::vector<Tile*>& pathTiles);
+
+    //! \brief Recomputes the clusters layer passability from all the tiles
+    void resetHierarchicalPathfinding();
+    void updateFloodFillLayerSeats();
 };
 
 #endif // GAMEMAP_H
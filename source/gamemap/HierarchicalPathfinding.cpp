@@ -0,0 +1,503 @@
+/*!
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gamemap/HierarchicalPathfinding.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+//! \brief Transitions longer than this get 2 entrances (one at each end) instead of one in the middle
+static const int MIN_LENGTH_DOUBLE_ENTRANCE = 6;
+
+HierarchicalPathfinding::HierarchicalPathfinding(uint32_t nbLayers, int clusterSize) :
+    mNbLayers(nbLayers),
+    mClusterSize(clusterSize),
+    mMapSizeX(0),
+    mMapSizeY(0),
+    mNbClustersX(0),
+    mNbClustersY(0)
+{
+}
+
+void HierarchicalPathfinding::init(int mapSizeX, int mapSizeY)
+{
+    mMapSizeX = mapSizeX;
+    mMapSizeY = mapSizeY;
+    mNbClustersX = (mapSizeX + mClusterSize - 1) / mClusterSize;
+    mNbClustersY = (mapSizeY + mClusterSize - 1) / mClusterSize;
+
+    uint32_t nbTiles = static_cast<uint32_t>(mapSizeX * mapSizeY);
+    uint32_t nbClusters = static_cast<uint32_t>(mNbClustersX * mNbClustersY);
+    mPassability.assign(nbTiles, 0);
+    mBlocked.assign(nbTiles, false);
+    mClusters.assign(nbClusters * mNbLayers, ClusterLayer());
+    mBordersRight.assign(nbClusters * mNbLayers, Transitions());
+    mBordersBottom.assign(nbClusters * mNbLayers, Transitions());
+
+    // Every cluster will be computed on the first search
+    mIsClusterDirty.assign(nbClusters, true);
+    mDirtyClusters.clear();
+    for(uint32_t i = 0; i < nbClusters; ++i)
+        mDirtyClusters.push_back(static_cast<int32_t>(i));
+}
+
+void HierarchicalPathfinding::setTilePassability(int x, int y, uint32_t mask)
+{
+    // Changes done before init (while the map is loading for example) will be taken into account by init
+    if((x < 0) || (y < 0) || (x >= mMapSizeX) || (y >= mMapSizeY))
+        return;
+
+    int32_t index = toIndex(x, y);
+    if(mPassability[index] == mask)
+        return;
+
+    mPassability[index] = mask;
+    setClusterDirty(getClusterIndex(x, y));
+}
+
+void HierarchicalPathfinding::setTileBlocked(int x, int y, bool blocked)
+{
+    // Changes done before init (while the map is loading for example) will be taken into account by init
+    if((x < 0) || (y < 0) || (x >= mMapSizeX) || (y >= mMapSizeY))
+        return;
+
+    int32_t index = toIndex(x, y);
+    if(mBlocked[index] == blocked)
+        return;
+
+    mBlocked[index] = blocked;
+    setClusterDirty(getClusterIndex(x, y));
+}
+
+bool HierarchicalPathfinding::isTilePassable(int x, int y, uint32_t layer) const
+{
+    if((x < 0) || (y < 0) || (x >= mMapSizeX) || (y >= mMapSizeY))
+        return false;
+
+    int32_t index = toIndex(x, y);
+    if(mBlocked[index])
+        return false;
+
+    return (mPassability[index] & (1u << layer)) != 0;
+}
+
+void HierarchicalPathfinding::setClusterDirty(int32_t clusterIndex)
+{
+    if(mIsClusterDirty[clusterIndex])
+        return;
+
+    mIsClusterDirty[clusterIndex] = true;
+    mDirtyClusters.push_back(clusterIndex);
+}
+
+void HierarchicalPathfinding::updateDirtyClusters()
+{
+    if(mDirtyClusters.empty())
+        return;
+
+    // The entrances of a dirty cluster are shared with its neighbours. We recompute every border
+    // of the dirty clusters and then, the edges of every cluster touching one of these borders
+    std::vector<bool> isAffected(mIsClusterDirty.size(), false);
+    std::vector<int32_t> affectedClusters;
+    auto addAffected = [&](int32_t clusterIndex)
+    {
+        if(isAffected[clusterIndex])
+            return;
+
+        isAffected[clusterIndex] = true;
+        affectedClusters.push_back(clusterIndex);
+    };
+
+    for(int32_t clusterIndex : mDirtyClusters)
+    {
+        int cx = clusterIndex % mNbClustersX;
+        int cy = clusterIndex / mNbClustersX;
+        for(uint32_t layer = 0; layer < mNbLayers; ++layer)
+        {
+            computeBorder(clusterIndex, true, layer);
+            computeBorder(clusterIndex, false, layer);
+            if(cx > 0)
+                computeBorder(clusterIndex - 1, true, layer);
+            if(cy > 0)
+                computeBorder(clusterIndex - mNbClustersX, false, layer);
+        }
+
+        addAffected(clusterIndex);
+        if(cx > 0)
+            addAffected(clusterIndex - 1);
+        if(cx + 1 < mNbClustersX)
+            addAffected(clusterIndex + 1);
+        if(cy > 0)
+            addAffected(clusterIndex - mNbClustersX);
+        if(cy + 1 < mNbClustersY)
+            addAffected(clusterIndex + mNbClustersX);
+
+        mIsClusterDirty[clusterIndex] = false;
+    }
+    mDirtyClusters.clear();
+
+    for(int32_t clusterIndex : affectedClusters)
+    {
+        for(uint32_t layer = 0; layer < mNbLayers; ++layer)
+            computeClusterEntrances(clusterIndex, layer);
+    }
+}
+
+void HierarchicalPathfinding::computeBorder(int32_t clusterIndex, bool right, uint32_t layer)
+{
+    int cx = clusterIndex % mNbClustersX;
+    int cy = clusterIndex / mNbClustersX;
+    Transitions& transitions = right ? mBordersRight[clusterIndex * mNbLayers + layer]
+                                     : mBordersBottom[clusterIndex * mNbLayers + layer];
+    transitions.clear();
+
+    // (x1, y1) is the first tile on the border in this cluster. (x2, y2) its neighbour in the other
+    // cluster. (dx, dy) the direction to follow the border
+    int x1, y1, x2, y2, dx, dy, length;
+    if(right)
+    {
+        x1 = (cx + 1) * mClusterSize - 1;
+        x2 = x1 + 1;
+        if(x2 >= mMapSizeX)
+            return;
+
+        y1 = cy * mClusterSize;
+        y2 = y1;
+        dx = 0;
+        dy = 1;
+        length = std::min(mClusterSize, mMapSizeY - y1);
+    }
+    else
+    {
+        y1 = (cy + 1) * mClusterSize - 1;
+        y2 = y1 + 1;
+        if(y2 >= mMapSizeY)
+            return;
+
+        x1 = cx * mClusterSize;
+        x2 = x1;
+        dx = 1;
+        dy = 0;
+        length = std::min(mClusterSize, mMapSizeX - x1);
+    }
+
+    auto addTransition = [&](int pos)
+    {
+        transitions.push_back(std::make_pair(toIndex(x1 + pos * dx, y1 + pos * dy),
+            toIndex(x2 + pos * dx, y2 + pos * dy)));
+    };
+
+    int runStart = -1;
+    for(int pos = 0; pos <= length; ++pos)
+    {
+        bool isOpen = (pos < length) &&
+            isTilePassable(x1 + pos * dx, y1 + pos * dy, layer) &&
+            isTilePassable(x2 + pos * dx, y2 + pos * dy, layer);
+
+        if(isOpen)
+        {
+            if(runStart < 0)
+                runStart = pos;
+            continue;
+        }
+
+        if(runStart < 0)
+            continue;
+
+        int runEnd = pos - 1;
+        if(runEnd - runStart + 1 < MIN_LENGTH_DOUBLE_ENTRANCE)
+        {
+            addTransition((runStart + runEnd) / 2);
+        }
+        else
+        {
+            addTransition(runStart);
+            addTransition(runEnd);
+        }
+        runStart = -1;
+    }
+}
+
+void HierarchicalPathfinding::computeClusterEntrances(int32_t clusterIndex, uint32_t layer)
+{
+    ClusterLayer& clusterLayer = mClusters[clusterIndex * mNbLayers + layer];
+    std::vector<Entrance>& entrances = clusterLayer.mEntrances;
+    entrances.clear();
+    clusterLayer.mPaths.clear();
+
+    auto addTransition = [&](int32_t tile, int32_t otherTile)
+    {
+        for(Entrance& entrance : entrances)
+        {
+            if(entrance.mTile != tile)
+                continue;
+
+            entrance.mInterEdges.push_back(otherTile);
+            return;
+        }
+
+        Entrance entrance;
+        entrance.mTile = tile;
+        entrance.mInterEdges.push_back(otherTile);
+        entrances.push_back(entrance);
+    };
+
+    int cx = clusterIndex % mNbClustersX;
+    int cy = clusterIndex / mNbClustersX;
+    for(const std::pair<int32_t, int32_t>& transition : mBordersRight[clusterIndex * mNbLayers + layer])
+        addTransition(transition.first, transition.second);
+    for(const std::pair<int32_t, int32_t>& transition : mBordersBottom[clusterIndex * mNbLayers + layer])
+        addTransition(transition.first, transition.second);
+    if(cx > 0)
+    {
+        for(const std::pair<int32_t, int32_t>& transition : mBordersRight[(clusterIndex - 1) * mNbLayers + layer])
+            addTransition(transition.second, transition.first);
+    }
+    if(cy > 0)
+    {
+        for(const std::pair<int32_t, int32_t>& transition : mBordersBottom[(clusterIndex - mNbClustersX) * mNbLayers + layer])
+            addTransition(transition.second, transition.first);
+    }
+
+    // Now, we compute the walking distance between the entrances
+    for(Entrance& entrance : entrances)
+    {
+        searchInCluster(entrance.mTile, layer, PathfindingArena::NO_INDEX);
+        for(const Entrance& other : entrances)
+        {
+            if(other.mTile == entrance.mTile)
+                continue;
+
+            if(!mArena.isReached(other.mTile))
+                continue;
+
+            entrance.mIntraEdges.push_back(std::make_pair(other.mTile, mArena.getNode(other.mTile).mG));
+        }
+    }
+}
+
+HierarchicalPathfinding::Entrance* HierarchicalPathfinding::getEntrance(int32_t clusterIndex, uint32_t layer, int32_t tileIndex)
+{
+    for(Entrance& entrance : mClusters[clusterIndex * mNbLayers + layer].mEntrances)
+    {
+        if(entrance.mTile == tileIndex)
+            return &entrance;
+    }
+
+    return nullptr;
+}
+
+void HierarchicalPathfinding::searchInCluster(int32_t tileIndex, uint32_t layer, int32_t stopTile)
+{
+    int x = indexToX(tileIndex);
+    int y = indexToY(tileIndex);
+    int xMin = (x / mClusterSize) * mClusterSize;
+    int yMin = (y / mClusterSize) * mClusterSize;
+    int xMax = std::min(xMin + mClusterSize, mMapSizeX);
+    int yMax = std::min(yMin + mClusterSize, mMapSizeY);
+
+    static const int DIRECTIONS[4][2] = { {-1, 0}, {1, 0}, {0, -1}, {0, 1} };
+
+    mArena.startSearch(mMapSizeX, mMapSizeY);
+    mArena.open(tileIndex, 0.0, 0.0, PathfindingArena::NO_INDEX);
+    while(!mArena.isOpenListEmpty())
+    {
+        int32_t currentIndex = mArena.popBest();
+        if(currentIndex == stopTile)
+            break;
+
+        int currentX = indexToX(currentIndex);
+        int currentY = indexToY(currentIndex);
+        double g = mArena.getNode(currentIndex).mG + 1.0;
+        for(const int* direction : DIRECTIONS)
+        {
+            int neighX = currentX + direction[0];
+            int neighY = currentY + direction[1];
+            if((neighX < xMin) || (neighX >= xMax) || (neighY < yMin) || (neighY >= yMax))
+                continue;
+
+            if(!isTilePassable(neighX, neighY, layer))
+                continue;
+
+            int32_t neighIndex = toIndex(neighX, neighY);
+            if(!mArena.isReached(neighIndex))
+                mArena.open(neighIndex, g, 0.0, currentIndex);
+            else if(!mArena.isClosed(neighIndex) && (g < mArena.getNode(neighIndex).mG))
+                mArena.decreaseCost(neighIndex, g, 0.0, currentIndex);
+        }
+    }
+}
+
+bool HierarchicalPathfinding::appendClusterPath(int32_t tileFrom, int32_t tileTo, uint32_t layer, std::vector<int32_t>& path)
+{
+    int32_t clusterIndex = getClusterIndexFromTile(tileFrom);
+    ClusterLayer& clusterLayer = mClusters[clusterIndex * mNbLayers + layer];
+    // We only keep paths between entrances. Paths to the start/destination tiles are not likely to be reused
+    bool isBetweenEntrances = (getEntrance(clusterIndex, layer, tileFrom) != nullptr) &&
+        (getEntrance(clusterIndex, layer, tileTo) != nullptr);
+    std::pair<int32_t, int32_t> key(tileFrom, tileTo);
+    if(isBetweenEntrances)
+    {
+        auto it = clusterLayer.mPaths.find(key);
+        if(it != clusterLayer.mPaths.end())
+        {
+            path.insert(path.end(), it->second.begin(), it->second.end());
+            return true;
+        }
+    }
+
+    searchInCluster(tileFrom, layer, tileTo);
+    if(!mArena.isReached(tileTo))
+        return false;
+
+    std::vector<int32_t> tiles;
+    mArena.buildPath(tileTo, tiles);
+    // The first tile is tileFrom which is already in the path
+    path.insert(path.end(), tiles.begin() + 1, tiles.end());
+    if(isBetweenEntrances)
+        clusterLayer.mPaths[key] = std::vector<int32_t>(tiles.begin() + 1, tiles.end());
+
+    return true;
+}
+
+bool HierarchicalPathfinding::findPath(int x1, int y1, int x2, int y2, uint32_t layer, std::vector<int32_t>& path)
+{
+    path.clear();
+    if(layer >= mNbLayers)
+        return false;
+
+    if((x1 < 0) || (y1 < 0) || (x1 >= mMapSizeX) || (y1 >= mMapSizeY))
+        return false;
+
+    if(!isTilePassable(x2, y2, layer))
+        return false;
+
+    int32_t startCluster = getClusterIndex(x1, y1);
+    int32_t destCluster = getClusterIndex(x2, y2);
+    if(startCluster == destCluster)
+        return false;
+
+    updateDirtyClusters();
+
+    int32_t startTile = toIndex(x1, y1);
+    int32_t destTile = toIndex(x2, y2);
+
+    // We compute the cost from the start tile to the entrances of its cluster and from the
+    // entrances of the destination cluster to the destination
+    std::vector<std::pair<int32_t, double>> startCosts;
+    searchInCluster(startTile, layer, PathfindingArena::NO_INDEX);
+    for(const Entrance& entrance : mClusters[startCluster * mNbLayers + layer].mEntrances)
+    {
+        if(mArena.isReached(entrance.mTile))
+            startCosts.push_back(std::make_pair(entrance.mTile, mArena.getNode(entrance.mTile).mG));
+    }
+
+    std::vector<std::pair<int32_t, double>> destCosts;
+    searchInCluster(destTile, layer, PathfindingArena::NO_INDEX);
+    for(const Entrance& entrance : mClusters[destCluster * mNbLayers + layer].mEntrances)
+    {
+        if(mArena.isReached(entrance.mTile))
+            destCosts.push_back(std::make_pair(entrance.mTile, mArena.getNode(entrance.mTile).mG));
+    }
+
+    if(startCosts.empty() || destCosts.empty())
+        return false;
+
+    // A* on the entrances graph. The destination tile is added to the graph through the entrances
+    // of its cluster
+    auto heuristic = [&](int32_t tileIndex)
+    {
+        return static_cast<double>(std::abs(indexToX(tileIndex) - x2) + std::abs(indexToY(tileIndex) - y2));
+    };
+    auto relax = [&](int32_t tileIndex, double g, int32_t parent)
+    {
+        if(mArena.isClosed(tileIndex))
+            return;
+
+        if(!mArena.isReached(tileIndex))
+            mArena.open(tileIndex, g, heuristic(tileIndex), parent);
+        else if(g < mArena.getNode(tileIndex).mG)
+            mArena.decreaseCost(tileIndex, g, heuristic(tileIndex), parent);
+    };
+
+    mArena.startSearch(mMapSizeX, mMapSizeY);
+    for(const std::pair<int32_t, double>& startCost : startCosts)
+        relax(startCost.first, startCost.second, PathfindingArena::NO_INDEX);
+
+    bool found = false;
+    while(!mArena.isOpenListEmpty())
+    {
+        int32_t currentIndex = mArena.popBest();
+        if(currentIndex == destTile)
+        {
+            found = true;
+            break;
+        }
+
+        double g = mArena.getNode(currentIndex).mG;
+        int32_t clusterIndex = getClusterIndexFromTile(currentIndex);
+        const Entrance* entrance = getEntrance(clusterIndex, layer, currentIndex);
+        if(entrance == nullptr)
+            continue;
+
+        for(const std::pair<int32_t, double>& edge : entrance->mIntraEdges)
+            relax(edge.first, g + edge.second, currentIndex);
+
+        for(int32_t otherTile : entrance->mInterEdges)
+            relax(otherTile, g + 1.0, currentIndex);
+
+        if(clusterIndex != destCluster)
+            continue;
+
+        for(const std::pair<int32_t, double>& destCost : destCosts)
+        {
+            if(destCost.first != currentIndex)
+                continue;
+
+            relax(destTile, g + destCost.second, currentIndex);
+            break;
+        }
+    }
+
+    if(!found)
+        return false;
+
+    std::vector<int32_t> abstractPath;
+    mArena.buildPath(destTile, abstractPath);
+
+    // Refinement. Consecutive nodes in different clusters are neighbour tiles. Otherwise, we
+    // need the tiles between them inside their cluster
+    path.push_back(startTile);
+    int32_t previousTile = startTile;
+    for(int32_t tileIndex : abstractPath)
+    {
+        if(tileIndex == previousTile)
+            continue;
+
+        if(getClusterIndexFromTile(previousTile) != getClusterIndexFromTile(tileIndex))
+            path.push_back(tileIndex);
+        else if(!appendClusterPath(previousTile, tileIndex, layer, path))
+        {
+            path.clear();
+            return false;
+        }
+
+        previousTile = tileIndex;
+    }
+
+    return true;
+}
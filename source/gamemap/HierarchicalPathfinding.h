@@ -0,0 +1,153 @@
+/*!
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HIERARCHICALPATHFINDING_H
+#define HIERARCHICALPATHFINDING_H
+
+#include "gamemap/PathfindingArena.h"
+
+#include <cstdint>
+#include <map>
+#include <utility>
+#include <vector>
+
+/*! \brief Abstraction layer used to compute long paths on big maps (HPA*).
+ *
+ * The map is split in square clusters. On each border between 2 clusters, we look for
+ * the walkable transitions and place entrances on them. Then, for each cluster, we compute
+ * the walking distance between its entrances. That gives a small graph (the entrances) on
+ * which a long path can be searched much faster than on the tile grid. Only the start and
+ * the destination clusters need a search on tiles. The paths between entrances of the same
+ * cluster are computed when first needed and kept until the cluster changes.
+ *
+ * There is one graph per layer. A layer is a passability type (see FloodFillType). Each tile
+ * has a passability mask with 1 bit per layer. When a tile mask changes, its cluster is marked
+ * as dirty and will be recomputed (with its neighbours entrances) on the next search.
+ *
+ * The layer works on uniform costs and 4 connected tiles. Paths returned are valid for the given
+ * passability but may be a bit longer than the ones computed by a full A*.
+ */
+class HierarchicalPathfinding
+{
+public:
+    HierarchicalPathfinding(uint32_t nbLayers, int clusterSize);
+
+    //! \brief Resets the layer for a map of the given size. Every tile is set as not passable
+    void init(int mapSizeX, int mapSizeY);
+
+    //! \brief Sets the passability mask (1 bit per layer) for the given tile
+    void setTilePassability(int x, int y, uint32_t mask);
+
+    //! \brief Blocks the given tile for every layer whatever its passability mask (for example,
+    //! because of a locked door)
+    void setTileBlocked(int x, int y, bool blocked);
+
+    //! \brief Returns true if the given tile can be walked on the given layer
+    bool isTilePassable(int x, int y, uint32_t layer) const;
+
+    //! \brief Computes a path between the 2 given tiles on the given layer. The path contains both
+    //! the start and the destination tile indexes (y * mapSizeX + x).
+    //! \returns false if the tiles are too close to benefit from the abstraction (same cluster) or
+    //! if no path was found. In both cases, the caller should fallback on a full search.
+    bool findPath(int x1, int y1, int x2, int y2, uint32_t layer, std::vector<int32_t>& path);
+
+    inline int getClusterSize() const
+    { return mClusterSize; }
+
+    inline int indexToX(int32_t index) const
+    { return index % mMapSizeX; }
+
+    inline int indexToY(int32_t index) const
+    { return index / mMapSizeX; }
+
+    //! \brief Returns the number of clusters that will be recomputed on the next search
+    inline uint32_t getNbDirtyClusters() const
+    { return static_cast<uint32_t>(mDirtyClusters.size()); }
+
+private:
+    struct Entrance
+    {
+        //! \brief Tile index of the entrance
+        int32_t mTile;
+        //! \brief Entrances of the same cluster reachable from this one with their walking cost
+        std::vector<std::pair<int32_t, double>> mIntraEdges;
+        //! \brief Adjacent entrances in the neighbour clusters
+        std::vector<int32_t> mInterEdges;
+    };
+
+    struct ClusterLayer
+    {
+        std::vector<Entrance> mEntrances;
+        //! \brief Tile paths between 2 entrances of the cluster computed so far (first tile excluded)
+        std::map<std::pair<int32_t, int32_t>, std::vector<int32_t>> mPaths;
+    };
+
+    //! \brief Transitions between 2 neighbour clusters. first is in the left/top cluster
+    //! and second in the right/bottom one
+    typedef std::vector<std::pair<int32_t, int32_t>> Transitions;
+
+    uint32_t mNbLayers;
+    int mClusterSize;
+    int mMapSizeX;
+    int mMapSizeY;
+    int mNbClustersX;
+    int mNbClustersY;
+
+    std::vector<uint32_t> mPassability;
+    std::vector<bool> mBlocked;
+
+    //! \brief Per cluster and per layer data. Index is (clusterIndex * mNbLayers + layer)
+    std::vector<ClusterLayer> mClusters;
+    //! \brief Transitions on borders between a cluster and the one on its right/bottom.
+    //! Index is (clusterIndex * mNbLayers + layer)
+    std::vector<Transitions> mBordersRight;
+    std::vector<Transitions> mBordersBottom;
+
+    std::vector<bool> mIsClusterDirty;
+    std::vector<int32_t> mDirtyClusters;
+
+    PathfindingArena mArena;
+
+    inline int32_t toIndex(int x, int y) const
+    { return y * mMapSizeX + x; }
+
+    inline int32_t getClusterIndex(int x, int y) const
+    { return (y / mClusterSize) * mNbClustersX + (x / mClusterSize); }
+
+    inline int32_t getClusterIndexFromTile(int32_t tileIndex) const
+    { return getClusterIndex(indexToX(tileIndex), indexToY(tileIndex)); }
+
+    void setClusterDirty(int32_t clusterIndex);
+
+    //! \brief Recomputes the entrances and the intra cluster edges of the dirty clusters and of their neighbours
+    void updateDirtyClusters();
+
+    void computeBorder(int32_t clusterIndex, bool right, uint32_t layer);
+    void computeClusterEntrances(int32_t clusterIndex, uint32_t layer);
+
+    Entrance* getEntrance(int32_t clusterIndex, uint32_t layer, int32_t tileIndex);
+
+    //! \brief Runs a Dijkstra from the given tile restricted to its cluster. Results are in mArena.
+    //! If stopTile is reached, the search is stopped.
+    void searchInCluster(int32_t tileIndex, uint32_t layer, int32_t stopTile);
+
+    //! \brief Appends to path the tiles from tileFrom (excluded) to tileTo (included) within the cluster
+    //! containing both. Returns false if no path is found
+    bool appendClusterPath(int32_t tileFrom, int32_t tileTo, uint32_t layer, std::vector<int32_t>& path);
+};
+
+#endif // HIERARCHICALPATHFINDING_H
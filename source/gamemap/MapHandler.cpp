@@ -132,6 +132,20 @@ bool readGameMapFromFile(const std::string& fileName, GameMap& gameMap)
             OD_LOG_INF("TileSet: " + tileSet);
             continue;
         }
+
+        param = "RandomSeed\t";
+        if (nextParam.compare(0, param.size(), param) == 0)
+        {
+            uint64_t seed = 0;
+            std::stringstream ss(nextParam.substr(param.size()));
+            if(!(ss >> seed))
+            {
+                OD_LOG_WRN("Invalid random seed=" + nextParam);
+                return false;
+            }
+            gameMap.setLevelRandomSeed(seed);
+            continue;
+        }
     }
 
     levelFile >> nextParam;
@@ -231,12 +245,20 @@ bool readGameMapFromFile(const std::string& fileName, GameMap& gameMap)
         std::getline(levelFile, nextParam);
         entire_line += nextParam;
 
-        Tile* tile = new Tile(&gameMap, true);
+        // The tiles have been created with the map. We load the one at the given coordinates
+        std::stringstream lineStream(entire_line);
+        int xLocation = -1;
+        int yLocation = -1;
+        lineStream >> xLocation >> yLocation;
+        Tile* tile = gameMap.getTile(xLocation, yLocation);
+        if(tile == nullptr)
+        {
+            OD_LOG_ERR("Invalid tile line=" + entire_line);
+            return false;
+        }
 
         Tile::loadFromLine(entire_line, tile);
         tile->computeTileVisual();
-
-        gameMap.addTile(tile);
     }
 
     gameMap.setAllFullnessAndNeighbors();
@@ -575,6 +597,8 @@ bool writeGameMapToFile(const std::string& fileName, GameMap& gameMap)
         levelFile << "FightMusic\t" << gameMap.getLevelFightMusicFile() << std::endl;
     if(!gameMap.getTileSetName().empty())
         levelFile << "TileSet\t" << gameMap.getTileSetName() << std::endl;
+    if(gameMap.getLevelRandomSeed() != 0)
+        levelFile << "RandomSeed\t" << gameMap.getLevelRandomSeed() << std::endl;
 
     levelFile << "[/Info]" << std::endl;
 
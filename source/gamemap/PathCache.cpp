@@ -0,0 +1,168 @@
+/*!
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gamemap/PathCache.h"
+
+#include <algorithm>
+
+bool PathCache::Key::operator<(const Key& other) const
+{
+    if(mStart != other.mStart)
+        return mStart < other.mStart;
+    if(mDestination != other.mDestination)
+        return mDestination < other.mDestination;
+    if(mSpeedGround != other.mSpeedGround)
+        return mSpeedGround < other.mSpeedGround;
+    if(mSpeedWater != other.mSpeedWater)
+        return mSpeedWater < other.mSpeedWater;
+    if(mSpeedLava != other.mSpeedLava)
+        return mSpeedLava < other.mSpeedLava;
+    if(mSeatId != other.mSeatId)
+        return mSeatId < other.mSeatId;
+
+    return mIsFighting < other.mIsFighting;
+}
+
+PathCache::PathCache(uint32_t capacity, int regionSize) :
+    mCapacity(capacity),
+    mRegionSize(regionSize),
+    mMapSizeX(0),
+    mMapSizeY(0),
+    mNbRegionsX(0),
+    mOpenedRevision(0),
+    mNbHits(0),
+    mNbMisses(0)
+{
+}
+
+void PathCache::init(int mapSizeX, int mapSizeY)
+{
+    mMapSizeX = mapSizeX;
+    mMapSizeY = mapSizeY;
+    mNbRegionsX = (mapSizeX + mRegionSize - 1) / mRegionSize;
+    int nbRegionsY = (mapSizeY + mRegionSize - 1) / mRegionSize;
+    mRegionRevisions.assign(static_cast<uint32_t>(mNbRegionsX * nbRegionsY), 0);
+    mEntries.clear();
+    mIndex.clear();
+}
+
+bool PathCache::get(const Key& key, std::vector<int32_t>& path)
+{
+    auto it = mIndex.find(key);
+    if(it == mIndex.end())
+    {
+        ++mNbMisses;
+        return false;
+    }
+
+    Entries::iterator itEntry = it->second;
+    if(!isEntryValid(*itEntry))
+    {
+        mEntries.erase(itEntry);
+        mIndex.erase(it);
+        ++mNbMisses;
+        return false;
+    }
+
+    // The entry is now the most recently used
+    mEntries.splice(mEntries.begin(), mEntries, itEntry);
+    path = itEntry->mPath;
+    ++mNbHits;
+    return true;
+}
+
+void PathCache::put(const Key& key, const std::vector<int32_t>& path)
+{
+    if((mCapacity == 0) || mRegionRevisions.empty())
+        return;
+
+    auto it = mIndex.find(key);
+    if(it != mIndex.end())
+    {
+        mEntries.erase(it->second);
+        mIndex.erase(it);
+    }
+    else if(mEntries.size() >= mCapacity)
+    {
+        mIndex.erase(mEntries.back().mKey);
+        mEntries.pop_back();
+    }
+
+    mEntries.push_front(Entry());
+    Entry& entry = mEntries.front();
+    entry.mKey = key;
+    entry.mPath = path;
+    entry.mOpenedRevision = mOpenedRevision;
+    std::vector<int32_t> regions;
+    for(int32_t index : path)
+        regions.push_back(getRegionIndex(index % mMapSizeX, index / mMapSizeX));
+
+    std::sort(regions.begin(), regions.end());
+    regions.erase(std::unique(regions.begin(), regions.end()), regions.end());
+    entry.mRegions.reserve(regions.size());
+    for(int32_t region : regions)
+        entry.mRegions.push_back(std::make_pair(region, mRegionRevisions[region]));
+
+    mIndex[key] = mEntries.begin();
+}
+
+void PathCache::tileChanged(int x, int y, bool isOpened)
+{
+    if((x < 0) || (y < 0) || (x >= mMapSizeX) || (y >= mMapSizeY))
+        return;
+
+    if(isOpened)
+        ++mOpenedRevision;
+
+    // A tile change can also forbid a diagonal move between 2 of its neighbours so we bump
+    // the regions of the neighbour tiles as well
+    int32_t bumped[9];
+    uint32_t nbBumped = 0;
+    for(int yy = std::max(0, y - 1); yy <= std::min(mMapSizeY - 1, y + 1); ++yy)
+    {
+        for(int xx = std::max(0, x - 1); xx <= std::min(mMapSizeX - 1, x + 1); ++xx)
+        {
+            int32_t region = getRegionIndex(xx, yy);
+            if(std::find(bumped, bumped + nbBumped, region) != bumped + nbBumped)
+                continue;
+
+            ++mRegionRevisions[region];
+            bumped[nbBumped] = region;
+            ++nbBumped;
+        }
+    }
+}
+
+void PathCache::resetStats()
+{
+    mNbHits = 0;
+    mNbMisses = 0;
+}
+
+bool PathCache::isEntryValid(const Entry& entry) const
+{
+    if(entry.mOpenedRevision != mOpenedRevision)
+        return false;
+
+    for(const std::pair<int32_t, uint32_t>& region : entry.mRegions)
+    {
+        if(mRegionRevisions[region.first] != region.second)
+            return false;
+    }
+
+    return true;
+}
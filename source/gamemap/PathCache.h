@@ -0,0 +1,120 @@
+/*!
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PATHCACHE_H
+#define PATHCACHE_H
+
+#include <cstdint>
+#include <list>
+#include <map>
+#include <utility>
+#include <vector>
+
+/*! \brief Bounded LRU cache of the paths computed by GameMap.
+ *
+ * Paths are stored as tile indexes (y * mapSizeX + x). The map is split in square regions, each
+ * with a revision counter that is bumped when one of its tiles (or a neighbour tile) changes.
+ * A cached path is only returned if none of the regions it goes through changed since it was
+ * computed. Changes in other regions cannot make the cached path invalid. However, if they open
+ * passability (dig, new bridge, unlocked door, ...), they may allow a shorter path anywhere. Such
+ * changes bump a global revision that invalidates every path.
+ */
+class PathCache
+{
+public:
+    //! \brief Everything the path depends on for a given creature
+    struct Key
+    {
+        int32_t mStart;
+        int32_t mDestination;
+        //! \brief Movement capability of the creature
+        double mSpeedGround;
+        double mSpeedWater;
+        double mSpeedLava;
+        //! \brief Seat of the creature. Used because doors may be locked for some seats only
+        int mSeatId;
+        //! \brief True if the creature is fighting or fleeing (enemy locked doors cannot be crossed then)
+        bool mIsFighting;
+
+        bool operator<(const Key& other) const;
+    };
+
+    PathCache(uint32_t capacity, int regionSize);
+
+    //! \brief Clears the cache and resets the regions for a map of the given size
+    void init(int mapSizeX, int mapSizeY);
+
+    //! \brief Fills path with the cached path for the given key if it is still valid.
+    //! \returns true if a path was found
+    bool get(const Key& key, std::vector<int32_t>& path);
+
+    //! \brief Stores the given path. If the cache is full, the least recently used path is dropped
+    void put(const Key& key, const std::vector<int32_t>& path);
+
+    //! \brief Invalidates the paths going through the given tile or close to it. If isOpened is true, the
+    //! tile may have become passable for some creatures and every path is invalidated
+    void tileChanged(int x, int y, bool isOpened);
+
+    inline uint32_t getNbEntries() const
+    { return static_cast<uint32_t>(mEntries.size()); }
+
+    inline uint32_t getNbHits() const
+    { return mNbHits; }
+
+    inline uint32_t getNbMisses() const
+    { return mNbMisses; }
+
+    void resetStats();
+
+private:
+    struct Entry
+    {
+        Key mKey;
+        std::vector<int32_t> mPath;
+        //! \brief Regions the path goes through with their revision when the path was stored
+        std::vector<std::pair<int32_t, uint32_t>> mRegions;
+        //! \brief Value of mOpenedRevision when the path was stored
+        uint32_t mOpenedRevision;
+    };
+
+    typedef std::list<Entry> Entries;
+
+    uint32_t mCapacity;
+    int mRegionSize;
+    int mMapSizeX;
+    int mMapSizeY;
+    int mNbRegionsX;
+
+    //! \brief Entries sorted from the most recently used to the least recently used one
+    Entries mEntries;
+    std::map<Key, Entries::iterator> mIndex;
+
+    std::vector<uint32_t> mRegionRevisions;
+
+    //! \brief Bumped each time a tile may have become passable
+    uint32_t mOpenedRevision;
+
+    uint32_t mNbHits;
+    uint32_t mNbMisses;
+
+    inline int32_t getRegionIndex(int x, int y) const
+    { return (y / mRegionSize) * mNbRegionsX + (x / mRegionSize); }
+
+    bool isEntryValid(const Entry& entry) const;
+};
+
+#endif // PATHCACHE_H
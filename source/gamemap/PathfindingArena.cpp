@@ -0,0 +1,162 @@
+/*!
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gamemap/PathfindingArena.h"
+
+#include <algorithm>
+
+const int32_t PathfindingArena::NO_INDEX;
+
+PathfindingArena::PathfindingArena() :
+    mMapSizeX(0),
+    mMapSizeY(0),
+    mGeneration(0),
+    mOrderCounter(0)
+{
+}
+
+void PathfindingArena::startSearch(int mapSizeX, int mapSizeY)
+{
+    mHeap.clear();
+    mOrderCounter = 0;
+    ++mGeneration;
+
+    uint32_t nbNodes = static_cast<uint32_t>(mapSizeX * mapSizeY);
+    if((mapSizeX != mMapSizeX) ||
+       (mapSizeY != mMapSizeY) ||
+       (mGeneration == 0))
+    {
+        // Either the map changed or the generation counter wrapped. In both cases, we cannot
+        // trust the stored generations anymore
+        mMapSizeX = mapSizeX;
+        mMapSizeY = mapSizeY;
+        Node emptyNode;
+        emptyNode.mG = 0.0;
+        emptyNode.mF = 0.0;
+        emptyNode.mOrder = 0;
+        emptyNode.mParent = NO_INDEX;
+        emptyNode.mHeapPos = NO_INDEX;
+        emptyNode.mGeneration = 0;
+        emptyNode.mClosed = false;
+        mNodes.assign(nbNodes, emptyNode);
+        mGeneration = 1;
+    }
+}
+
+void PathfindingArena::open(int32_t index, double g, double h, int32_t parent)
+{
+    Node& node = mNodes[index];
+    node.mG = g;
+    node.mF = g + h;
+    node.mOrder = mOrderCounter++;
+    node.mParent = parent;
+    node.mGeneration = mGeneration;
+    node.mClosed = false;
+    node.mHeapPos = static_cast<int32_t>(mHeap.size());
+    mHeap.push_back(index);
+    siftUp(static_cast<uint32_t>(node.mHeapPos));
+}
+
+void PathfindingArena::decreaseCost(int32_t index, double g, double h, int32_t parent)
+{
+    Node& node = mNodes[index];
+    node.mG = g;
+    node.mF = g + h;
+    // A node with a decreased cost is handled as if it was just pushed
+    node.mOrder = mOrderCounter++;
+    node.mParent = parent;
+    if(node.mHeapPos == NO_INDEX)
+        return;
+
+    // Because the order changed, the node may have to go down the heap if the cost did not
+    // change so we check both ways
+    uint32_t pos = static_cast<uint32_t>(node.mHeapPos);
+    siftUp(pos);
+    siftDown(static_cast<uint32_t>(node.mHeapPos));
+}
+
+int32_t PathfindingArena::popBest()
+{
+    int32_t best = mHeap.front();
+    int32_t last = mHeap.back();
+    mHeap.pop_back();
+    if(!mHeap.empty())
+    {
+        mHeap[0] = last;
+        mNodes[last].mHeapPos = 0;
+        siftDown(0);
+    }
+
+    Node& node = mNodes[best];
+    node.mHeapPos = NO_INDEX;
+    node.mClosed = true;
+    return best;
+}
+
+void PathfindingArena::buildPath(int32_t index, std::vector<int32_t>& indexes) const
+{
+    indexes.clear();
+    while(index != NO_INDEX)
+    {
+        indexes.push_back(index);
+        index = mNodes[index].mParent;
+    }
+    std::reverse(indexes.begin(), indexes.end());
+}
+
+void PathfindingArena::siftUp(uint32_t pos)
+{
+    int32_t index = mHeap[pos];
+    while(pos > 0)
+    {
+        uint32_t parentPos = (pos - 1) / 2;
+        int32_t parentIndex = mHeap[parentPos];
+        if(!isBefore(index, parentIndex))
+            break;
+
+        mHeap[pos] = parentIndex;
+        mNodes[parentIndex].mHeapPos = static_cast<int32_t>(pos);
+        pos = parentPos;
+    }
+    mHeap[pos] = index;
+    mNodes[index].mHeapPos = static_cast<int32_t>(pos);
+}
+
+void PathfindingArena::siftDown(uint32_t pos)
+{
+    uint32_t size = static_cast<uint32_t>(mHeap.size());
+    int32_t index = mHeap[pos];
+    while(true)
+    {
+        uint32_t childPos = (2 * pos) + 1;
+        if(childPos >= size)
+            break;
+
+        if((childPos + 1 < size) && isBefore(mHeap[childPos + 1], mHeap[childPos]))
+            ++childPos;
+
+        int32_t childIndex = mHeap[childPos];
+        if(!isBefore(childIndex, index))
+            break;
+
+        mHeap[pos] = childIndex;
+        mNodes[childIndex].mHeapPos = static_cast<int32_t>(pos);
+        pos = childPos;
+    }
+    mHeap[pos] = index;
+    mNodes[index].mHeapPos = static_cast<int32_t>(pos);
+}
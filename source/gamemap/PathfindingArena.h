@@ -0,0 +1,126 @@
+/*!
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PATHFINDINGARENA_H
+#define PATHFINDINGARENA_H
+
+#include <cstdint>
+#include <vector>
+
+/*! \brief Node storage and open list used by the searches done on the tile grid (A*, Dijkstra, ...).
+ *
+ * There is one node per tile, indexed by (y * mapSizeX + x). Nodes are not cleared between
+ * searches. Instead, each search bumps a generation counter and a node is considered as
+ * reached only if its generation matches the current one. That way, the memory can be
+ * reused by every search without allocation nor full clear.
+ *
+ * The open list is an indexed binary heap: each node knows its position in the heap so that
+ * its cost can be decreased in O(log n). Nodes with the same cost are popped in the order they
+ * were pushed (or had their cost decreased) to keep the results stable.
+ */
+class PathfindingArena
+{
+public:
+    static const int32_t NO_INDEX = -1;
+
+    struct Node
+    {
+        //! \brief Cost from the start node
+        double mG;
+        //! \brief Estimated total cost (mG + heuristic). Used to order the open list
+        double mF;
+        //! \brief Push order used to break ties between nodes with the same mF
+        uint64_t mOrder;
+        //! \brief Index of the node we come from. NO_INDEX for the start node
+        int32_t mParent;
+        //! \brief Position in the open list. NO_INDEX if the node is not in the open list
+        int32_t mHeapPos;
+        //! \brief Search the node belongs to. The node is not valid if different from the arena generation
+        uint32_t mGeneration;
+        //! \brief Set when the node has been popped from the open list
+        bool mClosed;
+    };
+
+    PathfindingArena();
+
+    //! \brief Prepares the arena for a new search on a map of the given size. This invalidates
+    //! every node from the previous search.
+    void startSearch(int mapSizeX, int mapSizeY);
+
+    inline int32_t toIndex(int x, int y) const
+    { return y * mMapSizeX + x; }
+
+    inline int indexToX(int32_t index) const
+    { return index % mMapSizeX; }
+
+    inline int indexToY(int32_t index) const
+    { return index / mMapSizeX; }
+
+    //! \brief Returns true if the node has been reached during the current search
+    inline bool isReached(int32_t index) const
+    { return mNodes[index].mGeneration == mGeneration; }
+
+    //! \brief Returns true if the node has been reached and popped from the open list
+    inline bool isClosed(int32_t index) const
+    { return isReached(index) && mNodes[index].mClosed; }
+
+    //! \brief Returns the node at the given index. It should only be used if isReached
+    //! returned true for this index
+    inline const Node& getNode(int32_t index) const
+    { return mNodes[index]; }
+
+    //! \brief Adds the given node to the open list. The node should not have been reached
+    //! during this search.
+    void open(int32_t index, double g, double h, int32_t parent);
+
+    //! \brief Sets a lower cost to a node that is in the open list and updates its position.
+    void decreaseCost(int32_t index, double g, double h, int32_t parent);
+
+    inline bool isOpenListEmpty() const
+    { return mHeap.empty(); }
+
+    //! \brief Removes the node with the lowest cost from the open list, marks it as closed
+    //! and returns its index.
+    int32_t popBest();
+
+    //! \brief Fills indexes with the indexes from the start node to the given node (both included)
+    void buildPath(int32_t index, std::vector<int32_t>& indexes) const;
+
+private:
+    std::vector<Node> mNodes;
+    std::vector<int32_t> mHeap;
+    int mMapSizeX;
+    int mMapSizeY;
+    uint32_t mGeneration;
+    uint64_t mOrderCounter;
+
+    //! \brief Returns true if the node at index1 should be popped before the one at index2
+    inline bool isBefore(int32_t index1, int32_t index2) const
+    {
+        const Node& node1 = mNodes[index1];
+        const Node& node2 = mNodes[index2];
+        if(node1.mF != node2.mF)
+            return node1.mF < node2.mF;
+
+        return node1.mOrder < node2.mOrder;
+    }
+
+    void siftUp(uint32_t pos);
+    void siftDown(uint32_t pos);
+};
+
+#endif // PATHFINDINGARENA_H
@@ -23,6 +23,10 @@
 #include "utils/Helper.h"
 #include "utils/LogManager.h"
 
+#include <boost/thread/tss.hpp>
+
+#include <algorithm>
+
 const std::vector<Tile*> EMPTY_TILES;
 
 class TileDistance
@@ -262,65 +266,38 @@ private:
     std::vector<std::pair<uint32_t, double>> mHiddenTilesSouth;
 };
 
-class TileDistanceProcess
+//! \brief Hidden values and tiles of the 8 octants processed by visibleTiles. They are
+//! indexed by (octant * nbTileDistances + index in mTileDistance). Reused between calls.
+struct VisibilityBuffers
 {
-public:
-    TileDistanceProcess(const TileDistance& tileDistance, Tile* tile):
-        mTileDistance(tileDistance),
-        mTile(tile),
-        mHiddenValueNorth(0.0),
-        mHiddenValueSouth(0.0)
-    {
-    }
-
-    inline const TileDistance& getTileDistance() const
-    {
-        return mTileDistance;
-    }
-
-    void addHiddenValueNorth(double val)
-    {
-        // We only add the highest value
-        if(val <= mHiddenValueNorth)
-            return;
-
-        mHiddenValueNorth = val;
-    }
-
-    void addHiddenValueSouth(double val)
-    {
-        // We only add the highest value
-        if(val <= mHiddenValueSouth)
-            return;
-
-        mHiddenValueSouth = val;
-    }
-
-    inline bool isTileVisible() const
-    {
-        return (mHiddenValueNorth + mHiddenValueSouth) <= 0.5;
-    }
+    std::vector<Tile*> mTiles;
+    std::vector<double> mHiddenValuesNorth;
+    std::vector<double> mHiddenValuesSouth;
+};
 
-    inline double getHiddenValueNorth() const
-    {
-        return mHiddenValueNorth;
-    }
+//! \brief Buffers used by visibleTiles on the calling thread
+static boost::thread_specific_ptr<VisibilityBuffers> gVisibilityBuffers;
 
-    inline double getHiddenValueSouth() const
-    {
-        return mHiddenValueSouth;
-    }
+static VisibilityBuffers& getVisibilityBuffers()
+{
+    if(gVisibilityBuffers.get() == nullptr)
+        gVisibilityBuffers.reset(new VisibilityBuffers);
 
-    inline Tile* getTile() const
-    {
-        return mTile;
-    }
+    return *gVisibilityBuffers;
+}
 
-private:
-    const TileDistance& mTileDistance;
-    Tile* mTile;
-    double mHiddenValueNorth;
-    double mHiddenValueSouth;
+//! \brief Transforms (diffX, diffY) from mTileDistance to the tile offset in each octant:
+//! offsetX = a * diffX + b * diffY and offsetY = c * diffX + d * diffY. See visibleTiles
+static const int OCTANT_TRANSFORMS[8][4] =
+{
+    {  1,  0,  0,  1 },
+    {  0,  1, -1,  0 },
+    { -1,  0,  0, -1 },
+    {  0, -1,  1,  0 },
+    {  0,  1,  1,  0 },
+    {  1,  0,  0, -1 },
+    {  0, -1, -1,  0 },
+    { -1,  0,  0,  1 }
 };
 
 bool sortByDistSquared(const TileDistance& tileDist1, const TileDistance& tileDist2)
@@ -332,7 +309,7 @@ TileContainer::TileContainer(int initTileDistance):
     mMapSizeX(0),
     mMapSizeY(0),
     mRr(0),
-    mTiles(nullptr),
+    mTileArena(nullptr),
     mTileDistanceComputed(0)
 {
     buildTileDistance(initTileDistance);
@@ -345,20 +322,20 @@ TileContainer::~TileContainer()
 
 void TileContainer::clearTiles()
 {
-    if (mTiles)
+    for (Tile* tile : mTiles)
     {
-        for (int ii = 0; ii < mMapSizeX; ++ii)
-        {
-            for (int jj = 0; jj < mMapSizeY; ++jj)
-            {
-                mTiles[ii][jj]->destroyMesh();
-                delete mTiles[ii][jj];
-            }
-            delete[] mTiles[ii];
-        }
-        delete[] mTiles;
-        mTiles = nullptr;
+        if(tile == nullptr)
+            continue;
+
+        tile->destroyMesh();
+        // Tiles are constructed in mTileArena so they should not be deleted
+        tile->~Tile();
     }
+    mTiles.clear();
+    delete[] mTileArena;
+    mTileArena = nullptr;
+    mTilesOpacity.clear();
+    mTilesSeatsChangedMasks.clear();
     mMapSizeX = 0;
     mMapSizeY = 0;
 }
@@ -370,12 +347,14 @@ bool TileContainer::addTile(Tile* t)
 
     if (x < getMapSizeX() && y < getMapSizeY() && x >= 0 && y >= 0)
     {
-        if(mTiles[x][y] != nullptr)
+        uint32_t index = static_cast<uint32_t>(y * mMapSizeX + x);
+        if((mTiles[index] != nullptr) || (t != getTileStorage(x, y)))
         {
-            mTiles[x][y]->destroyMesh();
-            delete mTiles[x][y];
+            OD_LOG_ERR("Tile not constructed in its storage tile=" + Helper::toString(x) + "," + Helper::toString(y));
+            return false;
         }
-        mTiles[x][y] = t;
+        mTiles[index] = t;
+        refreshTileOpacity(t);
         return true;
     }
 
@@ -441,41 +420,27 @@ bool TileContainer::allocateMapMemory(int xSize, int ySize)
     }
 
     // Clear memory usage first
-    if (mTiles)
-    {
-        for(int ii = 0; ii < mMapSizeX; ++ii)
-        {
-            for(int jj = 0; jj < mMapSizeY; ++jj)
-            {
-                delete  mTiles[ii][jj];
-            }
-            delete [] mTiles[ii];
-        }
-        delete [] mTiles;
-    }
+    clearTiles();
 
     // Set map size
     mMapSizeX = xSize;
     mMapSizeY = ySize;
 
-    mTiles = new Tile **[mMapSizeX];
-    if(!mTiles)
-    {
-        OD_LOG_ERR("Failed to allocate map memory");
-        return false;
-    }
-    for(int ii = 0; ii < mMapSizeX; ++ii)
-    {
-        mTiles[ii] = new Tile *[mMapSizeY];
-        for(int jj = 0; jj < mMapSizeY; ++jj)
-        {
-            mTiles[ii][jj] = nullptr;
-        }
-    }
+    uint32_t nbTiles = static_cast<uint32_t>(mMapSizeX * mMapSizeY);
+    // new[] of char returns memory aligned for any type
+    mTileArena = new char[nbTiles * sizeof(Tile)];
+    mTiles.assign(nbTiles, nullptr);
+    mTilesOpacity.assign(nbTiles, 0);
+    mTilesSeatsChangedMasks.assign(nbTiles, 0);
 
     return true;
 }
 
+void* TileContainer::getTileStorage(int x, int y) const
+{
+    return mTileArena + static_cast<uint32_t>(y * mMapSizeX + x) * sizeof(Tile);
+}
+
 std::vector<Tile*> TileContainer::rectangularRegion(int x1, int y1, int x2, int y2)
 {
     std::vector<Tile*> returnList;
@@ -809,15 +774,28 @@ std::list<Tile*> TileContainer::tilesBetween(int x1, int y1, int x2, int y2) con
 }
 
 std::vector<Tile*> TileContainer::visibleTiles(int x, int y, int radius)
+{
+    std::vector<Tile*> returnList;
+    visibleTiles(x, y, radius, returnList);
+    return returnList;
+}
+
+void TileContainer::visibleTiles(int x, int y, int radius, std::vector<Tile*>& tiles)
 {
     // To compute the tiles within this region, we use the symmetry of the square. That's why we mix tile x/y coordinate
     // with tileDist diffX/diffY. More explanation can be found in the buildTileDistance function
-    std::vector<Tile*> returnList;
+    tiles.clear();
 
     if(radius > mTileDistanceComputed)
         buildTileDistance(radius);
 
+    // mTileDistance is sorted by distance. We only process the tiles within radius
     int radiusSquared = radius * radius;
+    uint32_t nbTileDistances = static_cast<uint32_t>(std::upper_bound(mTileDistance.begin(), mTileDistance.end(),
+        radiusSquared, [](int distSquared, const TileDistance& tileDist)
+        {
+            return distSquared < tileDist.getDistSquared();
+        }) - mTileDistance.begin());
 
     // To have all the tiles around, we process mTileDistance 8 times.
     // We will process in, this order (c being the starting tile):
@@ -825,147 +803,95 @@ std::vector<Tile*> TileContainer::visibleTiles(int x, int y, int radius)
     // 2c0
     // 637
     // Then, we will have to merge diagonal/horizontal tiles
-    // Because we want the index to be correct, we will add tiles even when null in tilesProcess
-    std::vector<TileDistanceProcess> tilesProcess[8];
+    // Because we want the index to be correct, we keep null tiles in the buffers
+    VisibilityBuffers& buffers = getVisibilityBuffers();
+    uint32_t nbValues = 8 * nbTileDistances;
+    buffers.mTiles.resize(nbValues);
+    buffers.mHiddenValuesNorth.assign(nbValues, 0.0);
+    buffers.mHiddenValuesSouth.assign(nbValues, 0.0);
     for(uint32_t k = 0; k < 8; ++k)
     {
-        for(const TileDistance& tileDist : mTileDistance)
+        const int* transform = OCTANT_TRANSFORMS[k];
+        uint32_t octantIndex = k * nbTileDistances;
+        for(uint32_t i = 0; i < nbTileDistances; ++i)
         {
-            if(tileDist.getDistSquared() > radiusSquared)
-                break;
-
-            switch(k)
+            const TileDistance& tileDist = mTileDistance[i];
+            int xx = x + transform[0] * tileDist.getDiffX() + transform[1] * tileDist.getDiffY();
+            int yy = y + transform[2] * tileDist.getDiffX() + transform[3] * tileDist.getDiffY();
+            if((xx < 0) || (xx >= mMapSizeX) || (yy < 0) || (yy >= mMapSizeY))
             {
-                case 0:
-                {
-                    Tile* tile = getTile(x + tileDist.getDiffX(), y + tileDist.getDiffY());
-                    tilesProcess[k].push_back(TileDistanceProcess(tileDist, tile));
-                    break;
-                }
-                case 1:
-                {
-                    Tile* tile = getTile(x + tileDist.getDiffY(), y - tileDist.getDiffX());
-                    tilesProcess[k].push_back(TileDistanceProcess(tileDist, tile));
-                    break;
-                }
-                case 2:
-                {
-                    Tile* tile = getTile(x - tileDist.getDiffX(), y - tileDist.getDiffY());
-                    tilesProcess[k].push_back(TileDistanceProcess(tileDist, tile));
-                    break;
-                }
-                case 3:
-                {
-                    Tile* tile = getTile(x - tileDist.getDiffY(), y + tileDist.getDiffX());
-                    tilesProcess[k].push_back(TileDistanceProcess(tileDist, tile));
-                    break;
-                }
-                case 4:
-                {
-                    Tile* tile = getTile(x + tileDist.getDiffY(), y + tileDist.getDiffX());
-                    tilesProcess[k].push_back(TileDistanceProcess(tileDist, tile));
-                    break;
-                }
-                case 5:
-                {
-                    Tile* tile = getTile(x + tileDist.getDiffX(), y - tileDist.getDiffY());
-                    tilesProcess[k].push_back(TileDistanceProcess(tileDist, tile));
-                    break;
-                }
-                case 6:
-                {
-                    Tile* tile = getTile(x - tileDist.getDiffY(), y - tileDist.getDiffX());
-                    tilesProcess[k].push_back(TileDistanceProcess(tileDist, tile));
-                    break;
-                }
-                case 7:
-                {
-                    Tile* tile = getTile(x - tileDist.getDiffX(), y + tileDist.getDiffY());
-                    tilesProcess[k].push_back(TileDistanceProcess(tileDist, tile));
-                    break;
-                }
-                default:
-                    break;
-            }
-        }
-    }
-
-    // The array of tiles is filled. Now, we apply the visibility.
-    for(uint32_t k = 0; k < 8; ++k)
-    {
-        for(TileDistanceProcess& tileDistanceProcess : tilesProcess[k])
-        {
-            if(tileDistanceProcess.getTile() == nullptr)
+                buffers.mTiles[octantIndex + i] = nullptr;
                 continue;
+            }
 
-            if(tileDistanceProcess.getTile()->permitsVision())
+            buffers.mTiles[octantIndex + i] = mTiles[yy * mMapSizeX + xx];
+            if(mTilesOpacity[yy * mMapSizeX + xx] == 0)
                 continue;
 
-            // The tile hides vision. We process tiles it hides
-            for(const std::pair<uint32_t, double>& p : tileDistanceProcess.getTileDistance().getHiddenTilesNorth())
+            // The tile hides vision. We process tiles it hides. Hidden tiles are sorted by index so we can stop at
+            // the first one farther than radius
+            for(const std::pair<uint32_t, double>& p : tileDist.getHiddenTilesNorth())
             {
-                // mTileDistance might be bigger than the actual vector because it can include tiles
-                // farther than the ones currently computed (for example if sight < computedSight)
-                if(p.first >= tilesProcess[k].size())
-                    continue;
+                if(p.first >= nbTileDistances)
+                    break;
 
-                tilesProcess[k][p.first].addHiddenValueNorth(p.second);
+                double& hiddenValue = buffers.mHiddenValuesNorth[octantIndex + p.first];
+                hiddenValue = std::max(hiddenValue, p.second);
             }
-            for(const std::pair<uint32_t, double>& p : tileDistanceProcess.getTileDistance().getHiddenTilesSouth())
+            for(const std::pair<uint32_t, double>& p : tileDist.getHiddenTilesSouth())
             {
-                // mTileDistance might be bigger than the actual vector because it can include tiles
-                // farther than the ones currently computed (for example if sight < computedSight)
-                if(p.first >= tilesProcess[k].size())
-                    continue;
+                if(p.first >= nbTileDistances)
+                    break;
 
-                tilesProcess[k][p.first].addHiddenValueSouth(p.second);
+                double& hiddenValue = buffers.mHiddenValuesSouth[octantIndex + p.first];
+                hiddenValue = std::max(hiddenValue, p.second);
             }
         }
     }
 
     // Now, we process all the tiles. Note that horizontal tiles are common for 2 consecutive
-    // vectors in tilesProcess and that diagonal tiles should be merged.
-    // The 8 vectors have the same size
-    for(uint32_t i = 0; i < tilesProcess[0].size(); ++i)
+    // octants and that diagonal tiles should be merged
+    for(uint32_t i = 0; i < nbTileDistances; ++i)
     {
+        const TileDistance& tileDist = mTileDistance[i];
         for(uint32_t k = 0; k < 8; ++k)
         {
-            TileDistanceProcess& tileDistanceProcess = tilesProcess[k][i];
-            if(tileDistanceProcess.getTile() == nullptr)
+            uint32_t index = k * nbTileDistances + i;
+            Tile* tile = buffers.mTiles[index];
+            if(tile == nullptr)
                 continue;
 
             // We avoid adding several times the center tile
-            if((k > 0) && (tileDistanceProcess.getTileDistance().getDistSquared() == 0))
+            if((k > 0) && (tileDist.getDistSquared() == 0))
                 continue;
 
-            // Because horizontal tiles are common, we don't process them for the 4 last vectors
-            if((tileDistanceProcess.getTileDistance().getType() == TileDistance::TileDistanceType::Horizontal) &&
-               (k > 3))
-            {
-                continue;
-            }
-
-            // Diagonal tiles need to be merged (because south hiding and north hiding are not
-            // computed within the same array). They will be processed for k < 4
-            if((tileDistanceProcess.getTileDistance().getType() == TileDistance::TileDistanceType::Diagonal) &&
-               (k > 3))
-            {
+            // Because horizontal tiles are common and diagonal tiles are merged, we only process them for the 4 first octants
+            if((k > 3) && (tileDist.getType() != TileDistance::TileDistanceType::Other))
                 continue;
-            }
 
-            if(tileDistanceProcess.getTileDistance().getType() == TileDistance::TileDistanceType::Diagonal)
+            double hiddenValueNorth = buffers.mHiddenValuesNorth[index];
+            double hiddenValueSouth = buffers.mHiddenValuesSouth[index];
+            if(tileDist.getType() == TileDistance::TileDistanceType::Diagonal)
             {
                 // We merge diagonal tiles. Because they are inverted, south hidden value becomes north and vice-versa
-                TileDistanceProcess& tileDistanceProcess2 = tilesProcess[k + 4][i];
-                tileDistanceProcess.addHiddenValueNorth(tileDistanceProcess2.getHiddenValueSouth());
-                tileDistanceProcess.addHiddenValueSouth(tileDistanceProcess2.getHiddenValueNorth());
+                uint32_t index2 = index + 4 * nbTileDistances;
+                hiddenValueNorth = std::max(hiddenValueNorth, buffers.mHiddenValuesSouth[index2]);
+                hiddenValueSouth = std::max(hiddenValueSouth, buffers.mHiddenValuesNorth[index2]);
             }
 
-            if(!tileDistanceProcess.isTileVisible())
+            if((hiddenValueNorth + hiddenValueSouth) > 0.5)
                 continue;
 
-            returnList.push_back(tileDistanceProcess.getTile());
+            tiles.push_back(tile);
         }
     }
-    return returnList;
+}
+
+void TileContainer::refreshTileOpacity(Tile* tile)
+{
+    uint32_t index = static_cast<uint32_t>(tile->getY() * mMapSizeX + tile->getX());
+    if(index >= mTilesOpacity.size())
+        return;
+
+    mTilesOpacity[index] = tile->permitsVision() ? 0 : 1;
 }
@@ -18,7 +18,10 @@
 #ifndef TILECONTAINER_H
 #define TILECONTAINER_H
 
+#include "game/SeatMask.h"
+
 #include <cassert>
+#include <cstdint>
 #include <list>
 #include <vector>
 
@@ -37,7 +40,8 @@ public:
     //! \brief Clears the mesh and deletes the data structure for all the tiles in the TileContainer.
     void clearTiles();
 
-    //! \brief Adds the given tile on map. The tile coordinates members must be ready.
+    //! \brief Adds the given tile on map. The tile coordinates members must be ready and it must have been
+    //! constructed in the memory returned by getTileStorage for these coordinates.
     //! \returns true if added.
     bool addTile(Tile* t);
 
@@ -47,16 +51,21 @@ public:
     //! \brief Returns a pointer to the tile at location (x, y) (const version).
     inline Tile* getTile(int xx, int yy) const
     {
-        assert(mTiles != nullptr);
+        assert(mTileArena != nullptr);
 
         if (xx < getMapSizeX() && yy < getMapSizeY() && xx >= 0 && yy >= 0)
-            return mTiles[xx][yy];
+            return mTiles[yy * mMapSizeX + xx];
         else
         {
             return nullptr;
         }
     }
 
+    //! \brief Seats that have not been notified of the last changes on the tile at (x, y). The masks are stored
+    //! apart from the tiles so that passes over the whole map do not need to touch every tile
+    inline SeatMask& getTileSeatsChangedMask(int xx, int yy)
+    { return mTilesSeatsChangedMasks[yy * mMapSizeX + xx]; }
+
     //! \brief This functions exports the needed to retrieve a tile for networking.
     //! The tile informations are not embedded, only the needed to identify the tile
     void tileToPacket(ODPacket& packet, Tile* tile) const;
@@ -69,6 +78,12 @@ public:
     //! surrounding the given point and extending outward to the specified radius.
     std::vector<Tile*> circularRegion(int x, int y, int radius);
 
+    //! \brief Makes sure circularRegion and visibleTiles will not have to update their distance
+    //! helper for the given radius. Once called, they can be used from several threads at the same
+    //! time for radius up to this one
+    inline void prepareRegionRadius(int radius)
+    { buildTileDistance(radius); }
+
     //! \brief Returns a vector of all the valid tiles which are a neighbor
     //! to one or more tiles in the specified region,
     //! i.e. the "perimeter" of the region extended out one tile.
@@ -97,6 +112,13 @@ public:
     //! the furthest
     std::vector<Tile*> visibleTiles(int x, int y, int radius);
 
+    //! \brief Same as above but fills the given vector to avoid allocating a new one at each call. It is cleared first
+    void visibleTiles(int x, int y, int radius, std::vector<Tile*>& tiles);
+
+    //! \brief Updates the opacity of the given tile used by visibleTiles. Should be called each time the tile
+    //! starts or stops blocking vision (see Tile::permitsVision)
+    void refreshTileOpacity(Tile* tile);
+
 protected:
     //! \brief The map size
     int mMapSizeX;
@@ -104,10 +126,25 @@ protected:
 
     int mRr;
 
-    //! \brief Set the map size and memory
+    //! \brief Set the map size and memory. The tiles are not constructed. Each of them should be
+    //! constructed in getTileStorage and added with addTile before the map is used
     bool allocateMapMemory(int xSize, int ySize);
+
+    //! \brief Returns the memory where the tile at (x, y) should be constructed (with placement new)
+    void* getTileStorage(int x, int y) const;
 private:
-    Tile*** mTiles;
+    //! \brief Memory where all the tiles are stored, row by row. That way, passes over the whole
+    //! map (row by row) read the tiles in order
+    char* mTileArena;
+
+    //! \brief Pointer to the tile at index (y * mMapSizeX + x) in mTileArena. Null until added
+    std::vector<Tile*> mTiles;
+
+    //! \brief See getTileSeatsChangedMask
+    std::vector<SeatMask> mTilesSeatsChangedMasks;
+
+    //! \brief 1 if the tile at index (y * mMapSizeX + x) blocks vision, 0 otherwise
+    std::vector<uint8_t> mTilesOpacity;
 
     //! \brief Fills mTileDistance that will help to compute a vector with sorted Tiles more efficiently
     void buildTileDistance(int distance);
@@ -0,0 +1,52 @@
+/*!
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gamemap/VisionSource.h"
+
+#include "entities/Tile.h"
+
+void VisionSource::setTiles(const std::vector<Seat*>& seats, const std::vector<Tile*>& tiles)
+{
+    // We add the new references before releasing the old ones. That way, tiles seen before and
+    // after do not lose vision
+    for(Tile* tile : tiles)
+    {
+        for(Seat* seat : seats)
+            tile->addVisionRef(seat);
+    }
+
+    for(Tile* tile : mTiles)
+    {
+        for(Seat* seat : mSeats)
+            tile->removeVisionRef(seat);
+    }
+
+    mSeats = seats;
+    mTiles = tiles;
+}
+
+void VisionSource::clear()
+{
+    for(Tile* tile : mTiles)
+    {
+        for(Seat* seat : mSeats)
+            tile->removeVisionRef(seat);
+    }
+
+    mSeats.clear();
+    mTiles.clear();
+}
@@ -0,0 +1,56 @@
+/*!
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef VISIONSOURCE_H
+#define VISIONSOURCE_H
+
+#include <vector>
+
+class Seat;
+class Tile;
+
+/*! \brief Something giving vision on some tiles to some seats (claimed tile, creature, spell, ...).
+ *
+ * Each tile counts how many sources give vision on it for each seat (see Tile::addVisionRef). The
+ * source remembers the tiles it has referenced so that they can be released when it moves or
+ * disappears. A seat gains vision on a tile when its count goes from 0 to 1 and loses it when it
+ * goes back to 0. Sources only call setTiles when what they see may have changed.
+ */
+class VisionSource
+{
+public:
+    VisionSource()
+    {}
+
+    //! \brief Gives vision on the given tiles to the given seats and releases the previous ones
+    void setTiles(const std::vector<Seat*>& seats, const std::vector<Tile*>& tiles);
+
+    //! \brief Releases all the tiles
+    void clear();
+
+    inline const std::vector<Seat*>& getSeats() const
+    { return mSeats; }
+
+    inline bool isEmpty() const
+    { return mTiles.empty(); }
+
+private:
+    std::vector<Seat*> mSeats;
+    std::vector<Tile*> mTiles;
+};
+
+#endif // VISIONSOURCE_H
@@ -15,6 +15,8 @@
 #include "utils/ConfigManager.h"
 #include "utils/Helper.h"
 #include "utils/LogManager.h"
+#include "utils/Profiler.h"
+#include "utils/ResourceManager.h"
 
 #include <OgreCamera.h>
 #include <OgreSceneManager.h>
@@ -37,6 +39,9 @@ const std::string HELPMESSAGE =
         "\n\tlist/ls - Prints out lists of creatures, classes, etc..."
         "\n\tmaxtime - Sets or displays the max time for event messages to be displayed."
         "\n\ttermwidth - Sets the terminal width."
+        "\n\n==Replays=="
+        "\n\treplayspeed - Sets or displays the speed of the replay being watched."
+        "\n\treplayseek - Moves the replay being watched to the given turn."
         "\n\n==Cheats=="
         "\n\taddcreature - Adds a creature."
         "\n\tsetcreaturelevel - Sets the level of a given creature."
@@ -56,7 +61,8 @@ const std::string HELPMESSAGE =
         "\n\tcatmullspline - Triggers the catmullspline camera movement type."
         "\n\tcirclearound - Triggers the circle camera movement type."
         "\n\tsetcamerafovy - Sets the camera vertical field of view aspect ratio value."
-        "\n\tlogfloodfill - Displays the FloodFillValues of all the Tiles in the GameMap.";
+        "\n\tlogfloodfill - Displays the FloodFillValues of all the Tiles in the GameMap."
+        "\n\tpathfindingmode - Sets the algorithm used to compute creature paths.";
 
 //! \brief Template function to get/set a variable from the ODFrameListener object
 template<typename ValType, typename Getter, typename Setter>
@@ -150,6 +156,59 @@ Command::Result cFPS(const Command::ArgumentList_t& args, ConsoleInterface& c, A
     return Command::Result::SUCCESS;
 }
 
+Command::Result cReplaySpeed(const Command::ArgumentList_t& args, ConsoleInterface& c, AbstractModeManager&)
+{
+    ODClient& client = ODClient::getSingleton();
+    if(!client.isReplaying())
+    {
+        c.print("\nNo replay is being watched\n");
+        return Command::Result::FAILED;
+    }
+
+    if(args.size() < 2)
+    {
+        c.print("\nCurrent replay speed is " + Helper::toString(client.getReplaySpeed()) + "\n");
+        return Command::Result::SUCCESS;
+    }
+
+    double speed = Helper::toDouble(args[1]);
+    if(speed <= 0.0)
+    {
+        c.print("\nThe replay speed should be positive\n");
+        return Command::Result::INVALID_ARGUMENT;
+    }
+
+    client.setReplaySpeed(speed);
+    c.print("\nReplay speed set to: " + Helper::toString(speed));
+    return Command::Result::SUCCESS;
+}
+
+Command::Result cReplaySeek(const Command::ArgumentList_t& args, ConsoleInterface& c, AbstractModeManager&)
+{
+    ODClient& client = ODClient::getSingleton();
+    if(!client.isReplaying())
+    {
+        c.print("\nNo replay is being watched\n");
+        return Command::Result::FAILED;
+    }
+
+    if(args.size() < 2)
+    {
+        c.print("\nCurrent replay turn is " + Helper::toString(client.getReplayTurn()) + "\n");
+        return Command::Result::SUCCESS;
+    }
+
+    int64_t turn = Helper::stringToT<int64_t>(args[1]);
+    if(!client.seekReplay(turn))
+    {
+        c.print("\nCannot move the replay to turn " + Helper::toString(turn) + "\n");
+        return Command::Result::FAILED;
+    }
+
+    c.print("\nReplay moved to turn " + Helper::toString(client.getReplayTurn()));
+    return Command::Result::SUCCESS;
+}
+
 Command::Result cSrvAddCreature(const Command::ArgumentList_t& args, ConsoleInterface& c, GameMap& gameMap)
 {
     if (args.size() < 6)
@@ -418,6 +477,54 @@ Command::Result cSrvLogFloodFill(const Command::ArgumentList_t&, ConsoleInterfac
     return Command::Result::SUCCESS;
 }
 
+Command::Result cSrvPathfindingMode(const Command::ArgumentList_t& args, ConsoleInterface& c, GameMap& gameMap)
+{
+    if(args.size() < 2)
+        return Command::Result::INVALID_ARGUMENT;
+
+    if(!gameMap.consoleSetPathfindingMode(args[1]))
+        return Command::Result::INVALID_ARGUMENT;
+
+    return Command::Result::SUCCESS;
+}
+
+Command::Result cSrvProfiler(const Command::ArgumentList_t& args, ConsoleInterface& c, GameMap& gameMap)
+{
+    if(args.size() < 2)
+        return Command::Result::INVALID_ARGUMENT;
+
+    if(args[1] == "on")
+        Profiler::setEnabled(true);
+    else if(args[1] == "off")
+        Profiler::setEnabled(false);
+    else if(args[1] == "summary")
+        Profiler::logSummary();
+    else if(args[1] == "stoptrace")
+        Profiler::stopTrace();
+    else if((args[1] == "trace") && (args.size() >= 3))
+    {
+        // The file name is given by a client. We only accept a bare file name and write it in the user
+        // data directory so that a client cannot overwrite any file the server can write
+        const std::string& filename = args[2];
+        if(filename.empty() || (filename == "..") ||
+           (filename.find_first_of("/\\:") != std::string::npos))
+        {
+            c.print("Invalid trace file name: " + filename);
+            return Command::Result::INVALID_ARGUMENT;
+        }
+
+        if(!Profiler::startTrace(ResourceManager::getSingleton().getUserDataPath() + filename))
+            return Command::Result::FAILED;
+
+        if(!Profiler::isEnabled())
+            Profiler::setEnabled(true);
+    }
+    else
+        return Command::Result::INVALID_ARGUMENT;
+
+    return Command::Result::SUCCESS;
+}
+
 Command::Result cSetCameraFOVy(const Command::ArgumentList_t& args, ConsoleInterface& c, AbstractModeManager&)
 {
     Ogre::Camera* cam = ODFrameListener::getSingleton().getCameraManager()->getActiveCamera();
@@ -530,6 +637,18 @@ void addConsoleCommands(ConsoleInterface& cl)
                   cFPS,
                   Command::cStubServer,
                   {AbstractModeManager::ModeType::GAME, AbstractModeManager::ModeType::EDITOR});
+    cl.addCommand("replayspeed",
+                  "Sets or displays the speed of the replay being watched. 1 is the speed at which it was recorded.\n\nExample:\n"
+                  "replayspeed 4\n\nThe above command will play the replay 4 times faster.",
+                  cReplaySpeed,
+                  Command::cStubServer,
+                  {AbstractModeManager::ModeType::GAME});
+    cl.addCommand("replayseek",
+                  "Moves the replay being watched to the given turn. The replay can be moved backward or forward.\n\nExample:\n"
+                  "replayseek 1200\n\nThe above command will move the replay to turn 1200.",
+                  cReplaySeek,
+                  Command::cStubServer,
+                  {AbstractModeManager::ModeType::GAME});
     cl.addCommand("nearclip",
                    "Sets the minimal viewpoint clipping distance. Objects nearer than that won't be rendered.\n\nE.g.: nearclip 3.0",
                    [](const Command::ArgumentList_t& args, ConsoleInterface& c, AbstractModeManager&) {
@@ -662,6 +781,24 @@ void addConsoleCommands(ConsoleInterface& cl)
                    cSrvLogFloodFill,
                    {AbstractModeManager::ModeType::GAME},
                    {});
+    cl.addCommand("pathfindingmode",
+                   "'pathfindingmode' sets the algorithm used to compute creature paths. 'flat' uses a full A* search,"
+                   " 'hierarchical' computes long paths on a clusters layer and 'compare' uses the full search but logs"
+                   " each turn how the clusters layer paths compare.\n\nExample:\n"
+                   "pathfindingmode hierarchical",
+                   cSendCmdToServer,
+                   cSrvPathfindingMode,
+                   {AbstractModeManager::ModeType::GAME},
+                   {});
+    cl.addCommand("profiler",
+                   "'profiler' measures the time spent in the server turns. 'on' and 'off' start and stop the measures,"
+                   " 'summary' logs the percentiles of each zone over the last turns, 'trace' writes every zone to the"
+                   " given file in the user data directory in the Chrome trace format (chrome://tracing) until 'stoptrace'.\n\nExample:\n"
+                   "profiler trace serverTurns.json",
+                   cSendCmdToServer,
+                   cSrvProfiler,
+                   {AbstractModeManager::ModeType::GAME, AbstractModeManager::ModeType::EDITOR},
+                   {});
     cl.addCommand("listmeshanims",
                    "'listmeshanims' lists all the animations for the given mesh.",
                    cListMeshAnims,
@@ -25,6 +25,7 @@
 #include "render/ODFrameListener.h"
 #include "network/ODServer.h"
 #include "network/ODClient.h"
+#include "network/ReplayFile.h"
 #include "network/ServerNotification.h"
 #include "ODApplication.h"
 #include "utils/LogManager.h"
@@ -217,24 +218,32 @@ bool MenuModeReplay::listReplaysClicked(const CEGUI::EventArgs&)
 
 bool MenuModeReplay::checkReplayValid(const std::string& replayFileName, std::string& mapDescription, std::string& errorMsg)
 {
-    // We open the replay to get the level file name
-    std::ifstream is(replayFileName, std::ios::in | std::ios::binary);
-    ODPacket packet;
-    ServerNotificationType type;
-    do
-    {
-        packet.readPacket(is);
-        OD_ASSERT_TRUE(packet >> type);
-        if(is.eof())
-            break;
-    } while(type != ServerNotificationType::loadLevel);
-
-    if(is.eof())
+    // We open the replay to get the level file name. Replays with an unknown format are rejected by the reader
+    ReplayReader reader;
+    if(!reader.open(replayFileName))
     {
         errorMsg = "Invalid replay file";
         return false;
     }
 
+    ODPacket packet;
+    ReplayRecordType recordType;
+    int32_t timestamp;
+    ServerNotificationType type = ServerNotificationType::newMap;
+    while(type != ServerNotificationType::loadLevel)
+    {
+        if(!reader.readRecord(recordType, timestamp, packet))
+        {
+            errorMsg = "Invalid replay file";
+            return false;
+        }
+
+        if(recordType != ReplayRecordType::message)
+            continue;
+
+        OD_ASSERT_TRUE(packet >> type);
+    }
+
     std::string odVersion;
     std::string tmpStr;
     int32_t tmpInt;
@@ -20,7 +20,6 @@
 #include "entities/Creature.h"
 #include "entities/CreatureDefinition.h"
 #include "entities/EntityLoading.h"
-#include "entities/GameEntityType.h"
 #include "entities/MapLight.h"
 #include "entities/RenderedMovableEntity.h"
 #include "entities/Tile.h"
@@ -433,13 +432,12 @@ bool ODClient::processMessage(ServerNotificationType cmd, ODPacket& packetReceiv
 
         case ServerNotificationType::removeEntity:
         {
-            GameEntityType entityType;
-            std::string entityName;
-            OD_ASSERT_TRUE(packetReceived >> entityType >> entityName);
-            GameEntity* entity = gameMap->getEntityFromTypeAndName(entityType, entityName);
+            uint32_t networkId;
+            OD_ASSERT_TRUE(packetReceived >> networkId);
+            GameEntity* entity = gameMap->getAnimatedObjectFromNetworkId(networkId);
             if(entity == nullptr)
             {
-                OD_LOG_ERR("entityType=" + Helper::toString(static_cast<int32_t>(entityType)) + ", entityName=" + entityName);
+                OD_LOG_ERR("networkId=" + Helper::toString(networkId));
                 break;
             }
 
@@ -457,6 +455,7 @@ bool ODClient::processMessage(ServerNotificationType cmd, ODPacket& packetReceiv
                 + boost::lexical_cast<std::string>(turnNum));
 
             gameMap->clientUpKeep(turnNum);
+            notifyTurnStarted(turnNum);
             // We acknowledge the new turn to the server so that he knows we are
             // ready for next one
             ODPacket packSend;
@@ -473,19 +472,19 @@ bool ODClient::processMessage(ServerNotificationType cmd, ODPacket& packetReceiv
 
         case ServerNotificationType::animatedObjectSetWalkPath:
         {
-            std::string objName;
+            uint32_t networkId;
             std::string walkAnim;
             std::string endAnim;
             bool loopEndAnim;
             bool playIdleWhenAnimationEnds;
             uint32_t nbDest;
-            OD_ASSERT_TRUE(packetReceived >> objName >> walkAnim >> endAnim);
+            OD_ASSERT_TRUE(packetReceived >> networkId >> walkAnim >> endAnim);
             OD_ASSERT_TRUE(packetReceived >> loopEndAnim >> playIdleWhenAnimationEnds >> nbDest);
 
-            MovableGameEntity *tempAnimatedObject = gameMap->getAnimatedObject(objName);
+            MovableGameEntity *tempAnimatedObject = gameMap->getAnimatedObjectFromNetworkId(networkId);
             if(tempAnimatedObject == nullptr)
             {
-                OD_LOG_ERR("objName=" + objName);
+                OD_LOG_ERR("networkId=" + Helper::toString(networkId));
                 break;
             }
 
@@ -505,9 +504,8 @@ bool ODClient::processMessage(ServerNotificationType cmd, ODPacket& packetReceiv
         case ServerNotificationType::entityPickedUp:
         {
             int seatId;
-            GameEntityType entityType;
-            std::string entityName;
-            OD_ASSERT_TRUE(packetReceived >> seatId >> entityType >> entityName);
+            uint32_t networkId;
+            OD_ASSERT_TRUE(packetReceived >> seatId >> networkId);
             Player *tempPlayer = gameMap->getPlayerBySeatId(seatId);
             if(tempPlayer == nullptr)
             {
@@ -515,10 +513,10 @@ bool ODClient::processMessage(ServerNotificationType cmd, ODPacket& packetReceiv
                 break;
             }
 
-            GameEntity* entity = gameMap->getEntityFromTypeAndName(entityType, entityName);
+            GameEntity* entity = gameMap->getAnimatedObjectFromNetworkId(networkId);
             if(entity == nullptr)
             {
-                OD_LOG_ERR("entityType=" + Helper::toString(static_cast<int32_t>(entityType)) + ", entityName=" + entityName);
+                OD_LOG_ERR("networkId=" + Helper::toString(networkId));
                 break;
             }
 
@@ -552,17 +550,17 @@ bool ODClient::processMessage(ServerNotificationType cmd, ODPacket& packetReceiv
 
         case ServerNotificationType::setObjectAnimationState:
         {
-            std::string objName;
+            uint32_t networkId;
             std::string animState;
             bool loop;
             bool playIdleWhenAnimationEnds;
             bool shouldSetWalkDirection;
-            OD_ASSERT_TRUE(packetReceived >> objName >> animState
+            OD_ASSERT_TRUE(packetReceived >> networkId >> animState
                 >> loop >> playIdleWhenAnimationEnds >> shouldSetWalkDirection);
-            MovableGameEntity *obj = gameMap->getAnimatedObject(objName);
+            MovableGameEntity *obj = gameMap->getAnimatedObjectFromNetworkId(networkId);
             if (obj == nullptr)
             {
-                OD_LOG_ERR("objName=" + objName + ", state=" + animState);
+                OD_LOG_ERR("networkId=" + Helper::toString(networkId) + ", state=" + animState);
                 break;
             }
 
@@ -590,18 +588,16 @@ bool ODClient::processMessage(ServerNotificationType cmd, ODPacket& packetReceiv
         case ServerNotificationType::entitiesRefresh:
         {
             uint32_t nbEntities;
-            GameEntityType entityType;
-            std::string entityName;
+            uint32_t networkId;
             OD_ASSERT_TRUE(packetReceived >> nbEntities);
             while(nbEntities > 0)
             {
                 --nbEntities;
-                OD_ASSERT_TRUE(packetReceived >> entityType);
-                OD_ASSERT_TRUE(packetReceived >> entityName);
-                GameEntity* entity = gameMap->getEntityFromTypeAndName(entityType, entityName);
+                OD_ASSERT_TRUE(packetReceived >> networkId);
+                GameEntity* entity = gameMap->getAnimatedObjectFromNetworkId(networkId);
                 if(entity == nullptr)
                 {
-                    OD_LOG_ERR("entityType=" + Helper::toString(static_cast<int32_t>(entityType)) + ", entityName=" + entityName);
+                    OD_LOG_ERR("networkId=" + Helper::toString(networkId));
                     break;
                 }
 
@@ -638,14 +634,14 @@ bool ODClient::processMessage(ServerNotificationType cmd, ODPacket& packetReceiv
 
         case ServerNotificationType::setEntityOpacity:
         {
-            std::string entityName;
+            uint32_t networkId;
             float opacity;
-            OD_ASSERT_TRUE(packetReceived >> entityName >> opacity);
+            OD_ASSERT_TRUE(packetReceived >> networkId >> opacity);
 
-            RenderedMovableEntity* entity = gameMap->getRenderedMovableEntity(entityName);
+            RenderedMovableEntity* entity = gameMap->getRenderedMovableEntityFromNetworkId(networkId);
             if(entity == nullptr)
             {
-                OD_LOG_ERR("entityName=" + entityName);
+                OD_LOG_ERR("networkId=" + Helper::toString(networkId));
                 break;
             }
 
@@ -828,21 +824,20 @@ bool ODClient::processMessage(ServerNotificationType cmd, ODPacket& packetReceiv
 
         case ServerNotificationType::carryEntity:
         {
-            std::string carrierName;
-            GameEntityType entityType;
-            std::string carriedName;
-            OD_ASSERT_TRUE(packetReceived >> carrierName >> entityType >> carriedName);
-            Creature* carrier = gameMap->getCreature(carrierName);
+            uint32_t carrierId;
+            uint32_t carriedId;
+            OD_ASSERT_TRUE(packetReceived >> carrierId >> carriedId);
+            Creature* carrier = gameMap->getCreatureFromNetworkId(carrierId);
             if(carrier == nullptr)
             {
-                OD_LOG_ERR("carrierName=" + carrierName);
+                OD_LOG_ERR("carrierId=" + Helper::toString(carrierId));
                 break;
             }
 
-            GameEntity* carried = gameMap->getEntityFromTypeAndName(entityType, carriedName);
+            GameEntity* carried = gameMap->getAnimatedObjectFromNetworkId(carriedId);
             if(carried == nullptr)
             {
-                OD_LOG_ERR("entityType=" + Helper::toString(static_cast<int32_t>(entityType)) + ", carriedName=" + carriedName);
+                OD_LOG_ERR("carriedId=" + Helper::toString(carriedId));
                 break;
             }
 
@@ -854,22 +849,21 @@ bool ODClient::processMessage(ServerNotificationType cmd, ODPacket& packetReceiv
 
         case ServerNotificationType::releaseCarriedEntity:
         {
-            std::string carrierName;
-            GameEntityType entityType;
-            std::string carriedName;
+            uint32_t carrierId;
+            uint32_t carriedId;
             Ogre::Vector3 pos;
-            OD_ASSERT_TRUE(packetReceived >> carrierName >> entityType >> carriedName >> pos);
-            Creature* carrier = gameMap->getCreature(carrierName);
+            OD_ASSERT_TRUE(packetReceived >> carrierId >> carriedId >> pos);
+            Creature* carrier = gameMap->getCreatureFromNetworkId(carrierId);
             if(carrier == nullptr)
             {
-                OD_LOG_ERR("carrierName=" + carrierName);
+                OD_LOG_ERR("carrierId=" + Helper::toString(carrierId));
                 break;
             }
 
-            GameEntity* carried = gameMap->getEntityFromTypeAndName(entityType, carriedName);
+            GameEntity* carried = gameMap->getAnimatedObjectFromNetworkId(carriedId);
             if(carried == nullptr)
             {
-                OD_LOG_ERR("entityType=" + Helper::toString(static_cast<int32_t>(entityType)) + ", carriedName=" + carriedName);
+                OD_LOG_ERR("carriedId=" + Helper::toString(carriedId));
                 break;
             }
 
@@ -1017,6 +1011,166 @@ void ODClient::refreshMainUI(const std::string& goalsString)
     // Note: Later, we can handle other modes here if necessary.
 }
 
+void ODClient::exportReplayKeyframe(ODPacket& os)
+{
+    // The keyframe contains what the local player knows about the game. It is read by importReplayKeyframe
+    GameMap* gameMap = ODFrameListener::getSingleton().getClientGameMap();
+    Player* player = getPlayer();
+    Seat* seat = player->getSeat();
+    seat->exportToPacketForUpdate(os);
+
+    uint32_t nbItems = seat->getSkillPending().size();
+    os << nbItems;
+    for(SkillType skill : seat->getSkillPending())
+        os << skill;
+
+    nbItems = seat->getSkillDone().size();
+    os << nbItems;
+    for(SkillType skill : seat->getSkillDone())
+        os << skill;
+
+    for(int yy = 0; yy < gameMap->getMapSizeY(); ++yy)
+    {
+        for(int xx = 0; xx < gameMap->getMapSizeX(); ++xx)
+        {
+            Tile* tile = gameMap->getTile(xx, yy);
+            os << tile->getLocalPlayerHasVision() << tile->getMarkedForDigging(player);
+            tile->exportToPacketForReplay(os);
+        }
+    }
+
+    // The entities are exported with their walk queue so that the walks in progress go on after the keyframe
+    // is restored. The animation to play at the end of the walk is only known by the client and exported apart.
+    // The creatures also get every update field as the updates received after the keyframe only contain the
+    // changed ones (the prison seat is not in exportToPacket for example)
+    const std::vector<MovableGameEntity*>& entities = gameMap->getAnimatedObjects();
+    nbItems = entities.size();
+    os << nbItems;
+    for(MovableGameEntity* entity : entities)
+    {
+        GameEntity* gameEntity = entity;
+        gameEntity->exportHeadersToPacket(os);
+        gameEntity->exportToPacket(os, seat);
+        entity->exportWalkStateToPacket(os);
+        if(entity->getObjectType() == GameEntityType::creature)
+            static_cast<Creature*>(entity)->exportToPacketForReplay(os);
+    }
+
+    const std::vector<GameEntity*>& objectsInHand = player->getObjectsInHand();
+    nbItems = objectsInHand.size();
+    os << nbItems;
+    for(GameEntity* entity : objectsInHand)
+        os << entity->getNetworkId();
+}
+
+bool ODClient::importReplayKeyframe(int64_t turnNum, ODPacket& is)
+{
+    GameMap* gameMap = ODFrameListener::getSingleton().getClientGameMap();
+    Player* player = getPlayer();
+    if((gameMap == nullptr) || (player == nullptr))
+        return false;
+
+    Seat* seat = player->getSeat();
+    if(!seat->importFromPacketForUpdate(is))
+        return false;
+
+    uint32_t nbItems;
+    std::vector<SkillType> skillsPending;
+    std::vector<SkillType> skillsDone;
+    OD_ASSERT_TRUE(is >> nbItems);
+    while(nbItems > 0)
+    {
+        nbItems--;
+        SkillType skill;
+        OD_ASSERT_TRUE(is >> skill);
+        skillsPending.push_back(skill);
+    }
+    OD_ASSERT_TRUE(is >> nbItems);
+    while(nbItems > 0)
+    {
+        nbItems--;
+        SkillType skill;
+        OD_ASSERT_TRUE(is >> skill);
+        skillsDone.push_back(skill);
+    }
+    seat->setSkillTree(skillsPending);
+    seat->setSkillsDone(skillsDone);
+
+    // We remove every entity. The keyframe contains all the ones the local player knew about
+    player->clearObjectsInHand();
+    std::vector<MovableGameEntity*> entities = gameMap->getAnimatedObjects();
+    for(MovableGameEntity* entity : entities)
+    {
+        entity->removeEntityFromPositionTile();
+        entity->removeFromGameMap();
+        entity->deleteYourself();
+    }
+
+    std::vector<Tile*> tiles;
+    for(int yy = 0; yy < gameMap->getMapSizeY(); ++yy)
+    {
+        for(int xx = 0; xx < gameMap->getMapSizeX(); ++xx)
+        {
+            Tile* tile = gameMap->getTile(xx, yy);
+            bool hasVision;
+            bool isMarked;
+            OD_ASSERT_TRUE(is >> hasVision >> isMarked);
+            tile->setLocalPlayerHasVision(hasVision);
+            tile->setMarkedForDigging(isMarked, player);
+            tile->updateFromPacket(is);
+            tiles.push_back(tile);
+        }
+    }
+    gameMap->refreshBorderingTilesOf(tiles);
+
+    OD_ASSERT_TRUE(is >> nbItems);
+    while(nbItems > 0)
+    {
+        nbItems--;
+        GameEntity* entity = Entities::getGameEntityFromPacket(gameMap, is);
+        if(entity == nullptr)
+            return false;
+
+        // Only animated objects are exported in the keyframes
+        static_cast<MovableGameEntity*>(entity)->importWalkStateFromPacket(is);
+        if((entity->getObjectType() == GameEntityType::creature) &&
+           !static_cast<Creature*>(entity)->importFromPacketForReplay(is))
+        {
+            return false;
+        }
+
+        entity->addToGameMap();
+        entity->createMesh();
+        entity->restoreEntityState();
+        entity->setPosition(entity->getPosition());
+    }
+
+    OD_ASSERT_TRUE(is >> nbItems);
+    while(nbItems > 0)
+    {
+        nbItems--;
+        uint32_t networkId;
+        OD_ASSERT_TRUE(is >> networkId);
+        GameEntity* entity = gameMap->getAnimatedObjectFromNetworkId(networkId);
+        if(entity == nullptr)
+        {
+            OD_LOG_ERR("networkId=" + Helper::toString(networkId));
+            continue;
+        }
+
+        player->pickUpEntity(entity);
+    }
+
+    gameMap->setTurnNumber(turnNum);
+    return true;
+}
+
+void ODClient::updateReplayAnimations(double timeSinceLastMessage)
+{
+    GameMap* gameMap = ODFrameListener::getSingleton().getClientGameMap();
+    gameMap->updateAnimations(static_cast<Ogre::Real>(timeSinceLastMessage));
+}
+
 bool ODClient::connect(const std::string& host, const int port, uint32_t timeout, const std::string& outputReplayFilename)
 {
     mIsPlayerConfig = false;
@@ -88,6 +88,9 @@ class ODClient: public Ogre::Singleton<ODClient>,
  protected:
     bool processMessage(ServerNotificationType cmd, ODPacket& packetReceived) override;
     void playerDisconnected() override;
+    void exportReplayKeyframe(ODPacket& os) override;
+    bool importReplayKeyframe(int64_t turnNum, ODPacket& is) override;
+    void updateReplayAnimations(double timeSinceLastMessage) override;
 
  private:
     //! \brief Convenience function to send a game event.
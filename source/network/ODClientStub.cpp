@@ -0,0 +1,28 @@
+/*
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Client linked in the dedicated server. There is no local player so client notifications
+// are only queued from client code paths. They are dropped.
+
+#include "network/ODClient.h"
+
+template<> ODClient* Ogre::Singleton<ODClient>::msSingleton = nullptr;
+
+void ODClient::queueClientNotification(ClientNotification* n)
+{
+    delete n;
+}
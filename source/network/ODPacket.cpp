@@ -17,239 +17,392 @@
 
 #include "network/ODPacket.h"
 
-#define OD_INT64TOINT32H(valInt64)              (static_cast<int32_t>(valInt64 >> 32))
-#define OD_INT64TOINT32L(valInt64)              (static_cast<int32_t>(valInt64))
-#define OD_INT32TOINT64(valInt32h,valInt32l)    ((((static_cast<int64_t>(valInt32h)) << 32) & static_cast<int64_t>(0xFFFFFFFF00000000)) + ((static_cast<int64_t>(valInt32l)) & static_cast<int64_t>(0x00000000FFFFFFFF)))
+#include <cstring>
+#include <cwchar>
+#include <fstream>
+#include <limits>
+#include <mutex>
+#include <utility>
+
+namespace
+{
+//! \brief Capacity reserved for the packets when there is no buffer in the pool
+const uint32_t PACKET_INITIAL_CAPACITY = 256;
+//! \brief Bigger buffers (like the ones used to send the whole map) are not kept in the pool
+const uint32_t POOLED_BUFFER_MAX_CAPACITY = 64 * 1024;
+const uint32_t POOLED_BUFFERS_MAX = 64;
+//! \brief Maximum number of strings that can be referenced in a packet. The other ones are always written
+const uint32_t PACKET_MAX_STRINGS = 64;
+//! \brief A 64 bits varint takes at most 10 bytes
+const uint32_t VARINT_MAX_SIZE = 10;
+
+//! \brief Buffers of the destroyed packets. Packets are used by the game thread and the server thread
+class PacketBufferPool
+{
+public:
+    void acquire(std::vector<char>& buffer)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if(!mBuffers.empty())
+            {
+                buffer.swap(mBuffers.back());
+                mBuffers.pop_back();
+                return;
+            }
+        }
+
+        buffer.reserve(PACKET_INITIAL_CAPACITY);
+    }
+
+    void release(std::vector<char>& buffer)
+    {
+        if(buffer.capacity() > POOLED_BUFFER_MAX_CAPACITY)
+            return;
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        if(mBuffers.size() >= POOLED_BUFFERS_MAX)
+            return;
+
+        mBuffers.push_back(std::vector<char>());
+        mBuffers.back().swap(buffer);
+    }
+
+private:
+    std::mutex mMutex;
+    std::vector<std::vector<char>> mBuffers;
+};
+
+PacketBufferPool& getBufferPool()
+{
+    // Never deleted so that packets destroyed when the program exits can still release their buffer
+    static PacketBufferPool* pool = new PacketBufferPool;
+    return *pool;
+}
+}
+
+ODPacket::ODPacket() :
+    mReadPos(HEADER_SIZE),
+    mIsValid(true)
+{
+    getBufferPool().acquire(mData);
+    mData.resize(HEADER_SIZE);
+}
 
-// The max buffer size when reading packets.
-const int32_t BUFFER_SIZE = 1024;
+ODPacket::ODPacket(const ODPacket& packet) :
+    mReadPos(packet.mReadPos),
+    mIsValid(packet.mIsValid),
+    mWrittenStrings(packet.mWrittenStrings),
+    mReadStrings(packet.mReadStrings)
+{
+    getBufferPool().acquire(mData);
+    mData.assign(packet.mData.begin(), packet.mData.end());
+}
+
+ODPacket::~ODPacket()
+{
+    getBufferPool().release(mData);
+}
+
+ODPacket& ODPacket::operator =(const ODPacket& packet)
+{
+    mData.assign(packet.mData.begin(), packet.mData.end());
+    mReadPos = packet.mReadPos;
+    mIsValid = packet.mIsValid;
+    mWrittenStrings = packet.mWrittenStrings;
+    mReadStrings = packet.mReadStrings;
+    return *this;
+}
 
 ODPacket& ODPacket::operator >>(bool& data)
 {
-    mPacket>>data;
+    uint8_t value;
+    if(readRaw(&value, sizeof(value)))
+        data = (value != 0);
     return *this;
 }
 
 ODPacket& ODPacket::operator >>(int8_t& data)
 {
-    mPacket>>data;
+    readRaw(&data, sizeof(data));
     return *this;
 }
 
 ODPacket& ODPacket::operator >>(uint8_t& data)
 {
-    mPacket>>data;
+    readRaw(&data, sizeof(data));
     return *this;
 }
 
 ODPacket& ODPacket::operator >>(int16_t& data)
 {
-    mPacket>>data;
+    int64_t value;
+    if(readVarInt(value, std::numeric_limits<int16_t>::min(), std::numeric_limits<int16_t>::max()))
+        data = static_cast<int16_t>(value);
     return *this;
 }
 
 ODPacket& ODPacket::operator >>(uint16_t& data)
 {
-    mPacket>>data;
+    uint64_t value;
+    if(readVarUInt(value, std::numeric_limits<uint16_t>::max()))
+        data = static_cast<uint16_t>(value);
     return *this;
 }
 
 ODPacket& ODPacket::operator >>(int32_t& data)
 {
-    mPacket>>data;
+    int64_t value;
+    if(readVarInt(value, std::numeric_limits<int32_t>::min(), std::numeric_limits<int32_t>::max()))
+        data = static_cast<int32_t>(value);
     return *this;
 }
 
 ODPacket& ODPacket::operator >>(uint32_t& data)
 {
-    mPacket>>data;
+    uint64_t value;
+    if(readVarUInt(value, std::numeric_limits<uint32_t>::max()))
+        data = static_cast<uint32_t>(value);
     return *this;
 }
 
 ODPacket& ODPacket::operator >>(int64_t& data)
 {
-    // Note: currently, SFML 2.1 do not handle int64. We do it ourselves
-    int32_t dataH;
-    int32_t dataL;
-    mPacket>>dataH;
-    mPacket>>dataL;
-    data = OD_INT32TOINT64(dataH,dataL);
+    readVarInt(data, std::numeric_limits<int64_t>::min(), std::numeric_limits<int64_t>::max());
     return *this;
 }
 
 ODPacket& ODPacket::operator >>(uint64_t& data)
 {
-    // Note: currently, SFML 2.1 do not handle int64. We do it ourselves
-    uint32_t dataH;
-    uint32_t dataL;
-    mPacket>>dataH;
-    mPacket>>dataL;
-    data = OD_INT32TOINT64(dataH,dataL);
+    readVarUInt(data, std::numeric_limits<uint64_t>::max());
     return *this;
 }
 
 ODPacket& ODPacket::operator >>(float& data)
 {
-    mPacket>>data;
+    readRaw(&data, sizeof(data));
     return *this;
 }
 
 ODPacket& ODPacket::operator >>(double& data)
 {
-    mPacket>>data;
+    readRaw(&data, sizeof(data));
     return *this;
 }
 
 ODPacket& ODPacket::operator >>(char* data)
 {
-    mPacket>>data;
+    const char* str;
+    uint32_t size;
+    if(readString(str, size))
+    {
+        std::memcpy(data, str, size);
+        data[size] = '\0';
+    }
     return *this;
 }
 
 ODPacket& ODPacket::operator >>(std::string& data)
 {
-    mPacket>>data;
+    const char* str;
+    uint32_t size;
+    if(readString(str, size))
+        data.assign(str, size);
     return *this;
 }
 
 ODPacket& ODPacket::operator >>(wchar_t* data)
 {
-    mPacket>>data;
+    uint64_t size;
+    // Each character takes at least 1 byte
+    if(!readVarUInt(size, std::numeric_limits<uint32_t>::max()) || !checkSize(size))
+        return *this;
+
+    for(uint64_t i = 0; i < size; ++i)
+    {
+        uint64_t character;
+        if(!readVarUInt(character, std::numeric_limits<uint32_t>::max()))
+            return *this;
+
+        data[i] = static_cast<wchar_t>(character);
+    }
+    data[size] = L'\0';
     return *this;
 }
 
 ODPacket& ODPacket::operator >>(std::wstring& data)
 {
-    mPacket>>data;
+    uint64_t size;
+    if(!readVarUInt(size, std::numeric_limits<uint32_t>::max()) || !checkSize(size))
+        return *this;
+
+    std::wstring str;
+    str.reserve(size);
+    for(uint64_t i = 0; i < size; ++i)
+    {
+        uint64_t character;
+        if(!readVarUInt(character, std::numeric_limits<uint32_t>::max()))
+            return *this;
+
+        str += static_cast<wchar_t>(character);
+    }
+    data.swap(str);
     return *this;
 }
 
 ODPacket& ODPacket::operator >>(Ogre::Vector3& data)
 {
-    mPacket >> data.x >> data.y >> data.z;
+    *this >> data.x >> data.y >> data.z;
     return *this;
 }
 ODPacket& ODPacket::operator <<(bool data)
 {
-    mPacket<<data;
+    uint8_t value = data ? 1 : 0;
+    writeRaw(&value, sizeof(value));
     return *this;
 }
 
 ODPacket& ODPacket::operator <<(int8_t data)
 {
-    mPacket<<data;
+    writeRaw(&data, sizeof(data));
     return *this;
 }
 
 ODPacket& ODPacket::operator <<(uint8_t data)
 {
-    mPacket<<data;
+    writeRaw(&data, sizeof(data));
     return *this;
 }
 
 ODPacket& ODPacket::operator <<(int16_t data)
 {
-    mPacket<<data;
+    writeVarInt(data);
     return *this;
 }
 
 ODPacket& ODPacket::operator <<(uint16_t data)
 {
-    mPacket<<data;
+    writeVarUInt(data);
     return *this;
 }
 
 ODPacket& ODPacket::operator <<(int32_t data)
 {
-    mPacket<<data;
+    writeVarInt(data);
     return *this;
 }
 
 ODPacket& ODPacket::operator <<(uint32_t data)
 {
-    mPacket<<data;
+    writeVarUInt(data);
     return *this;
 }
 
 ODPacket& ODPacket::operator <<(int64_t data)
 {
-    // Note: currently, SFML 2.1 do not handle int64. We do it ourselves
-    int32_t dataH = OD_INT64TOINT32H(data);
-    int32_t dataL = OD_INT64TOINT32L(data);
-    mPacket<<dataH;
-    mPacket<<dataL;
+    writeVarInt(data);
     return *this;
 }
 
 ODPacket& ODPacket::operator <<(uint64_t data)
 {
-    // Note: currently, SFML 2.1 do not handle int64. We do it ourselves
-    int32_t dataH = OD_INT64TOINT32H(data);
-    int32_t dataL = OD_INT64TOINT32L(data);
-    mPacket<<dataH;
-    mPacket<<dataL;
+    writeVarUInt(data);
     return *this;
 }
 
 ODPacket& ODPacket::operator <<(float data)
 {
-    mPacket<<data;
+    writeRaw(&data, sizeof(data));
     return *this;
 }
 
 ODPacket& ODPacket::operator <<(double data)
 {
-    mPacket<<data;
+    writeRaw(&data, sizeof(data));
     return *this;
 }
 
 ODPacket& ODPacket::operator <<(const char* data)
 {
-    mPacket<<data;
+    writeString(data, static_cast<uint32_t>(std::strlen(data)));
     return *this;
 }
 
 ODPacket& ODPacket::operator <<(const std::string& data)
 {
-    mPacket<<data;
+    writeString(data.data(), static_cast<uint32_t>(data.size()));
     return *this;
 }
 
 ODPacket& ODPacket::operator <<(const wchar_t* data)
 {
-    mPacket<<data;
+    std::size_t size = std::wcslen(data);
+    writeVarUInt(size);
+    for(std::size_t i = 0; i < size; ++i)
+        writeVarUInt(static_cast<uint32_t>(data[i]));
     return *this;
 }
 
 ODPacket& ODPacket::operator <<(const std::wstring& data)
 {
-    mPacket<<data;
+    writeVarUInt(data.size());
+    for(wchar_t character : data)
+        writeVarUInt(static_cast<uint32_t>(character));
     return *this;
 }
 
 ODPacket& ODPacket::operator <<(const Ogre::Vector3&   data)
 {
-    mPacket << data.x << data.y << data.z;
+    *this << data.x << data.y << data.z;
     return *this;
 }
 
 ODPacket::operator bool() const
 {
-    return mPacket;
+    return mIsValid;
 }
 
 void ODPacket::clear()
 {
-    mPacket.clear();
+    mData.resize(HEADER_SIZE);
+    mReadPos = HEADER_SIZE;
+    mIsValid = true;
+    mWrittenStrings.clear();
+    mReadStrings.clear();
+}
+
+bool ODPacket::endOfPacket() const
+{
+    return mReadPos >= mData.size();
+}
+
+void ODPacket::appendSubPacket(const ODPacket& packet)
+{
+    uint32_t size = packet.getDataSize();
+    writeVarUInt(size);
+    writeRaw(packet.getData(), size);
+}
+
+bool ODPacket::extractSubPacket(ODPacket& packet)
+{
+    packet.clear();
+    uint64_t size;
+    if(!readVarUInt(size, std::numeric_limits<uint32_t>::max()) || !checkSize(size))
+        return false;
+
+    // The sub packet data is copied directly from our buffer
+    const char* data = mData.data() + mReadPos;
+    packet.writeRaw(data, static_cast<uint32_t>(size));
+    mReadPos += static_cast<uint32_t>(size);
+    return true;
 }
 
 void ODPacket::writePacket(int32_t timestamp, std::ofstream& os)
 {
-    int32_t bufferSize = mPacket.getDataSize();
-    const char* buffer = static_cast<const char*>(mPacket.getData());
+    int32_t bufferSize = static_cast<int32_t>(getDataSize());
     os.write(reinterpret_cast<const char*>(&timestamp), sizeof(int32_t));
     os.write(reinterpret_cast<const char*>(&bufferSize), sizeof(int32_t));
-    os.write(buffer, bufferSize);
+    os.write(getData(), bufferSize);
 }
 
 int32_t ODPacket::readPacket(std::ifstream& is)
@@ -262,18 +415,191 @@ int32_t ODPacket::readPacket(std::ifstream& is)
         return -1;
 
     is.read(reinterpret_cast<char*>(&packetSize), sizeof(int32_t));
-    if(is.eof())
+    if(is.eof() || (packetSize < 0))
         return -1;
 
-    mPacket.clear();
-    char buffer[BUFFER_SIZE];
-    while(packetSize > 0)
+    // The data is read directly in our buffer
+    is.read(getReceiveBuffer(static_cast<uint32_t>(packetSize)), packetSize);
+    if(is.gcount() != packetSize)
+        return -1;
+
+    return timestamp;
+}
+
+bool ODPacket::checkSize(uint64_t size)
+{
+    mIsValid = mIsValid && (size <= mData.size() - mReadPos);
+    return mIsValid;
+}
+
+void ODPacket::writeRaw(const void* data, uint32_t size)
+{
+    const char* bytes = static_cast<const char*>(data);
+    mData.insert(mData.end(), bytes, bytes + size);
+}
+
+bool ODPacket::readRaw(void* data, uint32_t size)
+{
+    if(!checkSize(size))
+        return false;
+
+    std::memcpy(data, mData.data() + mReadPos, size);
+    mReadPos += size;
+    return true;
+}
+
+void ODPacket::writeVarUInt(uint64_t data)
+{
+    // LEB128: 7 bits per byte, the lowest first. The high bit is set on every byte but the last
+    char buffer[VARINT_MAX_SIZE];
+    uint32_t size = 0;
+    while(data >= 0x80)
     {
-        int32_t sizeToRead = std::min(packetSize, BUFFER_SIZE);
-        is.read(buffer, sizeToRead);
-        mPacket.append(buffer, sizeToRead);
-        packetSize -= sizeToRead;
+        buffer[size++] = static_cast<char>((data & 0x7F) | 0x80);
+        data >>= 7;
     }
+    buffer[size++] = static_cast<char>(data);
+    writeRaw(buffer, size);
+}
 
-    return timestamp;
+bool ODPacket::readVarUInt(uint64_t& data, uint64_t max)
+{
+    uint64_t value = 0;
+    for(uint32_t i = 0; i < VARINT_MAX_SIZE; ++i)
+    {
+        if(!checkSize(1))
+            return false;
+
+        uint8_t byte = static_cast<uint8_t>(mData[mReadPos]);
+        ++mReadPos;
+        value |= static_cast<uint64_t>(byte & 0x7F) << (7 * i);
+        if((byte & 0x80) != 0)
+            continue;
+
+        // A value too big for the read type means the data was not written with this type
+        if(value > max)
+        {
+            mIsValid = false;
+            return false;
+        }
+
+        data = value;
+        return true;
+    }
+
+    mIsValid = false;
+    return false;
+}
+
+void ODPacket::writeVarInt(int64_t data)
+{
+    // Zigzag encoding so that small negative values are small varints too: 0, -1, 1, -2, ... are
+    // written as 0, 1, 2, 3, ...
+    uint64_t value = static_cast<uint64_t>(data) << 1;
+    if(data < 0)
+        value = ~value;
+    writeVarUInt(value);
+}
+
+bool ODPacket::readVarInt(int64_t& data, int64_t min, int64_t max)
+{
+    uint64_t value;
+    if(!readVarUInt(value, std::numeric_limits<uint64_t>::max()))
+        return false;
+
+    int64_t decoded = static_cast<int64_t>(value >> 1);
+    if((value & 1) != 0)
+        decoded = ~decoded;
+
+    if((decoded < min) || (decoded > max))
+    {
+        mIsValid = false;
+        return false;
+    }
+
+    data = decoded;
+    return true;
+}
+
+void ODPacket::writeString(const char* data, uint32_t size)
+{
+    // A string already in the table is written as its index + 1. A new one is written as 0 followed
+    // by its size and its data
+    for(uint32_t index = 0; index < mWrittenStrings.size(); ++index)
+    {
+        const StringRef& str = mWrittenStrings[index];
+        if((str.mSize != size) || (std::memcmp(mData.data() + str.mOffset, data, size) != 0))
+            continue;
+
+        writeVarUInt(index + 1);
+        return;
+    }
+
+    writeVarUInt(0);
+    writeVarUInt(size);
+    uint32_t offset = static_cast<uint32_t>(mData.size());
+    writeRaw(data, size);
+    if((size > 0) && (mWrittenStrings.size() < PACKET_MAX_STRINGS))
+        mWrittenStrings.push_back(StringRef{offset, size});
+}
+
+bool ODPacket::readString(const char*& data, uint32_t& size)
+{
+    uint64_t index;
+    if(!readVarUInt(index, PACKET_MAX_STRINGS))
+        return false;
+
+    if(index > 0)
+    {
+        if(index > mReadStrings.size())
+        {
+            mIsValid = false;
+            return false;
+        }
+
+        const StringRef& str = mReadStrings[index - 1];
+        data = mData.data() + str.mOffset;
+        size = str.mSize;
+        return true;
+    }
+
+    uint64_t strSize;
+    if(!readVarUInt(strSize, std::numeric_limits<uint32_t>::max()) || !checkSize(strSize))
+        return false;
+
+    data = mData.data() + mReadPos;
+    size = static_cast<uint32_t>(strSize);
+    if((size > 0) && (mReadStrings.size() < PACKET_MAX_STRINGS))
+        mReadStrings.push_back(StringRef{mReadPos, size});
+
+    mReadPos += size;
+    return true;
+}
+
+const char* ODPacket::getSendBuffer(uint32_t& size)
+{
+    // Network byte order, as sf::TcpSocket::send(sf::Packet&) writes it
+    uint32_t dataSize = getDataSize();
+    mData[0] = static_cast<char>((dataSize >> 24) & 0xFF);
+    mData[1] = static_cast<char>((dataSize >> 16) & 0xFF);
+    mData[2] = static_cast<char>((dataSize >> 8) & 0xFF);
+    mData[3] = static_cast<char>(dataSize & 0xFF);
+    size = static_cast<uint32_t>(mData.size());
+    return mData.data();
+}
+
+char* ODPacket::getReceiveBuffer(uint32_t dataSize)
+{
+    clear();
+    mData.resize(HEADER_SIZE + dataSize);
+    return mData.data() + HEADER_SIZE;
+}
+
+void ODPacket::swap(ODPacket& packet)
+{
+    mData.swap(packet.mData);
+    std::swap(mReadPos, packet.mReadPos);
+    std::swap(mIsValid, packet.mIsValid);
+    mWrittenStrings.swap(packet.mWrittenStrings);
+    mReadStrings.swap(packet.mReadStrings);
 }
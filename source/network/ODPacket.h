@@ -19,10 +19,10 @@
 #define ODPACKET_H
 
 #include <OgreVector3.h>
-#include <SFML/Network.hpp>
 
 #include <string>
 #include <cstdint>
+#include <vector>
 
 /*! \brief This class is an utility class to transfer data through ODSocketClient.
  * It should also override operators << and >> for each standard types.
@@ -62,16 +62,21 @@
  * Emission : packet << creature->mHp;
  * Reception : packet >> creature->mHp;
  * This way, if mHp changes (from float to double for example), it will still work.
+ * Integers wider than 8 bits are written as LEB128 varints (zigzag encoded if signed) so that the small
+ * values (counts, ids, enums, ...) only take 1 or 2 bytes. Strings written several times in the same
+ * packet (mesh names, animation names, ...) are only written the first time and then referenced by
+ * their index in the packet string table.
  */
 class ODPacket
 {
     friend class ODSocketClient;
 
     public:
-        ODPacket()
-        {}
-        ~ODPacket()
-        {}
+        ODPacket();
+        ODPacket(const ODPacket& packet);
+        ~ODPacket();
+
+        ODPacket& operator =(const ODPacket& packet);
 
         /*! \brief Export data operators.
          * The behaviour is the same as standard C++ streams
@@ -125,6 +130,19 @@ class ODPacket
          */
         void clear();
 
+        //! \brief Returns true if all the data has been exported (operator >>)
+        bool endOfPacket() const;
+
+        /*! \brief Appends the content of the given packet to this one. It can be read back
+         * with extractSubPacket. Used to send several messages in a single packet.
+         */
+        void appendSubPacket(const ODPacket& packet);
+
+        /*! \brief Exports a packet added with appendSubPacket. The given packet is cleared first.
+         * Returns false if there is no valid sub packet at the current position
+         */
+        bool extractSubPacket(ODPacket& packet);
+
         /*! \brief Writes the packet content to the given ofstream.
          */
         void writePacket(int32_t timestamp, std::ofstream& os);
@@ -150,9 +168,62 @@ class ODPacket
             packet << arg;
         }
 
+        //! \brief Returns the data written in the packet
+        inline const char* getData() const
+        { return mData.data() + HEADER_SIZE; }
+
+        inline uint32_t getDataSize() const
+        { return static_cast<uint32_t>(mData.size()) - HEADER_SIZE; }
+
     private:
-        sf::Packet mPacket;
+        //! \brief Position of a string in mData
+        struct StringRef
+        {
+            uint32_t mOffset;
+            uint32_t mSize;
+        };
+
+        //! \brief Room kept at the beginning of mData for the data size. It is filled by ODSocketClient when the
+        //! packet is sent so that the size and the data can be sent from the same buffer
+        static const uint32_t HEADER_SIZE = 4;
+
+        //! \brief Header followed by the data. The buffer is taken from a pool when the packet is constructed and
+        //! given back when it is destroyed so that it does not have to grow again for each message
+        std::vector<char> mData;
+        uint32_t mReadPos;
+        bool mIsValid;
+
+        //! \brief Strings written (or read) in the packet that can be referenced by the next ones. As strings are
+        //! read in the order they are written, both tables get the same indexes
+        std::vector<StringRef> mWrittenStrings;
+        std::vector<StringRef> mReadStrings;
+
+        //! \brief Returns true if size bytes can be read. Otherwise, marks the packet as invalid
+        bool checkSize(uint64_t size);
+
+        void writeRaw(const void* data, uint32_t size);
+        bool readRaw(void* data, uint32_t size);
+
+        void writeVarUInt(uint64_t data);
+        bool readVarUInt(uint64_t& data, uint64_t max);
+        void writeVarInt(int64_t data);
+        bool readVarInt(int64_t& data, int64_t min, int64_t max);
+
+        void writeString(const char* data, uint32_t size);
+
+        //! \brief Reads a string written with writeString. The returned data points to mData and is only valid
+        //! until the packet is modified
+        bool readString(const char*& data, uint32_t& size);
+
+        //! \brief Used by ODSocketClient. Writes the data size in the header and returns the header followed
+        //! by the data
+        const char* getSendBuffer(uint32_t& size);
+
+        //! \brief Used by ODSocketClient. Clears the packet and returns a buffer where dataSize bytes of data
+        //! can be copied
+        char* getReceiveBuffer(uint32_t dataSize);
 
+        void swap(ODPacket& packet);
 };
 
 #endif // ODPACKET_H
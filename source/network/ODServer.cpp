@@ -20,7 +20,6 @@
 #include "ai/KeeperAIType.h"
 #include "entities/Creature.h"
 #include "entities/CreatureDefinition.h"
-#include "entities/GameEntityType.h"
 #include "entities/MapLight.h"
 #include "entities/Tile.h"
 #include "entities/Weapon.h"
@@ -46,6 +45,8 @@
 #include "utils/Helper.h"
 #include "utils/LogManager.h"
 #include "utils/MasterServer.h"
+#include "utils/Profiler.h"
+#include "utils/Random.h"
 #include "utils/ResourceManager.h"
 #include "ODApplication.h"
 
@@ -57,6 +58,8 @@
 #include <boost/filesystem.hpp>
 #include <boost/lexical_cast.hpp>
 
+#include <algorithm>
+
 
 const std::string SAVEGAME_SKIRMISH_PREFIX = "SK-";
 const std::string SAVEGAME_MULTIPLAYER_PREFIX = "MP-";
@@ -64,6 +67,9 @@ static const double MASTER_SERVER_UPDATE_PERIOD_MS = 30000.0;
 static const int32_t MASTER_SERVER_STATUS_PENDING = 0;
 static const int32_t MASTER_SERVER_STATUS_STARTED = 1;
 static const int32_t MASTER_SERVER_STATUS_FINISHED = 2;
+//! \brief Number of turns the server can compute ahead of the last turn acknowledged by a client.
+//! That way, a client with some latency does not slow down the game for everybody
+static const int64_t MAX_TURNS_AHEAD = 2;
 
 template<> ODServer* Ogre::Singleton<ODServer>::msSingleton = nullptr;
 
@@ -74,6 +80,7 @@ ODServer::ODServer() :
     mGameMap(new GameMap(true)),
     mSeatsConfigured(false),
     mPlayerConfig(nullptr),
+    mTurnWaitLogged(-1),
     mConsoleInterface(std::bind(&ODServer::printConsoleMsg, this, std::placeholders::_1)),
     mMasterServerGameStatusUpdateTime(0)
 {
@@ -232,6 +239,73 @@ bool ODServer::startServer(const std::string& creator, const std::string& levelF
     return true;
 }
 
+bool ODServer::startOfflineGame(const std::string& levelFilename, uint64_t randomSeed)
+{
+    OD_LOG_INF("Asked to launch offline game with levelFilename=" + levelFilename);
+
+    if (isConnected())
+    {
+        OD_LOG_INF("Couldn't start offline game: The server is already connected");
+        return false;
+    }
+
+    mSeatsConfigured = false;
+    mDisconnectedPlayers.clear();
+    mMasterServerGameId.clear();
+    mMasterServerGameStatusUpdateTime = 0.0;
+    mPlayerConfig = nullptr;
+    mServerMode = ServerMode::ModeGameMultiPlayer;
+    mServerState = ServerState::StateGame;
+    mUniqueNumberPlayer = 0;
+    GameMap* gameMap = mGameMap;
+    if (!gameMap->loadLevel(levelFilename))
+    {
+        mServerMode = ServerMode::ModeNone;
+        mServerState = ServerState::StateNone;
+        OD_LOG_INF("Couldn't start offline game. The level file can't be loaded: " + levelFilename);
+        stopServer();
+        return false;
+    }
+
+    gameMap->seedRandom(randomSeed);
+
+    // Every seat is played by the AI. If the faction or the team can be chosen, we use the first one
+    const std::vector<std::string>& factions = ConfigManager::getSingleton().getFactions();
+    for(Seat* seat : gameMap->getSeats())
+    {
+        if(seat->isRogueSeat())
+            continue;
+
+        if(std::find(factions.begin(), factions.end(), seat->getFaction()) == factions.end())
+            seat->setFaction(factions.front());
+
+        const std::vector<int>& availableTeamIds = seat->getAvailableTeamIds();
+        if(!availableTeamIds.empty())
+            seat->setTeamId(availableTeamIds.front());
+
+        addAIPlayer(seat, KeeperAIType::normal);
+    }
+
+    for (Player* player : gameMap->getPlayers())
+        player->getSeat()->setMapSize(gameMap->getMapSizeX(), gameMap->getMapSizeY());
+
+    for(Seat* seat : gameMap->getSeats())
+        seat->initSeat();
+
+    mSeatsConfigured = true;
+    gameMap->notifySeatsConfigured();
+    launchGame();
+    return true;
+}
+
+void ODServer::doOfflineTurn(double timeSinceLastTurn)
+{
+    // As the server is not connected, the notifications are dropped when queued. There is
+    // nothing to process
+    startNewTurn(timeSinceLastTurn);
+    Profiler::endTurn(mGameMap->getTurnNumber());
+}
+
 void ODServer::queueServerNotification(ServerNotification* n)
 {
     if ((n == nullptr) || (!isConnected()))
@@ -247,13 +321,18 @@ void ODServer::sendAsyncMsg(ServerNotification& notif)
     sendMsg(notif.mConcernedPlayer, notif.mPacket);
 }
 
-void ODServer::sendMsg(Player* player, ODPacket& packet)
+void ODServer::sendMsg(Player* player, ODPacket& packet, bool isFramed)
 {
     if(player == nullptr)
     {
         // If player is nullptr, we send the message to every connected player
         for (ODSocketClient* client : mSockClients)
-            client->send(packet);
+        {
+            if(isFramed)
+                client->queueInFrame(packet);
+            else
+                client->send(packet);
+        }
 
         return;
     }
@@ -269,7 +348,12 @@ void ODServer::sendMsg(Player* player, ODPacket& packet)
         return;
     }
 
-    if(client != nullptr)
+    if(client == nullptr)
+        return;
+
+    if(isFramed)
+        client->queueInFrame(packet);
+    else
         client->send(packet);
 }
 
@@ -306,16 +390,35 @@ void ODServer::startNewTurn(double timeSinceLastTurn)
     GameMap* gameMap = mGameMap;
     int64_t turn = gameMap->getTurnNumber();
 
-    // We wait until every client acknowledge the turn to start the next one. This way, we ensure
-    // synchronisation is not too bad
+    // We wait until every client has loaded the map (acknowledged turn 0) and is no more than MAX_TURNS_AHEAD
+    // turns late to start the next one. This way, we ensure synchronisation is not too bad
+    int64_t oldestTurnAck = turn;
     for (ODSocketClient* client : mSockClients)
     {
-        if(client->getLastTurnAck() != turn)
-            return;
+        int64_t turnAck = client->getLastTurnAck();
+        oldestTurnAck = std::min(oldestTurnAck, turnAck);
+        if((turnAck >= 0) && (turn - turnAck < MAX_TURNS_AHEAD))
+            continue;
+
+        if(mTurnWaitLogged != turn)
+        {
+            mTurnWaitLogged = turn;
+            std::string nick = client->getPlayer() ? client->getPlayer()->getNick() : std::string();
+            OD_LOG_INF("Waiting for client " + nick + " to start turn " + Helper::toString(turn + 1)
+                + ": last turn ack=" + Helper::toString(turnAck)
+                + ", last ack delay=" + Helper::toString(client->getLastTurnAckDelay()) + "ms"
+                + ", queued bytes=" + Helper::toString(client->getSendQueueSize()));
+        }
+        return;
     }
 
+    OD_PROFILE_ZONE("ODServer::startNewTurn");
     gameMap->setTurnNumber(++turn);
 
+    // The turns acknowledged by every client are not needed anymore
+    mTurnsStartTime.erase(mTurnsStartTime.begin(), mTurnsStartTime.upper_bound(oldestTurnAck));
+    mTurnsStartTime[turn] = mTurnsClock.getElapsedTime().asMilliseconds();
+
     ServerNotification* serverNotification = new ServerNotification(
         ServerNotificationType::turnStarted, nullptr);
     serverNotification->mPacket << turn;
@@ -329,6 +432,11 @@ void ODServer::startNewTurn(double timeSinceLastTurn)
     // We notify the clients about what they got
     for (ODSocketClient* sock : mSockClients)
     {
+        // These messages are sent again at each turn with the full state. If the client cannot keep up
+        // with the data already queued, we skip them until it catches up
+        if(sock->isCongested())
+            continue;
+
         Player* player = sock->getPlayer();
         // For now, only the player whose seat changed is notified. If we need it, we could send the event to every player
         // so that they can see how far from the goals the other players are
@@ -390,17 +498,106 @@ void ODServer::startNewTurn(double timeSinceLastTurn)
     gameMap->processDeletionQueues();
 }
 
+void ODServer::addAIPlayer(Seat* seat, KeeperAIType aiType)
+{
+    GameMap* gameMap = mGameMap;
+    // We set player id = 0 for AI players. ID is only used during seat configuration phase
+    // During the game, one should use the seat ID to identify a player
+    Player* aiPlayer = new Player(gameMap, 0);
+    aiPlayer->setNick("Keeper AI " + KeeperAITypes::toString(aiType) + " " + Helper::toString(seat->getId()));
+    gameMap->addPlayer(aiPlayer);
+    seat->setPlayer(aiPlayer);
+    gameMap->assignAI(*aiPlayer, aiType);
+}
+
+void ODServer::launchGame()
+{
+    GameMap* gameMap = mGameMap;
+    // We configure the game for launching
+    const std::vector<Seat*>& seats = gameMap->getSeats();
+    for (int jj = 0; jj < gameMap->getMapSizeY(); ++jj)
+    {
+        for (int ii = 0; ii < gameMap->getMapSizeX(); ++ii)
+        {
+            Tile* tile = gameMap->getTile(ii,jj);
+            tile->setSeats(seats);
+        }
+    }
+
+    // We set allied seats
+    for(Seat* seat : seats)
+    {
+        for(Seat* alliedSeat : seats)
+        {
+            if(alliedSeat == seat)
+                continue;
+            if(!seat->isAlliedSeat(alliedSeat))
+                continue;
+            seat->addAlliedSeat(alliedSeat);
+        }
+    }
+
+    // Every client is connected and ready, we can launch the game
+    // Send turn 0 to init the map
+    ServerNotification* serverNotification = new ServerNotification(
+        ServerNotificationType::turnStarted, nullptr);
+    serverNotification->mPacket << static_cast<int64_t>(0);
+    queueServerNotification(serverNotification);
+
+    OD_LOG_INF("Server ready, starting game");
+    gameMap->setTurnNumber(0);
+    gameMap->setGamePaused(false);
+
+    // In editor mode, we give vision on all the gamemap tiles
+    if(mServerMode == ServerMode::ModeEditor)
+    {
+        for (Seat* seat : gameMap->getSeats())
+        {
+            for (int jj = 0; jj < gameMap->getMapSizeY(); ++jj)
+            {
+                for (int ii = 0; ii < gameMap->getMapSizeX(); ++ii)
+                {
+                    gameMap->getTile(ii,jj)->addVisionRef(seat);
+                }
+            }
+
+            seat->sendVisibleTiles();
+        }
+    }
+
+    gameMap->createAllEntities();
+
+    // Fill starting gold. The seat gold only counts what is in the treasuries so it is deposited there
+    for(Seat* seat : gameMap->getSeats())
+    {
+        if(seat->getPlayer() == nullptr)
+            continue;
+
+        if(seat->getStartingGold() > 0)
+            gameMap->addGoldToSeat(seat->getStartingGold(), seat->getId());
+    }
+}
+
 void ODServer::serverThread()
 {
     GameMap* gameMap = mGameMap;
+    // The game logic draws its random numbers from the gamemap stream. That way, it does not
+    // share a generator with the client and the game can be reproduced from its seed
+    Random::ScopedStream randomStream(gameMap->getRandom());
     sf::Clock clock;
     double turnLengthMs = 1000.0 / ODApplication::turnsPerSecond;
+    // In full speed mode (dedicated servers used for tests), we do not wait between turns once the game
+    // is started. Turns are then simulated as if they lasted their normal length
+    bool isFullSpeed = ResourceManager::getSingleton().isServerFullSpeed();
     bool isClientConnected = true;
     while(isConnected() && isClientConnected)
     {
         // doTask should return after the length of 1 turn even if their are communications. When
         // it returns, we can launch next turn.
-        doTask(static_cast<int32_t>(turnLengthMs));
+        if(isFullSpeed && (gameMap->getTurnNumber() != -1))
+            pollTask();
+        else
+            doTask(static_cast<int32_t>(turnLengthMs));
         // If all the clients are disconnected during a game, we close the server
         if((mServerState == ServerState::StateGame) &&
            (mSockClients.empty()))
@@ -422,69 +619,7 @@ void ODServer::serverThread()
                     MasterServer::updateGame(mMasterServerGameId, MASTER_SERVER_STATUS_STARTED);
                 }
 
-                // We configure the game for launching
-                const std::vector<Seat*>& seats = gameMap->getSeats();
-                for (int jj = 0; jj < gameMap->getMapSizeY(); ++jj)
-                {
-                    for (int ii = 0; ii < gameMap->getMapSizeX(); ++ii)
-                    {
-                        Tile* tile = gameMap->getTile(ii,jj);
-                        tile->setSeats(seats);
-                    }
-                }
-
-                // We set allied seats
-                for(Seat* seat : seats)
-                {
-                    for(Seat* alliedSeat : seats)
-                    {
-                        if(alliedSeat == seat)
-                            continue;
-                        if(!seat->isAlliedSeat(alliedSeat))
-                            continue;
-                        seat->addAlliedSeat(alliedSeat);
-                    }
-                }
-
-                // Every client is connected and ready, we can launch the game
-                // Send turn 0 to init the map
-                ServerNotification* serverNotification = new ServerNotification(
-                    ServerNotificationType::turnStarted, nullptr);
-                serverNotification->mPacket << static_cast<int64_t>(0);
-                queueServerNotification(serverNotification);
-
-                OD_LOG_INF("Server ready, starting game");
-                gameMap->setTurnNumber(0);
-                gameMap->setGamePaused(false);
-
-                // In editor mode, we give vision on all the gamemap tiles
-                if(mServerMode == ServerMode::ModeEditor)
-                {
-                    for (Seat* seat : gameMap->getSeats())
-                    {
-                        for (int jj = 0; jj < gameMap->getMapSizeY(); ++jj)
-                        {
-                            for (int ii = 0; ii < gameMap->getMapSizeX(); ++ii)
-                            {
-                                gameMap->getTile(ii,jj)->notifyVision(seat);
-                            }
-                        }
-
-                        seat->sendVisibleTiles();
-                    }
-                }
-
-                gameMap->createAllEntities();
-
-                // Fill starting gold
-                for(Seat* seat : gameMap->getSeats())
-                {
-                    if(seat->getPlayer() == nullptr)
-                        continue;
-
-                    if(seat->getGold() > 0)
-                        gameMap->addGoldToSeat(seat->getGold(), seat->getId());
-                }
+                launchGame();
             }
             else
             {
@@ -510,9 +645,17 @@ void ODServer::serverThread()
         // to wait for server. If server is in advance, he might send commands before the
         // creatures arrive at their destination. That could result in weird issues like
         // creatures going through walls.
-        startNewTurn(static_cast<double>(clock.restart().asSeconds()) * 0.95);
+        int64_t previousTurn = gameMap->getTurnNumber();
+        if(isFullSpeed)
+            startNewTurn(turnLengthMs / 1000.0);
+        else
+            startNewTurn(static_cast<double>(clock.restart().asSeconds()) * 0.95);
 
         processServerNotifications();
+
+        // startNewTurn does nothing while some clients have not acknowledged the last turn
+        if(gameMap->getTurnNumber() != previousTurn)
+            Profiler::endTurn(gameMap->getTurnNumber());
     }
 
     if(!mMasterServerGameId.empty())
@@ -524,6 +667,7 @@ void ODServer::serverThread()
 
 void ODServer::processServerNotifications()
 {
+    OD_PROFILE_ZONE("ODServer::processServerNotifications");
     GameMap* gameMap = mGameMap;
 
     bool running = true;
@@ -550,25 +694,25 @@ void ODServer::processServerNotifications()
             case ServerNotificationType::turnStarted:
                 OD_LOG_INF("Server sends newturn="
                     + boost::lexical_cast<std::string>(gameMap->getTurnNumber()));
-                sendMsg(event->mConcernedPlayer, event->mPacket);
+                sendMsg(event->mConcernedPlayer, event->mPacket, true);
                 break;
 
             case ServerNotificationType::entityPickedUp:
                 // This message should not be sent by human players (they are notified asynchronously)
                 OD_ASSERT_TRUE_MSG(event->mConcernedPlayer->getIsHuman(), "nick=" + event->mConcernedPlayer->getNick());
-                sendMsg(event->mConcernedPlayer, event->mPacket);
+                sendMsg(event->mConcernedPlayer, event->mPacket, true);
                 break;
 
             case ServerNotificationType::entityDropped:
                 // This message should not be sent by human players (they are notified asynchronously)
                 OD_ASSERT_TRUE_MSG(event->mConcernedPlayer->getIsHuman(), "nick=" + event->mConcernedPlayer->getNick());
-                sendMsg(event->mConcernedPlayer, event->mPacket);
+                sendMsg(event->mConcernedPlayer, event->mPacket, true);
                 break;
 
             case ServerNotificationType::entitySlapped:
                 // This message should not be sent by human players (they are notified asynchronously)
                 OD_ASSERT_TRUE_MSG(!event->mConcernedPlayer->getIsHuman(), "nick=" + event->mConcernedPlayer->getNick());
-                sendMsg(event->mConcernedPlayer, event->mPacket);
+                sendMsg(event->mConcernedPlayer, event->mPacket, true);
                 break;
 
             case ServerNotificationType::exit:
@@ -577,13 +721,17 @@ void ODServer::processServerNotifications()
                 break;
 
             default:
-                sendMsg(event->mConcernedPlayer, event->mPacket);
+                sendMsg(event->mConcernedPlayer, event->mPacket, true);
                 break;
         }
 
         delete event;
         event = nullptr;
     }
+
+    // The messages of the turn are sent to each client in a single frame
+    for (ODSocketClient* client : mSockClients)
+        client->flushFrame();
 }
 
 bool ODServer::processClientNotifications(ODSocketClient* clientSocket)
@@ -597,6 +745,11 @@ bool ODServer::processClientNotifications(ODSocketClient* clientSocket)
 
     ODSocketClient::ODComStatus status = clientSocket->recv(packetReceived);
 
+    // The client sockets are non-blocking. A packet split across several TCP segments
+    // is not fully received yet. The client is still connected
+    if(status == ODSocketClient::ODComStatus::NotReady)
+        return true;
+
     // If the client closed the connection
     if (status != ODSocketClient::ODComStatus::OK)
     {
@@ -1038,13 +1191,7 @@ bool ODServer::processClientNotifications(ODSocketClient* clientSocket)
                         // Default to normal
                         aiType = KeeperAIType::normal;
                     }
-                    // We set player id = 0 for AI players. ID is only used during seat configuration phase
-                    // During the game, one should use the seat ID to identify a player
-                    Player* aiPlayer = new Player(gameMap, 0);
-                    aiPlayer->setNick("Keeper AI " + KeeperAITypes::toString(aiType) + " " + Helper::toString(seatId));
-                    gameMap->addPlayer(aiPlayer);
-                    seat->setPlayer(aiPlayer);
-                    gameMap->assignAI(*aiPlayer, aiType);
+                    addAIPlayer(seat, aiType);
                 }
                 else
                 {
@@ -1145,24 +1292,21 @@ bool ODServer::processClientNotifications(ODSocketClient* clientSocket)
 
         case ClientNotificationType::askEntityPickUp:
         {
-            std::string entityName;
-            GameEntityType entityType;
-            OD_ASSERT_TRUE(packetReceived >> entityType >> entityName);
+            uint32_t networkId;
+            OD_ASSERT_TRUE(packetReceived >> networkId);
 
             Player *player = clientSocket->getPlayer();
-            GameEntity* entity = gameMap->getEntityFromTypeAndName(entityType, entityName);
+            GameEntity* entity = gameMap->getAnimatedObjectFromNetworkId(networkId);
             if(entity == nullptr)
             {
-                OD_LOG_ERR("entityType=" + Helper::toString(static_cast<int32_t>(entityType)) + ", entityName=" + entityName);
+                OD_LOG_ERR("networkId=" + Helper::toString(networkId));
                 break;
             }
             bool allowPickup = entity->tryPickup(player->getSeat());
             if(!allowPickup)
             {
                 OD_LOG_INF("player=" + player->getNick()
-                        + " could not pickup entity entityType="
-                        + Helper::toString(static_cast<int32_t>(entityType))
-                        + ", entityName=" + entityName);
+                        + " could not pickup entity entityName=" + entity->getName());
                 break;
             }
 
@@ -1228,23 +1372,20 @@ bool ODServer::processClientNotifications(ODSocketClient* clientSocket)
 
         case ClientNotificationType::askSlapEntity:
         {
-            GameEntityType entityType;
-            std::string entityName;
+            uint32_t networkId;
             Player* player = clientSocket->getPlayer();
-            OD_ASSERT_TRUE(packetReceived >> entityType >> entityName);
-            GameEntity* entity = gameMap->getEntityFromTypeAndName(entityType, entityName);
+            OD_ASSERT_TRUE(packetReceived >> networkId);
+            GameEntity* entity = gameMap->getAnimatedObjectFromNetworkId(networkId);
             if(entity == nullptr)
             {
-                OD_LOG_WRN("entityType=" + Helper::toString(static_cast<int32_t>(entityType)) + ", entityName=" + entityName);
+                OD_LOG_WRN("networkId=" + Helper::toString(networkId));
                 break;
             }
 
             if(!entity->canSlap(player->getSeat()))
             {
                 OD_LOG_INF("player seatId=" + Helper::toString(player->getSeat()->getId())
-                    + " could not slap entity entityType="
-                    + Helper::toString(static_cast<int32_t>(entityType))
-                    + ", entityName=" + entityName);
+                    + " could not slap entity entityName=" + entity->getName());
                 break;
             }
 
@@ -1415,6 +1556,9 @@ bool ODServer::processClientNotifications(ODSocketClient* clientSocket)
             int64_t turn;
             OD_ASSERT_TRUE(packetReceived >> turn);
             clientSocket->setLastTurnAck(turn);
+            std::map<int64_t, int32_t>::iterator itTurn = mTurnsStartTime.find(turn);
+            if(itTurn != mTurnsStartTime.end())
+                clientSocket->setLastTurnAckDelay(mTurnsClock.getElapsedTime().asMilliseconds() - itTurn->second);
             break;
         }
 
@@ -1910,6 +2054,8 @@ void ODServer::stopServer()
     mSeatsConfigured = false;
     mDisconnectedPlayers.clear();
     mPlayerConfig = nullptr;
+    mTurnsStartTime.clear();
+    mTurnWaitLogged = -1;
 
     // Now that the server is stopped, we can remove all pending messages
     while(!mServerNotificationQueue.empty())
@@ -25,7 +25,9 @@
 
 class ServerNotification;
 class GameMap;
+class Seat;
 
+enum class KeeperAIType;
 enum class ServerMode;
 
 //! \brief An enum used to know what kind of game event it is.
@@ -77,6 +79,19 @@ class ODServer: public Ogre::Singleton<ODServer>,
     bool startServer(const std::string& creator, const std::string& levelFilename, ServerMode mode, bool useMasterServer);
     void stopServer();
 
+    //! \brief Loads the given level and starts a game where every seat is played by the AI. No socket is
+    //! opened and no thread is launched: the calling thread becomes the server thread and runs the turns
+    //! with doOfflineTurn. Used to measure the game simulation. Stopped with stopServer
+    bool startOfflineGame(const std::string& levelFilename, uint64_t randomSeed);
+
+    //! \brief Runs one turn of a game started with startOfflineGame. The caller should have bound the
+    //! gamemap random stream (see Random::ScopedStream)
+    void doOfflineTurn(double timeSinceLastTurn);
+
+    //! \brief The server gamemap. It should only be used from the server thread
+    inline GameMap* getGameMap() const
+    { return mGameMap; }
+
     //! \brief Adds a server notification to the server notification queue. The message will be sent to the concerned player
     void queueServerNotification(ServerNotification* n);
 
@@ -114,6 +129,13 @@ private:
 
     std::map<ODSocketClient*, std::vector<std::string>> mCreaturesInfoWanted;
 
+    //! \brief Time (from mTurnsClock) when the turns not acknowledged by every client yet were started.
+    //! Used to know how late the clients are
+    sf::Clock mTurnsClock;
+    std::map<int64_t, int32_t> mTurnsStartTime;
+    //! \brief Last turn we logged as waiting for a late client. Avoids logging it at each try
+    int64_t mTurnWaitLogged;
+
     ConsoleInterface mConsoleInterface;
 
     std::string mMasterServerGameId;
@@ -127,6 +149,13 @@ private:
     //! \brief Called when a new turn started.
     void startNewTurn(double timeSinceLastTurn);
 
+    //! \brief Creates the player controlled by the given AI type on the given seat
+    void addAIPlayer(Seat* seat, KeeperAIType aiType);
+
+    //! \brief Sets up the seats, creates the entities and starts turn 0. Called once the seats are
+    //! configured
+    void launchGame();
+
     /*! \brief Monitors mServerNotificationQueue for new events and informs the clients about them.
      *
      * This function is used in server mode and acts as a "consumer" on
@@ -145,8 +174,10 @@ private:
      */
     bool processClientNotifications(ODSocketClient* clientSocket);
 
-    //! \brief Sends the packet to the given player. If player is nullptr, the packet is sent to every connected player
-    void sendMsg(Player* player, ODPacket& packet);
+    //! \brief Sends the packet to the given player. If player is nullptr, the packet is sent to every connected player.
+    //! If isFramed is true, the packet is only queued in the frame of the concerned clients and will be sent with
+    //! the other messages of the frame (see ODSocketClient::queueInFrame)
+    void sendMsg(Player* player, ODPacket& packet, bool isFramed = false);
 
     void fireSeatConfigurationRefresh();
 
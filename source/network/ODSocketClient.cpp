@@ -25,6 +25,34 @@
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include <boost/filesystem.hpp>
 
+//! \brief Data queued for a non-blocking socket. The initial map can take a few MB on big levels
+static const uint32_t SEND_QUEUE_CAPACITY = 16 * 1024 * 1024;
+//! \brief Above that much data waiting to be sent, the client is considered congested
+static const uint32_t SEND_QUEUE_CONGESTION_SIZE = 256 * 1024;
+//! \brief Bigger packets cannot be sent (see SEND_QUEUE_CAPACITY). The size read is probably garbage
+static const uint32_t RECEIVE_MAX_PACKET_SIZE = SEND_QUEUE_CAPACITY;
+//! \brief Turns between 2 keyframes in the replays. With the default turns per second, about one every minute
+static const int64_t REPLAY_KEYFRAME_PERIOD_TURNS = 300;
+
+ODSocketClient::ODSocketClient():
+    mSource(ODSource::none),
+    mPlayer(nullptr),
+    mLastTurnAck(-1),
+    mLastTurnAckDelay(0),
+    mPendingTimestamp(-1),
+    mReplayTimeStart(0),
+    mReplaySpeed(1.0),
+    mReplayTurn(-1),
+    mIsKeyframePending(false),
+    mNbFrameMessages(0),
+    mIsProcessingFrame(false),
+    mSendQueue(SEND_QUEUE_CAPACITY),
+    mIsSendFailed(false),
+    mReceivedHeaderSize(0),
+    mReceivedDataSize(0)
+{
+}
+
 bool ODSocketClient::connect(const std::string& host, const int port, uint32_t timeout, const std::string& outputReplayFilename)
 {
     mSource = ODSource::none;
@@ -43,7 +71,11 @@ bool ODSocketClient::connect(const std::string& host, const int port, uint32_t t
 
     mOutputReplayFilename = outputReplayFilename;
 
-    mReplayOutputStream.open(mOutputReplayFilename, std::ios::out | std::ios::binary);
+    if(!mReplayWriter.open(mOutputReplayFilename))
+        OD_LOG_ERR("Could not create replay file " + mOutputReplayFilename);
+
+    mReplayTurn = -1;
+    mIsKeyframePending = false;
     mGameClock.restart();
     mSource = ODSource::network;
     return true;
@@ -52,7 +84,15 @@ bool ODSocketClient::connect(const std::string& host, const int port, uint32_t t
 bool ODSocketClient::replay(const std::string& filename)
 {
     OD_LOG_INF("Reading replay from file " + filename);
-    mReplayInputStream.open(filename, std::ios::in | std::ios::binary);
+    if(!mReplayReader.open(filename))
+    {
+        OD_LOG_ERR("Could not read replay file " + filename);
+        return false;
+    }
+
+    mReplayTimeStart = 0;
+    mReplaySpeed = 1.0;
+    mReplayTurn = -1;
     mGameClock.restart();
     mSource = ODSource::file;
     return true;
@@ -61,6 +101,14 @@ bool ODSocketClient::replay(const std::string& filename)
 void ODSocketClient::disconnect(bool keepReplay)
 {
     mPendingTimestamp = -1;
+    mFrame.clear();
+    mNbFrameMessages = 0;
+    mIsProcessingFrame = false;
+    mSendQueue.clear();
+    mIsSendFailed = false;
+    mReceivingPacket.clear();
+    mReceivedHeaderSize = 0;
+    mReceivedDataSize = 0;
     ODSource src = mSource;
     mSource = ODSource::none;
     switch(src)
@@ -80,7 +128,7 @@ void ODSocketClient::disconnect(bool keepReplay)
         }
         case ODSource::file:
         {
-            mReplayInputStream.close();
+            mReplayReader.close();
             return;
         }
         default:
@@ -88,7 +136,8 @@ void ODSocketClient::disconnect(bool keepReplay)
             break;
     }
 
-    mReplayOutputStream.close();
+    mReplayWriter.close();
+    mIsKeyframePending = false;
     // Delete the replay newly created if asked to.
     if (!keepReplay)
         boost::filesystem::remove(mOutputReplayFilename);
@@ -113,16 +162,13 @@ bool ODSocketClient::isDataAvailable()
         }
         case ODSource::file:
         {
-            if(mReplayInputStream.eof())
-                return false;
-
             if(mPendingTimestamp == -1)
-                mPendingTimestamp = mPendingPacket.readPacket(mReplayInputStream);
+                mPendingTimestamp = readReplayMessage(mPendingPacket);
 
             if(mPendingTimestamp < 0)
                 return false;
 
-            if(mPendingTimestamp < mGameClock.getElapsedTime().asMilliseconds())
+            if(mPendingTimestamp < getGameTimeMillis())
                 return true;
 
             return false;
@@ -140,13 +186,95 @@ ODSocketClient::ODComStatus ODSocketClient::send(ODPacket& s)
     if(mSource != ODSource::network)
         return ODComStatus::OK;
 
-    sf::Socket::Status status = mSockClient.send(s.mPacket);
-    if (status == sf::Socket::Done)
+    if(flushFrame() != ODComStatus::OK)
+        return ODComStatus::Error;
+
+    return sendPacket(s);
+}
+
+ODSocketClient::ODComStatus ODSocketClient::sendPacket(ODPacket& packet)
+{
+    if(mIsSendFailed)
+        return ODComStatus::Error;
+
+    // The packet buffer starts with the data size so that it can be sent or queued as it is
+    uint32_t size;
+    const char* data = packet.getSendBuffer(size);
+    if(mSockClient.isBlocking())
+    {
+        sf::Socket::Status status = mSockClient.send(data, size);
+        if (status == sf::Socket::Done)
+            return ODComStatus::OK;
+
+        OD_LOG_ERR("Could not send data from client status="
+            + Helper::toString(status));
+        return ODComStatus::Error;
+    }
+
+    if(!mSendQueue.push(data, size))
+    {
+        OD_LOG_ERR("Send queue full, client too slow. queued=" + Helper::toString(mSendQueue.getSize())
+            + ", packet size=" + Helper::toString(size));
+        mIsSendFailed = true;
+        return ODComStatus::Error;
+    }
+
+    return flushSendQueue();
+}
+
+ODSocketClient::ODComStatus ODSocketClient::flushSendQueue()
+{
+    if(mIsSendFailed)
+        return ODComStatus::Error;
+
+    while(!mSendQueue.isEmpty())
+    {
+        uint32_t size;
+        const char* data = mSendQueue.getFront(size);
+        std::size_t sent = 0;
+        sf::Socket::Status status = mSockClient.send(data, size, sent);
+        mSendQueue.pop(static_cast<uint32_t>(sent));
+        if(status == sf::Socket::Done)
+            continue;
+
+        // The socket cannot take more for now. We will try again later
+        if((status == sf::Socket::Partial) || (status == sf::Socket::NotReady))
+            return ODComStatus::OK;
+
+        OD_LOG_ERR("Could not send queued data status=" + Helper::toString(status));
+        mIsSendFailed = true;
+        return ODComStatus::Error;
+    }
+
+    return ODComStatus::OK;
+}
+
+bool ODSocketClient::isCongested() const
+{
+    return mSendQueue.getSize() > SEND_QUEUE_CONGESTION_SIZE;
+}
+
+void ODSocketClient::queueInFrame(const ODPacket& s)
+{
+    if(mSource != ODSource::network)
+        return;
+
+    if(mNbFrameMessages == 0)
+        mFrame << ServerNotificationType::messagesFrame;
+
+    mFrame.appendSubPacket(s);
+    ++mNbFrameMessages;
+}
+
+ODSocketClient::ODComStatus ODSocketClient::flushFrame()
+{
+    if(mNbFrameMessages == 0)
         return ODComStatus::OK;
 
-    OD_LOG_ERR("Could not send data from client status="
-        + Helper::toString(status));
-    return ODComStatus::Error;
+    ODComStatus status = sendPacket(mFrame);
+    mFrame.clear();
+    mNbFrameMessages = 0;
+    return status;
 }
 
 ODSocketClient::ODComStatus ODSocketClient::recv(ODPacket& s)
@@ -161,16 +289,19 @@ ODSocketClient::ODComStatus ODSocketClient::recv(ODPacket& s)
         }
         case ODSource::network:
         {
-            sf::Socket::Status status = mSockClient.receive(s.mPacket);
+            // A client we cannot send data to anymore is considered disconnected
+            if(mIsSendFailed)
+                return ODComStatus::Error;
+
+            sf::Socket::Status status = receivePacket(s);
             if (status == sf::Socket::Done)
             {
-                s.writePacket(mGameClock.getElapsedTime().asMilliseconds(),
-                    mReplayOutputStream);
+                mReplayWriter.writeMessage(mGameClock.getElapsedTime().asMilliseconds(), s);
                 return ODComStatus::OK;
             }
 
             if((!mSockClient.isBlocking()) &&
-                    (status == sf::Socket::NotReady))
+                    ((status == sf::Socket::NotReady) || (status == sf::Socket::Partial)))
             {
                 return ODComStatus::NotReady;
             }
@@ -186,7 +317,7 @@ ODSocketClient::ODComStatus ODSocketClient::recv(ODPacket& s)
         case ODSource::file:
         {
             OD_ASSERT_TRUE(mPendingPacket != 0);
-            s = mPendingPacket;
+            s.swap(mPendingPacket);
             mPendingTimestamp = -1;
             return ODComStatus::OK;
         }
@@ -196,6 +327,165 @@ ODSocketClient::ODComStatus ODSocketClient::recv(ODPacket& s)
     return ODComStatus::Error;
 }
 
+sf::Socket::Status ODSocketClient::receivePacket(ODPacket& packet)
+{
+    // The data is sent by sendPacket: the size in network byte order followed by the data
+    while(mReceivedHeaderSize < sizeof(mReceivingHeader))
+    {
+        std::size_t received = 0;
+        sf::Socket::Status status = mSockClient.receive(mReceivingHeader + mReceivedHeaderSize,
+            sizeof(mReceivingHeader) - mReceivedHeaderSize, received);
+        mReceivedHeaderSize += static_cast<uint32_t>(received);
+        if(status != sf::Socket::Done)
+            return status;
+    }
+
+    uint32_t size = (static_cast<uint32_t>(static_cast<uint8_t>(mReceivingHeader[0])) << 24)
+        | (static_cast<uint32_t>(static_cast<uint8_t>(mReceivingHeader[1])) << 16)
+        | (static_cast<uint32_t>(static_cast<uint8_t>(mReceivingHeader[2])) << 8)
+        | static_cast<uint32_t>(static_cast<uint8_t>(mReceivingHeader[3]));
+    if(size > RECEIVE_MAX_PACKET_SIZE)
+    {
+        OD_LOG_ERR("Invalid packet size=" + Helper::toString(size));
+        return sf::Socket::Error;
+    }
+
+    // The buffer is prepared when the header is complete. On a non-blocking socket, the next calls
+    // continue filling it
+    if(mReceivedDataSize == 0)
+        mReceivingPacket.getReceiveBuffer(size);
+
+    while(mReceivedDataSize < size)
+    {
+        char* data = mReceivingPacket.mData.data() + ODPacket::HEADER_SIZE + mReceivedDataSize;
+        std::size_t received = 0;
+        sf::Socket::Status status = mSockClient.receive(data, size - mReceivedDataSize, received);
+        mReceivedDataSize += static_cast<uint32_t>(received);
+        if(status != sf::Socket::Done)
+            return status;
+    }
+
+    packet.swap(mReceivingPacket);
+    mReceivingPacket.clear();
+    mReceivedHeaderSize = 0;
+    mReceivedDataSize = 0;
+    return sf::Socket::Done;
+}
+
+int32_t ODSocketClient::getGameTimeMillis() const
+{
+    int32_t elapsed = mGameClock.getElapsedTime().asMilliseconds();
+    if(mSource != ODSource::file)
+        return elapsed;
+
+    return mReplayTimeStart + static_cast<int32_t>(static_cast<double>(elapsed) * mReplaySpeed);
+}
+
+void ODSocketClient::setReplaySpeed(double speed)
+{
+    // We restart the clock so that the time already played is not scaled by the new speed
+    mReplayTimeStart = getGameTimeMillis();
+    mGameClock.restart();
+    mReplaySpeed = speed;
+}
+
+bool ODSocketClient::seekReplay(int64_t turn)
+{
+    if(mSource != ODSource::file)
+        return false;
+
+    const ReplayKeyframe* keyframe = mReplayReader.seekKeyframe(turn);
+    if(keyframe == nullptr)
+    {
+        OD_LOG_WRN("No replay keyframe before turn=" + Helper::toString(turn));
+        return false;
+    }
+
+    int64_t keyframeTurn = keyframe->mTurn;
+    ReplayRecordType type;
+    int32_t timestamp;
+    ODPacket packet;
+    if(!mReplayReader.readRecord(type, timestamp, packet) || (type != ReplayRecordType::keyframe))
+    {
+        OD_LOG_ERR("Could not read replay keyframe turn=" + Helper::toString(keyframeTurn));
+        return false;
+    }
+
+    // The messages read but not processed yet are dropped as the keyframe replaces them
+    mPendingTimestamp = -1;
+    mIsProcessingFrame = false;
+    if(!importReplayKeyframe(keyframeTurn, packet))
+    {
+        OD_LOG_ERR("Could not restore replay keyframe turn=" + Helper::toString(keyframeTurn));
+        return false;
+    }
+    mReplayTurn = keyframeTurn;
+
+    // We process the messages until the asked turn as fast as possible. Nothing is rendered meanwhile but the
+    // entities have to move as they did when the messages were received. Otherwise, the next walk paths would
+    // start from where the entities were at the keyframe
+    while(mReplayTurn < turn)
+    {
+        int32_t messageTimestamp = readReplayMessage(packet);
+        if(messageTimestamp < 0)
+            break;
+
+        if(messageTimestamp > timestamp)
+            updateReplayAnimations(static_cast<double>(messageTimestamp - timestamp) / 1000.0);
+
+        timestamp = messageTimestamp;
+        processReplayMessage(packet);
+    }
+
+    mReplayTimeStart = timestamp;
+    mGameClock.restart();
+    return true;
+}
+
+void ODSocketClient::notifyTurnStarted(int64_t turnNum)
+{
+    mReplayTurn = turnNum;
+    if((mSource != ODSource::network) || !mReplayWriter.isOpen())
+        return;
+
+    // We also write a keyframe for the first turn so that every turn can be reached
+    if((turnNum == 1) || ((turnNum > 0) && (turnNum % REPLAY_KEYFRAME_PERIOD_TURNS == 0)))
+        mIsKeyframePending = true;
+}
+
+void ODSocketClient::processReplayMessage(ODPacket& packet)
+{
+    ServerNotificationType serverCommand;
+    if(!(packet >> serverCommand))
+        return;
+
+    if(serverCommand != ServerNotificationType::messagesFrame)
+    {
+        processMessage(serverCommand, packet);
+        return;
+    }
+
+    while(!packet.endOfPacket() && packet.extractSubPacket(mReceivedFrameMessage))
+    {
+        if(mReceivedFrameMessage >> serverCommand)
+            processMessage(serverCommand, mReceivedFrameMessage);
+    }
+}
+
+int32_t ODSocketClient::readReplayMessage(ODPacket& packet)
+{
+    ReplayRecordType type;
+    int32_t timestamp;
+    while(mReplayReader.readRecord(type, timestamp, packet))
+    {
+        // Keyframes are only used when seeking
+        if(type == ReplayRecordType::message)
+            return timestamp;
+    }
+
+    return -1;
+}
+
 bool ODSocketClient::isConnected()
 {
     return mSource != ODSource::none;
@@ -211,21 +501,47 @@ void ODSocketClient::processClientSocketMessages()
 
 bool ODSocketClient::processOneClientSocketMessage()
 {
-    if(!isDataAvailable())
-        return false;
+    ServerNotificationType serverCommand;
+    if(!mIsProcessingFrame)
+    {
+        // Every message received so far has been processed. That is where a keyframe can be written
+        if(mIsKeyframePending)
+        {
+            ODPacket keyframe;
+            exportReplayKeyframe(keyframe);
+            mReplayWriter.writeKeyframe(mReplayTurn, mGameClock.getElapsedTime().asMilliseconds(), keyframe);
+            mIsKeyframePending = false;
+        }
+
+        if(!isDataAvailable())
+            return false;
+
+        // Check if data available
+        ODComStatus comStatus = recv(mReceivedFrame);
+        if(comStatus != ODComStatus::OK)
+        {
+            playerDisconnected();
+            return false;
+        }
+
+        OD_ASSERT_TRUE(mReceivedFrame >> serverCommand);
+        if(serverCommand != ServerNotificationType::messagesFrame)
+            return processMessage(serverCommand, mReceivedFrame);
 
-    ODPacket packetReceived;
+        mIsProcessingFrame = true;
+    }
 
-    // Check if data available
-    ODComStatus comStatus = recv(packetReceived);
-    if(comStatus != ODComStatus::OK)
+    // We process the messages of the frame one by one as if they were received separately
+    if(!mReceivedFrame.extractSubPacket(mReceivedFrameMessage))
     {
-        playerDisconnected();
+        OD_LOG_ERR("Invalid message in frame");
+        mIsProcessingFrame = false;
         return false;
     }
 
-    ServerNotificationType serverCommand;
-    OD_ASSERT_TRUE(packetReceived >> serverCommand);
+    if(mReceivedFrame.endOfPacket())
+        mIsProcessingFrame = false;
 
-    return processMessage(serverCommand, packetReceived);
+    OD_ASSERT_TRUE(mReceivedFrameMessage >> serverCommand);
+    return processMessage(serverCommand, mReceivedFrameMessage);
 }
@@ -19,6 +19,8 @@
 #define ODSOCKETCLIENT_H
 
 #include "network/ODPacket.h"
+#include "network/ReplayFile.h"
+#include "network/SendRingBuffer.h"
 
 #include <SFML/Network.hpp>
 
@@ -45,12 +47,7 @@ class ODSocketClient
             file
         };
 
-        ODSocketClient():
-            mSource(ODSource::none),
-            mPlayer(nullptr),
-            mLastTurnAck(-1),
-            mPendingTimestamp(-1)
-        {}
+        ODSocketClient();
 
         virtual ~ODSocketClient()
         {}
@@ -69,10 +66,13 @@ class ODSocketClient
         void setPlayer(Player* player) { mPlayer = player; }
         int64_t getLastTurnAck() { return mLastTurnAck; }
         void setLastTurnAck(int64_t lastTurnAck) { mLastTurnAck = lastTurnAck; }
+        //! \brief Time between the start of the last acknowledged turn on the server and its acknowledgement
+        int32_t getLastTurnAckDelay() const { return mLastTurnAckDelay; }
+        void setLastTurnAckDelay(int32_t lastTurnAckDelay) { mLastTurnAckDelay = lastTurnAckDelay; }
         const std::string& getState() {return mState;}
         bool isDataAvailable();
-        int32_t getGameTimeMillis()
-        { return mGameClock.getElapsedTime().asMilliseconds(); }
+        //! \brief Time since the game started. When watching a replay, it is the time in the replay
+        int32_t getGameTimeMillis() const;
 
         void setState(const std::string& state) {mState = state;}
 
@@ -90,6 +90,16 @@ class ODSocketClient
          */
         ODComStatus send(ODPacket& s);
 
+        /*! \brief Adds the packet to the frame sent by the next flushFrame call. All the messages
+         * queued between 2 flushes are sent in a single packet (see ServerNotificationType::messagesFrame)
+         * and processed one by one on the other side, in the same order.
+         * If send is called while messages are queued, they are flushed first to keep the order
+         */
+        void queueInFrame(const ODPacket& s);
+
+        //! \brief Sends the messages queued with queueInFrame if any
+        ODComStatus flushFrame();
+
         /*! \brief Receives a packet through the network
          * ODPacket should preserve integrity. That means that if an ODSocketClient
          * sends an ODPacket, the server should receive exactly 1 similar ODPacket (same data,
@@ -97,6 +107,40 @@ class ODSocketClient
          */
         ODComStatus recv(ODPacket& s);
 
+        /*! \brief On a non-blocking socket, the data that cannot be written right away is kept in a
+         * bounded queue and written by flushSendQueue. If the queue is full, the client is considered
+         * disconnected: every call to send or recv will return Error.
+         * Blocking sockets send everything directly and never queue anything.
+         */
+        ODComStatus flushSendQueue();
+
+        //! \brief Number of bytes waiting to be written on the socket
+        inline uint32_t getSendQueueSize() const
+        { return mSendQueue.getSize(); }
+
+        //! \brief Returns true if the client does not read its data as fast as it is sent
+        bool isCongested() const;
+
+        inline bool isReplaying() const
+        { return mSource == ODSource::file; }
+
+        //! \brief Speed at which the replay is played. 1 is the speed at which it was recorded
+        inline double getReplaySpeed() const
+        { return mReplaySpeed; }
+
+        void setReplaySpeed(double speed);
+
+        //! \brief Last turn started in the game being recorded or watched
+        inline int64_t getReplayTurn() const
+        { return mReplayTurn; }
+
+        /*! \brief Moves the replay being watched to the given turn. The last keyframe before the turn is restored
+         * and the messages recorded after it are processed up to the turn without waiting. Between 2 messages, the
+         * animations are updated by the time elapsed between them when recording (see updateReplayAnimations).
+         * Returns false if there is no keyframe before the turn
+         */
+        bool seekReplay(int64_t turn);
+
     protected:
         virtual bool connect(const std::string& host, const int port, uint32_t timeout, const std::string& outputReplayFilename);
         virtual bool replay(const std::string& filename);
@@ -108,22 +152,82 @@ class ODSocketClient
         virtual void playerDisconnected()
         {}
 
+        //! \brief Should be called when a new turn starts. While recording, a keyframe is written every
+        //! REPLAY_KEYFRAME_PERIOD_TURNS turns once the messages already received are processed
+        void notifyTurnStarted(int64_t turnNum);
+
+        //! \brief Exports the whole state known by the client so that importReplayKeyframe can restore it
+        //! when the replay is watched
+        virtual void exportReplayKeyframe(ODPacket& os)
+        {}
+        virtual bool importReplayKeyframe(int64_t turnNum, ODPacket& is)
+        { return false; }
+
+        //! \brief Called when seeking a replay for the time elapsed between 2 recorded messages. Nothing is
+        //! rendered but the entities should move as if that time had passed before the next message is processed
+        virtual void updateReplayAnimations(double timeSinceLastMessage)
+        {}
+
     private :
         bool processOneClientSocketMessage();
 
+        //! \brief Processes a replay message (and all the messages it contains if it is a frame) without
+        //! waiting for its timestamp
+        void processReplayMessage(ODPacket& packet);
+
+        //! \brief Reads the next message of the replay being watched. The keyframes are skipped. Returns
+        //! its timestamp or -1 if there is none left
+        int32_t readReplayMessage(ODPacket& packet);
+
+        //! \brief Sends the packet directly or queues it depending on the socket blocking mode
+        ODComStatus sendPacket(ODPacket& packet);
+
+        /*! \brief Reads the next packet from the socket directly in its buffer. On a non-blocking socket, the
+         * packet can be received over several calls. NotReady is returned until it is complete
+         */
+        sf::Socket::Status receivePacket(ODPacket& packet);
+
         ODSource mSource;
         sf::SocketSelector mSockSelector;
         sf::TcpSocket mSockClient;
         Player* mPlayer;
         int64_t mLastTurnAck;
+        int32_t mLastTurnAckDelay;
         std::string mState;
 
         sf::Clock mGameClock;
-        std::ifstream mReplayInputStream;
-        std::ofstream mReplayOutputStream;
+        ReplayReader mReplayReader;
+        ReplayWriter mReplayWriter;
         ODPacket mPendingPacket;
         int32_t mPendingTimestamp;
 
+        //! \brief When watching a replay, the replay time is mReplayTimeStart + mReplaySpeed * mGameClock
+        int32_t mReplayTimeStart;
+        double mReplaySpeed;
+        int64_t mReplayTurn;
+        bool mIsKeyframePending;
+
+        //! \brief Messages queued by queueInFrame. The packet is kept between the frames so that
+        //! its memory is reused
+        ODPacket mFrame;
+        uint32_t mNbFrameMessages;
+
+        //! \brief Last frame received. When a message of the frame stops the processing (see processMessage),
+        //! the next messages are processed at the next call to processClientSocketMessages
+        ODPacket mReceivedFrame;
+        ODPacket mReceivedFrameMessage;
+        bool mIsProcessingFrame;
+
+        //! \brief Data waiting to be written on the non-blocking socket
+        SendRingBuffer mSendQueue;
+        bool mIsSendFailed;
+
+        //! \brief Packet being received by receivePacket. The header is the size of the packet
+        ODPacket mReceivingPacket;
+        char mReceivingHeader[4];
+        uint32_t mReceivedHeaderSize;
+        uint32_t mReceivedDataSize;
+
         //! \brief the replay filename being written. Used to later optionally delete it
         //! if asked to.
         std::string mOutputReplayFilename;
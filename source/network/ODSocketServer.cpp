@@ -24,6 +24,12 @@
 
 #include <SFML/System.hpp>
 
+#include <algorithm>
+
+//! \brief While some clients have data waiting to be sent, we check at least that often if their
+//! sockets can take more
+static const int SEND_RETRY_PERIOD_MS = 2;
+
 ODSocketServer::ODSocketServer():
     mThread(nullptr),
     mIsConnected(false)
@@ -70,60 +76,114 @@ void ODSocketServer::doTask(int timeoutMs)
           (timeoutMs > mClockMainTask.getElapsedTime().asMilliseconds()))
     {
         bool isSockReady;
+        bool hasDataToSend = hasPendingData();
         if(timeoutMs != 0)
         {
             // We adapt the timeout so that the function returns after timeoutMs
             // even if events occurred
             int timeoutMsAdjusted = std::max(1, timeoutMs - mClockMainTask.getElapsedTime().asMilliseconds());
+            if(hasDataToSend)
+                timeoutMsAdjusted = std::min(timeoutMsAdjusted, SEND_RETRY_PERIOD_MS);
+
             isSockReady = mSockSelector.wait(sf::milliseconds(timeoutMsAdjusted));
         }
+        else if(hasDataToSend)
+        {
+            isSockReady = mSockSelector.wait(sf::milliseconds(SEND_RETRY_PERIOD_MS));
+        }
         else
         {
             isSockReady = mSockSelector.wait(sf::Time::Zero);
         }
 
         // Check if a client tries to connect or to communicate
-        if(!isSockReady)
-            continue;
+        if(isSockReady)
+            processReadySockets();
+
+        if(hasDataToSend)
+            sendPendingData();
+    }
+}
+
+void ODSocketServer::pollTask()
+{
+    // A zero timeout would make the selector wait forever. We use the smallest one instead
+    while(mSockSelector.wait(sf::microseconds(1)))
+        processReadySockets();
+
+    sendPendingData();
+}
 
-        if(mSockSelector.isReady(mSockListener))
+void ODSocketServer::processReadySockets()
+{
+    if(mSockSelector.isReady(mSockListener))
+    {
+        // New connection
+        ODSocketClient* newClient = notifyNewConnection(mSockListener);
+        if (newClient != nullptr)
         {
             // New connection
-            ODSocketClient* newClient = notifyNewConnection(mSockListener);
-            if (newClient != nullptr)
-            {
-                // New connection
-                OD_LOG_INF("New client connected.");
-                // The server wants to keep the client
-                newClient->setSource(ODSocketClient::ODSource::network);
-                mSockSelector.add(newClient->getSockClient());
-                mSockClients.push_back(newClient);
-            }
+            OD_LOG_INF("New client connected.");
+            // The server wants to keep the client
+            newClient->setSource(ODSocketClient::ODSource::network);
+            // The server thread should never wait for a client. What cannot be sent right away
+            // is queued
+            newClient->getSockClient().setBlocking(false);
+            mSockSelector.add(newClient->getSockClient());
+            mSockClients.push_back(newClient);
+        }
+        return;
+    }
+
+    for(std::vector<ODSocketClient*>::iterator it = mSockClients.begin(); it != mSockClients.end();)
+    {
+        ODSocketClient* client = *it;
+        if((mSockSelector.isReady(client->getSockClient())) &&
+            (!notifyClientMessage(client)))
+        {
+            // The server wants to remove the client
+            it = removeClient(it);
         }
         else
         {
+            ++it;
+        }
+    }
+}
 
-            for(std::vector<ODSocketClient*>::iterator it = mSockClients.begin(); it != mSockClients.end();)
-            {
-                ODSocketClient* client = *it;
-                if((mSockSelector.isReady(client->getSockClient())) &&
-                    (!notifyClientMessage(client)))
-                {
-                    // The server wants to remove the client
-                    it = mSockClients.erase(it);
-                    mSockSelector.remove(client->getSockClient());
-                    client->disconnect();
-                    delete client;
-                }
-                else
-                {
-                    ++it;
-                }
-            }
+void ODSocketServer::sendPendingData()
+{
+    for(std::vector<ODSocketClient*>::iterator it = mSockClients.begin(); it != mSockClients.end();)
+    {
+        ODSocketClient* client = *it;
+        if((client->flushSendQueue() != ODSocketClient::ODComStatus::OK) &&
+            (!notifyClientMessage(client)))
+        {
+            it = removeClient(it);
+        }
+        else
+        {
+            ++it;
         }
     }
 }
 
+bool ODSocketServer::hasPendingData() const
+{
+    return std::any_of(mSockClients.begin(), mSockClients.end(),
+        [](const ODSocketClient* client) { return client->getSendQueueSize() > 0; });
+}
+
+std::vector<ODSocketClient*>::iterator ODSocketServer::removeClient(std::vector<ODSocketClient*>::iterator it)
+{
+    ODSocketClient* client = *it;
+    it = mSockClients.erase(it);
+    mSockSelector.remove(client->getSockClient());
+    client->disconnect();
+    delete client;
+    return it;
+}
+
 void ODSocketServer::stopServer()
 {
     mIsConnected = false;
@@ -60,13 +60,31 @@ class ODSocketServer
          * a message. If so, calls notifyClientMessage with the client socket.
          * If timeoutMs = 0, this function will never return. Otherwise, it will always return after
          * timeoutMs milliseconds, even if new clients connected or clients are sending messages.
+         * The client sockets are not blocking. The data they could not send right away is written
+         * as soon as they can take it.
          */
         void doTask(int timeoutMs);
+
+        //! \brief Same as doTask but only handles the connections and messages already pending. Returns
+        //! as soon as there is nothing left to handle
+        void pollTask();
+
         std::vector<ODSocketClient*> mSockClients;
         virtual void serverThread() = 0;
         sf::Thread* mThread;
 
     private:
+        //! \brief Handles the new connection or the client messages signaled by the selector
+        void processReadySockets();
+
+        //! \brief Writes the data queued by the clients. The clients that cannot be written to anymore
+        //! are notified through notifyClientMessage (their recv will fail) and removed
+        void sendPendingData();
+
+        bool hasPendingData() const;
+
+        std::vector<ODSocketClient*>::iterator removeClient(std::vector<ODSocketClient*>::iterator it);
+
         sf::TcpListener mSockListener;
         sf::SocketSelector mSockSelector;
         sf::Clock mClockMainTask;
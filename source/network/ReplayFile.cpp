@@ -0,0 +1,282 @@
+/*
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "network/ReplayFile.h"
+
+#include "network/ODPacket.h"
+
+#include <cstring>
+
+namespace
+{
+const char REPLAY_MAGIC[4] = {'O', 'D', 'R', 'P'};
+const char REPLAY_INDEX_MAGIC[4] = {'O', 'D', 'R', 'I'};
+//! \brief Should be increased each time the records or the keyframes format change
+const uint32_t REPLAY_VERSION = 1;
+
+//! \brief Magic and version
+const uint64_t REPLAY_HEADER_SIZE = sizeof(REPLAY_MAGIC) + sizeof(uint32_t);
+//! \brief Turn, timestamp and offset of a keyframe
+const uint64_t REPLAY_INDEX_ENTRY_SIZE = sizeof(int64_t) + sizeof(int32_t) + sizeof(uint64_t);
+//! \brief Index position, number of keyframes and magic
+const uint64_t REPLAY_TRAILER_SIZE = sizeof(uint64_t) + sizeof(uint32_t) + sizeof(REPLAY_INDEX_MAGIC);
+
+template<typename T>
+void writeValue(std::ofstream& os, const T& value)
+{
+    os.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template<typename T>
+bool readValue(std::ifstream& is, T& value)
+{
+    is.read(reinterpret_cast<char*>(&value), sizeof(T));
+    return static_cast<bool>(is);
+}
+}
+
+ReplayWriter::ReplayWriter()
+{
+}
+
+ReplayWriter::~ReplayWriter()
+{
+    close();
+}
+
+bool ReplayWriter::open(const std::string& filename)
+{
+    close();
+    mKeyframes.clear();
+    mStream.open(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+    if(!mStream.is_open())
+        return false;
+
+    mStream.write(REPLAY_MAGIC, sizeof(REPLAY_MAGIC));
+    writeValue(mStream, REPLAY_VERSION);
+    return true;
+}
+
+void ReplayWriter::writeMessage(int32_t timestamp, ODPacket& packet)
+{
+    if(!mStream.is_open())
+        return;
+
+    uint8_t type = static_cast<uint8_t>(ReplayRecordType::message);
+    writeValue(mStream, type);
+    packet.writePacket(timestamp, mStream);
+}
+
+void ReplayWriter::writeKeyframe(int64_t turn, int32_t timestamp, ODPacket& packet)
+{
+    if(!mStream.is_open())
+        return;
+
+    uint64_t offset = static_cast<uint64_t>(mStream.tellp());
+    mKeyframes.push_back(ReplayKeyframe{turn, timestamp, offset});
+
+    // The turn is in the record header so that the keyframes can be found without reading them
+    uint8_t type = static_cast<uint8_t>(ReplayRecordType::keyframe);
+    writeValue(mStream, type);
+    writeValue(mStream, turn);
+    packet.writePacket(timestamp, mStream);
+}
+
+void ReplayWriter::close()
+{
+    if(!mStream.is_open())
+        return;
+
+    uint64_t indexOffset = static_cast<uint64_t>(mStream.tellp());
+    for(const ReplayKeyframe& keyframe : mKeyframes)
+    {
+        writeValue(mStream, keyframe.mTurn);
+        writeValue(mStream, keyframe.mTimestamp);
+        writeValue(mStream, keyframe.mOffset);
+    }
+
+    uint32_t nbKeyframes = static_cast<uint32_t>(mKeyframes.size());
+    writeValue(mStream, indexOffset);
+    writeValue(mStream, nbKeyframes);
+    mStream.write(REPLAY_INDEX_MAGIC, sizeof(REPLAY_INDEX_MAGIC));
+    mStream.close();
+    mKeyframes.clear();
+}
+
+ReplayReader::ReplayReader() :
+    mRecordsEnd(0)
+{
+}
+
+bool ReplayReader::open(const std::string& filename)
+{
+    close();
+    mStream.open(filename, std::ios::in | std::ios::binary);
+    if(!mStream.is_open())
+        return false;
+
+    char magic[sizeof(REPLAY_MAGIC)];
+    uint32_t version = 0;
+    mStream.read(magic, sizeof(magic));
+    if(!mStream || (std::memcmp(magic, REPLAY_MAGIC, sizeof(magic)) != 0) ||
+       !readValue(mStream, version) || (version != REPLAY_VERSION))
+    {
+        close();
+        return false;
+    }
+
+    mStream.seekg(0, std::ios::end);
+    uint64_t fileSize = static_cast<uint64_t>(mStream.tellg());
+    if(!readIndex(fileSize))
+        scanRecords(fileSize);
+
+    mStream.clear();
+    mStream.seekg(REPLAY_HEADER_SIZE);
+    return true;
+}
+
+void ReplayReader::close()
+{
+    mStream.close();
+    mStream.clear();
+    mKeyframes.clear();
+    mRecordsEnd = 0;
+}
+
+bool ReplayReader::readRecord(ReplayRecordType& type, int32_t& timestamp, ODPacket& packet)
+{
+    if(!mStream.is_open())
+        return false;
+
+    std::streamoff pos = mStream.tellg();
+    if((pos < 0) || (static_cast<uint64_t>(pos) >= mRecordsEnd))
+        return false;
+
+    uint8_t rawType;
+    if(!readValue(mStream, rawType))
+        return false;
+
+    type = static_cast<ReplayRecordType>(rawType);
+    if(type == ReplayRecordType::keyframe)
+    {
+        int64_t turn;
+        if(!readValue(mStream, turn))
+            return false;
+    }
+
+    timestamp = packet.readPacket(mStream);
+    return timestamp >= 0;
+}
+
+const ReplayKeyframe* ReplayReader::seekKeyframe(int64_t turn)
+{
+    const ReplayKeyframe* found = nullptr;
+    for(const ReplayKeyframe& keyframe : mKeyframes)
+    {
+        if(keyframe.mTurn > turn)
+            break;
+
+        found = &keyframe;
+    }
+
+    if(found == nullptr)
+        return nullptr;
+
+    mStream.clear();
+    mStream.seekg(static_cast<std::streamoff>(found->mOffset));
+    return found;
+}
+
+bool ReplayReader::readIndex(uint64_t fileSize)
+{
+    if(fileSize < REPLAY_HEADER_SIZE + REPLAY_TRAILER_SIZE)
+        return false;
+
+    uint64_t indexOffset;
+    uint32_t nbKeyframes;
+    char magic[sizeof(REPLAY_INDEX_MAGIC)];
+    mStream.clear();
+    mStream.seekg(static_cast<std::streamoff>(fileSize - REPLAY_TRAILER_SIZE));
+    if(!readValue(mStream, indexOffset) || !readValue(mStream, nbKeyframes))
+        return false;
+
+    mStream.read(magic, sizeof(magic));
+    if(!mStream || (std::memcmp(magic, REPLAY_INDEX_MAGIC, sizeof(magic)) != 0))
+        return false;
+
+    // We check the index fits exactly between the records and the trailer
+    if((indexOffset < REPLAY_HEADER_SIZE) ||
+       (indexOffset + nbKeyframes * REPLAY_INDEX_ENTRY_SIZE + REPLAY_TRAILER_SIZE != fileSize))
+    {
+        return false;
+    }
+
+    mStream.seekg(static_cast<std::streamoff>(indexOffset));
+    mKeyframes.clear();
+    mKeyframes.reserve(nbKeyframes);
+    for(uint32_t i = 0; i < nbKeyframes; ++i)
+    {
+        ReplayKeyframe keyframe;
+        if(!readValue(mStream, keyframe.mTurn) || !readValue(mStream, keyframe.mTimestamp) ||
+           !readValue(mStream, keyframe.mOffset))
+        {
+            mKeyframes.clear();
+            return false;
+        }
+        mKeyframes.push_back(keyframe);
+    }
+
+    mRecordsEnd = indexOffset;
+    return true;
+}
+
+void ReplayReader::scanRecords(uint64_t fileSize)
+{
+    mKeyframes.clear();
+    uint64_t offset = REPLAY_HEADER_SIZE;
+    mStream.clear();
+    mStream.seekg(static_cast<std::streamoff>(offset));
+    while(true)
+    {
+        uint8_t rawType;
+        if(!readValue(mStream, rawType))
+            break;
+
+        int64_t turn = 0;
+        ReplayRecordType type = static_cast<ReplayRecordType>(rawType);
+        if((type == ReplayRecordType::keyframe) && !readValue(mStream, turn))
+            break;
+
+        int32_t timestamp;
+        int32_t size;
+        if(!readValue(mStream, timestamp) || !readValue(mStream, size) || (size < 0))
+            break;
+
+        // A record cut when the game stopped is ignored
+        uint64_t end = static_cast<uint64_t>(mStream.tellg()) + static_cast<uint64_t>(size);
+        if(end > fileSize)
+            break;
+
+        if(type == ReplayRecordType::keyframe)
+            mKeyframes.push_back(ReplayKeyframe{turn, timestamp, offset});
+
+        offset = end;
+        mStream.seekg(static_cast<std::streamoff>(offset));
+    }
+
+    mRecordsEnd = offset;
+}
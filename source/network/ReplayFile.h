@@ -0,0 +1,112 @@
+/*
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef REPLAYFILE_H
+#define REPLAYFILE_H
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+class ODPacket;
+
+//! \brief A keyframe is the whole state known by the client at a given turn (see ODClient::exportReplayKeyframe).
+//! Restoring it and playing the next messages gives the same state as playing the replay from the beginning
+enum class ReplayRecordType
+{
+    message,
+    keyframe
+};
+
+struct ReplayKeyframe
+{
+    int64_t mTurn;
+    int32_t mTimestamp;
+    //! \brief Position of the record in the file
+    uint64_t mOffset;
+};
+
+/*! \brief Replays are written by the client while it is connected to a server. A replay file starts with a
+ * header followed by records. Each record is either a message received from the server or a keyframe. When
+ * the replay is closed, the list of the keyframes is written at the end of the file so that playback can
+ * jump to any of them. If the file was not closed properly, ReplayReader rebuilds the list by going through
+ * the records.
+ */
+class ReplayWriter
+{
+public:
+    ReplayWriter();
+    ~ReplayWriter();
+
+    //! \brief Creates the file and writes the header. Returns false if the file could not be created
+    bool open(const std::string& filename);
+
+    inline bool isOpen() const
+    { return mStream.is_open(); }
+
+    void writeMessage(int32_t timestamp, ODPacket& packet);
+    void writeKeyframe(int64_t turn, int32_t timestamp, ODPacket& packet);
+
+    //! \brief Writes the keyframes list and closes the file
+    void close();
+
+private:
+    std::ofstream mStream;
+    std::vector<ReplayKeyframe> mKeyframes;
+};
+
+class ReplayReader
+{
+public:
+    ReplayReader();
+
+    //! \brief Opens the given replay. Returns false if it cannot be read or if it was written with
+    //! another replay format
+    bool open(const std::string& filename);
+
+    inline bool isOpen() const
+    { return mStream.is_open(); }
+
+    void close();
+
+    //! \brief Reads the next record. Returns false once every record has been read
+    bool readRecord(ReplayRecordType& type, int32_t& timestamp, ODPacket& packet);
+
+    //! \brief Moves to the last keyframe at or before the given turn so that it is the next record read.
+    //! Returns nullptr (and does not move) if there is no such keyframe
+    const ReplayKeyframe* seekKeyframe(int64_t turn);
+
+    //! \brief Keyframes sorted by turn
+    inline const std::vector<ReplayKeyframe>& getKeyframes() const
+    { return mKeyframes; }
+
+private:
+    std::ifstream mStream;
+    std::vector<ReplayKeyframe> mKeyframes;
+
+    //! \brief Position of the end of the last record
+    uint64_t mRecordsEnd;
+
+    //! \brief Reads the keyframes list written by ReplayWriter::close. Returns false if there is none
+    bool readIndex(uint64_t fileSize);
+
+    //! \brief Goes through the records to find the keyframes and the end of the last complete record
+    void scanRecords(uint64_t fileSize);
+};
+
+#endif // REPLAYFILE_H
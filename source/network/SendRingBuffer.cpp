@@ -0,0 +1,72 @@
+/*
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "network/SendRingBuffer.h"
+
+#include <algorithm>
+#include <cstring>
+
+SendRingBuffer::SendRingBuffer(uint32_t capacity) :
+    mCapacity(capacity),
+    mHead(0),
+    mSize(0)
+{
+}
+
+bool SendRingBuffer::push(const void* data, uint32_t size)
+{
+    if(size > mCapacity - mSize)
+        return false;
+
+    if(mBuffer.empty())
+        mBuffer.resize(mCapacity);
+
+    // The data may have to be split between the end and the beginning of the buffer
+    const char* src = static_cast<const char*>(data);
+    uint32_t tail = (mHead + mSize) % mCapacity;
+    uint32_t firstPart = std::min(size, mCapacity - tail);
+    std::memcpy(mBuffer.data() + tail, src, firstPart);
+    std::memcpy(mBuffer.data(), src + firstPart, size - firstPart);
+    mSize += size;
+    return true;
+}
+
+const char* SendRingBuffer::getFront(uint32_t& size) const
+{
+    size = std::min(mSize, mCapacity - mHead);
+    if(size == 0)
+        return nullptr;
+
+    return mBuffer.data() + mHead;
+}
+
+void SendRingBuffer::pop(uint32_t size)
+{
+    size = std::min(size, mSize);
+    mSize -= size;
+    // Once empty, we start again from the beginning to avoid splitting the next data
+    if(mSize == 0)
+        mHead = 0;
+    else
+        mHead = (mHead + size) % mCapacity;
+}
+
+void SendRingBuffer::clear()
+{
+    mHead = 0;
+    mSize = 0;
+}
@@ -0,0 +1,63 @@
+/*
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SENDRINGBUFFER_H
+#define SENDRINGBUFFER_H
+
+#include <cstdint>
+#include <vector>
+
+//! \brief Bounded FIFO of bytes waiting to be written on a non-blocking socket. Data is pushed at
+//! the back and popped from the front as the socket accepts it. The memory is allocated with the
+//! full capacity on the first push and is never reallocated.
+class SendRingBuffer
+{
+public:
+    explicit SendRingBuffer(uint32_t capacity);
+
+    inline uint32_t getCapacity() const
+    { return mCapacity; }
+
+    inline uint32_t getSize() const
+    { return mSize; }
+
+    inline bool isEmpty() const
+    { return mSize == 0; }
+
+    //! \brief Appends the given data. If there is not enough room for all of it, nothing is
+    //! appended and false is returned
+    bool push(const void* data, uint32_t size);
+
+    //! \brief Returns the data at the front of the buffer and sets size to its length. If the
+    //! data wraps around the end of the buffer, only the first contiguous part is returned
+    const char* getFront(uint32_t& size) const;
+
+    //! \brief Removes size bytes from the front. size should not be bigger than getSize
+    void pop(uint32_t size);
+
+    void clear();
+
+private:
+    uint32_t mCapacity;
+    std::vector<char> mBuffer;
+
+    //! \brief Index in mBuffer of the first byte
+    uint32_t mHead;
+    uint32_t mSize;
+};
+
+#endif // SENDRINGBUFFER_H
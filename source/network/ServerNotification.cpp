@@ -114,6 +114,8 @@ std::string ServerNotification::typeString(ServerNotificationType type)
             return "setSpellCooldown";
         case ServerNotificationType::playerEvents:
             return "playerEvents";
+        case ServerNotificationType::messagesFrame:
+            return "messagesFrame";
         case ServerNotificationType::exit:
             return "exit";
         default:
@@ -86,6 +86,10 @@ enum class ServerNotificationType
 
     playerEvents,
 
+    // Several messages sent at once: each message is a sub packet (see ODPacket::appendSubPacket)
+    // until the end of the packet
+    messagesFrame,
+
     exit
 };
 
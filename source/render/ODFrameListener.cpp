@@ -158,6 +158,11 @@ void ODFrameListener::updateAnimations(Ogre::Real timeSinceLastFrame)
     mRenderManager->updateRenderAnimations(timeSinceLastFrame);
     mGameMap->processDeletionQueues();
 
+    // When watching a replay, the entities move at the replay speed
+    ODClient* client = ODClient::getSingletonPtr();
+    if((client != nullptr) && client->isReplaying())
+        timeSinceLastFrame *= static_cast<Ogre::Real>(client->getReplaySpeed());
+
     mGameMap->updateAnimations(timeSinceLastFrame);
 }
 
@@ -0,0 +1,41 @@
+/*
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Frame listener linked in the dedicated server. There is no window nor camera. The
+// functions used by the console commands are defined so that they can be linked.
+
+#include "render/ODFrameListener.h"
+
+template<> ODFrameListener* Ogre::Singleton<ODFrameListener>::msSingleton = nullptr;
+
+void ODFrameListener::setActiveCameraNearClipDistance(Ogre::Real)
+{
+}
+
+Ogre::Real ODFrameListener::getActiveCameraNearClipDistance()
+{
+    return 0;
+}
+
+void ODFrameListener::setActiveCameraFarClipDistance(Ogre::Real)
+{
+}
+
+Ogre::Real ODFrameListener::getActiveCameraFarClipDistance()
+{
+    return 0;
+}
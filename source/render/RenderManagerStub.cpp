@@ -0,0 +1,174 @@
+/*
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Render manager linked in the dedicated server. The server gamemap never renders anything
+// so render requests are only called from client code paths. They are defined here so that
+// the game logic can be linked without the Ogre rendering nor CEGUI.
+
+#include "render/RenderManager.h"
+
+template<> RenderManager* Ogre::Singleton<RenderManager>::msSingleton = nullptr;
+
+void RenderManager::triggerCompositor(const std::string&)
+{
+}
+
+std::string RenderManager::consoleListAnimationsForMesh(const std::string&)
+{
+    return std::string();
+}
+
+void RenderManager::rrRefreshTile(const Tile&, const GameMap&, const Player&)
+{
+}
+
+void RenderManager::rrCreateTile(Tile&, const GameMap&, const Player&)
+{
+}
+
+void RenderManager::rrDestroyTile(Tile&)
+{
+}
+
+void RenderManager::rrTemporalMarkTile(Tile*)
+{
+}
+
+void RenderManager::rrDetachEntity(GameEntity*)
+{
+}
+
+void RenderManager::rrAttachEntity(GameEntity*)
+{
+}
+
+void RenderManager::rrCreateRenderedMovableEntity(RenderedMovableEntity*)
+{
+}
+
+void RenderManager::rrDestroyRenderedMovableEntity(RenderedMovableEntity*)
+{
+}
+
+void RenderManager::rrUpdateEntityOpacity(RenderedMovableEntity*)
+{
+}
+
+void RenderManager::rrCreateCreature(Creature*)
+{
+}
+
+void RenderManager::rrDestroyCreature(Creature*)
+{
+}
+
+void RenderManager::rrOrientEntityToward(MovableGameEntity*, const Ogre::Vector3&)
+{
+}
+
+void RenderManager::rrScaleCreature(Creature&)
+{
+}
+
+void RenderManager::rrCreateWeapon(Creature*, const Weapon*, const std::string&)
+{
+}
+
+void RenderManager::rrDestroyWeapon(Creature*, const Weapon*, const std::string&)
+{
+}
+
+void RenderManager::rrCreateMapLight(MapLight*, bool)
+{
+}
+
+void RenderManager::rrDestroyMapLight(MapLight*)
+{
+}
+
+void RenderManager::rrDestroyMapLightVisualIndicator(MapLight*)
+{
+}
+
+void RenderManager::rrPickUpEntity(GameEntity*, Player*)
+{
+}
+
+void RenderManager::rrDropHand(GameEntity*, Player*)
+{
+}
+
+void RenderManager::rrRotateHand(Player*)
+{
+}
+
+void RenderManager::rrCreateCreatureVisualDebug(Creature*, Tile*)
+{
+}
+
+void RenderManager::rrDestroyCreatureVisualDebug(Creature*, Tile*)
+{
+}
+
+void RenderManager::rrCreateSeatVisionVisualDebug(int, Tile*)
+{
+}
+
+void RenderManager::rrDestroySeatVisionVisualDebug(int, Tile*)
+{
+}
+
+void RenderManager::rrSetObjectAnimationState(MovableGameEntity*, const std::string&, bool)
+{
+}
+
+void RenderManager::rrMoveEntity(GameEntity*, const Ogre::Vector3&)
+{
+}
+
+void RenderManager::rrMoveMapLightFlicker(MapLight*, const Ogre::Vector3&)
+{
+}
+
+void RenderManager::rrCarryEntity(Creature*, GameEntity*)
+{
+}
+
+void RenderManager::rrReleaseCarriedEntity(Creature*, GameEntity*)
+{
+}
+
+Ogre::ParticleSystem* RenderManager::rrEntityAddParticleEffect(GameEntity*, const std::string&, const std::string&)
+{
+    return nullptr;
+}
+
+void RenderManager::rrEntityRemoveParticleEffect(GameEntity*, Ogre::ParticleSystem*)
+{
+}
+
+void RenderManager::rrToggleHandSelectorVisibility()
+{
+}
+
+void RenderManager::rrSetCreaturesTextOverlay(GameMap&, bool)
+{
+}
+
+void RenderManager::rrTemporaryDisplayCreaturesTextOverlay(Creature*, Ogre::Real)
+{
+}
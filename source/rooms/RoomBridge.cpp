@@ -279,7 +279,7 @@ void RoomBridge::setupRoom(const std::string& name, Seat* seat, const std::vecto
 
     mClaimedValue = static_cast<double>(tiles.size()) * CLAIMED_VALUE_PER_TILE;
 
-    for(Seat* s : getGameMap()->getSeats())
+    for(Seat* s : getGameMap()->getFloodFillLayerSeats())
         updateFloodFillPathCreated(s, tiles);
 }
 
@@ -287,7 +287,7 @@ void RoomBridge::restoreInitialEntityState()
 {
     Room::restoreInitialEntityState();
 
-    for(Seat* s : getGameMap()->getSeats())
+    for(Seat* s : getGameMap()->getFloodFillLayerSeats())
         updateFloodFillPathCreated(s, getCoveredTiles());
 }
 
@@ -330,7 +330,7 @@ bool RoomBridge::removeCoveredTile(Tile* t)
     if(mClaimedValue > CLAIMED_VALUE_PER_TILE)
         mClaimedValue -= CLAIMED_VALUE_PER_TILE;
 
-    for(Seat* seat : getGameMap()->getSeats())
+    for(Seat* seat : getGameMap()->getFloodFillLayerSeats())
         updateFloodFillTileRemoved(seat, t);
 
     return true;
@@ -401,7 +401,7 @@ void RoomBridge::updateFloodFillPathCreated(Seat* seat, const std::vector<Tile*>
     {
         // We couldn't find any tile with ground floodfill. That's not normal as bridges
         // are supposed to be built from a ground claimed tile
-        OD_LOG_ERR("Couldn't find floodfill tile for bridge=" + getName() + ", seatId=" + Helper::toString(seat->getId()));
+        OD_LOG_ERR("Couldn't find floodfill tile for bridge=" + getName() + ", seatId=" + std::string(seat == nullptr ? "-1" : Helper::toString(seat->getId())));
         return;
     }
 
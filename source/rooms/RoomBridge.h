@@ -69,6 +69,7 @@ protected:
     virtual void exportToStream(std::ostream& os) const override;
     virtual bool importFromStream(std::istream& is) override;
 
+    //! \brief Updates the floodfill layer of the given seat (the base layer if nullptr, see GameMap::getFloodFillLayerSeats)
     virtual void updateFloodFillPathCreated(Seat* seat, const std::vector<Tile*>& tiles);
     virtual void updateFloodFillTileRemoved(Seat* seat, Tile* tile) = 0;
 
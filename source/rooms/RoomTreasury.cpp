@@ -237,7 +237,10 @@ static const int maxGoldinTile = 1000;
 
 RoomTreasury::RoomTreasury(GameMap* gameMap) :
     Room(gameMap),
-    mGoldChanged(false)
+    mGoldChanged(false),
+    mIsSeatGoldCounted(false),
+    mSeatGoldCounted(0),
+    mSeatGoldMaxCounted(0)
 {
     setMeshName("Treasury");
 }
@@ -287,7 +290,58 @@ bool RoomTreasury::removeCoveredTile(Tile* t)
 
     roomTreasuryTileData->mMeshOfTile.clear();
     roomTreasuryTileData->mGoldInTile = 0;
-    return Room::removeCoveredTile(t);
+    bool ret = Room::removeCoveredTile(t);
+    refreshSeatGold();
+    return ret;
+}
+
+void RoomTreasury::addToGameMap()
+{
+    Room::addToGameMap();
+    mIsSeatGoldCounted = true;
+    refreshSeatGold();
+}
+
+void RoomTreasury::removeFromGameMap()
+{
+    Room::removeFromGameMap();
+    mIsSeatGoldCounted = false;
+    refreshSeatGold();
+}
+
+void RoomTreasury::absorbRoom(Room* r)
+{
+    Room::absorbRoom(r);
+    // The absorbed treasury has no covered tile anymore. Its gold is now in this one
+    refreshSeatGold();
+    static_cast<RoomTreasury*>(r)->refreshSeatGold();
+}
+
+void RoomTreasury::repairRoom()
+{
+    Room::repairRoom();
+    refreshSeatGold();
+}
+
+void RoomTreasury::refreshSeatGold()
+{
+    if(!getIsOnServerMap())
+        return;
+
+    if(getSeat() == nullptr)
+        return;
+
+    int gold = 0;
+    int goldMax = 0;
+    if(mIsSeatGoldCounted)
+    {
+        gold = getTotalGoldStored();
+        goldMax = getTotalGoldStorage();
+    }
+
+    getSeat()->addGoldStored(gold - mSeatGoldCounted, goldMax - mSeatGoldMaxCounted);
+    mSeatGoldCounted = gold;
+    mSeatGoldMaxCounted = goldMax;
 }
 
 int RoomTreasury::getTotalGoldStorage() const
@@ -299,9 +353,10 @@ int RoomTreasury::getTotalGoldStored() const
 {
     int totalGold = 0;
 
-    for (const std::pair<Tile* const, TileData*>& p : mTileData)
+    // Tiles that have been absorbed by another treasury keep their data but are not covered anymore
+    for (Tile* tile : mCoveredTiles)
     {
-        RoomTreasuryTileData* roomTreasuryTileData = static_cast<RoomTreasuryTileData*>(p.second);
+        RoomTreasuryTileData* roomTreasuryTileData = static_cast<RoomTreasuryTileData*>(mTileData.at(tile));
         totalGold += roomTreasuryTileData->mGoldInTile;
     }
 
@@ -344,6 +399,7 @@ int RoomTreasury::depositGold(int gold, Tile *tile)
         return wasDeposited;
 
     mGoldChanged = true;
+    refreshSeatGold();
 
     // Tells the client to play a deposit gold sound. For now, we only send it to the players
     // with vision on tile
@@ -377,6 +433,7 @@ int RoomTreasury::withdrawGold(int gold)
         }
     }
 
+    refreshSeatGold();
     return withdrawlAmount;
 }
 
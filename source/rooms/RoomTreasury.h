@@ -56,6 +56,10 @@ public:
 
     // Functions overriding virtual functions in the Room base class.
     bool removeCoveredTile(Tile* t);
+    void addToGameMap() override;
+    void removeFromGameMap() override;
+    void absorbRoom(Room* r) override;
+    void repairRoom() override;
 
     // Functions specific to this class.
     virtual void doUpkeep();
@@ -83,7 +87,18 @@ protected:
 
 private:
     void updateMeshesForTile(Tile* tile, RoomTreasuryTileData* roomTreasuryTileData);
+
+    //! \brief Updates the gold of the seat with the changes in this treasury since the last call. Called
+    //! on server side each time the gold stored or the covered tiles change
+    void refreshSeatGold();
+
     bool mGoldChanged;
+
+    //! \brief True while the treasury is on the gamemap. Only treasuries on the gamemap count in the seat gold
+    bool mIsSeatGoldCounted;
+    //! \brief Gold and storage this treasury currently adds to its seat
+    int mSeatGoldCounted;
+    int mSeatGoldMaxCounted;
 };
 
 #endif // ROOMTREASURY_H
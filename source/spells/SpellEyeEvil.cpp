@@ -80,8 +80,19 @@ SpellEyeEvil::~SpellEyeEvil()
 {
 }
 
+void SpellEyeEvil::removeFromGameMap()
+{
+    if(getIsOnServerMap())
+        mVisionSource.clear();
+
+    Spell::removeFromGameMap();
+}
+
 void SpellEyeEvil::computeVisibleTiles()
 {
+    if(!mVisionSource.isEmpty())
+        return;
+
     uint32_t radius = ConfigManager::getSingleton().getSpellConfigUInt32("EyeEvilRadiusTiles");
     Tile* posTile = getPositionTile();
     if(posTile == nullptr)
@@ -90,9 +101,7 @@ void SpellEyeEvil::computeVisibleTiles()
         return;
     }
 
-    std::vector<Tile*> tiles = getGameMap()->circularRegion(posTile->getX(), posTile->getY(), radius);
-    for(Tile* tile : tiles)
-        tile->notifyVision(getSeat());
+    mVisionSource.setTiles({getSeat()}, getGameMap()->circularRegion(posTile->getX(), posTile->getY(), radius));
 }
 
 void SpellEyeEvil::checkSpellCast(GameMap* gameMap, const InputManager& inputManager, InputCommand& inputCommand)
@@ -18,6 +18,7 @@
 #ifndef SPELLEYEEVIL_H
 #define SPELLEYEEVIL_H
 
+#include "gamemap/VisionSource.h"
 #include "spells/Spell.h"
 #include "spells/SpellType.h"
 
@@ -34,6 +35,9 @@ public:
     SpellType getSpellType() const override
     { return SpellType::eyeEvil; }
 
+    void removeFromGameMap() override;
+
+    //! \brief The eye does not move so the vision it gives is only computed once
     void computeVisibleTiles() override;
 
     static void checkSpellCast(GameMap* gameMap, const InputManager& inputManager, InputCommand& inputCommand);
@@ -43,6 +47,9 @@ public:
     static Spell* getSpellFromPacket(GameMap* gameMap, ODPacket &is);
 
     static const SpellType mSpellType;
+
+private:
+    VisionSource mVisionSource;
 };
 
 #endif // SPELLEYEEVIL_H
@@ -16,6 +16,7 @@
  */
 
 #include "ODClientTest.h"
+#include "entities/GameEntityType.h"
 
 #include "game/SeatData.h"
 #include "network/ClientNotification.h"
@@ -388,6 +389,37 @@ bool ODClientTest::processMessage(ServerNotificationType cmd, ODPacket& packetRe
             send(packSend);
             return true;
         }
+        case ServerNotificationType::addEntity:
+        {
+            // Creatures and trap entities are exported with their network id, seat id and name first. Trap
+            // entities have their type in the headers
+            GameEntityType entityType;
+            BOOST_CHECK(packetReceived >> entityType);
+            if(entityType == GameEntityType::trapEntity)
+            {
+                int32_t trapEntityType;
+                BOOST_CHECK(packetReceived >> trapEntityType);
+            }
+            else if(entityType != GameEntityType::creature)
+                break;
+
+            uint32_t networkId;
+            int32_t seatId;
+            std::string entityName;
+            BOOST_CHECK(packetReceived >> networkId >> seatId >> entityName);
+            if(entityType == GameEntityType::creature)
+                mCreatureNames[networkId] = entityName;
+
+            entityAdded(entityType, seatId, entityName);
+            break;
+        }
+        case ServerNotificationType::removeEntity:
+        {
+            uint32_t networkId;
+            BOOST_CHECK(packetReceived >> networkId);
+            mCreatureNames.erase(networkId);
+            break;
+        }
         case ServerNotificationType::refreshPlayerSeat:
         {
             BOOST_CHECK(mPlayers[mLocalPlayerIndex].mSeat->importFromPacketForUpdate(packetReceived));
@@ -396,13 +428,13 @@ bool ODClientTest::processMessage(ServerNotificationType cmd, ODPacket& packetRe
         }
         case ServerNotificationType::setObjectAnimationState:
         {
-            std::string entityName;
+            uint32_t networkId;
             std::string animState;
             bool loop;
             bool playIdleWhenAnimationEnds;
             bool shouldSetWalkDirection;
             Ogre::Vector3 walkDirection(0, 0, 0);
-            BOOST_CHECK(packetReceived >> entityName >> animState
+            BOOST_CHECK(packetReceived >> networkId >> animState
                 >> loop >> playIdleWhenAnimationEnds >> shouldSetWalkDirection);
 
             if(shouldSetWalkDirection)
@@ -410,18 +442,18 @@ bool ODClientTest::processMessage(ServerNotificationType cmd, ODPacket& packetRe
                 BOOST_CHECK(packetReceived >> walkDirection);
             }
 
-            animationPlayed(entityName, animState, loop, playIdleWhenAnimationEnds, shouldSetWalkDirection, walkDirection);
+            animationPlayed(mCreatureNames[networkId], animState, loop, playIdleWhenAnimationEnds, shouldSetWalkDirection, walkDirection);
             break;
         }
         case ServerNotificationType::animatedObjectSetWalkPath:
         {
-            std::string entityName;
+            uint32_t networkId;
             std::string walkAnim;
             std::string endAnim;
             bool loopEndAnim;
             bool playIdleWhenAnimationEnds;
             uint32_t nbDest;
-            BOOST_CHECK(packetReceived >> entityName >> walkAnim >> endAnim);
+            BOOST_CHECK(packetReceived >> networkId >> walkAnim >> endAnim);
             BOOST_CHECK(packetReceived >> loopEndAnim >> playIdleWhenAnimationEnds >> nbDest);
             std::vector<Ogre::Vector3> path;
             while(nbDest)
@@ -433,6 +465,7 @@ bool ODClientTest::processMessage(ServerNotificationType cmd, ODPacket& packetRe
             }
 
             //! We want to make sure animationPlayed is played for both animations (if required)
+            const std::string& entityName = mCreatureNames[networkId];
             if(!walkAnim.empty())
                 animationPlayed(entityName, walkAnim, true, false, false, Ogre::Vector3::ZERO);
             if(!endAnim.empty())
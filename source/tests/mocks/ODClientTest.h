@@ -21,10 +21,13 @@
 
 #include "network/ODSocketClient.h"
 
+#include <map>
 #include <string>
 
 class SeatData;
 
+enum class GameEntityType;
+
 class PlayerInfo
 {
 public:
@@ -80,6 +83,10 @@ protected:
         bool loop, bool playIdleWhenAnimationEnds, bool shouldSetWalkDirection, const Ogre::Vector3& walkDirection)
     {}
 
+    //! \brief Called when the server adds a creature or a trap entity on the client map
+    virtual void entityAdded(GameEntityType type, int32_t seatId, const std::string& entityName)
+    {}
+
     //! \brief This boolean can be used in the handle* functions to stop the processing loop
     //! before the end of the timeout
     bool mContinueLoop;
@@ -90,6 +97,9 @@ private:
     std::vector<PlayerInfo> mPlayers;
     std::vector<SeatData*> mSeats;
     uint32_t mLocalPlayerIndex;
+    //! \brief Names of the creatures added by the server indexed by network id. Used
+    //! to give the entity name to animationPlayed
+    std::map<uint32_t, std::string> mCreatureNames;
 };
 
 #endif // ODCLIENTTEST_H
@@ -0,0 +1,146 @@
+/*
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define BOOST_TEST_MODULE CreatureUpdateValues
+#include "BoostTestTargetConfig.h"
+
+#include "entities/CreatureUpdateValues.h"
+#include "network/ODPacket.h"
+
+namespace
+{
+// The seats are only used as keys by CreatureUpdatesSent. They are never dereferenced
+int seatData0;
+int seatData1;
+const Seat* seat0 = reinterpret_cast<const Seat*>(&seatData0);
+const Seat* seat1 = reinterpret_cast<const Seat*>(&seatData1);
+
+CreatureUpdateValues getServerValues()
+{
+    CreatureUpdateValues values;
+    values.mLevel = 3;
+    values.mSeatId = 1;
+    values.mOverlayHealthValue = 5;
+    values.mMoodValue = 0x0004;
+    values.mGroundSpeed = 1.5;
+    values.mWaterSpeed = 0.5;
+    values.mLavaSpeed = 0.0;
+    values.mSpeedModifier = 1.0;
+    values.mSeatPrisonId = -1;
+    return values;
+}
+
+//! \brief Sends the given values to the client values like fireCreatureRefreshIfNeeded and
+//! Creature::updateFromPacket do. Returns the mask read by the client
+uint16_t sendUpdate(CreatureUpdatesSent& updatesSent, const Seat* seat, const CreatureUpdateValues& serverValues,
+    CreatureUpdateValues& clientValues)
+{
+    ODPacket packet;
+    serverValues.exportToPacket(packet, updatesSent.getFieldsToSend(seat, serverValues));
+    uint16_t fields = CreatureUpdateFields::Nothing;
+    BOOST_CHECK(clientValues.importFromPacket(packet, fields));
+    return fields;
+}
+}
+
+BOOST_AUTO_TEST_CASE(test_FullThenPartialUpdate)
+{
+    CreatureUpdatesSent updatesSent;
+    CreatureUpdateValues serverValues = getServerValues();
+    CreatureUpdateValues clientValues;
+
+    // The first update contains every field
+    BOOST_CHECK(sendUpdate(updatesSent, seat0, serverValues, clientValues) == CreatureUpdateFields::All);
+    BOOST_CHECK(clientValues.getChangedFields(serverValues) == CreatureUpdateFields::Nothing);
+
+    // Nothing changed: only the empty mask is sent
+    BOOST_CHECK(sendUpdate(updatesSent, seat0, serverValues, clientValues) == CreatureUpdateFields::Nothing);
+    BOOST_CHECK(clientValues.getChangedFields(serverValues) == CreatureUpdateFields::Nothing);
+
+    // Only the changed fields are sent
+    serverValues.mMoodValue = 0x0001;
+    serverValues.mSpeedModifier = 0.5;
+    serverValues.mSeatPrisonId = 2;
+    const uint16_t expectedFields = CreatureUpdateFields::Mood | CreatureUpdateFields::SpeedModifier
+        | CreatureUpdateFields::SeatPrisonId;
+    CreatureUpdateValues clientValuesBefore = clientValues;
+    BOOST_CHECK(sendUpdate(updatesSent, seat0, serverValues, clientValues) == expectedFields);
+    BOOST_CHECK(clientValues.getChangedFields(clientValuesBefore) == expectedFields);
+    BOOST_CHECK(clientValues.getChangedFields(serverValues) == CreatureUpdateFields::Nothing);
+}
+
+BOOST_AUTO_TEST_CASE(test_PartialUpdateOnlyChangesMaskedFields)
+{
+    CreatureUpdateValues serverValues = getServerValues();
+    serverValues.mLevel = 4;
+    serverValues.mGroundSpeed = 2.0;
+
+    // The client values that are not in the mask are kept even if they differ from the server ones
+    CreatureUpdateValues clientValues;
+    clientValues.mSeatId = 7;
+    clientValues.mOverlayHealthValue = 2;
+    CreatureUpdateValues clientValuesBefore = clientValues;
+
+    ODPacket packet;
+    serverValues.exportToPacket(packet, CreatureUpdateFields::Level | CreatureUpdateFields::GroundSpeed);
+    uint16_t fields = CreatureUpdateFields::Nothing;
+    BOOST_CHECK(clientValues.importFromPacket(packet, fields));
+    BOOST_CHECK(fields == (CreatureUpdateFields::Level | CreatureUpdateFields::GroundSpeed));
+    BOOST_CHECK(clientValues.mLevel == 4);
+    BOOST_CHECK(clientValues.mGroundSpeed == 2.0);
+    BOOST_CHECK(clientValues.getChangedFields(clientValuesBefore) == fields);
+    BOOST_CHECK(clientValues.mSeatId == 7);
+    BOOST_CHECK(clientValues.mOverlayHealthValue == 2);
+
+    // The whole update was read
+    uint8_t remaining;
+    BOOST_CHECK(!(packet >> remaining));
+
+    // A truncated update is reported
+    ODPacket truncated;
+    truncated << static_cast<uint16_t>(CreatureUpdateFields::Level | CreatureUpdateFields::SeatId);
+    truncated << serverValues.mLevel;
+    BOOST_CHECK(!clientValues.importFromPacket(truncated, fields));
+}
+
+BOOST_AUTO_TEST_CASE(test_SeatRemovedResetsToFullUpdate)
+{
+    CreatureUpdatesSent updatesSent;
+    CreatureUpdateValues serverValues = getServerValues();
+    CreatureUpdateValues clientValues0;
+    CreatureUpdateValues clientValues1;
+
+    BOOST_CHECK(sendUpdate(updatesSent, seat0, serverValues, clientValues0) == CreatureUpdateFields::All);
+    BOOST_CHECK(sendUpdate(updatesSent, seat1, serverValues, clientValues1) == CreatureUpdateFields::All);
+
+    // The client of seat 0 removes the creature (Creature::fireRemoveEntity). When it is added again, its client
+    // starts from default values so the next update should contain every field
+    updatesSent.seatRemoved(seat0);
+    serverValues.mOverlayHealthValue = 3;
+    CreatureUpdateValues newClientValues0;
+    BOOST_CHECK(sendUpdate(updatesSent, seat0, serverValues, newClientValues0) == CreatureUpdateFields::All);
+    BOOST_CHECK(newClientValues0.getChangedFields(serverValues) == CreatureUpdateFields::Nothing);
+
+    // The other seats are not affected
+    BOOST_CHECK(sendUpdate(updatesSent, seat1, serverValues, clientValues1) == CreatureUpdateFields::OverlayHealth);
+    BOOST_CHECK(clientValues1.getChangedFields(serverValues) == CreatureUpdateFields::Nothing);
+
+    // Once the full update is sent, the next ones are partial again
+    serverValues.mLevel = 5;
+    BOOST_CHECK(sendUpdate(updatesSent, seat0, serverValues, newClientValues0) == CreatureUpdateFields::Level);
+    BOOST_CHECK(newClientValues0.getChangedFields(serverValues) == CreatureUpdateFields::Nothing);
+}
@@ -0,0 +1,72 @@
+/*
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "utils/JobSystem.h"
+
+#define BOOST_TEST_MODULE JobSystem
+#include "BoostTestTargetConfig.h"
+
+#include <vector>
+
+BOOST_AUTO_TEST_CASE(test_JobSystem)
+{
+    JobSystem jobSystem(4);
+    BOOST_CHECK(jobSystem.getNbThreads() == 4);
+
+    // Every index should be processed exactly once, whatever the thread running it
+    for(uint32_t count : {0u, 1u, 7u, 100u, 1000u})
+    {
+        std::vector<uint32_t> values(count, 0);
+        jobSystem.parallelFor(count, 7, [&values](uint32_t index)
+        {
+            values[index] += index + 1;
+        });
+
+        for(uint32_t index = 0; index < count; ++index)
+            BOOST_CHECK(values[index] == index + 1);
+    }
+
+    // Without worker, the jobs are run by the calling thread
+    JobSystem singleThread(1);
+    uint32_t sum = 0;
+    singleThread.parallelFor(10, 3, [&sum](uint32_t index)
+    {
+        sum += index;
+    });
+    BOOST_CHECK(sum == 45);
+
+    // The random numbers drawn by the jobs do not depend on the number of threads
+    std::vector<int> values4(100, 0);
+    std::vector<int> values1(100, 0);
+    RandomStream random4(12);
+    RandomStream random1(12);
+    {
+        Random::ScopedStream scope(random4);
+        jobSystem.parallelFor(100, 8, [&values4](uint32_t index)
+        {
+            values4[index] = Random::Int(0, 1000000);
+        });
+    }
+    {
+        Random::ScopedStream scope(random1);
+        singleThread.parallelFor(100, 8, [&values1](uint32_t index)
+        {
+            values1[index] = Random::Int(0, 1000000);
+        });
+    }
+    BOOST_CHECK(values4 == values1);
+}
@@ -20,6 +20,8 @@
 
 #include "network/ODPacket.h"
 
+#include <limits>
+
 BOOST_AUTO_TEST_CASE(test_ODPacket)
 {
     //Test input/output
@@ -53,4 +55,113 @@ BOOST_AUTO_TEST_CASE(test_ODPacket)
         BOOST_CHECK(inInt == outInt);
 
     }
+    //Test sub packets
+    {
+        ODPacket packet1;
+        ODPacket packet2;
+        const int32_t inInt = 42;
+        const std::string inString("sub");
+        packet1 << inInt;
+        packet2 << inString;
+        ODPacket frame;
+        frame << inInt;
+        frame.appendSubPacket(packet1);
+        frame.appendSubPacket(packet2);
+
+        int32_t outInt = 0;
+        frame >> outInt;
+        BOOST_CHECK(outInt == inInt);
+        ODPacket outPacket;
+        BOOST_CHECK(frame.extractSubPacket(outPacket));
+        outInt = 0;
+        BOOST_CHECK(outPacket >> outInt);
+        BOOST_CHECK(outInt == inInt);
+        BOOST_CHECK(outPacket.endOfPacket());
+        BOOST_CHECK(!frame.endOfPacket());
+        BOOST_CHECK(frame.extractSubPacket(outPacket));
+        std::string outString;
+        BOOST_CHECK(outPacket >> outString);
+        BOOST_CHECK(inString.compare(outString) == 0);
+        BOOST_CHECK(frame.endOfPacket());
+        BOOST_CHECK(!frame.extractSubPacket(outPacket));
+    }
+    //Test integer limits
+    {
+        ODPacket packet;
+        packet << std::numeric_limits<int16_t>::min() << std::numeric_limits<uint16_t>::max()
+            << std::numeric_limits<int32_t>::min() << std::numeric_limits<int32_t>::max()
+            << std::numeric_limits<uint32_t>::max() << std::numeric_limits<int64_t>::min()
+            << std::numeric_limits<int64_t>::max() << std::numeric_limits<uint64_t>::max();
+        int16_t outInt16 = 0;
+        uint16_t outUint16 = 0;
+        int32_t outInt32Min = 0;
+        int32_t outInt32Max = 0;
+        uint32_t outUint32 = 0;
+        int64_t outInt64Min = 0;
+        int64_t outInt64Max = 0;
+        uint64_t outUint64 = 0;
+        BOOST_CHECK(packet >> outInt16 >> outUint16 >> outInt32Min >> outInt32Max >> outUint32
+            >> outInt64Min >> outInt64Max >> outUint64);
+        BOOST_CHECK(outInt16 == std::numeric_limits<int16_t>::min());
+        BOOST_CHECK(outUint16 == std::numeric_limits<uint16_t>::max());
+        BOOST_CHECK(outInt32Min == std::numeric_limits<int32_t>::min());
+        BOOST_CHECK(outInt32Max == std::numeric_limits<int32_t>::max());
+        BOOST_CHECK(outUint32 == std::numeric_limits<uint32_t>::max());
+        BOOST_CHECK(outInt64Min == std::numeric_limits<int64_t>::min());
+        BOOST_CHECK(outInt64Max == std::numeric_limits<int64_t>::max());
+        BOOST_CHECK(outUint64 == std::numeric_limits<uint64_t>::max());
+        BOOST_CHECK(packet.endOfPacket());
+
+        // Small values only take 1 byte
+        packet.clear();
+        const int32_t smallInt = -3;
+        const uint32_t smallUint = 100;
+        packet << smallInt << smallUint;
+        BOOST_CHECK(packet.getDataSize() == 2);
+
+        // A value too big for the read type invalidates the packet
+        packet.clear();
+        const uint32_t bigUint = 70000;
+        packet << bigUint;
+        BOOST_CHECK(!(packet >> outUint16));
+        BOOST_CHECK(!packet);
+    }
+    //Test repeated strings
+    {
+        ODPacket packet;
+        const std::string inString1("Kobold_Idle");
+        const std::string inString2("Kobold_Walk");
+        const std::string emptyString;
+        packet << inString1 << inString2 << inString1 << emptyString << inString1.c_str();
+        ODPacket copy(packet);
+        // The last occurrences are only references
+        BOOST_CHECK(packet.getDataSize() < 3 * inString1.size() + inString2.size());
+        std::string outString1;
+        std::string outString2;
+        std::string outString3;
+        std::string outString4;
+        char outString5[32];
+        BOOST_CHECK(packet >> outString1 >> outString2 >> outString3 >> outString4 >> outString5);
+        BOOST_CHECK(outString1 == inString1);
+        BOOST_CHECK(outString2 == inString2);
+        BOOST_CHECK(outString3 == inString1);
+        BOOST_CHECK(outString4.empty());
+        BOOST_CHECK(inString1.compare(outString5) == 0);
+
+        // Sub packets have their own strings
+        ODPacket frame;
+        frame << inString1;
+        frame.appendSubPacket(packet);
+        BOOST_CHECK(frame >> outString1);
+        BOOST_CHECK(outString1 == inString1);
+        ODPacket outPacket;
+        BOOST_CHECK(frame.extractSubPacket(outPacket));
+        BOOST_CHECK(outPacket >> outString1 >> outString2 >> outString3);
+        BOOST_CHECK(outString3 == inString1);
+
+        // A copy can be read like the original
+        packet.clear();
+        BOOST_CHECK(copy >> outString1 >> outString2 >> outString3);
+        BOOST_CHECK(outString3 == inString1);
+    }
 }
@@ -18,7 +18,12 @@
 #define BOOST_TEST_MODULE Random
 #include "BoostTestTargetConfig.h"
 
+#include "gamemap/FloodFillForest.h"
+#include "gamemap/FlowField.h"
+#include "gamemap/HierarchicalPathfinding.h"
+#include "gamemap/PathCache.h"
 #include "gamemap/Pathfinding.h"
+#include "gamemap/PathfindingArena.h"
 
 struct Point
 {
@@ -39,3 +44,233 @@ BOOST_AUTO_TEST_CASE(test_Pathfinding)
     BOOST_CHECK((Pathfinding::distanceTile(a, b) - std::sqrt(128.0f)) < 0.0001f);
     BOOST_CHECK(Pathfinding::squaredDistance(9,1,1,9) == 128);
 }
+
+BOOST_AUTO_TEST_CASE(test_PathfindingArena)
+{
+    PathfindingArena arena;
+    arena.startSearch(4, 3);
+    BOOST_CHECK(arena.toIndex(3, 2) == 11);
+    BOOST_CHECK(arena.indexToX(11) == 3);
+    BOOST_CHECK(arena.indexToY(11) == 2);
+
+    // Nodes are popped by cost. Nodes with the same cost are popped in the order they were pushed
+    arena.open(arena.toIndex(0, 0), 0.0, 5.0, PathfindingArena::NO_INDEX);
+    arena.open(arena.toIndex(1, 0), 1.0, 2.0, arena.toIndex(0, 0));
+    arena.open(arena.toIndex(2, 0), 2.0, 1.0, arena.toIndex(1, 0));
+    arena.open(arena.toIndex(3, 0), 1.0, 1.0, arena.toIndex(0, 0));
+    BOOST_CHECK(arena.isReached(arena.toIndex(2, 0)));
+    BOOST_CHECK(!arena.isReached(arena.toIndex(0, 1)));
+
+    BOOST_CHECK(arena.popBest() == arena.toIndex(3, 0));
+    BOOST_CHECK(arena.isClosed(arena.toIndex(3, 0)));
+    // A decreased node is handled as if it was pushed last
+    arena.decreaseCost(arena.toIndex(0, 0), 0.0, 3.0, PathfindingArena::NO_INDEX);
+    BOOST_CHECK(arena.popBest() == arena.toIndex(1, 0));
+    BOOST_CHECK(arena.popBest() == arena.toIndex(2, 0));
+    BOOST_CHECK(arena.popBest() == arena.toIndex(0, 0));
+    BOOST_CHECK(arena.isOpenListEmpty());
+
+    std::vector<int32_t> indexes;
+    arena.buildPath(arena.toIndex(2, 0), indexes);
+    BOOST_CHECK(indexes.size() == 3);
+    BOOST_CHECK(indexes[0] == arena.toIndex(0, 0));
+    BOOST_CHECK(indexes[2] == arena.toIndex(2, 0));
+
+    // A new search invalidates the previous nodes
+    arena.startSearch(4, 3);
+    BOOST_CHECK(!arena.isReached(arena.toIndex(2, 0)));
+}
+
+BOOST_AUTO_TEST_CASE(test_HierarchicalPathfinding)
+{
+    // 32x32 map split in 8x8 clusters. A wall on x=16 can only be crossed at (16, 30)
+    HierarchicalPathfinding hpa(1, 8);
+    hpa.init(32, 32);
+    for(int y = 0; y < 32; ++y)
+    {
+        for(int x = 0; x < 32; ++x)
+            hpa.setTilePassability(x, y, (x == 16 && y != 30) ? 0 : 1);
+    }
+    BOOST_CHECK(hpa.isTilePassable(16, 30, 0));
+    BOOST_CHECK(!hpa.isTilePassable(16, 2, 0));
+
+    std::vector<int32_t> path;
+    // Tiles in the same cluster should use the full search
+    BOOST_CHECK(!hpa.findPath(1, 1, 6, 6, 0, path));
+
+    BOOST_REQUIRE(hpa.findPath(2, 2, 30, 2, 0, path));
+    BOOST_CHECK(hpa.getNbDirtyClusters() == 0);
+    BOOST_CHECK(hpa.indexToX(path.front()) == 2 && hpa.indexToY(path.front()) == 2);
+    BOOST_CHECK(hpa.indexToX(path.back()) == 30 && hpa.indexToY(path.back()) == 2);
+    bool gapUsed = false;
+    for(uint32_t i = 0; i < path.size(); ++i)
+    {
+        int x = hpa.indexToX(path[i]);
+        int y = hpa.indexToY(path[i]);
+        BOOST_CHECK(hpa.isTilePassable(x, y, 0));
+        if(x == 16 && y == 30)
+            gapUsed = true;
+        if(i == 0)
+            continue;
+
+        int dist = std::abs(x - hpa.indexToX(path[i - 1])) + std::abs(y - hpa.indexToY(path[i - 1]));
+        BOOST_CHECK(dist == 1);
+    }
+    BOOST_CHECK(gapUsed);
+
+    // Blocking the gap (like a locked door) should prevent any path
+    hpa.setTileBlocked(16, 30, true);
+    BOOST_CHECK(hpa.getNbDirtyClusters() == 1);
+    BOOST_CHECK(!hpa.findPath(2, 2, 30, 2, 0, path));
+    hpa.setTileBlocked(16, 30, false);
+    BOOST_CHECK(hpa.findPath(2, 2, 30, 2, 0, path));
+
+    // Same when the gap is not passable anymore
+    hpa.setTilePassability(16, 30, 0);
+    BOOST_CHECK(!hpa.findPath(2, 2, 30, 2, 0, path));
+}
+
+BOOST_AUTO_TEST_CASE(test_PathCache)
+{
+    // 16x16 map split in 4x4 regions with room for 2 paths
+    PathCache cache(2, 4);
+    cache.init(16, 16);
+
+    PathCache::Key key1{0, 3, 1.0, 0.0, 0.0, 1, false};
+    PathCache::Key key2 = key1;
+    key2.mDestination = 48;
+    PathCache::Key key3 = key1;
+    key3.mSpeedWater = 0.5;
+
+    std::vector<int32_t> path;
+    BOOST_CHECK(!cache.get(key1, path));
+    cache.put(key1, {0, 1, 2, 3});
+    cache.put(key2, {0, 16, 32, 48});
+    BOOST_CHECK(cache.get(key1, path));
+    BOOST_CHECK(path.size() == 4);
+    BOOST_CHECK(path[3] == 3);
+    // Creatures that move differently do not share paths
+    BOOST_CHECK(!cache.get(key3, path));
+    BOOST_CHECK(cache.getNbHits() == 1);
+    BOOST_CHECK(cache.getNbMisses() == 2);
+
+    // key2 is the least recently used entry. It should be dropped
+    cache.put(key3, {0, 1, 2, 3});
+    BOOST_CHECK(cache.getNbEntries() == 2);
+    BOOST_CHECK(!cache.get(key2, path));
+    BOOST_CHECK(cache.get(key1, path));
+
+    // A change far from the path does not invalidate it
+    cache.tileChanged(12, 12, false);
+    BOOST_CHECK(cache.get(key1, path));
+    // A change next to the path in another region does (it could block a diagonal)
+    cache.tileChanged(4, 1, false);
+    BOOST_CHECK(!cache.get(key1, path));
+    BOOST_CHECK(!cache.get(key3, path));
+    BOOST_CHECK(cache.getNbEntries() == 0);
+}
+
+BOOST_AUTO_TEST_CASE(test_PathCacheShortcut)
+{
+    // 16x16 map split in 2x2 regions. A wall on x=4 from y=0 to y=11 forces the path from (0, 0)
+    // to (8, 0) to go around it through y=12
+    PathCache cache(4, 2);
+    cache.init(16, 16);
+    PathCache::Key key{0, 8, 1.0, 0.0, 0.0, 1, false};
+
+    std::vector<int32_t> detour;
+    for(int y = 0; y < 12; ++y)
+        detour.push_back(y * 16);
+    for(int x = 0; x <= 8; ++x)
+        detour.push_back(12 * 16 + x);
+    for(int y = 11; y >= 0; --y)
+        detour.push_back(y * 16 + 8);
+    cache.put(key, detour);
+
+    std::vector<int32_t> path;
+    // Closing a tile away from the path cannot make it shorter or invalid
+    cache.tileChanged(12, 4, false);
+    BOOST_CHECK(cache.get(key, path));
+    BOOST_CHECK(path.size() == detour.size());
+
+    // Opening the wall at (4, 0) is far from the path but allows a much shorter one. The detour
+    // should not be returned anymore
+    cache.tileChanged(4, 0, true);
+    BOOST_CHECK(!cache.get(key, path));
+
+    std::vector<int32_t> shortcut;
+    for(int x = 0; x <= 8; ++x)
+        shortcut.push_back(x);
+    cache.put(key, shortcut);
+    BOOST_REQUIRE(cache.get(key, path));
+    BOOST_CHECK(path.size() == 9);
+    BOOST_CHECK(path.back() == 8);
+}
+
+BOOST_AUTO_TEST_CASE(test_FlowField)
+{
+    // Reverse search from (3, 0) on a 4x2 map where only the first row is reached
+    PathfindingArena arena;
+    arena.startSearch(4, 2);
+    arena.open(arena.toIndex(3, 0), 0.0, 0.0, PathfindingArena::NO_INDEX);
+    arena.open(arena.toIndex(2, 0), 1.0, 0.0, arena.toIndex(3, 0));
+    arena.open(arena.toIndex(1, 0), 2.0, 0.0, arena.toIndex(2, 0));
+    arena.open(arena.toIndex(0, 0), 3.0, 0.0, arena.toIndex(1, 0));
+
+    FlowField flowField;
+    flowField.setFromArena(arena, 4, 2, arena.toIndex(3, 0));
+    BOOST_CHECK(flowField.getTarget() == 3);
+    BOOST_CHECK(flowField.getNext(1) == 2);
+    BOOST_CHECK(flowField.getCost(0) == 3.0);
+    BOOST_CHECK(!flowField.isReached(arena.toIndex(1, 1)));
+    BOOST_CHECK(flowField.isTileUsed(1, 1));
+
+    std::vector<int32_t> indexes;
+    BOOST_CHECK(flowField.buildPath(0, indexes));
+    BOOST_CHECK(indexes.size() == 4);
+    BOOST_CHECK(indexes.front() == 0);
+    BOOST_CHECK(indexes.back() == 3);
+    BOOST_CHECK(!flowField.buildPath(arena.toIndex(1, 1), indexes));
+    BOOST_CHECK(indexes.empty());
+}
+
+BOOST_AUTO_TEST_CASE(test_FloodFillForest)
+{
+    FloodFillForest forest;
+    // Colors never merged are their own representative
+    BOOST_CHECK(forest.find(7) == 7);
+    BOOST_CHECK(forest.find(3, 7) == 7);
+
+    forest.merge(1, 2);
+    forest.merge(3, 4);
+    BOOST_CHECK(forest.find(1) == forest.find(2));
+    BOOST_CHECK(forest.find(1) != forest.find(3));
+    forest.merge(2, 4);
+    BOOST_CHECK(forest.find(1) == forest.find(3));
+    BOOST_CHECK(forest.find(5) == 5);
+
+    // Teams without overlay use the base forest
+    BOOST_CHECK(!forest.hasOverlay(1));
+    BOOST_CHECK(forest.find(1, 1) == forest.find(1, 3));
+
+    // A team merge creates the overlay from the base forest and does not change the other teams
+    forest.merge(1, 5, 6);
+    BOOST_CHECK(forest.hasOverlay(1));
+    BOOST_CHECK(forest.find(1, 5) == forest.find(1, 6));
+    BOOST_CHECK(forest.find(1, 1) == forest.find(1, 3));
+    BOOST_CHECK(forest.find(0, 5) != forest.find(0, 6));
+    BOOST_CHECK(forest.find(5) != forest.find(6));
+
+    // Base merges done after the overlay creation do not change it
+    forest.merge(7, 8);
+    BOOST_CHECK(forest.find(0, 7) == forest.find(0, 8));
+    BOOST_CHECK(forest.find(1, 7) != forest.find(1, 8));
+
+    forest.removeOverlay(1);
+    BOOST_CHECK(!forest.hasOverlay(1));
+    BOOST_CHECK(forest.find(1, 5) != forest.find(1, 6));
+    BOOST_CHECK(forest.find(1, 7) == forest.find(1, 8));
+
+    forest.clear();
+    BOOST_CHECK(forest.find(4) == 4);
+}
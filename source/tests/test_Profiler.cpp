@@ -0,0 +1,72 @@
+/*
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "utils/Profiler.h"
+#include "utils/LogManager.h"
+#include "utils/LogSinkConsole.h"
+
+#define BOOST_TEST_MODULE Profiler
+#include "BoostTestTargetConfig.h"
+
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+BOOST_AUTO_TEST_CASE(test_Profiler)
+{
+    LogManager logMgr;
+    logMgr.addSink(std::unique_ptr<LogSink>(new LogSinkConsole()));
+
+    const std::string traceFile = "test_Profiler.json";
+
+    // Nothing is recorded while the profiler is disabled
+    BOOST_CHECK(!Profiler::isEnabled());
+    BOOST_CHECK(Profiler::startTrace(traceFile));
+    {
+        OD_PROFILE_ZONE("disabledZone");
+    }
+    Profiler::endTurn(0);
+
+    // Zones are recorded from every thread
+    Profiler::setEnabled(true);
+    {
+        OD_PROFILE_ZONE("mainZone");
+        std::thread thread([]()
+        {
+            OD_PROFILE_ZONE("workerZone");
+        });
+        thread.join();
+    }
+    Profiler::endTurn(1);
+    Profiler::logSummary();
+    Profiler::stopTrace();
+    Profiler::setEnabled(false);
+
+    std::ifstream file(traceFile);
+    std::stringstream content;
+    content << file.rdbuf();
+    const std::string trace = content.str();
+    BOOST_CHECK(trace.find("{\"traceEvents\":[") == 0);
+    BOOST_CHECK(trace.find("\"name\":\"mainZone\"") != std::string::npos);
+    BOOST_CHECK(trace.find("\"name\":\"workerZone\"") != std::string::npos);
+    BOOST_CHECK(trace.find("\"name\":\"turn 1\"") != std::string::npos);
+    BOOST_CHECK(trace.find("disabledZone") == std::string::npos);
+    BOOST_CHECK(trace.find("]}") != std::string::npos);
+
+    // The main thread and the worker thread record in different buffers
+    BOOST_CHECK(trace.find("\"tid\":1") != std::string::npos);
+}
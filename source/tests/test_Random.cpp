@@ -25,3 +25,36 @@ BOOST_AUTO_TEST_CASE(test_Random)
     Random::initialize();
     BOOST_CHECK (Random::Int(1, 2 ) <= 2);
 }
+
+BOOST_AUTO_TEST_CASE(test_RandomStream)
+{
+    // Same seed, same numbers
+    RandomStream stream1(42);
+    RandomStream stream2(42);
+    for(int i = 0; i < 100; ++i)
+        BOOST_CHECK(stream1.next() == stream2.next());
+
+    for(int i = 0; i < 1000; ++i)
+    {
+        int valInt = stream1.Int(-3, 3);
+        BOOST_CHECK(valInt >= -3 && valInt <= 3);
+        unsigned int valUint = stream1.Uint(5, 2);
+        BOOST_CHECK(valUint >= 2 && valUint <= 5);
+        double valDouble = stream1.Double(-1.0, 1.0);
+        BOOST_CHECK(valDouble >= -1.0 && valDouble < 1.0);
+    }
+
+    // Split streams do not give the numbers of their parent
+    RandomStream parent(7);
+    RandomStream child = parent.split();
+    BOOST_CHECK(child.next() != parent.next());
+
+    // The Random functions draw from the bound stream
+    RandomStream bound(123);
+    RandomStream expected(123);
+    {
+        Random::ScopedStream scope(bound);
+        BOOST_CHECK(Random::Int(0, 1000000) == expected.Int(0, 1000000));
+    }
+    BOOST_CHECK(&Random::getCurrentStream() != &bound);
+}
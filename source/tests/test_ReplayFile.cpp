@@ -0,0 +1,148 @@
+/*
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define BOOST_TEST_MODULE ReplayFile
+#include "BoostTestTargetConfig.h"
+
+#include "network/ODPacket.h"
+#include "network/ReplayFile.h"
+
+#include <cstdio>
+#include <fstream>
+
+namespace
+{
+const std::string REPLAY_FILENAME = "test_ReplayFile.odr";
+
+//! \brief Writes 10 turns with a message per turn and a keyframe every 4 turns
+void writeReplay()
+{
+    ReplayWriter writer;
+    BOOST_CHECK(writer.open(REPLAY_FILENAME));
+    for(int64_t turn = 0; turn < 10; ++turn)
+    {
+        int32_t timestamp = static_cast<int32_t>(turn * 100);
+        ODPacket message;
+        message << turn;
+        writer.writeMessage(timestamp, message);
+        if((turn % 4) != 0)
+            continue;
+
+        ODPacket keyframe;
+        std::string state("state");
+        keyframe << state << turn;
+        writer.writeKeyframe(turn, timestamp, keyframe);
+    }
+    writer.close();
+}
+
+//! \brief Reads the next records until the message of the given turn. Returns false if not found
+bool readUntilMessage(ReplayReader& reader, int64_t turn)
+{
+    ReplayRecordType type;
+    int32_t timestamp;
+    ODPacket packet;
+    while(reader.readRecord(type, timestamp, packet))
+    {
+        if(type != ReplayRecordType::message)
+            continue;
+
+        int64_t messageTurn;
+        if(!(packet >> messageTurn))
+            return false;
+
+        if(messageTurn == turn)
+            return timestamp == turn * 100;
+    }
+    return false;
+}
+}
+
+BOOST_AUTO_TEST_CASE(test_ReplayFile)
+{
+    //Test reading the replay from the beginning
+    {
+        writeReplay();
+        ReplayReader reader;
+        BOOST_CHECK(reader.open(REPLAY_FILENAME));
+        BOOST_CHECK(reader.getKeyframes().size() == 3);
+        BOOST_CHECK(readUntilMessage(reader, 0));
+        BOOST_CHECK(readUntilMessage(reader, 9));
+        ReplayRecordType type;
+        int32_t timestamp;
+        ODPacket packet;
+        BOOST_CHECK(!reader.readRecord(type, timestamp, packet));
+    }
+    //Test seeking
+    {
+        ReplayReader reader;
+        BOOST_CHECK(reader.open(REPLAY_FILENAME));
+        const ReplayKeyframe* keyframe = reader.seekKeyframe(7);
+        BOOST_CHECK(keyframe != nullptr);
+        BOOST_CHECK(keyframe->mTurn == 4);
+        ReplayRecordType type;
+        int32_t timestamp;
+        ODPacket packet;
+        BOOST_CHECK(reader.readRecord(type, timestamp, packet));
+        BOOST_CHECK(type == ReplayRecordType::keyframe);
+        BOOST_CHECK(timestamp == 400);
+        std::string state;
+        int64_t turn;
+        BOOST_CHECK(packet >> state >> turn);
+        BOOST_CHECK(turn == 4);
+        BOOST_CHECK(readUntilMessage(reader, 5));
+
+        // We can go back
+        keyframe = reader.seekKeyframe(0);
+        BOOST_CHECK(keyframe != nullptr);
+        BOOST_CHECK(keyframe->mTurn == 0);
+        BOOST_CHECK(readUntilMessage(reader, 1));
+        BOOST_CHECK(reader.seekKeyframe(-1) == nullptr);
+    }
+    //Test a replay that was not closed properly: we cut the index and a part of the last record
+    {
+        std::ifstream is(REPLAY_FILENAME, std::ios::in | std::ios::binary);
+        std::string data((std::istreambuf_iterator<char>(is)), std::istreambuf_iterator<char>());
+        is.close();
+        std::ofstream os(REPLAY_FILENAME, std::ios::out | std::ios::binary | std::ios::trunc);
+        // Index (3 keyframes), trailer and the 2 last bytes of the last message
+        os.write(data.data(), data.size() - 3 * 20 - 16 - 2);
+        os.close();
+
+        ReplayReader reader;
+        BOOST_CHECK(reader.open(REPLAY_FILENAME));
+        BOOST_CHECK(reader.getKeyframes().size() == 3);
+        const ReplayKeyframe* keyframe = reader.seekKeyframe(9);
+        BOOST_CHECK(keyframe != nullptr);
+        BOOST_CHECK(keyframe->mTurn == 8);
+        ReplayRecordType type;
+        int32_t timestamp;
+        ODPacket packet;
+        BOOST_CHECK(reader.readRecord(type, timestamp, packet));
+        BOOST_CHECK(type == ReplayRecordType::keyframe);
+        BOOST_CHECK(!readUntilMessage(reader, 9));
+    }
+    //Test a file that is not a replay
+    {
+        std::ofstream os(REPLAY_FILENAME, std::ios::out | std::ios::binary | std::ios::trunc);
+        os << "Not a replay";
+        os.close();
+        ReplayReader reader;
+        BOOST_CHECK(!reader.open(REPLAY_FILENAME));
+    }
+    std::remove(REPLAY_FILENAME.c_str());
+}
@@ -0,0 +1,270 @@
+/*
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define BOOST_TEST_MODULE ReplaySeek
+#include "BoostTestTargetConfig.h"
+
+#include "entities/CreatureUpdateValues.h"
+#include "network/ODPacket.h"
+#include "network/ODSocketClient.h"
+#include "network/ReplayFile.h"
+#include "network/ServerNotification.h"
+#include "utils/LogManager.h"
+#include "utils/LogSinkConsole.h"
+
+#include <cstdio>
+#include <deque>
+#include <vector>
+
+namespace
+{
+const std::string REPLAY_FILENAME = "test_ReplaySeek.odr";
+const uint32_t ENTITY_NETWORK_ID = 1;
+
+//! \brief Client watching a replay with a single creature walking at 1 tile per second. It moves like the
+//! MovableGameEntity walk queues and its update values are refreshed like Creature::updateFromPacket does
+class ReplaySeekClient : public ODSocketClient
+{
+public:
+    ReplaySeekClient() :
+        mPosition(Ogre::Vector3::ZERO)
+    {}
+
+    bool openReplay(const std::string& filename)
+    { return replay(filename); }
+
+    Ogre::Vector3 mPosition;
+    std::deque<Ogre::Vector3> mWalkQueue;
+    CreatureUpdateValues mCreatureValues;
+
+protected:
+    bool processMessage(ServerNotificationType cmd, ODPacket& packetReceived) override
+    {
+        switch(cmd)
+        {
+            case ServerNotificationType::turnStarted:
+            {
+                int64_t turnNum;
+                BOOST_CHECK(packetReceived >> turnNum);
+                notifyTurnStarted(turnNum);
+                break;
+            }
+            case ServerNotificationType::animatedObjectSetWalkPath:
+            {
+                uint32_t networkId;
+                std::string walkAnim;
+                std::string endAnim;
+                bool loopEndAnim;
+                bool playIdleWhenAnimationEnds;
+                uint32_t nbDest;
+                BOOST_CHECK(packetReceived >> networkId >> walkAnim >> endAnim);
+                BOOST_CHECK(packetReceived >> loopEndAnim >> playIdleWhenAnimationEnds >> nbDest);
+                BOOST_CHECK(networkId == ENTITY_NETWORK_ID);
+                mWalkQueue.clear();
+                while(nbDest > 0)
+                {
+                    --nbDest;
+                    Ogre::Vector3 dest;
+                    BOOST_CHECK(packetReceived >> dest);
+                    mWalkQueue.push_back(dest);
+                }
+                break;
+            }
+            case ServerNotificationType::entitiesRefresh:
+            {
+                uint32_t nbCreature;
+                uint32_t networkId;
+                BOOST_CHECK(packetReceived >> nbCreature >> networkId);
+                BOOST_CHECK(nbCreature == 1);
+                BOOST_CHECK(networkId == ENTITY_NETWORK_ID);
+                uint16_t fields;
+                BOOST_CHECK(mCreatureValues.importFromPacket(packetReceived, fields));
+                break;
+            }
+            default:
+                BOOST_ERROR("Unexpected message");
+                break;
+        }
+        return true;
+    }
+
+    bool importReplayKeyframe(int64_t turnNum, ODPacket& is) override
+    {
+        uint32_t nbDest;
+        if(!(is >> mPosition >> nbDest))
+            return false;
+
+        mWalkQueue.clear();
+        while(nbDest > 0)
+        {
+            --nbDest;
+            Ogre::Vector3 dest;
+            if(!(is >> dest))
+                return false;
+            mWalkQueue.push_back(dest);
+        }
+
+        mCreatureValues = CreatureUpdateValues();
+        uint16_t fields;
+        return mCreatureValues.importFromPacket(is, fields);
+    }
+
+    void updateReplayAnimations(double timeSinceLastMessage) override
+    {
+        double moveDist = timeSinceLastMessage;
+        while((moveDist > 0.0) && !mWalkQueue.empty())
+        {
+            Ogre::Vector3 nextDest = mWalkQueue.front();
+            double distToNextDest = mPosition.distance(nextDest);
+            if(distToNextDest > moveDist)
+            {
+                Ogre::Vector3 walkDirection = nextDest - mPosition;
+                walkDirection.normalise();
+                mPosition += walkDirection * static_cast<Ogre::Real>(moveDist);
+                break;
+            }
+
+            mPosition = nextDest;
+            moveDist -= distToNextDest;
+            mWalkQueue.pop_front();
+        }
+    }
+};
+
+void writeTurnStarted(ReplayWriter& writer, int32_t timestamp, int64_t turnNum)
+{
+    ODPacket packet;
+    packet << ServerNotificationType::turnStarted << turnNum;
+    writer.writeMessage(timestamp, packet);
+}
+
+void writeWalkPath(ReplayWriter& writer, int32_t timestamp, const std::vector<Ogre::Vector3>& path)
+{
+    ODPacket packet;
+    const std::string walkAnim("Walk");
+    const std::string endAnim("Idle");
+    uint32_t nbDest = path.size();
+    packet << ServerNotificationType::animatedObjectSetWalkPath << ENTITY_NETWORK_ID << walkAnim << endAnim;
+    packet << true << true << nbDest;
+    for(const Ogre::Vector3& dest : path)
+        packet << dest;
+    writer.writeMessage(timestamp, packet);
+}
+
+//! \brief Writes a creature update containing the given fields like Creature::fireCreatureRefreshIfNeeded does
+void writeCreatureUpdate(ReplayWriter& writer, int32_t timestamp, const CreatureUpdateValues& values, uint16_t fields)
+{
+    ODPacket packet;
+    uint32_t nbCreature = 1;
+    packet << ServerNotificationType::entitiesRefresh << nbCreature << ENTITY_NETWORK_ID;
+    values.exportToPacket(packet, fields);
+    writer.writeMessage(timestamp, packet);
+}
+
+//! \brief The keyframes contain every creature update field like ODClient::exportReplayKeyframe
+void writeKeyframe(ReplayWriter& writer, int32_t timestamp, int64_t turnNum, const Ogre::Vector3& position,
+    const std::vector<Ogre::Vector3>& walkQueue, const CreatureUpdateValues& values)
+{
+    ODPacket packet;
+    uint32_t nbDest = walkQueue.size();
+    packet << position << nbDest;
+    for(const Ogre::Vector3& dest : walkQueue)
+        packet << dest;
+    values.exportToPacket(packet, CreatureUpdateFields::All);
+    writer.writeKeyframe(turnNum, timestamp, packet);
+}
+
+CreatureUpdateValues getCreatureValues(int seatPrisonId, uint32_t moodValue)
+{
+    CreatureUpdateValues values;
+    values.mLevel = 2;
+    values.mSeatId = 1;
+    values.mMoodValue = moodValue;
+    values.mGroundSpeed = 1.0;
+    values.mSeatPrisonId = seatPrisonId;
+    return values;
+}
+
+/*! \brief Writes 4 turns, one per second. The entity starts walking toward (10,0) at 200 ms. On turn 3, a
+ * keyframe is written while it is walking. At 2700 ms, it turns toward (2.5,5) while in (2.5,0).
+ * The creature is put in the prison of seat 2 at 1500 ms. After the keyframe of turn 3, only its mood changes
+ */
+void writeReplay()
+{
+    ReplayWriter writer;
+    BOOST_CHECK(writer.open(REPLAY_FILENAME));
+    CreatureUpdateValues values = getCreatureValues(-1, 0x0001);
+    writeTurnStarted(writer, 100, 1);
+    writeKeyframe(writer, 100, 1, Ogre::Vector3::ZERO, std::vector<Ogre::Vector3>(), values);
+    writeWalkPath(writer, 200, { Ogre::Vector3(10.0, 0.0, 0.0) });
+    writeTurnStarted(writer, 1200, 2);
+    values.mSeatPrisonId = 2;
+    writeCreatureUpdate(writer, 1500, values, CreatureUpdateFields::SeatPrisonId);
+    writeTurnStarted(writer, 2200, 3);
+    writeKeyframe(writer, 2200, 3, Ogre::Vector3(2.0, 0.0, 0.0), { Ogre::Vector3(10.0, 0.0, 0.0) }, values);
+    writeWalkPath(writer, 2700, { Ogre::Vector3(2.5, 5.0, 0.0) });
+    values.mMoodValue = 0x0004;
+    writeCreatureUpdate(writer, 2900, values, CreatureUpdateFields::Mood);
+    writeTurnStarted(writer, 3200, 4);
+    writer.close();
+}
+
+bool isPositionClose(const Ogre::Vector3& position, const Ogre::Vector3& expected)
+{
+    return position.distance(expected) < 0.001;
+}
+}
+
+BOOST_AUTO_TEST_CASE(test_ReplaySeek)
+{
+    LogManager logMgr;
+    logMgr.addSink(std::unique_ptr<LogSink>(new LogSinkConsole()));
+
+    writeReplay();
+    ReplaySeekClient client;
+    BOOST_CHECK(client.openReplay(REPLAY_FILENAME));
+
+    // From the keyframe of turn 1, the entity walks the second between 200 ms and 1200 ms
+    BOOST_CHECK(client.seekReplay(2));
+    BOOST_CHECK(client.getReplayTurn() == 2);
+    BOOST_CHECK(isPositionClose(client.mPosition, Ogre::Vector3(1.0, 0.0, 0.0)));
+    BOOST_CHECK(client.mCreatureValues.getChangedFields(getCreatureValues(-1, 0x0001)) == CreatureUpdateFields::Nothing);
+
+    // The keyframe of turn 3 is past the walk path start. The walk goes on from where it was when the keyframe was
+    // written and the new path starts from where the entity is when it is received
+    BOOST_CHECK(client.seekReplay(4));
+    BOOST_CHECK(client.getReplayTurn() == 4);
+    BOOST_CHECK(isPositionClose(client.mPosition, Ogre::Vector3(2.5, 0.5, 0.0)));
+    BOOST_CHECK(client.mWalkQueue.size() == 1);
+    // The prison seat is not in the updates received after the keyframe. It comes from the keyframe
+    BOOST_CHECK(client.mCreatureValues.getChangedFields(getCreatureValues(2, 0x0004)) == CreatureUpdateFields::Nothing);
+
+    // Seeking backward restores the previous keyframes the same way
+    BOOST_CHECK(client.seekReplay(3));
+    BOOST_CHECK(client.getReplayTurn() == 3);
+    BOOST_CHECK(isPositionClose(client.mPosition, Ogre::Vector3(2.0, 0.0, 0.0)));
+    BOOST_CHECK(client.mCreatureValues.getChangedFields(getCreatureValues(2, 0x0001)) == CreatureUpdateFields::Nothing);
+    BOOST_CHECK(client.seekReplay(2));
+    BOOST_CHECK(isPositionClose(client.mPosition, Ogre::Vector3(1.0, 0.0, 0.0)));
+    BOOST_CHECK(client.mCreatureValues.mSeatPrisonId == -1);
+
+    // Nothing can be reached before the first keyframe
+    BOOST_CHECK(!client.seekReplay(0));
+
+    client.disconnect(true);
+    std::remove(REPLAY_FILENAME.c_str());
+}
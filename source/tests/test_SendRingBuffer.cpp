@@ -0,0 +1,82 @@
+/*
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "network/SendRingBuffer.h"
+
+#define BOOST_TEST_MODULE SendRingBuffer
+#include "BoostTestTargetConfig.h"
+
+#include <algorithm>
+#include <string>
+
+namespace
+{
+//! \brief Pops everything from the buffer, as a socket taking chunkSize bytes at most per call would
+std::string popAll(SendRingBuffer& buffer, uint32_t chunkSize)
+{
+    std::string result;
+    while(!buffer.isEmpty())
+    {
+        uint32_t size;
+        const char* data = buffer.getFront(size);
+        size = std::min(size, chunkSize);
+        result.append(data, size);
+        buffer.pop(size);
+    }
+    return result;
+}
+}
+
+BOOST_AUTO_TEST_CASE(test_SendRingBuffer)
+{
+    SendRingBuffer buffer(8);
+    BOOST_CHECK(buffer.isEmpty());
+    BOOST_CHECK(buffer.getCapacity() == 8);
+
+    BOOST_CHECK(buffer.push("abcde", 5));
+    BOOST_CHECK(buffer.getSize() == 5);
+
+    // Not enough room: nothing is appended
+    BOOST_CHECK(!buffer.push("fghi", 4));
+    BOOST_CHECK(buffer.getSize() == 5);
+
+    // Partial writes
+    uint32_t size;
+    const char* data = buffer.getFront(size);
+    BOOST_CHECK(size == 5);
+    BOOST_CHECK(std::string(data, 2) == "ab");
+    buffer.pop(2);
+    BOOST_CHECK(buffer.getSize() == 3);
+
+    // The data wraps around the end of the buffer
+    BOOST_CHECK(buffer.push("fghij", 5));
+    BOOST_CHECK(buffer.getSize() == 8);
+    data = buffer.getFront(size);
+    BOOST_CHECK(size == 6);
+    BOOST_CHECK(std::string(data, size) == "cdefgh");
+    BOOST_CHECK(popAll(buffer, 3) == "cdefghij");
+    BOOST_CHECK(buffer.isEmpty());
+
+    // Once emptied, the buffer starts again from the beginning
+    BOOST_CHECK(buffer.push("12345678", 8));
+    data = buffer.getFront(size);
+    BOOST_CHECK(size == 8);
+    buffer.clear();
+    BOOST_CHECK(buffer.isEmpty());
+    BOOST_CHECK(buffer.getFront(size) == nullptr);
+    BOOST_CHECK(size == 0);
+}
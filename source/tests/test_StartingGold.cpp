@@ -0,0 +1,102 @@
+/*
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "mocks/ODClientTest.h"
+
+#include "game/SeatData.h"
+#include "utils/LogManager.h"
+#include "utils/LogSinkConsole.h"
+
+#define BOOST_TEST_MODULE TestStartingGold
+#include <BoostTestTargetConfig.h>
+
+class ODClientTestStartingGold : public ODClientTest
+{
+public:
+    ODClientTestStartingGold(const std::vector<PlayerInfo>& players, uint32_t indexLocalPlayer) :
+        ODClientTest(players, indexLocalPlayer)
+    {}
+};
+
+BOOST_AUTO_TEST_CASE(test_StartingGold)
+{
+    LogManager logMgr;
+    logMgr.addSink(std::unique_ptr<LogSink>(new LogSinkConsole()));
+    std::vector<PlayerInfo> players;
+
+    // We know we have seat id = 1, 2
+    int seatId = 1;
+    // We know we have team id = 1, 2
+    int32_t teamId = 1;
+    // The first player is the local one
+    for(uint32_t i = 0; i < 1; ++i)
+    {
+        PlayerInfo player;
+        player.mNick = "PlayerStub" + Helper::toString(seatId);
+        player.mWantedSeatId = seatId;
+        player.mWantedTeamId = teamId;
+        player.mIsHuman = true;
+        // The player id will be set by the server
+        player.mPlayerId = -1;
+        // We take faction index 0 for every player (keeper faction)
+        player.mWantedFactionIndex = 0;
+        players.push_back(player);
+        OD_LOG_INF("Adding player nick=" + player.mNick + ", id=" + Helper::toString(player.mPlayerId) + ", seatId=" + Helper::toString(player.mWantedSeatId));
+
+        ++seatId;
+        ++teamId;
+    }
+
+    // We add the AI players
+    for(uint32_t i = 0; i < 2; ++i)
+    {
+        PlayerInfo playerAi;
+        playerAi.mPlayerId = 0;
+        playerAi.mWantedSeatId = seatId;
+        playerAi.mWantedTeamId = teamId;
+        playerAi.mWantedFactionIndex = 0;
+        playerAi.mIsHuman = false;
+        players.push_back(playerAi);
+        OD_LOG_INF("Adding ai player id=" + Helper::toString(playerAi.mPlayerId) + ", seatId=" + Helper::toString(playerAi.mWantedSeatId));
+
+        ++seatId;
+        ++teamId;
+    }
+
+    ODClientTestStartingGold client(players, 0);
+    BOOST_CHECK(client.connect("localhost", 32222, 10, "test_StartingGoldReplay"));
+
+    BOOST_CHECK(client.isConnected());
+
+    // We run for 5s. That is enough for the game to be launched and the seat to be refreshed
+    client.runFor(5000);
+
+    if(!client.isConnected() || (client.getLocalSeat() == nullptr))
+    {
+        BOOST_CHECK(false);
+        return;
+    }
+
+    // The local seat starts with 1500 gold and a 2 tiles treasury (1000 gold per tile). The starting
+    // gold is deposited in the treasury and the seat gold is what the treasury contains
+    SeatData& seatLocal = *client.getLocalSeat();
+    OD_LOG_INF("gold local player=" + Helper::toString(seatLocal.getGold()) + "/" + Helper::toString(seatLocal.getGoldMax()));
+    BOOST_CHECK(seatLocal.getGold() == 1500);
+    BOOST_CHECK(seatLocal.getGoldMax() == 2000);
+
+    client.disconnect(false);
+}
@@ -17,6 +17,7 @@
 
 #include "mocks/ODClientTest.h"
 
+#include "entities/GameEntityType.h"
 #include "game/SeatData.h"
 #include "utils/LogManager.h"
 #include "utils/LogSinkConsole.h"
@@ -29,12 +30,28 @@ class ODClientTestCreatures : public ODClientTest
 public:
     ODClientTestCreatures(const std::vector<PlayerInfo>& players, uint32_t indexLocalPlayer) :
         ODClientTest(players, indexLocalPlayer),
-        mResultTest(false)
+        mResultTest(false),
+        mAwaitedTrapSeatId(-1),
+        mIsTrapRevealed(false)
     {}
 
     std::string mAwaitedEntityName;
     std::string mAwaitedEntityAnimation;
     bool mResultTest;
+    int32_t mAwaitedTrapSeatId;
+    bool mIsTrapRevealed;
+
+    virtual void entityAdded(GameEntityType type, int32_t seatId, const std::string& entityName) override
+    {
+        if(type != GameEntityType::trapEntity)
+            return;
+        if(seatId != mAwaitedTrapSeatId)
+            return;
+
+        mIsTrapRevealed = true;
+        if(mAwaitedEntityName.empty())
+            mContinueLoop = false;
+    }
 
     virtual void animationPlayed(const std::string& entityName, const std::string& animState, bool loop,
         bool playIdleWhenAnimationEnds, bool shouldSetWalkDirection, const Ogre::Vector3& walkDirection) override
@@ -143,10 +160,19 @@ BOOST_AUTO_TEST_CASE(test_Creatures)
     client.mResultTest = false;
     client.mAwaitedEntityName = "Wyvern3";
     client.mAwaitedEntityAnimation = "Die";
+    client.mAwaitedTrapSeatId = 0;
     client.runFor(5000);
 
     BOOST_CHECK(client.mResultTest);
 
+    // The local player saw the seat 0 trap kill its creature. The trap should have been revealed
+    client.mAwaitedEntityName.clear();
+    if(!client.mIsTrapRevealed)
+        client.runFor(2000);
+
+    BOOST_CHECK(client.mIsTrapRevealed);
+    client.mAwaitedTrapSeatId = -1;
+
     // We spawn a creature with hp=1 from seat 1 near the seat 1 traps and check it is not killed
     cmd = "addcreature 0 Wyvern4 Wyvern 8 15 0 Wyvern 1 0 1 100 0 0 none none 4 none 0";
     client.sendConsoleCmd(cmd);
@@ -50,22 +50,29 @@ void TrapTileData::fireSeatsSawTriggering()
         mTrapEntity->seatSawTriggering(seat);
 }
 
-void TrapTileData::seatSawTriggering(Seat* seat)
+bool TrapTileData::seatSawTriggering(Seat* seat)
 {
     if(std::find(mSeatsVision.begin(), mSeatsVision.end(), seat) != mSeatsVision.end())
-        return;
+        return false;
 
     mSeatsVision.push_back(seat);
     if(mTrapEntity == nullptr)
-        return;
+        return false;
 
     mTrapEntity->seatSawTriggering(seat);
+    return true;
 }
 
-void TrapTileData::seatsSawTriggering(const std::vector<Seat*>& seats)
+bool TrapTileData::seatsSawTriggering(const std::vector<Seat*>& seats)
 {
+    bool isRevealed = false;
     for(Seat* seat : seats)
-        seatSawTriggering(seat);
+    {
+        if(seatSawTriggering(seat))
+            isRevealed = true;
+    }
+
+    return isRevealed;
 }
 
 Trap::Trap(GameMap* gameMap) :
@@ -142,8 +149,11 @@ void Trap::doUpkeep()
             if(!trapTileData->decreaseShoot())
                 deactivate(tile);
 
+            // Entities are only notified on the tiles where something changed. If new seats saw
+            // the trap, they should get its entity
             const std::vector<Seat*>& seats = tile->getSeatsWithVision();
-            trapTileData->seatsSawTriggering(seats);
+            if(trapTileData->seatsSawTriggering(seats))
+                getGameMap()->tileEntitiesChanged(tile);
 
             for(Seat* seat : trapTileData->mSeatsVision)
                 seat->setVisibleBuildingOnTile(this, tile);
@@ -249,6 +259,13 @@ void Trap::activate(Tile* tile)
     trapTileData->setNbShootsBeforeDeactivation(mNbShootsBeforeDeactivation);
     trapTileData->setReloadTime(0);
 
+    // Some traps (like doors) block vision and movement depending on their state
+    if(getIsOnServerMap())
+    {
+        getGameMap()->tileVisionChanged(tile, true);
+        getGameMap()->tilePassabilityChanged(tile, true);
+    }
+
     BuildingObject* entity = getBuildingObjectFromTile(tile);
     if (entity == nullptr)
         return;
@@ -264,6 +281,13 @@ void Trap::deactivate(Tile* tile)
     TrapTileData* trapTileData = static_cast<TrapTileData*>(mTileData[tile]);
     trapTileData->setActivated(false);
 
+    // Some traps (like doors) block vision and movement depending on their state
+    if(getIsOnServerMap())
+    {
+        getGameMap()->tileVisionChanged(tile, true);
+        getGameMap()->tilePassabilityChanged(tile, true);
+    }
+
     BuildingObject* entity = getBuildingObjectFromTile(tile);
     if (entity == nullptr)
         return;
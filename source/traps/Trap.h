@@ -141,8 +141,10 @@ public:
     { mRemoveTrap = removeTrap; }
 
     void fireSeatsSawTriggering();
-    void seatSawTriggering(Seat* seat);
-    void seatsSawTriggering(const std::vector<Seat*>& seats);
+    //! \brief Adds the given seats to the ones that saw the trap. Returns true if the trap entity was
+    //! revealed to a seat that could not see it before. In this case, the seats should be notified again
+    bool seatSawTriggering(Seat* seat);
+    bool seatsSawTriggering(const std::vector<Seat*>& seats);
 
     double mClaimedValue;
 
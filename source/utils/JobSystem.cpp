@@ -0,0 +1,174 @@
+/*!
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "utils/JobSystem.h"
+
+#include <algorithm>
+
+JobSystem::JobSystem(uint32_t nbThreads) :
+    mNbJobsLeft(0),
+    mGeneration(0),
+    mIsStopping(false)
+{
+    if(nbThreads == 0)
+        nbThreads = std::max(1u, std::thread::hardware_concurrency());
+
+    for(uint32_t i = 0; i < nbThreads; ++i)
+        mQueues.emplace_back(new JobQueue);
+
+    // The queue 0 is used by the thread calling parallelFor
+    for(uint32_t i = 1; i < nbThreads; ++i)
+        mWorkers.emplace_back(&JobSystem::workerLoop, this, i);
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(mWakeMutex);
+        mIsStopping = true;
+    }
+    mWakeCondition.notify_all();
+
+    for(std::thread& worker : mWorkers)
+        worker.join();
+}
+
+void JobSystem::parallelFor(uint32_t count, uint32_t batchSize, const std::function<void(uint32_t)>& func)
+{
+    if(batchSize == 0)
+        batchSize = 1;
+
+    uint32_t nbJobs = (count + batchSize - 1) / batchSize;
+
+    // Not worth waking up the workers if there is only one job. The jobs get the same random
+    // streams as if they were run by the workers
+    if(mWorkers.empty() || (nbJobs <= 1))
+    {
+        for(uint32_t begin = 0; begin < count; begin += batchSize)
+        {
+            RandomStream random = Random::getCurrentStream().split();
+            Random::ScopedStream randomScope(random);
+            uint32_t end = std::min(count, begin + batchSize);
+            for(uint32_t index = begin; index < end; ++index)
+                func(index);
+        }
+
+        return;
+    }
+
+    // The random streams are split in the jobs order so that they do not depend on the threads
+    std::vector<RandomStream> randoms;
+    randoms.reserve(nbJobs);
+    for(uint32_t jobIndex = 0; jobIndex < nbJobs; ++jobIndex)
+        randoms.push_back(Random::getCurrentStream().split());
+
+    mNbJobsLeft = nbJobs;
+
+    // We spread the jobs over the queues. Threads that end up with the cheapest jobs will
+    // steal from the others
+    uint32_t nbQueues = getNbThreads();
+    for(uint32_t queueIndex = 0; queueIndex < nbQueues; ++queueIndex)
+    {
+        JobQueue& queue = *mQueues[queueIndex];
+        std::lock_guard<std::mutex> lock(queue.mMutex);
+        for(uint32_t jobIndex = queueIndex; jobIndex < nbJobs; jobIndex += nbQueues)
+        {
+            uint32_t begin = jobIndex * batchSize;
+            queue.mJobs.push_back(Job{&func, begin, std::min(count, begin + batchSize), randoms[jobIndex]});
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mWakeMutex);
+        ++mGeneration;
+    }
+    mWakeCondition.notify_all();
+
+    runJobs(0);
+
+    // Some jobs may still be running on the workers
+    std::unique_lock<std::mutex> lock(mDoneMutex);
+    mDoneCondition.wait(lock, [this]() { return mNbJobsLeft.load() == 0; });
+}
+
+void JobSystem::workerLoop(uint32_t queueIndex)
+{
+    uint64_t generation = 0;
+    while(true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mWakeMutex);
+            mWakeCondition.wait(lock, [this, generation]() { return mIsStopping || (mGeneration != generation); });
+            if(mIsStopping)
+                return;
+
+            generation = mGeneration;
+        }
+
+        runJobs(queueIndex);
+    }
+}
+
+void JobSystem::runJobs(uint32_t queueIndex)
+{
+    Job job;
+    while(popJob(queueIndex, job) || stealJob(queueIndex, job))
+    {
+        {
+            Random::ScopedStream randomScope(job.mRandom);
+            for(uint32_t index = job.mBegin; index < job.mEnd; ++index)
+                (*job.mFunc)(index);
+        }
+
+        if(mNbJobsLeft.fetch_sub(1) != 1)
+            continue;
+
+        // That was the last job. We wake up the thread waiting in parallelFor
+        std::lock_guard<std::mutex> lock(mDoneMutex);
+        mDoneCondition.notify_all();
+    }
+}
+
+bool JobSystem::popJob(uint32_t queueIndex, Job& job)
+{
+    JobQueue& queue = *mQueues[queueIndex];
+    std::lock_guard<std::mutex> lock(queue.mMutex);
+    if(queue.mJobs.empty())
+        return false;
+
+    job = queue.mJobs.front();
+    queue.mJobs.pop_front();
+    return true;
+}
+
+bool JobSystem::stealJob(uint32_t thiefIndex, Job& job)
+{
+    uint32_t nbQueues = getNbThreads();
+    for(uint32_t i = 1; i < nbQueues; ++i)
+    {
+        JobQueue& queue = *mQueues[(thiefIndex + i) % nbQueues];
+        std::lock_guard<std::mutex> lock(queue.mMutex);
+        if(queue.mJobs.empty())
+            continue;
+
+        job = queue.mJobs.back();
+        queue.mJobs.pop_back();
+        return true;
+    }
+
+    return false;
+}
@@ -0,0 +1,97 @@
+/*!
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef JOBSYSTEM_H
+#define JOBSYSTEM_H
+
+#include "utils/Random.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//! \brief Runs jobs on a pool of worker threads. Each thread has its own queue of jobs. It takes
+//! the jobs from the front of its queue and, once it is empty, steals jobs from the back of the
+//! queues of the other threads. The thread calling parallelFor takes part in the work and
+//! returns only when every job is done.
+//! Jobs are run in no particular order. They should only write data owned by the index they are
+//! given so that the result does not depend on which thread ran them. Each job draws its random
+//! numbers from its own stream, split from the calling thread one when the job is queued.
+class JobSystem
+{
+public:
+    //! \brief nbThreads is the number of threads running the jobs, including the one calling
+    //! parallelFor. If 0, the number of hardware threads is used
+    explicit JobSystem(uint32_t nbThreads);
+    ~JobSystem();
+
+    inline uint32_t getNbThreads() const
+    { return static_cast<uint32_t>(mQueues.size()); }
+
+    //! \brief Calls func(index) for each index in [0, count). Indexes are grouped in jobs of
+    //! batchSize indexes. Returns once func has been called for every index
+    void parallelFor(uint32_t count, uint32_t batchSize, const std::function<void(uint32_t)>& func);
+
+private:
+    struct Job
+    {
+        const std::function<void(uint32_t)>* mFunc;
+        uint32_t mBegin;
+        uint32_t mEnd;
+        RandomStream mRandom;
+    };
+
+    struct JobQueue
+    {
+        std::mutex mMutex;
+        std::deque<Job> mJobs;
+    };
+
+    //! \brief One queue per thread. The queue 0 belongs to the thread calling parallelFor
+    std::vector<std::unique_ptr<JobQueue>> mQueues;
+    std::vector<std::thread> mWorkers;
+
+    //! \brief Number of jobs queued by the current parallelFor and not finished yet
+    std::atomic<uint32_t> mNbJobsLeft;
+
+    //! \brief Workers wait on mWakeCondition until mGeneration changes (a parallelFor
+    //! queued jobs) or until mIsStopping is set
+    std::mutex mWakeMutex;
+    std::condition_variable mWakeCondition;
+    uint64_t mGeneration;
+    bool mIsStopping;
+
+    //! \brief The thread calling parallelFor waits on mDoneCondition until mNbJobsLeft is 0
+    std::mutex mDoneMutex;
+    std::condition_variable mDoneCondition;
+
+    void workerLoop(uint32_t queueIndex);
+
+    //! \brief Runs jobs from the given queue and steals from the others until no job is left
+    void runJobs(uint32_t queueIndex);
+
+    bool popJob(uint32_t queueIndex, Job& job);
+    bool stealJob(uint32_t thiefIndex, Job& job);
+};
+
+#endif // JOBSYSTEM_H
@@ -0,0 +1,331 @@
+/*
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "utils/Profiler.h"
+
+#include "utils/Helper.h"
+#include "utils/LogManager.h"
+
+#include <boost/thread/tss.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+//! \brief Number of turns kept to compute the percentiles
+const uint32_t PROFILER_WINDOW_TURNS = 200;
+//! \brief The summary is logged every PROFILER_SUMMARY_PERIOD_TURNS turns
+const uint32_t PROFILER_SUMMARY_PERIOD_TURNS = 100;
+//! \brief If endTurn is not called, threads stop recording zones after this many
+const uint32_t PROFILER_MAX_ZONES_PER_THREAD = 1 << 20;
+
+struct ZoneEvent
+{
+    const char* mName;
+    uint64_t mStart;
+    uint64_t mDuration;
+};
+
+struct ThreadBuffer
+{
+    explicit ThreadBuffer(uint32_t threadIndex) :
+        mThreadIndex(threadIndex)
+    {
+    }
+
+    const uint32_t mThreadIndex;
+    //! \brief Only locked by the owning thread and endTurn so it is almost never contended
+    std::mutex mMutex;
+    std::vector<ZoneEvent> mEvents;
+};
+
+//! \brief Time spent in a zone during one turn
+struct TurnSample
+{
+    uint64_t mTime = 0;
+    uint32_t mNbCalls = 0;
+};
+
+struct ProfilerData
+{
+    std::atomic<bool> mIsEnabled{false};
+
+    //! \brief Buffers are never deleted so that endTurn can read the ones of finished threads
+    std::mutex mBuffersMutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> mBuffers;
+
+    //! \brief Protects the members below
+    std::mutex mMutex;
+    std::ofstream mTraceFile;
+    bool mIsFirstTraceEvent = true;
+    //! \brief Last turns samples for each zone, the most recent last
+    std::map<std::string, std::deque<TurnSample>> mZones;
+    uint32_t mNbTurns = 0;
+};
+
+ProfilerData& getData()
+{
+    static ProfilerData data;
+    return data;
+}
+
+void noCleanup(ThreadBuffer*)
+{
+    // The buffers are owned by ProfilerData
+}
+
+ThreadBuffer& getThreadBuffer()
+{
+    static boost::thread_specific_ptr<ThreadBuffer> threadBuffer(&noCleanup);
+    ThreadBuffer* buffer = threadBuffer.get();
+    if(buffer != nullptr)
+        return *buffer;
+
+    ProfilerData& data = getData();
+    std::lock_guard<std::mutex> lock(data.mBuffersMutex);
+    data.mBuffers.emplace_back(new ThreadBuffer(static_cast<uint32_t>(data.mBuffers.size())));
+    buffer = data.mBuffers.back().get();
+    threadBuffer.reset(buffer);
+    return *buffer;
+}
+
+std::string escapeJson(const char* str)
+{
+    std::string escaped;
+    for(; *str != 0; ++str)
+    {
+        if((*str == '"') || (*str == '\\'))
+            escaped += '\\';
+        escaped += *str;
+    }
+    return escaped;
+}
+
+void writeTraceEvent(ProfilerData& data, const std::string& event)
+{
+    if(!data.mIsFirstTraceEvent)
+        data.mTraceFile << ",\n";
+    data.mIsFirstTraceEvent = false;
+    data.mTraceFile << event;
+}
+
+//! \brief Nearest rank percentile of the given sorted values
+uint64_t percentile(const std::vector<uint64_t>& sortedValues, uint32_t percent)
+{
+    if(sortedValues.empty())
+        return 0;
+
+    std::size_t rank = (sortedValues.size() * percent + 99) / 100;
+    return sortedValues[std::max<std::size_t>(rank, 1) - 1];
+}
+}
+
+namespace Profiler
+{
+bool isEnabled()
+{
+    return getData().mIsEnabled.load(std::memory_order_relaxed);
+}
+
+void setEnabled(bool enabled)
+{
+    ProfilerData& data = getData();
+    if(enabled)
+    {
+        // We forget what was recorded before
+        {
+            std::lock_guard<std::mutex> lock(data.mBuffersMutex);
+            for(std::unique_ptr<ThreadBuffer>& buffer : data.mBuffers)
+            {
+                std::lock_guard<std::mutex> bufferLock(buffer->mMutex);
+                buffer->mEvents.clear();
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(data.mMutex);
+        data.mZones.clear();
+        data.mNbTurns = 0;
+    }
+    data.mIsEnabled.store(enabled);
+    OD_LOG_INF(std::string("Profiler ") + (enabled ? "enabled" : "disabled"));
+}
+
+bool startTrace(const std::string& filename)
+{
+    ProfilerData& data = getData();
+    std::lock_guard<std::mutex> lock(data.mMutex);
+    if(data.mTraceFile.is_open())
+    {
+        OD_LOG_WRN("A profiler trace is already being written");
+        return false;
+    }
+
+    data.mTraceFile.open(filename.c_str(), std::ios_base::out | std::ios_base::trunc);
+    if(!data.mTraceFile.is_open())
+    {
+        OD_LOG_ERR("Cannot open profiler trace file " + filename);
+        return false;
+    }
+
+    data.mTraceFile << "{\"traceEvents\":[\n";
+    data.mIsFirstTraceEvent = true;
+    OD_LOG_INF("Writing profiler trace to " + filename);
+    return true;
+}
+
+void stopTrace()
+{
+    ProfilerData& data = getData();
+    std::lock_guard<std::mutex> lock(data.mMutex);
+    if(!data.mTraceFile.is_open())
+        return;
+
+    data.mTraceFile << "\n]}\n";
+    data.mTraceFile.close();
+    OD_LOG_INF("Profiler trace closed");
+}
+
+void endTurn(int64_t turnNumber)
+{
+    ProfilerData& data = getData();
+    if(!isEnabled())
+        return;
+
+    std::vector<ThreadBuffer*> buffers;
+    {
+        std::lock_guard<std::mutex> lock(data.mBuffersMutex);
+        for(std::unique_ptr<ThreadBuffer>& buffer : data.mBuffers)
+            buffers.push_back(buffer.get());
+    }
+
+    bool isSummaryDue = false;
+    {
+        std::lock_guard<std::mutex> lock(data.mMutex);
+        bool isTracing = data.mTraceFile.is_open();
+        if(isTracing)
+        {
+            writeTraceEvent(data, "{\"name\":\"turn " + Helper::toString(turnNumber)
+                + "\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":0,\"ts\":" + Helper::toString(getTime()) + "}");
+        }
+
+        std::map<std::string, TurnSample> turnSamples;
+        std::vector<ZoneEvent> events;
+        for(ThreadBuffer* buffer : buffers)
+        {
+            events.clear();
+            {
+                std::lock_guard<std::mutex> bufferLock(buffer->mMutex);
+                events.swap(buffer->mEvents);
+            }
+
+            // Zones from the same call site share the same pointer. We convert each name once
+            const char* lastName = nullptr;
+            TurnSample* lastSample = nullptr;
+            for(const ZoneEvent& event : events)
+            {
+                if(event.mName != lastName)
+                {
+                    lastName = event.mName;
+                    lastSample = &turnSamples[lastName];
+                }
+                lastSample->mTime += event.mDuration;
+                ++lastSample->mNbCalls;
+
+                if(!isTracing)
+                    continue;
+
+                writeTraceEvent(data, "{\"name\":\"" + escapeJson(event.mName) + "\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+                    + Helper::toString(buffer->mThreadIndex) + ",\"ts\":" + Helper::toString(event.mStart)
+                    + ",\"dur\":" + Helper::toString(event.mDuration) + "}");
+            }
+        }
+
+        // Zones that were not run during this turn get an empty sample
+        for(std::pair<const std::string, std::deque<TurnSample>>& zone : data.mZones)
+        {
+            if(turnSamples.count(zone.first) == 0)
+                zone.second.push_back(TurnSample());
+        }
+
+        for(const std::pair<const std::string, TurnSample>& sample : turnSamples)
+            data.mZones[sample.first].push_back(sample.second);
+
+        for(std::pair<const std::string, std::deque<TurnSample>>& zone : data.mZones)
+        {
+            while(zone.second.size() > PROFILER_WINDOW_TURNS)
+                zone.second.pop_front();
+        }
+
+        ++data.mNbTurns;
+        isSummaryDue = ((data.mNbTurns % PROFILER_SUMMARY_PERIOD_TURNS) == 0);
+    }
+
+    if(isSummaryDue)
+        logSummary();
+}
+
+void logSummary()
+{
+    ProfilerData& data = getData();
+    std::lock_guard<std::mutex> lock(data.mMutex);
+    OD_LOG_INF("Profiler summary over the last " + Helper::toString(std::min(data.mNbTurns, PROFILER_WINDOW_TURNS))
+        + " turns (microseconds per turn)");
+    for(const std::pair<const std::string, std::deque<TurnSample>>& zone : data.mZones)
+    {
+        std::vector<uint64_t> times;
+        uint64_t nbCalls = 0;
+        for(const TurnSample& sample : zone.second)
+        {
+            times.push_back(sample.mTime);
+            nbCalls += sample.mNbCalls;
+        }
+        std::sort(times.begin(), times.end());
+
+        OD_LOG_INF("Profiler zone=" + zone.first
+            + ", p50=" + Helper::toString(percentile(times, 50))
+            + ", p90=" + Helper::toString(percentile(times, 90))
+            + ", p99=" + Helper::toString(percentile(times, 99))
+            + ", max=" + Helper::toString(times.empty() ? 0 : times.back())
+            + ", calls per turn=" + Helper::toString(times.empty() ? 0 : nbCalls / static_cast<uint64_t>(times.size())));
+    }
+}
+
+uint64_t getTime()
+{
+    static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count());
+}
+
+void recordZone(const char* name, uint64_t start, uint64_t end)
+{
+    ThreadBuffer& buffer = getThreadBuffer();
+    std::lock_guard<std::mutex> lock(buffer.mMutex);
+    if(buffer.mEvents.size() >= PROFILER_MAX_ZONES_PER_THREAD)
+        return;
+
+    buffer.mEvents.push_back(ZoneEvent{name, start, end - start});
+}
+}
@@ -0,0 +1,85 @@
+/*
+ *  Copyright (C) 2011-2016  OpenDungeons Team
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <cstdint>
+#include <string>
+
+#define OD_PROFILE_CONCAT_IMPL(_a, _b)  _a##_b
+#define OD_PROFILE_CONCAT(_a, _b)       OD_PROFILE_CONCAT_IMPL(_a, _b)
+
+//! \brief Measures the time spent in the current scope under the given zone name. Only the pointer
+//! is kept so the name should be a string literal
+#define OD_PROFILE_ZONE(_name)          Profiler::ScopedZone OD_PROFILE_CONCAT(odProfileZone, __LINE__)(_name)
+
+//! \brief Scoped zones profiler. When enabled, each zone is recorded in a buffer owned by the thread
+//! running it. At the end of each turn (see endTurn), the zones of every thread are gathered. They
+//! are written to the Chrome trace file if one is opened (it can be loaded in chrome://tracing) and
+//! the time spent in each zone during the turn is kept for the last turns to log percentiles.
+//! When disabled, a zone only costs a check of the enabled flag.
+namespace Profiler
+{
+    bool isEnabled();
+
+    //! \brief Enabling the profiler resets the turns statistics
+    void setEnabled(bool enabled);
+
+    //! \brief Writes the zones recorded from now on to the given file in the Chrome trace format.
+    //! Returns false if the file cannot be opened
+    bool startTrace(const std::string& filename);
+    void stopTrace();
+
+    //! \brief Gathers the zones recorded by every thread since the last call. Should be called once
+    //! per turn by the thread running the turns, outside of any zone
+    void endTurn(int64_t turnNumber);
+
+    //! \brief Logs, for each zone, the percentiles of the time spent per turn over the last turns
+    void logSummary();
+
+    //! \brief Microseconds elapsed since the profiler was first used
+    uint64_t getTime();
+
+    //! \brief Adds a zone to the buffer of the current thread
+    void recordZone(const char* name, uint64_t start, uint64_t end);
+
+    class ScopedZone
+    {
+    public:
+        explicit ScopedZone(const char* name) :
+            mName(isEnabled() ? name : nullptr),
+            mStart(mName != nullptr ? getTime() : 0)
+        {
+        }
+
+        ~ScopedZone()
+        {
+            if(mName != nullptr)
+                recordZone(mName, mStart, getTime());
+        }
+
+    private:
+        const char* mName;
+        uint64_t mStart;
+
+        ScopedZone(const ScopedZone&) = delete;
+        ScopedZone& operator=(const ScopedZone&) = delete;
+    };
+}
+
+#endif // PROFILER_H
@@ -23,88 +23,182 @@
 #include "utils/Random.h"
 #include "utils/Helper.h"
 
+#include <boost/thread/tss.hpp>
+
 #include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <ctime>
 
-unsigned long myRandomSeed;
-const unsigned long MAX = 32768;
-
-static unsigned long randgen()
+//! \brief Used to build the xoshiro state from a single seed, as advised by its authors
+static uint64_t splitMix64(uint64_t& x)
 {
-    myRandomSeed = myRandomSeed * 1103515245 + 12345;
-    //TODO: What is the purpose of the cast?
-    unsigned long returnVal = static_cast<unsigned int>(myRandomSeed / 65536) % MAX;
-
-    return returnVal;
+    uint64_t z = (x += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
 }
 
-//! \brief uniformly distributed number [0;1)
-static double uniform()
+static inline uint64_t rotl(uint64_t x, int k)
 {
-    return randgen() * 1.0 / static_cast<double>(MAX);
+    return (x << k) | (x >> (64 - k));
 }
 
-//! \brief uniformly distributed number [lo;hi)
-static double uniform(double lo, double hi)
+RandomStream::RandomStream(uint64_t seed)
 {
-    return uniform() * (hi - lo) + lo;
+    this->seed(seed);
 }
 
-//! \brief random integer [lo;hi]
-static int randint(int lo, int hi)
+void RandomStream::seed(uint64_t seed)
 {
-    return static_cast<int>(uniform() * (hi - lo + 1) + lo);
+    for(uint64_t& state : mState)
+        state = splitMix64(seed);
 }
 
-//! \brief random unsigned integer [lo;hi]
-static unsigned int randuint(unsigned int lo, unsigned int hi)
+uint64_t RandomStream::next()
 {
-    return static_cast<unsigned int>(uniform() * (hi - lo + 1) + lo);
-}
+    const uint64_t result = rotl(mState[1] * 5, 7) * 9;
+    const uint64_t t = mState[1] << 17;
 
+    mState[2] ^= mState[0];
+    mState[3] ^= mState[1];
+    mState[1] ^= mState[2];
+    mState[0] ^= mState[3];
 
-namespace Random
-{
+    mState[2] ^= t;
+    mState[3] = rotl(mState[3], 45);
 
-void initialize()
+    return result;
+}
+
+RandomStream RandomStream::split()
 {
-    myRandomSeed = static_cast<unsigned long>(std::time(0));
+    return RandomStream(next());
 }
 
-double Double(double min, double max)
+double RandomStream::Double(double min, double max)
 {
     if (min > max)
     {
         std::swap(min, max);
     }
 
-    return uniform(min, max);
+    // The 53 highest bits give a uniformly distributed number in [0;1)
+    double uniform = static_cast<double>(next() >> 11) * (1.0 / 9007199254740992.0);
+    return uniform * (max - min) + min;
 }
 
-int Int(int min, int max)
+int RandomStream::Int(int min, int max)
 {
     if (min > max)
     {
         std::swap(min, max);
     }
 
-    return randint(min, max);
+    uint64_t range = static_cast<uint64_t>(static_cast<int64_t>(max) - static_cast<int64_t>(min)) + 1;
+    return static_cast<int>(static_cast<int64_t>(min) + static_cast<int64_t>(next() % range));
 }
 
-unsigned int Uint(unsigned int min, unsigned int max)
+unsigned int RandomStream::Uint(unsigned int min, unsigned int max)
 {
     if (min > max)
     {
         std::swap(min, max);
     }
 
-    return randuint(min, max);
+    uint64_t range = static_cast<uint64_t>(max - min) + 1;
+    return min + static_cast<unsigned int>(next() % range);
+}
+
+double RandomStream::gaussianRandomDouble()
+{
+    // We use 1 - x to avoid log(0)
+    return std::sqrt(-2.0 * log(1.0 - Double(0.0, 1.0))) * cos(2.0 * PI * Double(0.0, 1.0));
+}
+
+namespace
+{
+//! \brief Streams of a thread. mCurrentStream is the default one unless a ScopedStream is alive
+struct ThreadStreams
+{
+    explicit ThreadStreams(uint64_t seed) :
+        mDefaultStream(seed),
+        mCurrentStream(&mDefaultStream)
+    {}
+
+    RandomStream mDefaultStream;
+    RandomStream* mCurrentStream;
+};
+
+boost::thread_specific_ptr<ThreadStreams> gThreadStreams;
+
+//! \brief Seed given to initialize. Each thread default stream is seeded from it and the order
+//! the thread asked for its first number
+std::atomic<uint64_t> gSeed(0);
+std::atomic<uint64_t> gNbThreadStreams(0);
+
+ThreadStreams& getThreadStreams()
+{
+    ThreadStreams* streams = gThreadStreams.get();
+    if(streams == nullptr)
+    {
+        streams = new ThreadStreams(gSeed.load() + gNbThreadStreams.fetch_add(1));
+        gThreadStreams.reset(streams);
+    }
+    return *streams;
+}
+}
+
+namespace Random
+{
+
+void initialize()
+{
+    initialize(static_cast<uint64_t>(std::time(0)));
+}
+
+void initialize(uint64_t seed)
+{
+    gSeed = seed;
+    gNbThreadStreams = 0;
+    getThreadStreams().mDefaultStream.seed(seed + gNbThreadStreams.fetch_add(1));
+}
+
+RandomStream& getCurrentStream()
+{
+    return *getThreadStreams().mCurrentStream;
+}
+
+ScopedStream::ScopedStream(RandomStream& stream)
+{
+    ThreadStreams& streams = getThreadStreams();
+    mPreviousStream = streams.mCurrentStream;
+    streams.mCurrentStream = &stream;
+}
+
+ScopedStream::~ScopedStream()
+{
+    getThreadStreams().mCurrentStream = mPreviousStream;
+}
+
+double Double(double min, double max)
+{
+    return getCurrentStream().Double(min, max);
+}
+
+int Int(int min, int max)
+{
+    return getCurrentStream().Int(min, max);
+}
+
+unsigned int Uint(unsigned int min, unsigned int max)
+{
+    return getCurrentStream().Uint(min, max);
 }
 
 double gaussianRandomDouble()
 {
-    return std::sqrt(-2.0 * log(Double(0.0, 1.0))) * cos(2.0 * PI * Double(0.0, 1.0));
+    return getCurrentStream().gaussianRandomDouble();
 }
 
 } // namespace Random
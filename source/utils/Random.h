@@ -23,11 +23,65 @@
 #ifndef RANDOM_H_
 #define RANDOM_H_
 
+#include <cstdint>
+
+//! \brief Stream of pseudo random numbers (xoshiro256**). The same seed always gives the same
+//! numbers. A stream must not be used by several threads at the same time: each thread (or job)
+//! should use its own, for example one created with split
+class RandomStream
+{
+public:
+    explicit RandomStream(uint64_t seed = 0);
+
+    //! \brief Restarts the stream from the given seed
+    void seed(uint64_t seed);
+
+    //! \brief Returns the next 64 random bits
+    uint64_t next();
+
+    //! \brief Returns a new stream seeded from this one. Used to give each parallel job its own
+    //! stream while keeping the results independent from the threads
+    RandomStream split();
+
+    //! \brief Same as the Random functions below but drawing from this stream
+    double Double(double min, double max);
+    int Int(int min, int max);
+    unsigned int Uint(unsigned int min, unsigned int max);
+    double gaussianRandomDouble();
+
+private:
+    uint64_t mState[4];
+};
+
+//! \brief The functions of this namespace draw from the current stream of the calling thread.
+//! By default, each thread has its own stream seeded from the seed given to initialize. The
+//! server binds the gamemap stream (see ScopedStream) so that a game started with the same seed
+//! gives the same results
 namespace Random
 {
-    //! \brief initializes the semaphore and seeds the generator
+    //! \brief Seeds the threads streams from the current time
     void initialize();
 
+    //! \brief Seeds the threads streams from the given seed
+    void initialize(uint64_t seed);
+
+    //! \brief Returns the stream used by the calling thread
+    RandomStream& getCurrentStream();
+
+    //! \brief Makes the given stream the current stream of the calling thread until destroyed
+    class ScopedStream
+    {
+    public:
+        explicit ScopedStream(RandomStream& stream);
+        ~ScopedStream();
+
+    private:
+        RandomStream* mPreviousStream;
+
+        ScopedStream(const ScopedStream&) = delete;
+        ScopedStream& operator=(const ScopedStream&) = delete;
+    };
+
     /*! \brief generate a random double
      *
      *  \param min, max One or both can be negative
@@ -84,7 +84,9 @@ const std::string ResourceManager::RESOURCEGROUPSOUND = "Sound";
  */
 ResourceManager::ResourceManager(boost::program_options::variables_map& options) :
         mServerMode(false),
+        mServerFullSpeed(false),
         mForcedNetworkPort(-1),
+        mForcedRandomSeed(0),
         mLogLevel(LogMessageLevel::NORMAL),
         mGameDataPath("./"),
         mUserDataPath("./"),
@@ -425,10 +427,18 @@ void ResourceManager::setupUserDataFolders(boost::program_options::variables_map
         }
     }
 
+    itOption = options.find("fullspeed");
+    if(itOption != options.end())
+        mServerFullSpeed = true;
+
     itOption = options.find("port");
     if(itOption != options.end())
         mForcedNetworkPort = itOption->second.as<int32_t>();
 
+    itOption = options.find("seed");
+    if(itOption != options.end())
+        mForcedRandomSeed = itOption->second.as<uint64_t>();
+
     itOption = options.find("loglevel");
     if(itOption != options.end())
         mLogLevel = static_cast<LogMessageLevel>(itOption->second.as<int32_t>());
@@ -576,7 +586,9 @@ void ResourceManager::buildCommandOptions(boost::program_options::options_descri
         ("serversave", boost::program_options::value<std::string>(), "Launches the game on server mode and opens the given saved game")
         ("appData", boost::program_options::value<std::string>(), "Sets appData to the given path (where logs, replays, ... are saved)")
         ("mscreator", boost::program_options::value<std::string>(), "Sets the creator for this map to connect to the master server. server/servercustom/serversave option needs to be on")
+        ("fullspeed", "Server mode only. Runs the game turns one after the other without waiting for the turn duration")
         ("port", boost::program_options::value<int32_t>(), "Sets the port used. Note that the port is used for both single and multi player")
+        ("seed", boost::program_options::value<uint64_t>(), "Sets the seed of the game random numbers (server side) to replay the same game")
         ("loglevel", boost::program_options::value<int32_t>(), "Sets the log level (between 0=Trivial and 3=Critical)")
     ;
 }
@@ -145,9 +145,17 @@ public:
     inline const std::string& getServerModeCreator() const
     { return mServerModeCreator; }
 
+    //! \brief Whether the server should run the turns as fast as it can instead of following turnsPerSecond
+    inline bool isServerFullSpeed() const
+    { return mServerFullSpeed; }
+
     inline int32_t getForcedNetworkPort() const
     { return mForcedNetworkPort; }
 
+    //! \brief Seed of the game random numbers given on the command line (0 if none)
+    inline uint64_t getForcedRandomSeed() const
+    { return mForcedRandomSeed; }
+
     inline LogMessageLevel getLogLevel() const
     { return mLogLevel; }
 
@@ -156,10 +164,14 @@ private:
     bool mServerMode;
     std::string mServerModeLevel;
     std::string mServerModeCreator;
+    bool mServerFullSpeed;
 
     //! \brief used when the network port is forced
     int32_t mForcedNetworkPort;
 
+    //! \brief used when the random seed is forced
+    uint64_t mForcedRandomSeed;
+
     //! \brief The log level
     LogMessageLevel mLogLevel;
 